@@ -15,10 +15,36 @@
 
 #include "util.h"
 #include "net.h"
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
 
 
 #define REQHEADMAX     32                // maximum number of request headers of HTTP
 #define MINIBNUM       31                // bucket number of map for trivial use
+#define SCANUNIT       1024              // number of records fetched by each scan
+
+typedef struct {                         // type of structure for a bench thread
+  TCMDB *mdb;                            // database object
+  int id;                                // thread ID
+  int tnum;                              // number of threads
+  int rnum;                              // number of records
+  bool rnd;                              // whether keys are random
+  bool get;                              // whether to retrieve records
+  int hnum;                              // number of hit records
+} BENCHARG;
+
+typedef struct {                         // type of structure for a network bench thread
+  const char *host;                      // name of the server
+  int port;                              // port number
+  int id;                                // thread ID
+  int tnum;                              // number of threads
+  int rnum;                              // number of records
+  int vsiz;                              // size of each value
+  int pnum;                              // number of pipelined requests
+  bool get;                              // whether to retrieve records
+  int hnum;                              // number of hit records
+  bool err;                              // whether an error occurred
+} NETBENCHARG;
 
 
 /* global variables */
@@ -33,6 +59,7 @@ static int sepstrtochr(const char *str);
 static char *strtozsv(const char *str, int sep, int *sp);
 static int printdata(const char *ptr, int size, bool px, int sep);
 static char *mygetline(FILE *ifp);
+static int myrand(int range);
 static bool myopen(TCRDB *rdb, const char *host, int port);
 static bool mysetmst(TCRDB *rdb, const char *host, int port, uint64_t ts, int opts);
 static int runinform(int argc, char **argv);
@@ -48,16 +75,18 @@ static int runrestore(int argc, char **argv);
 static int runsetmst(int argc, char **argv);
 static int runrepl(int argc, char **argv);
 static int runhttp(int argc, char **argv);
+static int runbench(int argc, char **argv);
+static int runnetbench(int argc, char **argv);
 static int runversion(int argc, char **argv);
 static int procinform(const char *host, int port, bool st);
 static int procput(const char *host, int port, const char *kbuf, int ksiz,
-                   const char *vbuf, int vsiz, int dmode);
+                   const char *vbuf, int vsiz, int dmode, int xtime);
 static int procout(const char *host, int port, const char *kbuf, int ksiz);
 static int procget(const char *host, int port, const char *kbuf, int ksiz, int sep,
-                   bool px, bool pz);
+                   bool px, bool pz, bool cmp);
 static int procmget(const char *host, int port, const TCLIST *keys, int sep, bool px);
 static int proclist(const char *host, int port, int sep, int max, bool pv, bool px,
-                    const char *fmstr);
+                    const char *rbstr, const char *restr, const char *fmstr);
 static int procvanish(const char *host, int port);
 static int procmisc(const char *host, int port, const char *func, int opts,
                     const TCLIST *args, int sep, bool px);
@@ -68,7 +97,17 @@ static int procsetmst(const char *host, int port, const char *mhost, int mport,
                       uint64_t ts, int opts);
 static int procrepl(const char *host, int port, uint64_t ts, uint32_t sid, bool ph);
 static int prochttp(const char *url, TCMAP *hmap, bool ih);
+static int procbench(int rnum, int bnum, int mnum, int mopts, int mpopts, bool rnd, int thnum);
+static int procnetbench(const char *host, int port, int rnum, int vsiz, int pnum, int cnum,
+                        int thnum);
 static int procversion(void);
+static void *threadbench(void *targ);
+static void *threadnetbench(void *targ);
+static bool pipenetbench(NETBENCHARG *arg);
+static int connnetbench(const char *host, int port, int *fds, int cnum);
+static int64_t rssnetbench(const char *host, int port);
+static int tlbstart(void);
+static double tlbstop(int fd, int rnum);
 
 
 /* main routine */
@@ -103,6 +142,10 @@ int main(int argc, char **argv){
     rv = runrepl(argc, argv);
   } else if(!strcmp(argv[1], "http")){
     rv = runhttp(argc, argv);
+  } else if(!strcmp(argv[1], "bench")){
+    rv = runbench(argc, argv);
+  } else if(!strcmp(argv[1], "netbench")){
+    rv = runnetbench(argc, argv);
   } else if(!strcmp(argv[1], "version") || !strcmp(argv[1], "--version")){
     rv = runversion(argc, argv);
   } else {
@@ -119,12 +162,13 @@ static void usage(void){
   fprintf(stderr, "usage:\n");
   fprintf(stderr, "  %s inform [-port num] [-st] host\n", g_progname);
   fprintf(stderr, "  %s put [-port num] [-sx] [-sep chr] [-dk|-dc|-dai|-dad] [-ds num]"
-          " host key value\n", g_progname);
+          " [-ttl num] host key value\n", g_progname);
   fprintf(stderr, "  %s out [-port num] [-sx] [-sep chr] host key\n", g_progname);
-  fprintf(stderr, "  %s get [-port num] [-sx] [-sep chr] [-px] [-pz] host key\n", g_progname);
-  fprintf(stderr, "  %s mget [-port num] [-sx] [-sep chr] [-px] host [key...]\n", g_progname);
-  fprintf(stderr, "  %s list [-port num] [-sep chr] [-m num] [-pv] [-px] [-fm str] host\n",
+  fprintf(stderr, "  %s get [-port num] [-sx] [-sep chr] [-px] [-pz] [-cmp] host key\n",
           g_progname);
+  fprintf(stderr, "  %s mget [-port num] [-sx] [-sep chr] [-px] host [key...]\n", g_progname);
+  fprintf(stderr, "  %s list [-port num] [-sep chr] [-m num] [-pv] [-px] [-rb bkey ekey]"
+          " [-fm str] host\n", g_progname);
   fprintf(stderr, "  %s vanish [-port num] host\n", g_progname);
   fprintf(stderr, "  %s misc [-port num] [-mnu] [-sx] [-sep chr] [-px] host func [arg...]\n",
           g_progname);
@@ -134,6 +178,10 @@ static void usage(void){
           g_progname);
   fprintf(stderr, "  %s repl [-port num] [-ts num] [-sid num] [-ph] host\n", g_progname);
   fprintf(stderr, "  %s http [-ah name value] [-ih] url\n", g_progname);
+  fprintf(stderr, "  %s bench [-bnum num] [-mnum num] [-flat|-compact] [-huge thp|tlb]"
+          " [-numa inter|local] [-rnd] [-th num] rnum\n", g_progname);
+  fprintf(stderr, "  %s netbench [-port num] [-th num] [-vsiz num] [-pipe num] [-conn num]"
+          " host rnum\n", g_progname);
   fprintf(stderr, "  %s version\n", g_progname);
   fprintf(stderr, "\n");
   exit(1);
@@ -219,6 +267,16 @@ static char *mygetline(FILE *ifp){
 }
 
 
+/* get a random number */
+static int myrand(int range){
+  if(range < 2) return 0;
+  int high = (unsigned int)rand() >> 4;
+  int low = range * (rand() / (RAND_MAX + 1.0));
+  low &= (unsigned int)INT_MAX >> 4;
+  return (high + low) % range;
+}
+
+
 /* open the remote database */
 static bool myopen(TCRDB *rdb, const char *host, int port){
   bool err = false;
@@ -277,6 +335,7 @@ static int runput(int argc, char **argv){
   char *value = NULL;
   int port = TTDEFPORT;
   int dmode = 0;
+  int xtime = 0;
   bool sx = false;
   int sep = -1;
   for(int i = 2; i < argc; i++){
@@ -284,6 +343,9 @@ static int runput(int argc, char **argv){
       if(!strcmp(argv[i], "-port")){
         if(++i >= argc) usage();
         port = tcatoi(argv[i]);
+      } else if(!strcmp(argv[i], "-ttl")){
+        if(++i >= argc) usage();
+        xtime = tcatoi(argv[i]);
       } else if(!strcmp(argv[i], "-dk")){
         dmode = -1;
       } else if(!strcmp(argv[i], "-dc")){
@@ -325,7 +387,7 @@ static int runput(int argc, char **argv){
     vsiz = strlen(value);
     vbuf = tcmemdup(value, vsiz);
   }
-  int rv = procput(host, port, kbuf, ksiz, vbuf, vsiz, dmode);
+  int rv = procput(host, port, kbuf, ksiz, vbuf, vsiz, dmode, xtime);
   free(vbuf);
   free(kbuf);
   return rv;
@@ -386,6 +448,7 @@ static int runget(int argc, char **argv){
   int sep = -1;
   bool px = false;
   bool pz = false;
+  bool cmp = false;
   for(int i = 2; i < argc; i++){
     if(!host && argv[i][0] == '-'){
       if(!strcmp(argv[i], "-port")){
@@ -400,6 +463,8 @@ static int runget(int argc, char **argv){
         px = true;
       } else if(!strcmp(argv[i], "-pz")){
         pz = true;
+      } else if(!strcmp(argv[i], "-cmp")){
+        cmp = true;
       } else {
         usage();
       }
@@ -422,7 +487,7 @@ static int runget(int argc, char **argv){
     ksiz = strlen(key);
     kbuf = tcmemdup(key, ksiz);
   }
-  int rv = procget(host, port, kbuf, ksiz, sep, px, pz);
+  int rv = procget(host, port, kbuf, ksiz, sep, px, pz, cmp);
   free(kbuf);
   return rv;
 }
@@ -487,6 +552,8 @@ static int runlist(int argc, char **argv){
   int max = -1;
   bool pv = false;
   bool px = false;
+  char *rbstr = NULL;
+  char *restr = NULL;
   char *fmstr = NULL;
   for(int i = 2; i < argc; i++){
     if(!host && argv[i][0] == '-'){
@@ -503,6 +570,11 @@ static int runlist(int argc, char **argv){
         pv = true;
       } else if(!strcmp(argv[i], "-px")){
         px = true;
+      } else if(!strcmp(argv[i], "-rb")){
+        if(++i >= argc) usage();
+        rbstr = argv[i];
+        if(++i >= argc) usage();
+        restr = argv[i];
       } else if(!strcmp(argv[i], "-fm")){
         if(++i >= argc) usage();
         fmstr = argv[i];
@@ -516,7 +588,7 @@ static int runlist(int argc, char **argv){
     }
   }
   if(!host) usage();
-  int rv = proclist(host, port, sep, max, pv, px, fmstr);
+  int rv = proclist(host, port, sep, max, pv, px, rbstr, restr, fmstr);
   return rv;
 }
 
@@ -786,6 +858,112 @@ static int runhttp(int argc, char **argv){
 }
 
 
+/* parse arguments of bench command */
+static int runbench(int argc, char **argv){
+  char *rstr = NULL;
+  int bnum = 0;
+  int mnum = 0;
+  int mopts = 0;
+  int mpopts = 0;
+  bool rnd = false;
+  int thnum = 1;
+  for(int i = 2; i < argc; i++){
+    if(!rstr && argv[i][0] == '-'){
+      if(!strcmp(argv[i], "-bnum")){
+        if(++i >= argc) usage();
+        bnum = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-mnum")){
+        if(++i >= argc) usage();
+        mnum = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-th")){
+        if(++i >= argc) usage();
+        thnum = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-flat")){
+        mopts |= MDBTFLAT;
+      } else if(!strcmp(argv[i], "-compact")){
+        mopts |= MDBTCOMPACT;
+      } else if(!strcmp(argv[i], "-huge")){
+        if(++i >= argc) usage();
+        if(!tcstricmp(argv[i], "thp")){
+          mpopts |= TCMPTHP;
+        } else if(!tcstricmp(argv[i], "tlb")){
+          mpopts |= TCMPHUGETLB;
+        } else {
+          usage();
+        }
+      } else if(!strcmp(argv[i], "-numa")){
+        if(++i >= argc) usage();
+        if(!tcstricmp(argv[i], "inter")){
+          mpopts |= TCMPINTER;
+        } else if(!tcstricmp(argv[i], "local")){
+          mpopts |= TCMPLOCAL;
+        } else {
+          usage();
+        }
+      } else if(!strcmp(argv[i], "-rnd")){
+        rnd = true;
+      } else {
+        usage();
+      }
+    } else if(!rstr){
+      rstr = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!rstr) usage();
+  int rnum = tcatoix(rstr);
+  if(rnum < 1 || thnum < 1) usage();
+  int rv = procbench(rnum, bnum, mnum, mopts, mpopts, rnd, thnum);
+  return rv;
+}
+
+
+/* parse arguments of netbench command */
+static int runnetbench(int argc, char **argv){
+  char *host = NULL;
+  char *rstr = NULL;
+  int port = TTDEFPORT;
+  int thnum = 1;
+  int vsiz = 8;
+  int pnum = 1;
+  int cnum = 0;
+  for(int i = 2; i < argc; i++){
+    if(!host && argv[i][0] == '-'){
+      if(!strcmp(argv[i], "-port")){
+        if(++i >= argc) usage();
+        port = tcatoi(argv[i]);
+      } else if(!strcmp(argv[i], "-th")){
+        if(++i >= argc) usage();
+        thnum = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-vsiz")){
+        if(++i >= argc) usage();
+        vsiz = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-pipe")){
+        if(++i >= argc) usage();
+        pnum = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-conn")){
+        if(++i >= argc) usage();
+        cnum = tcatoix(argv[i]);
+      } else {
+        usage();
+      }
+    } else if(!host){
+      host = argv[i];
+    } else if(!rstr){
+      rstr = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!host || !rstr) usage();
+  int rnum = tcatoix(rstr);
+  if(rnum < 1 || thnum < 1 || vsiz < 0 || pnum < 1 || cnum < 0) usage();
+  int rv = procnetbench(host, port, rnum, vsiz, pnum, cnum, thnum);
+  return rv;
+}
+
+
 /* parse arguments of version command */
 static int runversion(int argc, char **argv){
   int rv = procversion();
@@ -826,7 +1004,7 @@ static int procinform(const char *host, int port, bool st){
 
 /* perform put command */
 static int procput(const char *host, int port, const char *kbuf, int ksiz,
-                   const char *vbuf, int vsiz, int dmode){
+                   const char *vbuf, int vsiz, int dmode, int xtime){
   TCRDB *rdb = tcrdbnew();
   if(!myopen(rdb, host, port)){
     printerr(rdb);
@@ -868,7 +1046,12 @@ static int procput(const char *host, int port, const char *kbuf, int ksiz,
       }
       break;
     default:
-      if(!tcrdbput(rdb, kbuf, ksiz, vbuf, vsiz)){
+      if(xtime != 0){
+        if(!tcrdbputexp(rdb, kbuf, ksiz, vbuf, vsiz, xtime)){
+          printerr(rdb);
+          err = true;
+        }
+      } else if(!tcrdbput(rdb, kbuf, ksiz, vbuf, vsiz)){
         printerr(rdb);
         err = true;
       }
@@ -907,8 +1090,9 @@ static int procout(const char *host, int port, const char *kbuf, int ksiz){
 
 /* perform get command */
 static int procget(const char *host, int port, const char *kbuf, int ksiz, int sep,
-                   bool px, bool pz){
+                   bool px, bool pz, bool cmp){
   TCRDB *rdb = tcrdbnew();
+  if(cmp) tcrdbtune(rdb, 0, RDBTCMP);
   if(!myopen(rdb, host, port)){
     printerr(rdb);
     tcrdbdel(rdb);
@@ -977,7 +1161,7 @@ static int procmget(const char *host, int port, const TCLIST *keys, int sep, boo
 
 /* perform list command */
 static int proclist(const char *host, int port, int sep, int max, bool pv, bool px,
-                    const char *fmstr){
+                    const char *rbstr, const char *restr, const char *fmstr){
   TCRDB *rdb = tcrdbnew();
   if(!myopen(rdb, host, port)){
     printerr(rdb);
@@ -985,7 +1169,23 @@ static int proclist(const char *host, int port, int sep, int max, bool pv, bool
     return 1;
   }
   bool err = false;
-  if(fmstr){
+  if(rbstr){
+    TCLIST *recs = tcrdbrange(rdb, rbstr, strlen(rbstr), restr, strlen(restr), max, pv);
+    int step = pv ? 2 : 1;
+    for(int i = 0; i < tclistnum(recs); i += step){
+      int ksiz;
+      const char *kbuf = tclistval(recs, i, &ksiz);
+      printdata(kbuf, ksiz, px, sep);
+      if(pv){
+        int vsiz;
+        const char *vbuf = tclistval(recs, i + 1, &vsiz);
+        putchar('\t');
+        printdata(vbuf, vsiz, px, sep);
+      }
+      putchar('\n');
+    }
+    tclistdel(recs);
+  } else if(fmstr){
     TCLIST *keys = tcrdbfwmkeys2(rdb, fmstr, max);
     for(int i = 0; i < tclistnum(keys); i++){
       int ksiz;
@@ -1004,28 +1204,32 @@ static int proclist(const char *host, int port, int sep, int max, bool pv, bool
     }
     tclistdel(keys);
   } else {
-    if(!tcrdbiterinit(rdb)){
-      printerr(rdb);
-      err = true;
-    }
-    int ksiz;
-    char *kbuf;
+    uint64_t cur = 0;
     int cnt = 0;
-    while((kbuf = tcrdbiternext(rdb, &ksiz)) != NULL){
-      printdata(kbuf, ksiz, px, sep);
-      if(pv){
-        int vsiz;
-        char *vbuf = tcrdbget(rdb, kbuf, ksiz, &vsiz);
-        if(vbuf){
+    do {
+      int unit = (max >= 0 && max - cnt < SCANUNIT) ? max - cnt : SCANUNIT;
+      TCLIST *recs = tcrdbscan(rdb, &cur, unit, pv);
+      if(!recs){
+        printerr(rdb);
+        err = true;
+        break;
+      }
+      int step = pv ? 2 : 1;
+      for(int i = 0; i < tclistnum(recs); i += step){
+        int ksiz;
+        const char *kbuf = tclistval(recs, i, &ksiz);
+        printdata(kbuf, ksiz, px, sep);
+        if(pv){
+          int vsiz;
+          const char *vbuf = tclistval(recs, i + 1, &vsiz);
           putchar('\t');
           printdata(vbuf, vsiz, px, sep);
-          free(vbuf);
         }
+        putchar('\n');
+        cnt++;
       }
-      putchar('\n');
-      free(kbuf);
-      if(max >= 0 && ++cnt >= max) break;
-    }
+      tclistdel(recs);
+    } while(cur != 0 && (max < 0 || cnt < max));
   }
   if(!tcrdbclose(rdb)){
     if(!err) printerr(rdb);
@@ -1294,6 +1498,419 @@ static int prochttp(const char *url, TCMAP *hmap, bool ih){
 }
 
 
+/* perform bench command */
+static int procbench(int rnum, int bnum, int mnum, int mopts, int mpopts, bool rnd, int thnum){
+  printf("<On-memory Database Benchmark>\n"
+         "  rnum=%d  bnum=%d  mnum=%d  engine=%s  huge=%s  numa=%s  rnd=%d  th=%d\n\n",
+         rnum, bnum, mnum,
+         (mopts & MDBTCOMPACT) ? "compact" : (mopts & MDBTFLAT) ? "flat" : "tree",
+         (mpopts & TCMPHUGETLB) ? "tlb" : (mpopts & TCMPTHP) ? "thp" : "none",
+         (mpopts & TCMPLOCAL) ? "local" : (mpopts & TCMPINTER) ? "inter" : "none", rnd, thnum);
+  tcsetmemplace(mpopts);
+  bool err = false;
+  if(thnum > 1){
+    for(int tnum = 1; true; tnum *= 2){
+      if(tnum > thnum) tnum = thnum;
+      TCMDB *mdb = tcmdbnew3(bnum, mnum, mopts);
+      BENCHARG *args = tcmalloc(sizeof(*args) * tnum);
+      pthread_t *ths = tcmalloc(sizeof(*ths) * tnum);
+      double etimes[2];
+      double tlbmiss = -1;
+      for(int mode = 0; mode < 2; mode++){
+        int tlbfd = mode == 1 ? tlbstart() : -1;
+        double stime = tctime();
+        for(int i = 0; i < tnum; i++){
+          args[i].mdb = mdb;
+          args[i].id = i;
+          args[i].tnum = tnum;
+          args[i].rnum = rnum;
+          args[i].rnd = rnd;
+          args[i].get = mode == 1;
+          args[i].hnum = 0;
+          if(pthread_create(ths + i, NULL, threadbench, args + i) != 0){
+            fprintf(stderr, "%s: pthread_create failed\n", g_progname);
+            args[i].tnum = 0;
+            err = true;
+          }
+        }
+        for(int i = 0; i < tnum; i++){
+          if(args[i].tnum > 0 && pthread_join(ths[i], NULL) != 0){
+            fprintf(stderr, "%s: pthread_join failed\n", g_progname);
+            err = true;
+          }
+        }
+        etimes[mode] = tctime() - stime;
+        if(mode == 1) tlbmiss = tlbstop(tlbfd, rnum);
+      }
+      int hnum = 0;
+      for(int i = 0; i < tnum; i++){
+        hnum += args[i].hnum;
+      }
+      if(!rnd && hnum != rnum){
+        fprintf(stderr, "%s: %d records are missing\n", g_progname, rnum - hnum);
+        err = true;
+      }
+      printf("threads=%d: put %.0f ops/sec, get %.0f ops/sec", tnum,
+             rnum / etimes[0], rnum / etimes[1]);
+      if(tlbmiss >= 0) printf(", %.3f dTLB misses/get", tlbmiss);
+      printf("\n");
+      free(ths);
+      free(args);
+      tcmdbdel(mdb);
+      if(tnum >= thnum) break;
+    }
+    printf("%s\n\n", err ? "error" : "ok");
+    return err ? 1 : 0;
+  }
+  TCMDB *mdb = tcmdbnew3(bnum, mnum, mopts);
+  char kbuf[TCNUMBUFSIZ];
+  double stime = tctime();
+  for(int i = 1; i <= rnum; i++){
+    int ksiz = sprintf(kbuf, "%08d", rnd ? myrand(rnum) + 1 : i);
+    tcmdbput(mdb, kbuf, ksiz, kbuf, ksiz);
+  }
+  double etime = tctime() - stime;
+  printf("put: %.3f sec (%.0f ops/sec)\n", etime, rnum / etime);
+  int hnum = 0;
+  int tlbfd = tlbstart();
+  stime = tctime();
+  for(int i = 1; i <= rnum; i++){
+    int ksiz = sprintf(kbuf, "%08d", rnd ? myrand(rnum) + 1 : i);
+    int vsiz;
+    char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
+    if(vbuf){
+      hnum++;
+      free(vbuf);
+    }
+  }
+  etime = tctime() - stime;
+  double tlbmiss = tlbstop(tlbfd, rnum);
+  printf("get: %.3f sec (%.0f ops/sec)\n", etime, rnum / etime);
+  if(tlbmiss >= 0){
+    printf("dTLB misses per get: %.3f\n", tlbmiss);
+  } else {
+    printf("dTLB misses per get: unavailable\n");
+  }
+  if(!rnd && hnum != rnum){
+    fprintf(stderr, "%s: %d records are missing\n", g_progname, rnum - hnum);
+    err = true;
+  }
+  printf("record number: %llu\n", (unsigned long long)tcmdbrnum(mdb));
+  printf("size: %llu\n", (unsigned long long)tcmdbmsiz(mdb));
+  uint64_t slabused;
+  tcmdbslab(mdb, &slabused, NULL);
+  uint64_t recnum = tcmdbrnum(mdb);
+  printf("bytes per record: %.1f\n",
+         recnum > 0 ? (double)(slabused + tcmdbisiz(mdb)) / recnum : 0.0);
+  TCMAP *info = tcsysinfo();
+  if(info){
+    const char *vbuf = tcmapget2(info, "rss");
+    if(vbuf) printf("memory: %s\n", vbuf);
+    tcmapdel(info);
+  }
+  tcmdbdel(mdb);
+  printf("%s\n\n", err ? "error" : "ok");
+  return err ? 1 : 0;
+}
+
+
+/* perform netbench command */
+static int procnetbench(const char *host, int port, int rnum, int vsiz, int pnum, int cnum,
+                        int thnum){
+  printf("<Network Benchmark>\n"
+         "  host=%s  port=%d  rnum=%d  vsiz=%d  pipe=%d  conn=%d  th=%d\n\n",
+         host, port, rnum, vsiz, pnum, cnum, thnum);
+  bool err = false;
+  int *fds = tcmalloc(sizeof(*fds) * (cnum + 1));
+  int fnum = 0;
+  if(cnum > 0){
+    int64_t orss = rssnetbench(host, port);
+    double stime = tctime();
+    fnum = connnetbench(host, port, fds, cnum);
+    double etime = tctime() - stime;
+    int64_t nrss = rssnetbench(host, port);
+    if(fnum < cnum) err = true;
+    printf("conn: %.3f sec (%d idle connections", etime, fnum);
+    if(fnum > 0 && orss >= 0 && nrss >= 0)
+      printf(", %.0f bytes/conn of server RSS", (double)(nrss - orss) / fnum);
+    printf(")\n");
+  }
+  NETBENCHARG *args = tcmalloc(sizeof(*args) * thnum);
+  pthread_t *ths = tcmalloc(sizeof(*ths) * thnum);
+  double etimes[2];
+  for(int mode = 0; mode < 2; mode++){
+    double stime = tctime();
+    for(int i = 0; i < thnum; i++){
+      args[i].host = host;
+      args[i].port = port;
+      args[i].id = i;
+      args[i].tnum = thnum;
+      args[i].rnum = rnum;
+      args[i].vsiz = vsiz;
+      args[i].pnum = pnum;
+      args[i].get = mode == 1;
+      args[i].hnum = 0;
+      args[i].err = false;
+      if(pthread_create(ths + i, NULL, threadnetbench, args + i) != 0){
+        fprintf(stderr, "%s: pthread_create failed\n", g_progname);
+        args[i].tnum = 0;
+        err = true;
+      }
+    }
+    for(int i = 0; i < thnum; i++){
+      if(args[i].tnum > 0 && pthread_join(ths[i], NULL) != 0){
+        fprintf(stderr, "%s: pthread_join failed\n", g_progname);
+        err = true;
+      }
+      if(args[i].err) err = true;
+    }
+    etimes[mode] = tctime() - stime;
+  }
+  int hnum = 0;
+  for(int i = 0; i < thnum; i++){
+    hnum += args[i].hnum;
+  }
+  if(hnum != rnum){
+    fprintf(stderr, "%s: %d records are missing\n", g_progname, rnum - hnum);
+    err = true;
+  }
+  double msiz = (double)rnum * vsiz / (1024 * 1024);
+  printf("put: %.3f sec (%.0f ops/sec, %.1f MB/sec)\n",
+         etimes[0], rnum / etimes[0], msiz / etimes[0]);
+  printf("get: %.3f sec (%.0f ops/sec, %.1f MB/sec)\n",
+         etimes[1], rnum / etimes[1], msiz / etimes[1]);
+  for(int i = 0; i < fnum; i++){
+    ttclosesock(fds[i]);
+  }
+  free(fds);
+  free(ths);
+  free(args);
+  printf("%s\n\n", err ? "error" : "ok");
+  return err ? 1 : 0;
+}
+
+
+/* thread of bench command */
+static void *threadbench(void *targ){
+  BENCHARG *arg = targ;
+  TCMDB *mdb = arg->mdb;
+  unsigned int seed = arg->id + 1;
+  char kbuf[TCNUMBUFSIZ];
+  for(int i = arg->id + 1; i <= arg->rnum; i += arg->tnum){
+    int ksiz = sprintf(kbuf, "%08d", arg->rnd ? rand_r(&seed) % arg->rnum + 1 : i);
+    if(arg->get){
+      int vsiz;
+      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
+      if(vbuf){
+        arg->hnum++;
+        free(vbuf);
+      }
+    } else {
+      tcmdbput(mdb, kbuf, ksiz, kbuf, ksiz);
+    }
+  }
+  return NULL;
+}
+
+
+/* thread of netbench command */
+static void *threadnetbench(void *targ){
+  NETBENCHARG *arg = targ;
+  if(arg->get && arg->pnum > 1){
+    if(!pipenetbench(arg)) arg->err = true;
+    return NULL;
+  }
+  TCRDB *rdb = tcrdbnew();
+  if(!myopen(rdb, arg->host, arg->port)){
+    printerr(rdb);
+    tcrdbdel(rdb);
+    arg->err = true;
+    return NULL;
+  }
+  char *vbuf = tcmalloc(arg->vsiz + 1);
+  memset(vbuf, 'v', arg->vsiz);
+  char kbuf[TCNUMBUFSIZ];
+  for(int i = arg->id + 1; i <= arg->rnum; i += arg->tnum){
+    int ksiz = sprintf(kbuf, "%08d", i);
+    if(arg->get){
+      int rsiz;
+      char *rbuf = tcrdbget(rdb, kbuf, ksiz, &rsiz);
+      if(rbuf){
+        if(rsiz == arg->vsiz) arg->hnum++;
+        free(rbuf);
+      }
+    } else if(!tcrdbput(rdb, kbuf, ksiz, vbuf, arg->vsiz)){
+      printerr(rdb);
+      arg->err = true;
+      break;
+    }
+  }
+  free(vbuf);
+  if(!tcrdbclose(rdb)){
+    printerr(rdb);
+    arg->err = true;
+  }
+  tcrdbdel(rdb);
+  return NULL;
+}
+
+
+/* retrieve records of netbench command by pipelined requests */
+static bool pipenetbench(NETBENCHARG *arg){
+  char addr[TTADDRBUFSIZ];
+  int fd = ttgethostaddr(arg->host, addr) ? ttopensock(addr, arg->port) : -1;
+  if(fd == -1){
+    fprintf(stderr, "%s: %s:%d: connection failed\n", g_progname, arg->host, arg->port);
+    return false;
+  }
+  bool err = false;
+  TTSOCK *sock = ttsocknew(fd);
+  TCXSTR *xstr = tcxstrnew();
+  char *vbuf = tcmalloc(arg->vsiz + 1);
+  int i = arg->id + 1;
+  while(!err && i <= arg->rnum){
+    tcxstrclear(xstr);
+    int cnum = 0;
+    while(cnum < arg->pnum && i <= arg->rnum){
+      char kbuf[TCNUMBUFSIZ];
+      int ksiz = sprintf(kbuf, "%08d", i);
+      unsigned char hbuf[2];
+      hbuf[0] = TTMAGICNUM;
+      hbuf[1] = TTCMDGET;
+      uint32_t lnum = htonl(ksiz);
+      tcxstrcat(xstr, hbuf, sizeof(hbuf));
+      tcxstrcat(xstr, &lnum, sizeof(lnum));
+      tcxstrcat(xstr, kbuf, ksiz);
+      cnum++;
+      i += arg->tnum;
+    }
+    if(!ttsocksend(sock, tcxstrptr(xstr), tcxstrsize(xstr))){
+      err = true;
+      break;
+    }
+    while(cnum-- > 0){
+      int code = ttsockgetc(sock);
+      if(code == -1){
+        err = true;
+        break;
+      }
+      if(code != 0) continue;
+      int vsiz = ttsockgetint32(sock);
+      if(ttsockcheckend(sock) || vsiz < 0){
+        err = true;
+        break;
+      }
+      if(vsiz > arg->vsiz) vbuf = tcrealloc(vbuf, vsiz + 1);
+      if(!ttsockrecv(sock, vbuf, vsiz)){
+        err = true;
+        break;
+      }
+      if(vsiz == arg->vsiz) arg->hnum++;
+    }
+  }
+  if(err) fprintf(stderr, "%s: pipelined get failed\n", g_progname);
+  free(vbuf);
+  tcxstrdel(xstr);
+  ttsockdel(sock);
+  ttclosesock(fd);
+  return !err;
+}
+
+
+/* open idle connections of netbench command
+   Each connection performs one request so that the server keeps its state and then stays idle.
+   The return value is the number of the opened connections. */
+static int connnetbench(const char *host, int port, int *fds, int cnum){
+  char addr[TTADDRBUFSIZ];
+  if(!ttgethostaddr(host, addr)){
+    fprintf(stderr, "%s: %s: unknown host\n", g_progname, host);
+    return 0;
+  }
+  int fnum = 0;
+  while(fnum < cnum){
+    int fd = ttopensock(addr, port);
+    if(fd == -1){
+      fprintf(stderr, "%s: %s:%d: connection failed after %d connections\n",
+              g_progname, host, port, fnum);
+      break;
+    }
+    unsigned char buf[2+sizeof(uint32_t)+TCNUMBUFSIZ];
+    int ksiz = sprintf((char *)buf + 2 + sizeof(uint32_t), "%08d", fnum + 1);
+    buf[0] = TTMAGICNUM;
+    buf[1] = TTCMDVSIZ;
+    uint32_t lnum = htonl(ksiz);
+    memcpy(buf + 2, &lnum, sizeof(lnum));
+    TTSOCK *sock = ttsocknew(fd);
+    bool ok = ttsocksend(sock, buf, 2 + sizeof(lnum) + ksiz);
+    int code = ok ? ttsockgetc(sock) : -1;
+    if(code == 0) ttsockgetint32(sock);
+    ok = code != -1 && !ttsockcheckend(sock);
+    ttsockdel(sock);
+    if(!ok){
+      fprintf(stderr, "%s: request of an idle connection failed\n", g_progname);
+      ttclosesock(fd);
+      break;
+    }
+    fds[fnum++] = fd;
+  }
+  return fnum;
+}
+
+
+/* get the resident set size of the server of netbench command
+   The return value is the size in bytes or -1 if it is unknown. */
+static int64_t rssnetbench(const char *host, int port){
+  TCRDB *rdb = tcrdbnew();
+  int64_t rss = -1;
+  if(myopen(rdb, host, port)){
+    char *status = tcrdbstat(rdb);
+    if(status){
+      const char *rp = strstr(status, "\nmemrss\t");
+      if(rp) rss = tcatoi(rp + 8);
+      free(status);
+    }
+    tcrdbclose(rdb);
+  }
+  tcrdbdel(rdb);
+  return rss;
+}
+
+
+/* start counting misses of the data TLB of the process
+   The return value is the descriptor of the counter or -1 if it is unavailable. */
+static int tlbstart(void){
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  if(fd == -1) return -1;
+  if(ioctl(fd, PERF_EVENT_IOC_RESET, 0) != 0 || ioctl(fd, PERF_EVENT_IOC_ENABLE, 0) != 0){
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+
+/* stop counting misses of the data TLB
+   The return value is the number of misses per operation or -1 if it is unavailable. */
+static double tlbstop(int fd, int rnum){
+  if(fd == -1) return -1;
+  ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  uint64_t cnt;
+  bool ok = read(fd, &cnt, sizeof(cnt)) == sizeof(cnt);
+  close(fd);
+  return ok && rnum > 0 ? (double)cnt / rnum : -1;
+}
+
+
 /* perform version command */
 static int procversion(void){
   printf("Tokyo Tyrant version %s (%d:%s) for %s\n",
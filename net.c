@@ -17,6 +17,13 @@
 #include "util.h"
 #include "net.h"
 
+#if !defined(_TT_NOURING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define _TT_URING
+#endif
+#endif
+
 
 
 /*************************************************************************************************
@@ -32,6 +39,29 @@
 #define SOCKLINEMAXSIZ (16*1024*1024)    // maximum size of a line of socket
 #define HTTPBODYMAXSIZ (256*1024*1024)   // maximum size of the entity body of HTTP
 #define TRILLIONNUM    1000000000000     // trillion number
+#define SOCKPOOLCLSNUM 5                 // number of size classes of a buffer pool
+#define SOCKPOOLBUFNUM 32                // maximum number of free buffers of each size class
+
+typedef struct {                         // type of structure for a buffer pool
+  char *bufs[SOCKPOOLCLSNUM][SOCKPOOLBUFNUM];  // free buffers of each size class
+  int nums[SOCKPOOLCLSNUM];              // numbers of the free buffers of each size class
+} TTBUFPOOL;
+
+
+/* private function prototypes */
+static int ttopenservsockimpl(const char *addr, int port, bool reuse);
+static bool ttsocksendimpl(TTSOCK *sock, const void *buf, int size);
+static bool ttsocksendvimpl(TTSOCK *sock, const struct iovec *iov, int iovcnt);
+static bool ttsockbuffer(TTSOCK *sock, const struct iovec *iov, int iovcnt);
+static int ttsockrecvonce(TTSOCK *sock, char *buf, int size);
+static bool ttsockfill(TTSOCK *sock);
+static void ttsockcatline(TCXSTR *xstr, const char *ptr, int size);
+static void ttsockload(TTSOCK *sock, const void *ptr, int size);
+static void ttsockrelax(TTSOCK *sock);
+static void *ttbufpoolnew(void);
+static void ttbufpooldel(void *pool);
+static char *ttbufpoolget(void *pool, int size);
+static void ttbufpoolput(void *pool, char *buf, int size);
 
 
 /* String containing the version information. */
@@ -147,6 +177,16 @@ int ttopensockunix(const char *path){
 /* Open a server socket of TCP/IP stream to clients. */
 int ttopenservsock(const char *addr, int port){
   assert(port >= 0);
+  return ttopenservsockimpl(addr, port, false);
+}
+
+
+/* Open a server socket of TCP/IP stream to clients.
+   `addr' specifies the address of the server.  If it is `NULL', every network address is binded.
+   `port' specifies the port number.
+   `reuse' specifies whether the port can be shared by other sockets by `SO_REUSEPORT'.
+   The return value is the file descriptor of the socket or -1 on failure. */
+static int ttopenservsockimpl(const char *addr, int port, bool reuse){
   struct sockaddr_in sain;
   memset(&sain, 0, sizeof(sain));
   sain.sin_family = AF_INET;
@@ -160,6 +200,17 @@ int ttopenservsock(const char *addr, int port){
     close(fd);
     return -1;
   }
+#if defined(SO_REUSEPORT)
+  if(reuse && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char *)&optint, sizeof(optint)) != 0){
+    close(fd);
+    return -1;
+  }
+#else
+  if(reuse){
+    close(fd);
+    return -1;
+  }
+#endif
   if(bind(fd, (struct sockaddr *)&sain, sizeof(sain)) != 0 ||
      listen(fd, SOMAXCONN) != 0){
     close(fd);
@@ -289,11 +340,18 @@ TTSOCK *ttsocknew(int fd){
   assert(fd >= 0);
   TTSOCK *sock = tcmalloc(sizeof(*sock));
   sock->fd = fd;
-  sock->rp = sock->buf;
-  sock->ep = sock->buf;
+  sock->buf = NULL;
+  sock->asiz = TTSOCKBUFSIZ;
+  sock->rp = NULL;
+  sock->ep = NULL;
   sock->end = false;
   sock->to = 0.0;
   sock->dl = HUGE_VAL;
+  sock->obuf = NULL;
+  sock->osiz = 0;
+  sock->oasiz = 0;
+  sock->cork = false;
+  sock->pool = NULL;
   return sock;
 }
 
@@ -301,6 +359,8 @@ TTSOCK *ttsocknew(int fd){
 /* Delete a socket object. */
 void ttsockdel(TTSOCK *sock){
   assert(sock);
+  if(sock->obuf) ttbufpoolput(sock->pool, sock->obuf, sock->oasiz);
+  if(sock->buf) ttbufpoolput(sock->pool, sock->buf, sock->asiz);
   free(sock);
 }
 
@@ -316,6 +376,48 @@ void ttsocksetlife(TTSOCK *sock, double lifetime){
 /* Send data by a socket. */
 bool ttsocksend(TTSOCK *sock, const void *buf, int size){
   assert(sock && buf && size >= 0);
+  if(sock->cork){
+    struct iovec iov;
+    iov.iov_base = (void *)buf;
+    iov.iov_len = size;
+    return ttsockbuffer(sock, &iov, 1);
+  }
+  return ttsocksendimpl(sock, buf, size);
+}
+
+
+/* Send data in plural regions by a socket. */
+bool ttsocksendv(TTSOCK *sock, const struct iovec *iov, int iovcnt){
+  assert(sock && iov && iovcnt >= 0);
+  if(sock->cork) return ttsockbuffer(sock, iov, iovcnt);
+  return ttsocksendvimpl(sock, iov, iovcnt);
+}
+
+
+/* Set the output buffering mode of a socket object. */
+bool ttsocksetcork(TTSOCK *sock, bool cork){
+  assert(sock);
+  sock->cork = cork;
+  return cork || ttsockflush(sock);
+}
+
+
+/* Send the buffered output of a socket object. */
+bool ttsockflush(TTSOCK *sock){
+  assert(sock);
+  if(sock->osiz < 1) return true;
+  int size = sock->osiz;
+  sock->osiz = 0;
+  return ttsocksendimpl(sock, sock->obuf, size);
+}
+
+
+/* Send data by a socket without buffering.
+   `sock' specifies the socket object.
+   `buf' specifies the pointer to the region of the data to send.
+   `size' specifies the size of the buffer.
+   If successful, the return value is true, else, it is false. */
+static bool ttsocksendimpl(TTSOCK *sock, const void *buf, int size){
   const char *rp = buf;
   do {
     int ocs = PTHREAD_CANCEL_DISABLE;
@@ -350,6 +452,104 @@ bool ttsocksend(TTSOCK *sock, const void *buf, int size){
 }
 
 
+/* Send data in plural regions by a socket without buffering.
+   `sock' specifies the socket object.
+   `iov' specifies the array of the regions of the data to send.
+   `iovcnt' specifies the number of the elements of the array.
+   If successful, the return value is true, else, it is false. */
+static bool ttsocksendvimpl(TTSOCK *sock, const struct iovec *iov, int iovcnt){
+  struct iovec stack[TTIOVECNUM];
+  struct iovec *vec = (iovcnt <= TTIOVECNUM) ? stack : tcmalloc(sizeof(*vec) * iovcnt);
+  memcpy(vec, iov, sizeof(*vec) * iovcnt);
+  bool err = false;
+  pthread_cleanup_push(free, (vec == stack) ? NULL : vec);
+  struct iovec *cur = vec;
+  while(iovcnt > 0){
+    if(cur->iov_len < 1){
+      cur++;
+      iovcnt--;
+      continue;
+    }
+    int ocs = PTHREAD_CANCEL_DISABLE;
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &ocs);
+    if(sock->to > 0.0 && !ttwaitsock(sock->fd, 1, sock->to)){
+      pthread_setcancelstate(ocs, NULL);
+      err = true;
+      break;
+    }
+    ssize_t wb = writev(sock->fd, cur, tclmin(iovcnt, IOV_MAX));
+    int en = errno;
+    pthread_setcancelstate(ocs, NULL);
+    if(wb == -1){
+      if((en != EINTR && en != EAGAIN && en != EWOULDBLOCK) || tctime() > sock->dl){
+        sock->end = true;
+        err = true;
+        break;
+      }
+    }
+    while(wb > 0){
+      if(wb >= cur->iov_len){
+        wb -= cur->iov_len;
+        cur++;
+        iovcnt--;
+      } else {
+        cur->iov_base = (char *)cur->iov_base + wb;
+        cur->iov_len -= wb;
+        wb = 0;
+      }
+    }
+  }
+  pthread_cleanup_pop(1);
+  return !err;
+}
+
+
+/* Append data in plural regions to the writing buffer of a socket.
+   `sock' specifies the socket object.
+   `iov' specifies the array of the regions of the data to send.
+   `iovcnt' specifies the number of the elements of the array.
+   If successful, the return value is true, else, it is false.
+   If the buffer would exceed `TTIOBUFSIZ' bytes, it is sent together with the data. */
+static bool ttsockbuffer(TTSOCK *sock, const struct iovec *iov, int iovcnt){
+  size_t size = 0;
+  for(int i = 0; i < iovcnt; i++){
+    size += iov[i].iov_len;
+  }
+  if(sock->osiz + size > TTIOBUFSIZ){
+    struct iovec stack[TTIOVECNUM+1];
+    struct iovec *vec = (iovcnt <= TTIOVECNUM) ? stack : tcmalloc(sizeof(*vec) * (iovcnt + 1));
+    vec[0].iov_base = sock->obuf;
+    vec[0].iov_len = sock->osiz;
+    memcpy(vec + 1, iov, sizeof(*vec) * iovcnt);
+    sock->osiz = 0;
+    bool err = false;
+    pthread_cleanup_push(free, (vec == stack) ? NULL : vec);
+    if(!ttsocksendvimpl(sock, vec, iovcnt + 1)) err = true;
+    pthread_cleanup_pop(1);
+    return !err;
+  }
+  if(sock->osiz + size > sock->oasiz){
+    int asiz = sock->oasiz > 0 ? sock->oasiz : TTSOCKBUFSIZ;
+    while(asiz < sock->osiz + size){
+      asiz *= 2;
+    }
+    if(asiz > TTIOBUFSIZ) asiz = TTIOBUFSIZ;
+    char *obuf = ttbufpoolget(sock->pool, asiz);
+    if(sock->obuf){
+      memcpy(obuf, sock->obuf, sock->osiz);
+      ttbufpoolput(sock->pool, sock->obuf, sock->oasiz);
+    }
+    sock->obuf = obuf;
+    sock->oasiz = asiz;
+  }
+  for(int i = 0; i < iovcnt; i++){
+    memcpy(sock->obuf + sock->osiz, iov[i].iov_base, iov[i].iov_len);
+    sock->osiz += iov[i].iov_len;
+  }
+  return true;
+}
+
+
 /* Send formatted data by a socket. */
 bool ttsockprintf(TTSOCK *sock, const char *format, ...){
   assert(sock && format);
@@ -459,23 +659,32 @@ bool ttsockprintf(TTSOCK *sock, const char *format, ...){
 /* Receive data by a socket. */
 bool ttsockrecv(TTSOCK *sock, char *buf, int size){
   assert(sock && buf && size >= 0);
-  if(sock->rp + size <= sock->ep){
-    memcpy(buf, sock->rp, size);
+  int len = sock->ep - sock->rp;
+  if(len >= size){
+    if(size > 0) memcpy(buf, sock->rp, size);
     sock->rp += size;
     return true;
   }
-  bool err = false;
-  char *wp = buf;
+  if(len > 0) memcpy(buf, sock->rp, len);
+  sock->rp = sock->ep;
+  buf += len;
+  size -= len;
+  if(sock->osiz > 0 && !ttsockflush(sock)) return false;
+  while(size >= sock->asiz){
+    int rv = ttsockrecvonce(sock, buf, size);
+    if(rv < 0) return false;
+    buf += rv;
+    size -= rv;
+  }
   while(size > 0){
-    int c = ttsockgetc(sock);
-    if(c == -1){
-      err = true;
-      break;
-    }
-    *(wp++) = c;
-    size--;
+    if(!ttsockfill(sock)) return false;
+    len = tclmin(sock->ep - sock->rp, size);
+    memcpy(buf, sock->rp, len);
+    sock->rp += len;
+    buf += len;
+    size -= len;
   }
-  return !err;
+  return true;
 }
 
 
@@ -483,6 +692,28 @@ bool ttsockrecv(TTSOCK *sock, char *buf, int size){
 int ttsockgetc(TTSOCK *sock){
   assert(sock);
   if(sock->rp < sock->ep) return *(unsigned char *)(sock->rp++);
+  if(sock->osiz > 0 && !ttsockflush(sock)) return -1;
+  if(!ttsockfill(sock)) return -1;
+  return *(unsigned char *)(sock->rp++);
+}
+
+
+/* Push a character back to a socket. */
+void ttsockungetc(TTSOCK *sock, int c){
+  assert(sock);
+  if(sock->rp <= sock->buf) return;
+  sock->rp--;
+  *(unsigned char *)sock->rp = c;
+}
+
+
+/* Receive data by one system call of a socket.
+   `sock' specifies the socket object.
+   `buf' specifies the pointer to the region into which the data is written.
+   `size' specifies the size of the region.
+   The return value is the size of the received data, or -1 on failure or at the end of the
+   stream.  The timeout, the deadline, and the cancellation point are those of `ttsockgetc'. */
+static int ttsockrecvonce(TTSOCK *sock, char *buf, int size){
   int en;
   do {
     int ocs = PTHREAD_CANCEL_DISABLE;
@@ -491,13 +722,11 @@ int ttsockgetc(TTSOCK *sock){
       pthread_setcancelstate(ocs, NULL);
       return -1;
     }
-    int rv = recv(sock->fd, sock->buf, TTIOBUFSIZ, 0);
+    int rv = recv(sock->fd, buf, size, 0);
     en = errno;
     pthread_setcancelstate(ocs, NULL);
     if(rv > 0){
-      sock->rp = sock->buf + 1;
-      sock->ep = sock->buf + rv;
-      return *(unsigned char *)sock->buf;
+      return rv;
     } else if(rv == 0){
       sock->end = true;
       return -1;
@@ -508,12 +737,140 @@ int ttsockgetc(TTSOCK *sock){
 }
 
 
-/* Push a character back to a socket. */
-void ttsockungetc(TTSOCK *sock, int c){
-  assert(sock);
-  if(sock->rp <= sock->buf) return;
-  sock->rp--;
-  *(unsigned char *)sock->rp = c;
+/* Fill the reading buffer of a socket by one system call.
+   `sock' specifies the socket object, whose buffered data must have been consumed.
+   If successful, the return value is true, else, it is false.
+   The buffer is taken from the pool of the socket and doubled up to `TTIOBUFSIZ' bytes if the
+   previous call filled it up. */
+static bool ttsockfill(TTSOCK *sock){
+  if(sock->buf && sock->ep == sock->buf + sock->asiz && sock->asiz < TTIOBUFSIZ){
+    ttbufpoolput(sock->pool, sock->buf, sock->asiz);
+    sock->buf = NULL;
+    sock->asiz *= 2;
+  }
+  if(!sock->buf){
+    sock->buf = ttbufpoolget(sock->pool, sock->asiz);
+    sock->rp = sock->buf;
+    sock->ep = sock->buf;
+  }
+  int rv = ttsockrecvonce(sock, sock->buf, sock->asiz);
+  if(rv < 0) return false;
+  sock->rp = sock->buf;
+  sock->ep = sock->buf + rv;
+  return true;
+}
+
+
+/* Concatenate a part of a line to an extensible string object without carriage returns.
+   `xstr' specifies the extensible string object.
+   `ptr' specifies the pointer to the region of the part.
+   `size' specifies the size of the region. */
+static void ttsockcatline(TCXSTR *xstr, const char *ptr, int size){
+  const char *ep = ptr + size;
+  while(ptr < ep){
+    const char *cp = memchr(ptr, '\r', ep - ptr);
+    if(!cp) cp = ep;
+    tcxstrcat(xstr, ptr, cp - ptr);
+    ptr = cp + 1;
+  }
+}
+
+
+/* Store data already received into the reading buffer of a socket.
+   `sock' specifies the socket object, whose buffered data must have been consumed.
+   `ptr' specifies the pointer to the region of the data.
+   `size' specifies the size of the region, which must not be more than `TTIOBUFSIZ'. */
+static void ttsockload(TTSOCK *sock, const void *ptr, int size){
+  assert(size <= TTIOBUFSIZ);
+  if(sock->buf && sock->asiz < size){
+    ttbufpoolput(sock->pool, sock->buf, sock->asiz);
+    sock->buf = NULL;
+  }
+  while(sock->asiz < size){
+    sock->asiz *= 2;
+  }
+  if(!sock->buf) sock->buf = ttbufpoolget(sock->pool, sock->asiz);
+  memcpy(sock->buf, ptr, size);
+  sock->rp = sock->buf;
+  sock->ep = sock->buf + size;
+}
+
+
+/* Return the buffers of an idle socket to its pool and detach the pool.
+   `sock' specifies the socket object.
+   The buffers are retained if they still hold data.  The size of the reading buffer is kept for
+   the next allocation. */
+static void ttsockrelax(TTSOCK *sock){
+  if(sock->buf && sock->rp >= sock->ep){
+    ttbufpoolput(sock->pool, sock->buf, sock->asiz);
+    sock->buf = NULL;
+    sock->rp = NULL;
+    sock->ep = NULL;
+  }
+  if(sock->obuf && sock->osiz < 1){
+    ttbufpoolput(sock->pool, sock->obuf, sock->oasiz);
+    sock->obuf = NULL;
+    sock->oasiz = 0;
+  }
+  sock->pool = NULL;
+}
+
+
+/* Create a buffer pool.
+   The return value is the opaque pointer to the pool.
+   A pool is not thread-safe and is meant to be owned by one worker thread. */
+static void *ttbufpoolnew(void){
+  TTBUFPOOL *pool = tcmalloc(sizeof(*pool));
+  memset(pool->nums, 0, sizeof(pool->nums));
+  return pool;
+}
+
+
+/* Delete a buffer pool.
+   `pool' specifies the opaque pointer to the pool. */
+static void ttbufpooldel(void *pool){
+  TTBUFPOOL *bp = pool;
+  for(int i = 0; i < SOCKPOOLCLSNUM; i++){
+    for(int j = 0; j < bp->nums[i]; j++){
+      free(bp->bufs[i][j]);
+    }
+  }
+  free(bp);
+}
+
+
+/* Take a buffer from a buffer pool.
+   `pool' specifies the opaque pointer to the pool.  If it is `NULL', the buffer is allocated.
+   `size' specifies the size of the buffer, which should be `TTSOCKBUFSIZ' multiplied by a power
+   of two.
+   The return value is the pointer to the buffer. */
+static char *ttbufpoolget(void *pool, int size){
+  TTBUFPOOL *bp = pool;
+  int cls = 0;
+  while((TTSOCKBUFSIZ << cls) < size){
+    cls++;
+  }
+  if(bp && cls < SOCKPOOLCLSNUM && bp->nums[cls] > 0) return bp->bufs[cls][--bp->nums[cls]];
+  return tcmalloc(size);
+}
+
+
+/* Return a buffer to a buffer pool.
+   `pool' specifies the opaque pointer to the pool.  If it is `NULL', the buffer is released.
+   `buf' specifies the pointer to the buffer.
+   `size' specifies the size of the buffer. */
+static void ttbufpoolput(void *pool, char *buf, int size){
+  TTBUFPOOL *bp = pool;
+  int cls = 0;
+  while((TTSOCKBUFSIZ << cls) < size){
+    cls++;
+  }
+  if(bp && cls < SOCKPOOLCLSNUM && (TTSOCKBUFSIZ << cls) == size &&
+     bp->nums[cls] < SOCKPOOLBUFNUM){
+    bp->bufs[cls][bp->nums[cls]++] = buf;
+    return;
+  }
+  free(buf);
 }
 
 
@@ -546,23 +903,23 @@ char *ttsockgets2(TTSOCK *sock){
   bool err = false;
   TCXSTR *xstr = tcxstrnew2(SOCKLINEBUFSIZ);
   pthread_cleanup_push((void (*)(void *))tcxstrdel, xstr);
-  int size = 0;
   while(true){
-    int c = ttsockgetc(sock);
-    if(c == '\n') break;
-    if(c == -1){
-      err = true;
-      break;
-    }
-    if(c != '\r'){
-      unsigned char b = c;
-      tcxstrcat(xstr, &b, sizeof(b));
-      size++;
-      if(size >= SOCKLINEMAXSIZ){
+    if(sock->rp >= sock->ep){
+      if(ttsockgetc(sock) == -1){
         err = true;
         break;
       }
+      sock->rp--;
+    }
+    char *np = memchr(sock->rp, '\n', sock->ep - sock->rp);
+    char *lp = np ? np : sock->ep;
+    ttsockcatline(xstr, sock->rp, lp - sock->rp);
+    sock->rp = np ? np + 1 : lp;
+    if(tcxstrsize(xstr) >= SOCKLINEMAXSIZ){
+      err = true;
+      break;
     }
+    if(np) break;
   }
   pthread_cleanup_pop(0);
   return tcxstrtomalloc(xstr);
@@ -828,12 +1185,65 @@ double ttunpackdouble(const char *buf){
 #define TTEVENTMAX     256               // maximum number of events
 #define TTWAITREQUEST  0.2               // waiting seconds for requests
 #define TTWAITWORKER   0.1               // waiting seconds for finish of workers
+#define TTSOCKTABMAX   (1<<20)           // maximum number of persistent socket objects
+#define TTURINGSQNUM   256               // number of entries of the submission queue
+#define TTURINGBUFNUM  128               // number of provided buffers of a ring
+#define TTURINGBUFSIZ  16384             // size of each provided buffer
+#define TTURINGBGID    1                 // group ID of the provided buffers
+#define TTURINGACCEPT  (1ULL << 32)      // tag of completions of accept
+
+#if defined(_TT_URING)
+
+typedef struct {                         // type of structure for an I/O ring
+  int fd;                                // file descriptor of the ring
+  void *sqmap;                           // mapped region of the submission queue
+  size_t sqmsiz;                         // size of the region of the submission queue
+  void *cqmap;                           // mapped region of the completion queue
+  size_t cqmsiz;                         // size of the region of the completion queue
+  struct io_uring_sqe *sqes;             // array of submission entries
+  size_t sqesiz;                         // size of the array of submission entries
+  uint32_t *sqhead;                      // head of the submission queue
+  uint32_t *sqtail;                      // tail of the submission queue
+  uint32_t *sqarray;                     // index array of the submission queue
+  uint32_t sqmask;                       // mask of the submission queue
+  uint32_t sqnum;                        // number of entries of the submission queue
+  uint32_t sqlast;                       // local tail of the submission queue
+  uint32_t *cqhead;                      // head of the completion queue
+  uint32_t *cqtail;                      // tail of the completion queue
+  uint32_t cqmask;                       // mask of the completion queue
+  struct io_uring_cqe *cqes;             // array of completion entries
+  struct io_uring_buf_ring *bring;       // ring of provided buffers
+  size_t bmsiz;                          // size of the region of provided buffers
+  char *bufs;                            // provided buffers
+  bool accepting;                        // whether a multishot accept is queued
+} TTURING;
+
+#endif
 
 
 /* private function prototypes */
 static void *ttservtimer(void *argp);
 static void ttservtask(TTSOCK *sock, TTREQ *req);
 static void *ttservdeqtasks(void *argp);
+static void *ttservreactor(void *argp);
+static bool ttservserve(TTREQ *req, int cfd);
+static TTSOCK *ttservsockopen(TTREQ *req, int cfd);
+static void ttservsockidle(TTREQ *req);
+static bool ttservsockclose(TTSERV *serv, int cfd, TTSOCK *sock);
+static void ttservsockcancel(TTREQ *req);
+static bool ttservreaporphans(TTSERV *serv, bool all);
+static void *ttservuring(void *argp);
+static void *ttservuringnew(void);
+static void ttservuringdel(void *uring);
+#if defined(_TT_URING)
+static void ttservsetsockopts(int fd, bool tcp);
+static struct io_uring_sqe *ttservuringsqe(TTURING *ring);
+static void ttservuringpush(TTURING *ring);
+static int ttservuringenter(TTURING *ring, int min, double timeout);
+static bool ttservuringaccept(TTURING *ring, int lfd);
+static bool ttservuringrecv(TTURING *ring, int cfd);
+static void ttservuringputbuf(TTURING *ring, int bid);
+#endif
 
 
 /* Create a server object. */
@@ -849,6 +1259,11 @@ TTSERV *ttservnew(void){
   if(pthread_cond_init(&serv->tcnd, NULL) != 0) tcmyfatal("pthread_cond_init failed");
   serv->thnum = TTDEFTHNUM;
   serv->timeout = 0;
+  serv->opts = 0;
+  serv->reqs = NULL;
+  serv->hnext = 0;
+  serv->socks = NULL;
+  serv->socknum = 0;
   serv->term = false;
   serv->do_log = NULL;
   serv->opq_log = NULL;
@@ -897,10 +1312,11 @@ bool ttservconf(TTSERV *serv, const char *host, int port){
 
 
 /* Set tuning parameters of a server object. */
-void ttservtune(TTSERV *serv, int thnum, double timeout){
+void ttservtune(TTSERV *serv, int thnum, double timeout, int opts){
   assert(serv && thnum > 0);
   serv->thnum = thnum;
   serv->timeout = timeout;
+  serv->opts = opts;
 }
 
 
@@ -943,23 +1359,54 @@ void ttservsettermhandler(TTSERV *serv, void (*do_term)(void *), void *opq){
 /* Start the service of a server object. */
 bool ttservstart(TTSERV *serv){
   assert(serv);
-  int lfd;
-  if(serv->port < 1){
-    lfd = ttopenservsockunix(serv->host);
-    if(lfd == -1){
-      ttservlog(serv, TTLOGERROR, "ttopenservsockunix failed");
-      return false;
+  bool uring = false;
+  if(serv->opts & TTSERVURING){
+    void *probe = ttservuringnew();
+    if(probe){
+      ttservuringdel(probe);
+      uring = true;
+    } else {
+      ttservlog(serv, TTLOGINFO, "io_uring is not available: falling back to epoll");
     }
-  } else {
-    lfd = ttopenservsock(serv->addr[0] != '\0' ? serv->addr : NULL, serv->port);
-    if(lfd == -1){
-      ttservlog(serv, TTLOGERROR, "ttopenservsock failed");
-      return false;
+  }
+  bool reactor = uring || (serv->opts & TTSERVREACTOR);
+  int thnum = serv->thnum;
+  int lfds[thnum];
+  bool reuse = reactor && serv->port > 0;
+  for(int i = 0; i < thnum; i++){
+    lfds[i] = reuse ?
+      ttopenservsockimpl(serv->addr[0] != '\0' ? serv->addr : NULL, serv->port, true) : -1;
+    if(lfds[i] == -1) reuse = false;
+  }
+  int lfd = -1;
+  if(!reuse){
+    for(int i = 0; i < thnum; i++){
+      if(lfds[i] >= 0) close(lfds[i]);
+      lfds[i] = -1;
+    }
+    if(reactor && serv->port > 0)
+      ttservlog(serv, TTLOGINFO, "SO_REUSEPORT is not available: %s",
+                uring ? "the listener is shared" : "connections are handed over");
+    if(serv->port < 1){
+      lfd = ttopenservsockunix(serv->host);
+      if(lfd == -1){
+        ttservlog(serv, TTLOGERROR, "ttopenservsockunix failed");
+        return false;
+      }
+    } else {
+      lfd = ttopenservsock(serv->addr[0] != '\0' ? serv->addr : NULL, serv->port);
+      if(lfd == -1){
+        ttservlog(serv, TTLOGERROR, "ttopenservsock failed");
+        return false;
+      }
     }
   }
   int epfd = epoll_create(TTEVENTMAX);
   if(epfd == -1){
-    close(lfd);
+    if(lfd >= 0) close(lfd);
+    for(int i = 0; i < thnum; i++){
+      if(lfds[i] >= 0) close(lfds[i]);
+    }
     ttservlog(serv, TTLOGERROR, "epoll_create failed");
     return false;
   }
@@ -977,28 +1424,71 @@ bool ttservstart(TTSERV *serv){
       err = true;
     }
   }
-  int thnum = serv->thnum;
-  TTREQ reqs[thnum];
+  void *(*do_worker)(void *) = uring ? ttservuring : reactor ? ttservreactor : ttservdeqtasks;
+  const char *wname = uring ? "ttservuring" : reactor ? "ttservreactor" : "ttservdeqtasks";
+  TTREQ *reqs[thnum];
+  serv->reqs = reqs;
+  serv->hnext = 0;
+  struct rlimit rlbuf;
+  serv->socknum = TTSOCKTABMAX;
+  if(getrlimit(RLIMIT_NOFILE, &rlbuf) == 0 && rlbuf.rlim_cur < TTSOCKTABMAX)
+    serv->socknum = rlbuf.rlim_cur;
+  serv->socks = tccalloc(serv->socknum, sizeof(*serv->socks));
   for(int i = 0; i < thnum; i++){
-    reqs[i].alive = true;
-    reqs[i].serv = serv;
-    reqs[i].epfd = epfd;
-    reqs[i].mtime = tctime();
-    reqs[i].keep = false;
-    reqs[i].idx = i;
-    if(pthread_create(&reqs[i].thid, NULL, ttservdeqtasks, reqs + i) == 0){
+    reqs[i] = tcmalloc(sizeof(**reqs));
+    reqs[i]->alive = true;
+    reqs[i]->serv = serv;
+    reqs[i]->epfd = epfd;
+    reqs[i]->mtime = tctime();
+    reqs[i]->keep = false;
+    reqs[i]->idx = i;
+    reqs[i]->lfd = uring && lfds[i] < 0 ? lfd : lfds[i];
+    reqs[i]->cfd = -1;
+    reqs[i]->sock = NULL;
+    reqs[i]->orphan = false;
+    reqs[i]->uring = NULL;
+    reqs[i]->pool = ttbufpoolnew();
+    if(uring){
+      reqs[i]->epfd = -1;
+      reqs[i]->uring = ttservuringnew();
+      if(!reqs[i]->uring){
+        reqs[i]->alive = false;
+        err = true;
+        ttservlog(serv, TTLOGERROR, "ttservuringnew failed");
+        continue;
+      }
+    } else if(reactor){
+      reqs[i]->epfd = epoll_create(TTEVENTMAX);
+      if(reqs[i]->epfd == -1){
+        reqs[i]->alive = false;
+        err = true;
+        ttservlog(serv, TTLOGERROR, "epoll_create failed");
+        continue;
+      }
+      if(reqs[i]->lfd >= 0){
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = reqs[i]->lfd;
+        if(epoll_ctl(reqs[i]->epfd, EPOLL_CTL_ADD, reqs[i]->lfd, &ev) != 0){
+          err = true;
+          ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
+        }
+      }
+    }
+    if(pthread_create(&reqs[i]->thid, NULL, do_worker, reqs[i]) == 0){
       ttservlog(serv, TTLOGINFO, "worker thread %d started", i + 1);
     } else {
-      reqs[i].alive = false;
+      reqs[i]->alive = false;
       err = true;
-      ttservlog(serv, TTLOGERROR, "pthread_create (ttservdeqtasks) failed");
+      ttservlog(serv, TTLOGERROR, "pthread_create (%s) failed", wname);
     }
   }
   struct epoll_event ev;
   memset(&ev, 0, sizeof(ev));
   ev.events = EPOLLIN;
   ev.data.fd = lfd;
-  if(epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev) != 0){
+  if(lfd >= 0 && !uring && epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev) != 0){
     err = true;
     ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
   }
@@ -1021,11 +1511,17 @@ bool ttservstart(TTSERV *serv){
           }
           if(cfd != -1){
             ttservlog(serv, TTLOGINFO, "connected: %s:%d", addr, port);
+            int cepfd = epfd;
             struct epoll_event ev;
             memset(&ev, 0, sizeof(ev));
             ev.events = EPOLLIN | EPOLLONESHOT;
             ev.data.fd = cfd;
-            if(epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &ev) != 0){
+            if(reactor){
+              TTREQ *hreq = __atomic_load_n(reqs + serv->hnext++ % thnum, __ATOMIC_ACQUIRE);
+              cepfd = hreq->epfd;
+              ev.events = EPOLLIN;
+            }
+            if(epoll_ctl(cepfd, EPOLL_CTL_ADD, cfd, &ev) != 0){
               close(cfd);
               err = true;
               ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
@@ -1084,29 +1580,32 @@ bool ttservstart(TTSERV *serv){
     if(serv->timeout > 0){
       double ctime = tctime();
       for(int i = 0; i < thnum; i++){
-        double itime = ctime - reqs[i].mtime;
+        TTREQ *req = __atomic_load_n(reqs + i, __ATOMIC_ACQUIRE);
+        if(!req->alive) continue;
+        double itime = ctime - req->mtime;
         if(itime > serv->timeout + TTWAITREQUEST + SOCKRCVTIMEO + SOCKSNDTIMEO &&
-           pthread_cancel(reqs[i].thid) == 0){
+           pthread_cancel(req->thid) == 0){
           ttservlog(serv, TTLOGINFO, "worker thread %d canceled by timeout", i + 1);
           void *rv;
-          if(pthread_join(reqs[i].thid, &rv) == 0){
+          if(pthread_join(req->thid, &rv) == 0){
             if(rv && rv != PTHREAD_CANCELED) err = true;
-            reqs[i].mtime = tctime();
-            if(pthread_create(&reqs[i].thid, NULL, ttservdeqtasks, reqs + i) != 0){
-              reqs[i].alive = false;
+            req->mtime = tctime();
+            if(pthread_create(&req->thid, NULL, do_worker, req) != 0){
+              req->alive = false;
               err = true;
-              ttservlog(serv, TTLOGERROR, "pthread_create (ttservdeqtasks) failed");
+              ttservlog(serv, TTLOGERROR, "pthread_create (%s) failed", wname);
             } else {
               ttservlog(serv, TTLOGINFO, "worker thread %d started", i + 1);
             }
           } else {
-            reqs[i].alive = false;
+            req->alive = false;
             err = true;
             ttservlog(serv, TTLOGERROR, "pthread_join failed");
           }
         }
       }
     }
+    if(reactor && !ttservreaporphans(serv, false)) err = true;
   }
   ttservlog(serv, TTLOGSYSTEM, "listening finished");
   if(pthread_cond_broadcast(&serv->qcnd) != 0){
@@ -1120,11 +1619,11 @@ bool ttservstart(TTSERV *serv){
   tcsleep(TTWAITWORKER);
   if(serv->do_term) serv->do_term(serv->opq_term);
   for(int i = 0; i < thnum; i++){
-    if(!reqs[i].alive) continue;
-    if(pthread_cancel(reqs[i].thid) == 0)
+    if(!reqs[i]->alive) continue;
+    if(pthread_cancel(reqs[i]->thid) == 0)
       ttservlog(serv, TTLOGINFO, "worker thread %d was canceled", i + 1);
     void *rv;
-    if(pthread_join(reqs[i].thid, &rv) == 0){
+    if(pthread_join(reqs[i]->thid, &rv) == 0){
       ttservlog(serv, TTLOGINFO, "worker thread %d finished", i + 1);
       if(rv && rv != PTHREAD_CANCELED) err = true;
     } else {
@@ -1132,9 +1631,18 @@ bool ttservstart(TTSERV *serv){
       ttservlog(serv, TTLOGERROR, "pthread_join failed");
     }
   }
-  if(tclistnum(serv->queue) > 0)
+  if(reactor){
+    if(!ttservreaporphans(serv, true)) err = true;
+  } else if(tclistnum(serv->queue) > 0){
     ttservlog(serv, TTLOGINFO, "%d requests discarded", tclistnum(serv->queue));
+  }
   tclistclear(serv->queue);
+  for(int i = 0; i < serv->socknum; i++){
+    if(serv->socks[i]) ttsockdel(serv->socks[i]);
+  }
+  free(serv->socks);
+  serv->socks = NULL;
+  serv->socknum = 0;
   for(int i = 0; i < serv->timernum; i++){
     TTTIMER *timer = serv->timers + i;
     if(!timer->alive) continue;
@@ -1149,6 +1657,20 @@ bool ttservstart(TTSERV *serv){
       ttservlog(serv, TTLOGERROR, "pthread_join failed");
     }
   }
+  for(int i = 0; i < thnum; i++){
+    if(reactor && reqs[i]->epfd >= 0 && close(reqs[i]->epfd) != 0){
+      err = true;
+      ttservlog(serv, TTLOGERROR, "epoll_close failed");
+    }
+    if(reqs[i]->lfd >= 0 && reqs[i]->lfd != lfd && close(reqs[i]->lfd) != 0){
+      err = true;
+      ttservlog(serv, TTLOGERROR, "close failed");
+    }
+    if(reqs[i]->uring) ttservuringdel(reqs[i]->uring);
+    ttbufpooldel(reqs[i]->pool);
+    free(reqs[i]);
+  }
+  serv->reqs = NULL;
   if(close(epfd) != 0){
     err = true;
     ttservlog(serv, TTLOGERROR, "epoll_close failed");
@@ -1195,6 +1717,58 @@ bool ttserviskilled(TTSERV *serv){
 }
 
 
+/* Hand over the other connections of the worker of a request to a new worker thread. */
+bool ttservhandoff(TTREQ *req){
+  assert(req);
+  TTSERV *serv = req->serv;
+  if(!(serv->opts & (TTSERVREACTOR | TTSERVURING)) || !serv->reqs || req->orphan || req->cfd < 0)
+    return false;
+  if(req->epfd >= 0 && epoll_ctl(req->epfd, EPOLL_CTL_DEL, req->cfd, NULL) != 0){
+    ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
+    return false;
+  }
+  void *(*do_worker)(void *) = req->uring ? ttservuring : ttservreactor;
+  TTREQ *nreq = tcmemdup(req, sizeof(*req));
+  nreq->mtime = tctime();
+  nreq->keep = false;
+  nreq->cfd = -1;
+  nreq->sock = NULL;
+  nreq->pool = ttbufpoolnew();
+  if(pthread_mutex_lock(&serv->qmtx) != 0){
+    ttbufpooldel(nreq->pool);
+    free(nreq);
+    ttservlog(serv, TTLOGERROR, "pthread_mutex_lock failed");
+    return false;
+  }
+  bool err = false;
+  if(pthread_create(&nreq->thid, NULL, do_worker, nreq) == 0){
+    req->orphan = true;
+    tclistpush(serv->queue, &req, sizeof(req));
+    __atomic_store_n(serv->reqs + req->idx, nreq, __ATOMIC_RELEASE);
+    ttservlog(serv, TTLOGINFO, "worker thread %d handed over", req->idx + 1);
+  } else {
+    ttbufpooldel(nreq->pool);
+    free(nreq);
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_create (%s) failed",
+              req->uring ? "ttservuring" : "ttservreactor");
+  }
+  if(pthread_mutex_unlock(&serv->qmtx) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_mutex_unlock failed");
+  }
+  if(!req->orphan && req->epfd >= 0){
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = req->cfd;
+    if(epoll_ctl(req->epfd, EPOLL_CTL_ADD, req->cfd, &ev) != 0)
+      ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
+  }
+  return !err;
+}
+
+
 /* Break a simple server expression. */
 char *ttbreakservexpr(const char *expr, int *pp){
   assert(expr);
@@ -1326,9 +1900,8 @@ static void *ttservdeqtasks(void *argp){
           empty = false;
           int cfd = *(int *)val;
           free(val);
-          pthread_cleanup_push((void (*)(void *))close, (void *)(intptr_t)cfd);
-          TTSOCK *sock = ttsocknew(cfd);
-          pthread_cleanup_push((void (*)(void *))ttsockdel, sock);
+          TTSOCK *sock = ttservsockopen(req, cfd);
+          pthread_cleanup_push((void (*)(void *))ttservsockcancel, req);
           bool reuse;
           do {
             if(serv->timeout > 0) ttsocksetlife(sock, serv->timeout);
@@ -1342,15 +1915,16 @@ static void *ttservdeqtasks(void *argp){
               reuse = true;
             }
           } while(reuse);
-          pthread_cleanup_pop(1);
+          if(!ttsockflush(sock)) req->keep = false;
           pthread_cleanup_pop(0);
           if(req->keep){
+            ttservsockidle(req);
             struct epoll_event ev;
             memset(&ev, 0, sizeof(ev));
             ev.events = EPOLLIN | EPOLLONESHOT;
             ev.data.fd = cfd;
             if(epoll_ctl(req->epfd, EPOLL_CTL_MOD, cfd, &ev) != 0){
-              close(cfd);
+              ttservsockclose(serv, cfd, NULL);
               err = true;
               ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
             }
@@ -1359,7 +1933,9 @@ static void *ttservdeqtasks(void *argp){
               err = true;
               ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
             }
-            if(!ttclosesock(cfd)){
+            req->cfd = -1;
+            req->sock = NULL;
+            if(!ttservsockclose(serv, cfd, sock)){
               err = true;
               ttservlog(serv, TTLOGERROR, "close failed");
             }
@@ -1389,42 +1965,600 @@ static void *ttservdeqtasks(void *argp){
   return err ? "error" : NULL;
 }
 
-
-
-/*************************************************************************************************
- * features for experts
- *************************************************************************************************/
-
-
-#define NULLDEV        "/dev/null"       // path of the null device
-
-
-/* Switch the process into the background. */
-bool ttdaemonize(void){
-  fflush(stdout);
-  fflush(stderr);
-  switch(fork()){
-    case -1: return false;
-    case 0: break;
-    default: _exit(0);
-  }
-  if(setsid() == -1) return false;
-  switch(fork()){
-    case -1: return false;
-    case 0: break;
-    default: _exit(0);
+/* Poll the connections of a worker of a server object and dispatch tasks.
+   `argp' specifies the argument structure of the server object.
+   The return value is `NULL' on success and other on failure. */
+static void *ttservreactor(void *argp){
+  TTREQ *req = argp;
+  TTSERV *serv = req->serv;
+  bool err = false;
+  if(pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_setcancelstate failed");
   }
-  umask(0);
-  if(chdir(MYPATHSTR) == -1) return false;
-  close(0);
-  close(1);
-  close(2);
-  int fd = open(NULLDEV, O_RDWR, 0);
-  if(fd != -1){
-    dup2(fd, 0);
-    dup2(fd, 1);
-    dup2(fd, 2);
-    if(fd > 2) close(fd);
+  sigset_t sigset;
+  sigemptyset(&sigset);
+  sigaddset(&sigset, SIGPIPE);
+  sigset_t oldsigset;
+  if(pthread_sigmask(SIG_BLOCK, &sigset, &oldsigset) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_sigmask failed");
+  }
+  while(!serv->term && !req->orphan){
+    struct epoll_event events[TTEVENTMAX];
+    int fdnum = epoll_wait(req->epfd, events, TTEVENTMAX, TTWAITREQUEST * 1000);
+    if(fdnum != -1){
+      for(int i = 0; i < fdnum && !req->orphan; i++){
+        if(events[i].data.fd == req->lfd){
+          char addr[TTADDRBUFSIZ];
+          int port;
+          int cfd = ttacceptsock(req->lfd, addr, &port);
+          if(cfd != -1){
+            ttservlog(serv, TTLOGINFO, "connected: %s:%d", addr, port);
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.fd = cfd;
+            if(epoll_ctl(req->epfd, EPOLL_CTL_ADD, cfd, &ev) != 0){
+              close(cfd);
+              err = true;
+              ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
+            }
+          } else {
+            err = true;
+            ttservlog(serv, TTLOGERROR, "ttacceptsock failed");
+            tcsleep(TTWAITWORKER);
+          }
+        } else {
+          if(!ttservserve(req, events[i].data.fd)) err = true;
+        }
+      }
+    } else if(errno == EINTR){
+      ttservlog(serv, TTLOGINFO, "signal interruption");
+    } else {
+      err = true;
+      ttservlog(serv, TTLOGERROR, "epoll_wait failed");
+    }
+    if(req->orphan) break;
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    pthread_testcancel();
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    req->mtime = tctime();
+  }
+  if(pthread_sigmask(SIG_SETMASK, &oldsigset, NULL) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_sigmask failed");
+  }
+  if(req->orphan) __atomic_store_n(&req->alive, false, __ATOMIC_RELEASE);
+  return err ? "error" : NULL;
+}
+
+
+/* Dispatch the tasks of a ready connection of a reactor.
+   `req' specifies the request object of the worker.
+   `cfd' specifies the file descriptor of the connection.
+   If successful, the return value is true, else, it is false.
+   If the connection is kept alive, it is left for the caller to poll it again. */
+static bool ttservserve(TTREQ *req, int cfd){
+  TTSERV *serv = req->serv;
+  bool err = false;
+  TTSOCK *sock = ttservsockopen(req, cfd);
+  pthread_cleanup_push((void (*)(void *))ttservsockcancel, req);
+  bool reuse;
+  do {
+    if(serv->timeout > 0) ttsocksetlife(sock, serv->timeout);
+    req->mtime = tctime();
+    req->keep = false;
+    ttservtask(sock, req);
+    reuse = false;
+    if(sock->end){
+      req->keep = false;
+    } else if(sock->ep > sock->rp){
+      reuse = true;
+    }
+  } while(reuse);
+  if(!ttsockflush(sock)) req->keep = false;
+  pthread_cleanup_pop(0);
+  if(req->keep && req->orphan && req->uring){
+    req->keep = false;
+    ttservlog(serv, TTLOGINFO, "the connection of a handed over ring is not kept");
+  }
+  if(req->keep){
+    ttservsockidle(req);
+    if(req->orphan){
+      struct epoll_event ev;
+      memset(&ev, 0, sizeof(ev));
+      ev.events = EPOLLIN;
+      ev.data.fd = cfd;
+      if(epoll_ctl(req->epfd, EPOLL_CTL_ADD, cfd, &ev) != 0){
+        ttservsockclose(serv, cfd, NULL);
+        err = true;
+        ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
+      }
+    }
+  } else {
+    req->cfd = -1;
+    req->sock = NULL;
+    if(!req->orphan && req->epfd >= 0 && epoll_ctl(req->epfd, EPOLL_CTL_DEL, cfd, NULL) != 0){
+      err = true;
+      ttservlog(serv, TTLOGERROR, "epoll_ctl failed");
+    }
+    if(!ttservsockclose(serv, cfd, sock)){
+      err = true;
+      ttservlog(serv, TTLOGERROR, "close failed");
+    }
+    ttservlog(serv, TTLOGINFO, "connection finished");
+  }
+  return !err;
+}
+
+
+/* Get the socket object of a connection of a server object.
+   `req' specifies the request object of the worker.
+   `cfd' specifies the file descriptor of the connection.
+   The return value is the socket object, which is kept across dispatches while the descriptor is
+   open and borrows the buffers from the pool of the worker. */
+static TTSOCK *ttservsockopen(TTREQ *req, int cfd){
+  TTSERV *serv = req->serv;
+  if(req->sock && req->cfd == cfd) return req->sock;
+  TTSOCK *sock = cfd < serv->socknum ? serv->socks[cfd] : NULL;
+  if(!sock){
+    sock = ttsocknew(cfd);
+    if(cfd < serv->socknum) serv->socks[cfd] = sock;
+  }
+  ttsocksetcork(sock, true);
+  sock->pool = req->pool;
+  req->cfd = cfd;
+  req->sock = sock;
+  return sock;
+}
+
+
+/* Detach the socket object of the current connection of a worker which is kept alive.
+   `req' specifies the request object of the worker.
+   The buffers of the socket object are returned to the pool of the worker. */
+static void ttservsockidle(TTREQ *req){
+  TTSERV *serv = req->serv;
+  TTSOCK *sock = req->sock;
+  if(req->cfd < serv->socknum && serv->socks[req->cfd] == sock){
+    ttsockrelax(sock);
+  } else {
+    ttsockdel(sock);
+  }
+  req->cfd = -1;
+  req->sock = NULL;
+}
+
+
+/* Close a connection of a server object with its socket object.
+   `serv' specifies the server object.
+   `cfd' specifies the file descriptor of the connection.
+   `sock' specifies the socket object.  If it is `NULL', the kept one is used if any.
+   If successful, the return value is true, else, it is false. */
+static bool ttservsockclose(TTSERV *serv, int cfd, TTSOCK *sock){
+  TTSOCK *ksock = cfd < serv->socknum ? serv->socks[cfd] : NULL;
+  if(ksock && (!sock || sock == ksock)){
+    serv->socks[cfd] = NULL;
+    sock = ksock;
+  }
+  if(sock) ttsockdel(sock);
+  return ttclosesock(cfd);
+}
+
+
+/* Close the current connection of a worker whose thread is canceled.
+   `req' specifies the request object of the worker. */
+static void ttservsockcancel(TTREQ *req){
+  if(req->cfd < 0) return;
+  ttservsockclose(req->serv, req->cfd, req->sock);
+  req->cfd = -1;
+  req->sock = NULL;
+}
+
+
+/* Join the worker threads of a server object which were handed over.
+   `serv' specifies the server object.
+   `all' specifies whether to cancel the ones still running.
+   If successful, the return value is true, else, it is false. */
+static bool ttservreaporphans(TTSERV *serv, bool all){
+  if(pthread_mutex_lock(&serv->qmtx) != 0){
+    ttservlog(serv, TTLOGERROR, "pthread_mutex_lock failed");
+    return false;
+  }
+  bool err = false;
+  int num = tclistnum(serv->queue);
+  for(int i = 0; i < num; i++){
+    TTREQ **rp = (TTREQ **)tclistshift(serv->queue);
+    TTREQ *req = *rp;
+    if(!__atomic_load_n(&req->alive, __ATOMIC_ACQUIRE)){
+      void *rv;
+      if(pthread_join(req->thid, &rv) == 0){
+        if(rv && rv != PTHREAD_CANCELED) err = true;
+        ttbufpooldel(req->pool);
+        free(req);
+      } else {
+        err = true;
+        ttservlog(serv, TTLOGERROR, "pthread_join failed");
+      }
+    } else if(all){
+      if(pthread_cancel(req->thid) == 0)
+        ttservlog(serv, TTLOGINFO, "handed over thread %d was canceled", req->idx + 1);
+      void *rv;
+      if(pthread_join(req->thid, &rv) == 0){
+        if(rv && rv != PTHREAD_CANCELED) err = true;
+        ttbufpooldel(req->pool);
+        free(req);
+      } else {
+        err = true;
+        ttservlog(serv, TTLOGERROR, "pthread_join failed");
+      }
+    } else {
+      tclistpush(serv->queue, &req, sizeof(req));
+    }
+    free(rp);
+  }
+  if(pthread_mutex_unlock(&serv->qmtx) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_mutex_unlock failed");
+  }
+  return !err;
+}
+
+/* Poll the connections of a worker of a server object by an I/O ring and dispatch tasks.
+   `argp' specifies the argument structure of the server object.
+   The return value is `NULL' on success and other on failure. */
+static void *ttservuring(void *argp){
+#if defined(_TT_URING)
+  TTREQ *req = argp;
+  TTSERV *serv = req->serv;
+  TTURING *ring = req->uring;
+  bool err = false;
+  if(pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_setcancelstate failed");
+  }
+  sigset_t sigset;
+  sigemptyset(&sigset);
+  sigaddset(&sigset, SIGPIPE);
+  sigset_t oldsigset;
+  if(pthread_sigmask(SIG_BLOCK, &sigset, &oldsigset) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_sigmask failed");
+  }
+  while(!serv->term && !req->orphan){
+    if(req->lfd >= 0 && !ring->accepting){
+      if(ttservuringaccept(ring, req->lfd)){
+        ring->accepting = true;
+      } else {
+        err = true;
+        ttservlog(serv, TTLOGERROR, "ttservuringaccept failed");
+      }
+    }
+    if(ttservuringenter(ring, 1, TTWAITREQUEST) == -1 &&
+       errno != ETIME && errno != EINTR && errno != EBUSY){
+      err = true;
+      ttservlog(serv, TTLOGERROR, "io_uring_enter failed");
+    }
+    while(!req->orphan){
+      uint32_t head = *ring->cqhead;
+      if(head == __atomic_load_n(ring->cqtail, __ATOMIC_ACQUIRE)) break;
+      struct io_uring_cqe cqe = ring->cqes[head&ring->cqmask];
+      __atomic_store_n(ring->cqhead, head + 1, __ATOMIC_RELEASE);
+      if(cqe.user_data == TTURINGACCEPT){
+        if(!(cqe.flags & IORING_CQE_F_MORE)) ring->accepting = false;
+        if(cqe.res >= 0){
+          int cfd = cqe.res;
+          char addr[TTADDRBUFSIZ];
+          int port = 0;
+          sprintf(addr, "(unix)");
+          if(serv->port > 0){
+            struct sockaddr_in sain;
+            socklen_t slen = sizeof(sain);
+            if(getpeername(cfd, (struct sockaddr *)&sain, &slen) != 0 ||
+               getnameinfo((struct sockaddr *)&sain, slen, addr, TTADDRBUFSIZ,
+                           NULL, 0, NI_NUMERICHOST) != 0){
+              sprintf(addr, "0.0.0.0");
+            } else {
+              port = (int)ntohs(sain.sin_port);
+            }
+          }
+          ttservsetsockopts(cfd, serv->port > 0);
+          ttservlog(serv, TTLOGINFO, "connected: %s:%d", addr, port);
+          if(!ttservuringrecv(ring, cfd)){
+            close(cfd);
+            err = true;
+            ttservlog(serv, TTLOGERROR, "ttservuringrecv failed");
+          }
+        } else {
+          err = true;
+          ttservlog(serv, TTLOGERROR, "accept failed: %s", strerror(-cqe.res));
+          tcsleep(TTWAITWORKER);
+        }
+      } else {
+        int cfd = cqe.user_data;
+        if(cqe.res > 0){
+          int bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+          ttsockload(ttservsockopen(req, cfd), ring->bufs + (size_t)bid * TTURINGBUFSIZ,
+                     cqe.res);
+          ttservuringputbuf(ring, bid);
+          if(!ttservserve(req, cfd)) err = true;
+          if(req->keep && !req->orphan && !ttservuringrecv(ring, cfd)){
+            ttservsockclose(serv, cfd, NULL);
+            err = true;
+            ttservlog(serv, TTLOGERROR, "ttservuringrecv failed");
+          }
+        } else if(cqe.res == -ENOBUFS){
+          if(!ttservuringrecv(ring, cfd)){
+            ttservsockclose(serv, cfd, NULL);
+            err = true;
+            ttservlog(serv, TTLOGERROR, "ttservuringrecv failed");
+          }
+        } else {
+          if(cqe.flags & IORING_CQE_F_BUFFER)
+            ttservuringputbuf(ring, cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+          if(!ttservsockclose(serv, cfd, NULL)){
+            err = true;
+            ttservlog(serv, TTLOGERROR, "close failed");
+          }
+          ttservlog(serv, TTLOGINFO, "connection finished");
+        }
+      }
+    }
+    if(req->orphan) break;
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    pthread_testcancel();
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    req->mtime = tctime();
+  }
+  if(pthread_sigmask(SIG_SETMASK, &oldsigset, NULL) != 0){
+    err = true;
+    ttservlog(serv, TTLOGERROR, "pthread_sigmask failed");
+  }
+  if(req->orphan) __atomic_store_n(&req->alive, false, __ATOMIC_RELEASE);
+  return err ? "error" : NULL;
+#else
+  return "error";
+#endif
+}
+
+
+/* Create an I/O ring for a worker of a server object.
+   The return value is the opaque pointer to the ring or `NULL' if io_uring is not available. */
+static void *ttservuringnew(void){
+#if defined(_TT_URING)
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = syscall(__NR_io_uring_setup, TTURINGSQNUM, &params);
+  if(fd == -1) return NULL;
+  TTURING *ring = tcmalloc(sizeof(*ring));
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = fd;
+  if(!(params.features & IORING_FEAT_EXT_ARG)){
+    ttservuringdel(ring);
+    return NULL;
+  }
+  ring->sqmsiz = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  ring->sqmap = mmap(NULL, ring->sqmsiz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+  if(ring->sqmap == MAP_FAILED) ring->sqmap = NULL;
+  ring->cqmsiz = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->cqmap = mmap(NULL, ring->cqmsiz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_CQ_RING);
+  if(ring->cqmap == MAP_FAILED) ring->cqmap = NULL;
+  ring->sqesiz = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqesiz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    fd, IORING_OFF_SQES);
+  if(ring->sqes == MAP_FAILED) ring->sqes = NULL;
+  ring->bmsiz = TTURINGBUFNUM * sizeof(struct io_uring_buf);
+  ring->bring = mmap(NULL, ring->bmsiz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                     -1, 0);
+  if(ring->bring == MAP_FAILED) ring->bring = NULL;
+  if(!ring->sqmap || !ring->cqmap || !ring->sqes || !ring->bring){
+    ttservuringdel(ring);
+    return NULL;
+  }
+  char *sqmap = ring->sqmap;
+  ring->sqhead = (uint32_t *)(sqmap + params.sq_off.head);
+  ring->sqtail = (uint32_t *)(sqmap + params.sq_off.tail);
+  ring->sqarray = (uint32_t *)(sqmap + params.sq_off.array);
+  ring->sqmask = *(uint32_t *)(sqmap + params.sq_off.ring_mask);
+  ring->sqnum = params.sq_entries;
+  ring->sqlast = *ring->sqtail;
+  char *cqmap = ring->cqmap;
+  ring->cqhead = (uint32_t *)(cqmap + params.cq_off.head);
+  ring->cqtail = (uint32_t *)(cqmap + params.cq_off.tail);
+  ring->cqmask = *(uint32_t *)(cqmap + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cqmap + params.cq_off.cqes);
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = (uintptr_t)ring->bring;
+  reg.ring_entries = TTURINGBUFNUM;
+  reg.bgid = TTURINGBGID;
+  if(syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0){
+    ttservuringdel(ring);
+    return NULL;
+  }
+  ring->bufs = tcmalloc((size_t)TTURINGBUFNUM * TTURINGBUFSIZ);
+  for(int i = 0; i < TTURINGBUFNUM; i++){
+    ttservuringputbuf(ring, i);
+  }
+  return ring;
+#else
+  return NULL;
+#endif
+}
+
+
+/* Delete an I/O ring of a worker of a server object.
+   `uring' specifies the opaque pointer to the ring. */
+static void ttservuringdel(void *uring){
+#if defined(_TT_URING)
+  TTURING *ring = uring;
+  close(ring->fd);
+  if(ring->bring) munmap(ring->bring, ring->bmsiz);
+  if(ring->sqes) munmap(ring->sqes, ring->sqesiz);
+  if(ring->cqmap) munmap(ring->cqmap, ring->cqmsiz);
+  if(ring->sqmap) munmap(ring->sqmap, ring->sqmsiz);
+  free(ring->bufs);
+  free(ring);
+#endif
+}
+
+
+#if defined(_TT_URING)
+
+
+/* Set the options of a socket connected to a client.
+   `fd' specifies the file descriptor of the socket.
+   `tcp' specifies whether the socket is of TCP/IP. */
+static void ttservsetsockopts(int fd, bool tcp){
+  int optint = 1;
+  setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (char *)&optint, sizeof(optint));
+  struct timeval opttv;
+  opttv.tv_sec = (int)SOCKRCVTIMEO;
+  opttv.tv_usec = (SOCKRCVTIMEO - (int)SOCKRCVTIMEO) * 1000000;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&opttv, sizeof(opttv));
+  opttv.tv_sec = (int)SOCKSNDTIMEO;
+  opttv.tv_usec = (SOCKSNDTIMEO - (int)SOCKSNDTIMEO) * 1000000;
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&opttv, sizeof(opttv));
+  if(tcp){
+    optint = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char *)&optint, sizeof(optint));
+  }
+}
+
+
+/* Get a free submission entry of an I/O ring.
+   `ring' specifies the ring object.
+   The return value is the cleared entry or `NULL' if the queue is full.
+   The entry is not visible to the kernel until `ttservuringpush' is called. */
+static struct io_uring_sqe *ttservuringsqe(TTURING *ring){
+  if(ring->sqlast - __atomic_load_n(ring->sqhead, __ATOMIC_ACQUIRE) >= ring->sqnum){
+    ttservuringenter(ring, 0, 0);
+    if(ring->sqlast - __atomic_load_n(ring->sqhead, __ATOMIC_ACQUIRE) >= ring->sqnum)
+      return NULL;
+  }
+  uint32_t idx = ring->sqlast & ring->sqmask;
+  struct io_uring_sqe *sqe = ring->sqes + idx;
+  memset(sqe, 0, sizeof(*sqe));
+  ring->sqarray[idx] = idx;
+  return sqe;
+}
+
+
+/* Publish the submission entry got last from an I/O ring.
+   `ring' specifies the ring object. */
+static void ttservuringpush(TTURING *ring){
+  ring->sqlast++;
+  __atomic_store_n(ring->sqtail, ring->sqlast, __ATOMIC_RELEASE);
+}
+
+
+/* Submit the pending entries of an I/O ring and wait for completions.
+   `ring' specifies the ring object.
+   `min' specifies the minimum number of completions to wait for.
+   `timeout' specifies the timeout in seconds of waiting.
+   The return value is the number of submitted entries or -1 on failure. */
+static int ttservuringenter(TTURING *ring, int min, double timeout){
+  uint32_t num = ring->sqlast - __atomic_load_n(ring->sqhead, __ATOMIC_ACQUIRE);
+  if(num < 1 && min < 1) return 0;
+  struct __kernel_timespec ts;
+  memset(&ts, 0, sizeof(ts));
+  ts.tv_sec = (int64_t)timeout;
+  ts.tv_nsec = (timeout - (int64_t)timeout) * 1000000000.0;
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  arg.ts = (uintptr_t)&ts;
+  unsigned int flags = min > 0 ? IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG : 0;
+  return syscall(__NR_io_uring_enter, ring->fd, num, min, flags,
+                 min > 0 ? &arg : NULL, min > 0 ? sizeof(arg) : 0);
+}
+
+
+/* Queue a multishot accept on an I/O ring.
+   `ring' specifies the ring object.
+   `lfd' specifies the file descriptor of the listening socket.
+   If successful, the return value is true, else, it is false. */
+static bool ttservuringaccept(TTURING *ring, int lfd){
+  struct io_uring_sqe *sqe = ttservuringsqe(ring);
+  if(!sqe) return false;
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = lfd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->user_data = TTURINGACCEPT;
+  ttservuringpush(ring);
+  return true;
+}
+
+
+/* Queue a receive into a provided buffer on an I/O ring.
+   `ring' specifies the ring object.
+   `cfd' specifies the file descriptor of the connection.
+   If successful, the return value is true, else, it is false. */
+static bool ttservuringrecv(TTURING *ring, int cfd){
+  struct io_uring_sqe *sqe = ttservuringsqe(ring);
+  if(!sqe) return false;
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = cfd;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = TTURINGBGID;
+  sqe->user_data = (uint64_t)cfd;
+  ttservuringpush(ring);
+  return true;
+}
+
+
+/* Give a provided buffer back to an I/O ring.
+   `ring' specifies the ring object.
+   `bid' specifies the ID of the buffer. */
+static void ttservuringputbuf(TTURING *ring, int bid){
+  uint16_t tail = ring->bring->tail;
+  struct io_uring_buf *buf = ring->bring->bufs + (tail & (TTURINGBUFNUM - 1));
+  buf->addr = (uintptr_t)(ring->bufs + (size_t)bid * TTURINGBUFSIZ);
+  buf->len = TTURINGBUFSIZ;
+  buf->bid = bid;
+  __atomic_store_n(&ring->bring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+#endif
+
+
+
+/*************************************************************************************************
+ * features for experts
+ *************************************************************************************************/
+
+
+#define NULLDEV        "/dev/null"       // path of the null device
+
+
+/* Switch the process into the background. */
+bool ttdaemonize(void){
+  fflush(stdout);
+  fflush(stderr);
+  switch(fork()){
+    case -1: return false;
+    case 0: break;
+    default: _exit(0);
+  }
+  if(setsid() == -1) return false;
+  switch(fork()){
+    case -1: return false;
+    case 0: break;
+    default: _exit(0);
+  }
+  umask(0);
+  if(chdir(MYPATHSTR) == -1) return false;
+  close(0);
+  close(1);
+  close(2);
+  int fd = open(NULLDEV, O_RDWR, 0);
+  if(fd != -1){
+    dup2(fd, 0);
+    dup2(fd, 1);
+    dup2(fd, 2);
+    if(fd > 2) close(fd);
   }
   return true;
 }
@@ -1455,6 +2589,8 @@ const char *ttcmdidtostr(int id){
     case TTCMDPUT: return "put";
     case TTCMDPUTKEEP: return "putkeep";
     case TTCMDPUTCAT: return "putcat";
+    case TTCMDPUTEXP: return "putexp";
+    case TTCMDPUTKEEPEXP: return "putkeepexp";
     case TTCMDPUTNR: return "putnr";
     case TTCMDOUT: return "out";
     case TTCMDGET: return "get";
@@ -1462,7 +2598,9 @@ const char *ttcmdidtostr(int id){
     case TTCMDVSIZ: return "vsiz";
     case TTCMDITERINIT: return "iterinit";
     case TTCMDITERNEXT: return "iternext";
+    case TTCMDSCAN: return "scan";
     case TTCMDFWMKEYS: return "fwmkeys";
+    case TTCMDRANGE: return "range";
     case TTCMDADDINT: return "addint";
     case TTCMDADDDOUBLE: return "adddouble";
     case TTCMDVANISH: return "vanish";
@@ -1486,6 +2624,8 @@ const char *ttcmdidtostr(int id){
 
 /* private function prototypes */
 static bool tculogflushaiocbp(struct aiocb *aiocbp);
+static int *tculogids(const char *base, int *np);
+static int tculogidcmp(const void *a, const void *b);
 
 
 
@@ -1607,13 +2747,9 @@ bool tculogclose(TCULOG *ulog){
 
 
 /* Get the mutex index of a record. */
-int tculogrmtxidx(TCULOG *ulog, const char *kbuf, int ksiz){
-  assert(ulog && kbuf && ksiz >= 0);
+int tculogrmtxidx(TCULOG *ulog, uint64_t hash){
+  assert(ulog);
   if(!ulog->base || !ulog->aiocbs) return 0;
-  uint32_t hash = 19780211;
-  while(ksiz--){
-    hash = hash * 41 + *(uint8_t *)kbuf++;
-  }
   return hash % TCULRMTXNUM;
 }
 
@@ -1759,6 +2895,122 @@ bool tculogwrite(TCULOG *ulog, uint64_t ts, uint32_t sid, uint32_t mid,
 }
 
 
+/* Get the position of the next message of an update log object. */
+bool tculogpos(TCULOG *ulog, int *np, uint64_t *op){
+  assert(ulog && np && op);
+  if(!ulog->base) return false;
+  if(pthread_rwlock_rdlock(&ulog->rwlck) != 0) return false;
+  bool err = false;
+  *np = ulog->max;
+  if(ulog->fd != -1){
+    *op = ulog->size;
+  } else {
+    char *path = tcsprintf("%s/%08d%s", ulog->base, ulog->max, TCULSUFFIX);
+    struct stat sbuf;
+    if(stat(path, &sbuf) == 0){
+      *op = sbuf.st_size;
+    } else if(errno == ENOENT){
+      *op = 0;
+    } else {
+      err = true;
+    }
+    free(path);
+  }
+  pthread_rwlock_unlock(&ulog->rwlck);
+  return !err;
+}
+
+
+/* Purge old files of an update log object. */
+int tculogpurge(TCULOG *ulog, int num, uint64_t ts, int keep, double age, uint64_t size,
+                const char *arcpath){
+  assert(ulog);
+  if(!ulog->base) return -1;
+  if(pthread_rwlock_rdlock(&ulog->rwlck) != 0) return -1;
+  int inum;
+  int *ids = tculogids(ulog->base, &inum);
+  if(!ids){
+    pthread_rwlock_unlock(&ulog->rwlck);
+    return -1;
+  }
+  uint64_t *sizes = tcmalloc(sizeof(*sizes) * (inum + 1));
+  uint64_t *ftss = tcmalloc(sizeof(*ftss) * (inum + 1));
+  uint64_t tsiz = 0;
+  for(int i = 0; i < inum; i++){
+    char *path = tcsprintf("%s/%08d%s", ulog->base, ids[i], TCULSUFFIX);
+    sizes[i] = 0;
+    ftss[i] = INT64_MAX;
+    int fd = open(path, O_RDONLY, 00644);
+    free(path);
+    if(fd == -1) continue;
+    struct stat sbuf;
+    if(fstat(fd, &sbuf) == 0) sizes[i] = sbuf.st_size;
+    unsigned char buf[sizeof(uint8_t)+sizeof(uint64_t)];
+    if(tcread(fd, buf, sizeof(buf)) && *buf == TCULMAGICNUM){
+      memcpy(ftss + i, buf + sizeof(uint8_t), sizeof(uint64_t));
+      ftss[i] = ntohll(ftss[i]);
+    }
+    close(fd);
+    tsiz += sizes[i];
+  }
+  uint64_t dev = TCULTMDEVALW * 1000000;
+  uint64_t ats = (age > 0) ? (uint64_t)((tctime() - age) * 1000000) : UINT64_MAX;
+  int pnum = 0;
+  for(int i = 0; i < inum - 1; i++){
+    if(ids[i] >= num || ids[i] >= ulog->max) break;
+    uint64_t lts = ftss[i+1];
+    if(lts >= INT64_MAX || lts + dev > ts) break;
+    if(inum - i <= keep || lts > ats) break;
+    if(size > 0 && tsiz <= size) break;
+    char *path = tcsprintf("%s/%08d%s", ulog->base, ids[i], TCULSUFFIX);
+    bool err = false;
+    if(arcpath){
+      char *apath = tcsprintf("%s/%08d%s", arcpath, ids[i], TCULSUFFIX);
+      if(rename(path, apath) != 0) err = true;
+      free(apath);
+    } else if(unlink(path) != 0){
+      err = true;
+    }
+    free(path);
+    if(err){
+      if(pnum < 1) pnum = -1;
+      break;
+    }
+    tsiz -= sizes[i];
+    pnum++;
+  }
+  free(ftss);
+  free(sizes);
+  free(ids);
+  pthread_rwlock_unlock(&ulog->rwlck);
+  return pnum;
+}
+
+
+/* Get the total size of files of an update log object. */
+uint64_t tculogfsiz(TCULOG *ulog, int *fnp){
+  assert(ulog && fnp);
+  *fnp = 0;
+  if(!ulog->base) return 0;
+  if(pthread_rwlock_rdlock(&ulog->rwlck) != 0) return 0;
+  int inum;
+  int *ids = tculogids(ulog->base, &inum);
+  uint64_t tsiz = 0;
+  for(int i = 0; ids && i < inum; i++){
+    char *path = tcsprintf("%s/%08d%s", ulog->base, ids[i], TCULSUFFIX);
+    struct stat sbuf;
+    if(stat(path, &sbuf) == 0){
+      tsiz += sbuf.st_size;
+      (*fnp)++;
+    }
+    free(path);
+  }
+  free(ids);
+  pthread_rwlock_unlock(&ulog->rwlck);
+  return tsiz;
+}
+
+
 /* Create a log reader object. */
 TCULRD *tculrdnew(TCULOG *ulog, uint64_t ts){
   assert(ulog);
@@ -1928,21 +3180,115 @@ const void *tculrdread(TCULRD *ulrd, int *sp, uint64_t *tsp, uint32_t *sidp, uin
 }
 
 
-/* Store a record into a database object. */
-bool tculogdbput(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                  const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+/* Move the position of a log reader object. */
+bool tculrdseek(TCULRD *ulrd, int num, uint64_t off){
+  assert(ulrd && num > 0);
+  TCULOG *ulog = ulrd->ulog;
+  if(pthread_rwlock_rdlock(&ulog->rwlck) != 0) return false;
+  bool err = false;
+  if(ulrd->fd != -1) close(ulrd->fd);
+  ulrd->ts = 0;
+  ulrd->num = num;
+  char *path = tcsprintf("%s/%08d%s", ulog->base, num, TCULSUFFIX);
+  ulrd->fd = open(path, O_RDONLY, 00644);
+  free(path);
+  if(ulrd->fd == -1){
+    if(errno != ENOENT || off > 0) err = true;
+  } else if(lseek(ulrd->fd, off, SEEK_SET) == -1){
+    close(ulrd->fd);
+    ulrd->fd = -1;
+    err = true;
+  }
+  pthread_rwlock_unlock(&ulog->rwlck);
+  return !err;
+}
+
+
+/* Store a record into a database object. */
+bool tculogdbput(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                  const void *kbuf, int ksiz, const void *vbuf, int vsiz, uint64_t hash){
+  assert(ulog && mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  bool err = false;
+  int rmidx = tculogrmtxidx(ulog, hash);
+  bool dolog = tculogbegin(ulog, rmidx);
+  tcmdbputhash(mdb, kbuf, ksiz, vbuf, vsiz, hash);
+  if(dolog){
+    unsigned char mstack[TTIOBUFSIZ];
+    int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + ksiz + vsiz;
+    unsigned char *mbuf = (msiz < TTIOBUFSIZ) ? mstack : tcmalloc(msiz + 1);
+    unsigned char *wp = mbuf;
+    *(wp++) = TTMAGICNUM;
+    *(wp++) = TTCMDPUT;
+    uint32_t lnum;
+    lnum = htonl(ksiz);
+    memcpy(wp, &lnum, sizeof(lnum));
+    wp += sizeof(lnum);
+    lnum = htonl(vsiz);
+    memcpy(wp, &lnum, sizeof(lnum));
+    wp += sizeof(lnum);
+    memcpy(wp, kbuf, ksiz);
+    wp += ksiz;
+    memcpy(wp, vbuf, vsiz);
+    wp += vsiz;
+    *(wp++) = err ? 1 : 0;
+    if(!tculogwrite(ulog, 0, sid, mid, mbuf, msiz)) err = true;
+    if(mbuf != mstack) free(mbuf);
+    tculogend(ulog, rmidx);
+  }
+  return !err;
+}
+
+
+/* Store a new record into a database object. */
+bool tculogdbputkeep(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                      const void *kbuf, int ksiz, const void *vbuf, int vsiz, uint64_t hash){
+  assert(ulog && mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  bool err = false;
+  int rmidx = tculogrmtxidx(ulog, hash);
+  bool dolog = tculogbegin(ulog, rmidx);
+  if(!tcmdbputkeephash(mdb, kbuf, ksiz, vbuf, vsiz, hash)) err = true;
+  if(dolog){
+    unsigned char mstack[TTIOBUFSIZ];
+    int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + ksiz + vsiz;
+    unsigned char *mbuf = (msiz < TTIOBUFSIZ) ? mstack : tcmalloc(msiz + 1);
+    unsigned char *wp = mbuf;
+    *(wp++) = TTMAGICNUM;
+    *(wp++) = TTCMDPUTKEEP;
+    uint32_t lnum;
+    lnum = htonl(ksiz);
+    memcpy(wp, &lnum, sizeof(lnum));
+    wp += sizeof(lnum);
+    lnum = htonl(vsiz);
+    memcpy(wp, &lnum, sizeof(lnum));
+    wp += sizeof(lnum);
+    memcpy(wp, kbuf, ksiz);
+    wp += ksiz;
+    memcpy(wp, vbuf, vsiz);
+    wp += vsiz;
+    *(wp++) = err ? 1 : 0;
+    if(!tculogwrite(ulog, 0, sid, mid, mbuf, msiz)) err = true;
+    if(mbuf != mstack) free(mbuf);
+    tculogend(ulog, rmidx);
+  }
+  return !err;
+}
+
+
+/* Concatenate a value at the end of the existing record in a database object. */
+bool tculogdbputcat(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                     const void *kbuf, int ksiz, const void *vbuf, int vsiz, uint64_t hash){
   assert(ulog && mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
   bool err = false;
-  int rmidx = tculogrmtxidx(ulog, kbuf, ksiz);
+  int rmidx = tculogrmtxidx(ulog, hash);
   bool dolog = tculogbegin(ulog, rmidx);
-  tcmdbput(mdb, kbuf, ksiz, vbuf, vsiz);
+  tcmdbputcathash(mdb, kbuf, ksiz, vbuf, vsiz, hash);
   if(dolog){
     unsigned char mstack[TTIOBUFSIZ];
     int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + ksiz + vsiz;
     unsigned char *mbuf = (msiz < TTIOBUFSIZ) ? mstack : tcmalloc(msiz + 1);
     unsigned char *wp = mbuf;
     *(wp++) = TTMAGICNUM;
-    *(wp++) = TTCMDPUT;
+    *(wp++) = TTCMDPUTCAT;
     uint32_t lnum;
     lnum = htonl(ksiz);
     memcpy(wp, &lnum, sizeof(lnum));
@@ -1963,21 +3309,23 @@ bool tculogdbput(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 }
 
 
-/* Store a new record into a database object. */
-bool tculogdbputkeep(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                      const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+/* Store a record with an expiration time into a database object. */
+bool tculogdbputexp(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                    const void *kbuf, int ksiz, const void *vbuf, int vsiz, int64_t xtime,
+                    uint64_t hash){
   assert(ulog && mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(xtime < 1) return tculogdbput(ulog, sid, mid, mdb, kbuf, ksiz, vbuf, vsiz, hash);
   bool err = false;
-  int rmidx = tculogrmtxidx(ulog, kbuf, ksiz);
+  int rmidx = tculogrmtxidx(ulog, hash);
   bool dolog = tculogbegin(ulog, rmidx);
-  if(!tcmdbputkeep(mdb, kbuf, ksiz, vbuf, vsiz)) err = true;
+  tcmdbputexphash(mdb, kbuf, ksiz, vbuf, vsiz, xtime, hash);
   if(dolog){
     unsigned char mstack[TTIOBUFSIZ];
-    int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + ksiz + vsiz;
+    int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + sizeof(uint64_t) + ksiz + vsiz;
     unsigned char *mbuf = (msiz < TTIOBUFSIZ) ? mstack : tcmalloc(msiz + 1);
     unsigned char *wp = mbuf;
     *(wp++) = TTMAGICNUM;
-    *(wp++) = TTCMDPUTKEEP;
+    *(wp++) = TTCMDPUTEXP;
     uint32_t lnum;
     lnum = htonl(ksiz);
     memcpy(wp, &lnum, sizeof(lnum));
@@ -1985,6 +3333,9 @@ bool tculogdbputkeep(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
     lnum = htonl(vsiz);
     memcpy(wp, &lnum, sizeof(lnum));
     wp += sizeof(lnum);
+    uint64_t llnum = htonll((uint64_t)xtime);
+    memcpy(wp, &llnum, sizeof(llnum));
+    wp += sizeof(llnum);
     memcpy(wp, kbuf, ksiz);
     wp += ksiz;
     memcpy(wp, vbuf, vsiz);
@@ -1998,21 +3349,23 @@ bool tculogdbputkeep(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 }
 
 
-/* Concatenate a value at the end of the existing record in a database object. */
-bool tculogdbputcat(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                     const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+/* Store a new record with an expiration time into a database object. */
+bool tculogdbputkeepexp(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                        const void *kbuf, int ksiz, const void *vbuf, int vsiz, int64_t xtime,
+                        uint64_t hash){
   assert(ulog && mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(xtime < 1) return tculogdbputkeep(ulog, sid, mid, mdb, kbuf, ksiz, vbuf, vsiz, hash);
   bool err = false;
-  int rmidx = tculogrmtxidx(ulog, kbuf, ksiz);
+  int rmidx = tculogrmtxidx(ulog, hash);
   bool dolog = tculogbegin(ulog, rmidx);
-  tcmdbputcat(mdb, kbuf, ksiz, vbuf, vsiz);
+  if(!tcmdbputkeepexphash(mdb, kbuf, ksiz, vbuf, vsiz, xtime, hash)) err = true;
   if(dolog){
     unsigned char mstack[TTIOBUFSIZ];
-    int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + ksiz + vsiz;
+    int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + sizeof(uint64_t) + ksiz + vsiz;
     unsigned char *mbuf = (msiz < TTIOBUFSIZ) ? mstack : tcmalloc(msiz + 1);
     unsigned char *wp = mbuf;
     *(wp++) = TTMAGICNUM;
-    *(wp++) = TTCMDPUTCAT;
+    *(wp++) = TTCMDPUTKEEPEXP;
     uint32_t lnum;
     lnum = htonl(ksiz);
     memcpy(wp, &lnum, sizeof(lnum));
@@ -2020,6 +3373,9 @@ bool tculogdbputcat(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
     lnum = htonl(vsiz);
     memcpy(wp, &lnum, sizeof(lnum));
     wp += sizeof(lnum);
+    uint64_t llnum = htonll((uint64_t)xtime);
+    memcpy(wp, &llnum, sizeof(llnum));
+    wp += sizeof(llnum);
     memcpy(wp, kbuf, ksiz);
     wp += ksiz;
     memcpy(wp, vbuf, vsiz);
@@ -2035,12 +3391,12 @@ bool tculogdbputcat(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 
 /* Remove a record of a database object. */
 bool tculogdbout(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                  const void *kbuf, int ksiz){
+                  const void *kbuf, int ksiz, uint64_t hash){
   assert(ulog && mdb && kbuf && ksiz >= 0);
   bool err = false;
-  int rmidx = tculogrmtxidx(ulog, kbuf, ksiz);
+  int rmidx = tculogrmtxidx(ulog, hash);
   bool dolog = tculogbegin(ulog, rmidx);
-  if(!tcmdbout(mdb, kbuf, ksiz)) err = true;
+  if(!tcmdbouthash(mdb, kbuf, ksiz, hash)) err = true;
   if(dolog){
     unsigned char mstack[TTIOBUFSIZ];
     int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) + ksiz;
@@ -2065,11 +3421,11 @@ bool tculogdbout(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 
 /* Add an integer to a record in a database object. */
 int tculogdbaddint(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                    const void *kbuf, int ksiz, int num){
+                    const void *kbuf, int ksiz, int num, uint64_t hash){
   assert(ulog && mdb && kbuf && ksiz >= 0);
-  int rmidx = tculogrmtxidx(ulog, kbuf, ksiz);
+  int rmidx = tculogrmtxidx(ulog, hash);
   bool dolog = num != 0 && tculogbegin(ulog, rmidx);
-  int rnum = tcmdbaddint(mdb, kbuf, ksiz, num);
+  int rnum = tcmdbaddinthash(mdb, kbuf, ksiz, num, hash);
   if(dolog){
     unsigned char mstack[TTIOBUFSIZ];
     int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + ksiz;
@@ -2097,11 +3453,11 @@ int tculogdbaddint(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 
 /* Add a real number to a record in a database object. */
 double tculogdbadddouble(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                          const void *kbuf, int ksiz, double num){
+                          const void *kbuf, int ksiz, double num, uint64_t hash){
   assert(ulog && mdb && kbuf && ksiz >= 0);
-  int rmidx = tculogrmtxidx(ulog, kbuf, ksiz);
+  int rmidx = tculogrmtxidx(ulog, hash);
   bool dolog = num != 0 && tculogbegin(ulog, rmidx);
-  double rnum = tcmdbadddouble(mdb, kbuf, ksiz, num);
+  double rnum = tcmdbadddoublehash(mdb, kbuf, ksiz, num, hash);
   if(dolog){
     unsigned char mstack[TTIOBUFSIZ];
     int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) + sizeof(uint64_t) * 2 + ksiz;
@@ -2126,6 +3482,51 @@ double tculogdbadddouble(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 }
 
 
+/* Add an integer to a decimal counter of a record in a database object. */
+int tculogdbincr(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                 const void *kbuf, int ksiz, int64_t num, uint64_t *np, uint64_t hash){
+  assert(ulog && mdb && kbuf && ksiz >= 0 && np);
+  int rmidx = tculogrmtxidx(ulog, hash);
+  bool dolog = tculogbegin(ulog, rmidx);
+  int rv = tcmdbincrhash(mdb, kbuf, ksiz, num, np, hash);
+  if(dolog){
+    if(rv > 0){
+      char vbuf[TCNUMBUFSIZ];
+      int vsiz = sprintf(vbuf, "%llu", (unsigned long long)*np);
+      int64_t xtime = tcmdbxtimehash(mdb, kbuf, ksiz, hash);
+      unsigned char mstack[TTIOBUFSIZ];
+      int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) * 2 + ksiz + vsiz;
+      if(xtime > 0) msiz += sizeof(uint64_t);
+      unsigned char *mbuf = (msiz < TTIOBUFSIZ) ? mstack : tcmalloc(msiz + 1);
+      unsigned char *wp = mbuf;
+      *(wp++) = TTMAGICNUM;
+      *(wp++) = (xtime > 0) ? TTCMDPUTEXP : TTCMDPUT;
+      uint32_t lnum;
+      lnum = htonl(ksiz);
+      memcpy(wp, &lnum, sizeof(lnum));
+      wp += sizeof(lnum);
+      lnum = htonl(vsiz);
+      memcpy(wp, &lnum, sizeof(lnum));
+      wp += sizeof(lnum);
+      if(xtime > 0){
+        uint64_t llnum = htonll((uint64_t)xtime);
+        memcpy(wp, &llnum, sizeof(llnum));
+        wp += sizeof(llnum);
+      }
+      memcpy(wp, kbuf, ksiz);
+      wp += ksiz;
+      memcpy(wp, vbuf, vsiz);
+      wp += vsiz;
+      *(wp++) = 0;
+      if(!tculogwrite(ulog, 0, sid, mid, mbuf, msiz)) rv = -1;
+      if(mbuf != mstack) free(mbuf);
+    }
+    tculogend(ulog, rmidx);
+  }
+  return rv;
+}
+
+
 /* Remove all records of a database object. */
 bool tculogdbvanish(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb){
   assert(ulog && mdb);
@@ -2145,6 +3546,45 @@ bool tculogdbvanish(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb){
 }
 
 
+/* Remove expired records of a database object. */
+int tculogdbexpire(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb, int64_t now, int max){
+  assert(ulog && mdb && max >= 0);
+  TCLIST *keys = tcmdbxkeys(mdb, now, max);
+  int xnum = 0;
+  for(int i = 0; i < tclistnum(keys); i++){
+    int ksiz;
+    const char *kbuf = tclistval(keys, i, &ksiz);
+    uint64_t hash = tcmdbhash(kbuf, ksiz);
+    int rmidx = tculogrmtxidx(ulog, hash);
+    bool dolog = tculogbegin(ulog, rmidx);
+    bool hit = tcmdbxouthash(mdb, kbuf, ksiz, now, hash);
+    if(hit) xnum++;
+    if(dolog){
+      if(hit){
+        unsigned char mstack[TTIOBUFSIZ];
+        int msiz = sizeof(uint8_t) * 3 + sizeof(uint32_t) + ksiz;
+        unsigned char *mbuf = (msiz < TTIOBUFSIZ) ? mstack : tcmalloc(msiz + 1);
+        unsigned char *wp = mbuf;
+        *(wp++) = TTMAGICNUM;
+        *(wp++) = TTCMDOUT;
+        uint32_t lnum;
+        lnum = htonl(ksiz);
+        memcpy(wp, &lnum, sizeof(lnum));
+        wp += sizeof(lnum);
+        memcpy(wp, kbuf, ksiz);
+        wp += ksiz;
+        *(wp++) = 0;
+        tculogwrite(ulog, 0, sid, mid, mbuf, msiz);
+        if(mbuf != mstack) free(mbuf);
+      }
+      tculogend(ulog, rmidx);
+    }
+  }
+  tclistdel(keys);
+  return xnum;
+}
+
+
 /* Call a versatile function for miscellaneous operations of a database object. */
 TCLIST *tculogdbmisc(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
                       const char *name, const TCLIST *args){
@@ -2227,6 +3667,46 @@ bool tculogdbrestore(TCMDB *mdb, const char *path, uint64_t ts, bool con, TCULOG
 }
 
 
+/* Restore a database object from a position of the update log. */
+bool tculogdbrestore2(TCMDB *mdb, const char *path, int num, uint64_t off, TCULOG *ulog,
+                      uint64_t *rnp){
+  assert(mdb && path && num > 0);
+  bool err = false;
+  uint64_t rnum = 0;
+  TCULOG *sulog = tculognew();
+  if(tculogopen(sulog, path, 0)){
+    TCULRD *ulrd = tculrdnew(sulog, 0);
+    if(ulrd){
+      if(tculrdseek(ulrd, num, off)){
+        const char *rbuf;
+        int rsiz;
+        uint64_t rts;
+        uint32_t rsid, rmid;
+        while((rbuf = tculrdread(ulrd, &rsiz, &rts, &rsid, &rmid)) != NULL){
+          bool cc;
+          if(!tculogdbredo(mdb, rbuf, rsiz, ulog, rsid, rmid, &cc)){
+            err = true;
+            break;
+          }
+          rnum++;
+        }
+      } else {
+        err = true;
+      }
+      tculrddel(ulrd);
+    } else {
+      err = true;
+    }
+    if(!tculogclose(sulog)) err = true;
+  } else {
+    err = true;
+  }
+  tculogdel(sulog);
+  if(rnp) *rnp = rnum;
+  return !err;
+}
+
+
 /* Redo an update log message. */
 bool tculogdbredo(TCMDB *mdb, const char *ptr, int size, TCULOG *ulog,
                    uint32_t sid, uint32_t mid, bool *cp){
@@ -2251,7 +3731,8 @@ bool tculogdbredo(TCMDB *mdb, const char *ptr, int size, TCULOG *ulog,
         memcpy(&vsiz, rp, sizeof(vsiz));
         vsiz = ntohl(vsiz);
         rp += sizeof(vsiz);
-        if(tculogdbput(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz) != exp) *cp = false;
+        uint64_t hash = tcmdbhash(rp, ksiz);
+        if(tculogdbput(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz, hash) != exp) *cp = false;
       } else {
         err = true;
       }
@@ -2266,7 +3747,36 @@ bool tculogdbredo(TCMDB *mdb, const char *ptr, int size, TCULOG *ulog,
         memcpy(&vsiz, rp, sizeof(vsiz));
         vsiz = ntohl(vsiz);
         rp += sizeof(vsiz);
-        if(tculogdbputkeep(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz) != exp) *cp = false;
+        uint64_t hash = tcmdbhash(rp, ksiz);
+        if(tculogdbputkeep(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz, hash) != exp)
+          *cp = false;
+      } else {
+        err = true;
+      }
+      break;
+    case TTCMDPUTEXP:
+    case TTCMDPUTKEEPEXP:
+      if(size >= sizeof(uint32_t) * 2 + sizeof(uint64_t)){
+        uint32_t ksiz;
+        memcpy(&ksiz, rp, sizeof(ksiz));
+        ksiz = ntohl(ksiz);
+        rp += sizeof(ksiz);
+        uint32_t vsiz;
+        memcpy(&vsiz, rp, sizeof(vsiz));
+        vsiz = ntohl(vsiz);
+        rp += sizeof(vsiz);
+        uint64_t xtime;
+        memcpy(&xtime, rp, sizeof(xtime));
+        xtime = ntohll(xtime);
+        rp += sizeof(xtime);
+        uint64_t hash = tcmdbhash(rp, ksiz);
+        if(cmd == TTCMDPUTEXP){
+          if(tculogdbputexp(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz, (int64_t)xtime,
+                            hash) != exp) *cp = false;
+        } else {
+          if(tculogdbputkeepexp(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz, (int64_t)xtime,
+                                hash) != exp) *cp = false;
+        }
       } else {
         err = true;
       }
@@ -2281,7 +3791,9 @@ bool tculogdbredo(TCMDB *mdb, const char *ptr, int size, TCULOG *ulog,
         memcpy(&vsiz, rp, sizeof(vsiz));
         vsiz = ntohl(vsiz);
         rp += sizeof(vsiz);
-        if(tculogdbputcat(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz) != exp) *cp = false;
+        uint64_t hash = tcmdbhash(rp, ksiz);
+        if(tculogdbputcat(ulog, sid, mid, mdb, rp, ksiz, rp + ksiz, vsiz, hash) != exp)
+          *cp = false;
       } else {
         err = true;
       }
@@ -2292,7 +3804,8 @@ bool tculogdbredo(TCMDB *mdb, const char *ptr, int size, TCULOG *ulog,
         memcpy(&ksiz, rp, sizeof(ksiz));
         ksiz = ntohl(ksiz);
         rp += sizeof(ksiz);
-        if(tculogdbout(ulog, sid, mid, mdb, rp, ksiz) != exp) *cp = false;
+        uint64_t hash = tcmdbhash(rp, ksiz);
+        if(tculogdbout(ulog, sid, mid, mdb, rp, ksiz, hash) != exp) *cp = false;
       } else {
         err = true;
       }
@@ -2307,7 +3820,8 @@ bool tculogdbredo(TCMDB *mdb, const char *ptr, int size, TCULOG *ulog,
         memcpy(&num, rp, sizeof(num));
         num = ntohl(num);
         rp += sizeof(num);
-        int rnum = tculogdbaddint(ulog, sid, mid, mdb, rp, ksiz, num);
+        uint64_t hash = tcmdbhash(rp, ksiz);
+        int rnum = tculogdbaddint(ulog, sid, mid, mdb, rp, ksiz, num, hash);
         if(exp && rnum == INT_MIN) *cp = false;
       } else {
         err = true;
@@ -2321,7 +3835,8 @@ bool tculogdbredo(TCMDB *mdb, const char *ptr, int size, TCULOG *ulog,
         rp += sizeof(ksiz);
         double num = ttunpackdouble((char *)rp);
         rp += sizeof(uint64_t) * 2;
-        double rnum = tculogdbadddouble(ulog, sid, mid, mdb, rp, ksiz, num);
+        uint64_t hash = tcmdbhash(rp, ksiz);
+        double rnum = tculogdbadddouble(ulog, sid, mid, mdb, rp, ksiz, num, hash);
         if(exp && isnan(rnum)) *cp = false;
       } else {
         err = true;
@@ -2504,6 +4019,44 @@ static bool tculogflushaiocbp(struct aiocb *aiocbp){
 }
 
 
+/* Get the sorted ID numbers of files of an update log.
+   `base' specifies the path of the base directory.
+   `np' specifies the pointer to the variable into which the number of the IDs is assigned.
+   If successful, the return value is the pointer to the array of the IDs, else, it is `NULL'.
+   Because the region of the return value is allocated with the `malloc' call, it should be
+   released with the `free' call when it is no longer in use. */
+static int *tculogids(const char *base, int *np){
+  assert(base && np);
+  TCLIST *names = tcreaddir(base);
+  if(!names) return NULL;
+  int ln = tclistnum(names);
+  int *ids = tcmalloc(sizeof(*ids) * (ln + 1));
+  int num = 0;
+  for(int i = 0; i < ln; i++){
+    const char *name = tclistval2(names, i);
+    if(!tcstrbwm(name, TCULSUFFIX)) continue;
+    int id = tcatoi(name);
+    if(id > 0) ids[num++] = id;
+  }
+  tclistdel(names);
+  qsort(ids, num, sizeof(*ids), tculogidcmp);
+  *np = num;
+  return ids;
+}
+
+
+/* Compare two ID numbers of files of an update log.
+   `a' specifies the pointer to one ID.
+   `b' specifies the pointer to the other ID.
+   The return value is positive if the former is big, negative if the latter is big, 0 if both
+   are equivalent. */
+static int tculogidcmp(const void *a, const void *b){
+  int an = *(int *)a;
+  int bn = *(int *)b;
+  return (an > bn) ? 1 : (an < bn) ? -1 : 0;
+}
+
+
 #define RDBRECONWAIT   0.1               // wait time to reconnect
 #define RDBNUMCOLMAX   16                // maximum number of columns of the long double
 
@@ -2526,6 +4079,8 @@ static bool tcrdbcloseimpl(TCRDB *rdb);
 static bool tcrdbputimpl(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 static bool tcrdbputkeepimpl(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 static bool tcrdbputcatimpl(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+static bool tcrdbputexpimpl(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                            int xtime);
 static bool tcrdbputnrimpl(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 static bool tcrdboutimpl(TCRDB *rdb, const void *kbuf, int ksiz);
 static void *tcrdbgetimpl(TCRDB *rdb, const void *kbuf, int ksiz, int *sp);
@@ -2533,7 +4088,10 @@ static bool tcrdbmgetimpl(TCRDB *rdb, TCMAP *recs);
 static int tcrdbvsizimpl(TCRDB *rdb, const void *kbuf, int ksiz);
 static bool tcrdbiterinitimpl(TCRDB *rdb);
 static void *tcrdbiternextimpl(TCRDB *rdb, int *sp);
+static TCLIST *tcrdbscanimpl(TCRDB *rdb, uint64_t *cp, int max, bool vals);
 static TCLIST *tcrdbfwmkeysimpl(TCRDB *rdb, const void *pbuf, int psiz, int max);
+static TCLIST *tcrdbrangeimpl(TCRDB *rdb, const void *bkbuf, int bksiz, const void *ekbuf,
+                              int eksiz, int max, bool vals);
 static int tcrdbaddintimpl(TCRDB *rdb, const void *kbuf, int ksiz, int num);
 static double tcrdbadddoubleimpl(TCRDB *rdb, const void *kbuf, int ksiz, double num);
 static bool tcrdbvanishimpl(TCRDB *rdb);
@@ -2699,6 +4257,18 @@ bool tcrdbputkeep(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int
 }
 
 
+/* Store a record with an expiration time into a remote database object. */
+bool tcrdbputexp(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz, int xtime){
+  assert(rdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(!tcrdblockmethod(rdb)) return false;
+  bool rv;
+  pthread_cleanup_push((void (*)(void *))tcrdbunlockmethod, rdb);
+  rv = tcrdbputexpimpl(rdb, kbuf, ksiz, vbuf, vsiz, xtime);
+  pthread_cleanup_pop(1);
+  return rv;
+}
+
+
 /* Concatenate a value at the end of the existing record in a remote database object. */
 bool tcrdbputcat(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
   assert(rdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
@@ -2802,6 +4372,18 @@ void *tcrdbiternext(TCRDB *rdb, int *sp){
 }
 
 
+/* Scan records of a remote database object with a cursor. */
+TCLIST *tcrdbscan(TCRDB *rdb, uint64_t *cp, int max, bool vals){
+  assert(rdb && cp);
+  if(!tcrdblockmethod(rdb)) return NULL;
+  TCLIST *rv;
+  pthread_cleanup_push((void (*)(void *))tcrdbunlockmethod, rdb);
+  rv = tcrdbscanimpl(rdb, cp, max, vals);
+  pthread_cleanup_pop(1);
+  return rv;
+}
+
+
 /* Get forward matching keys in a remote database object. */
 TCLIST *tcrdbfwmkeys(TCRDB *rdb, const void *pbuf, int psiz, int max){
   assert(rdb && pbuf && psiz >= 0);
@@ -2821,6 +4403,19 @@ TCLIST *tcrdbfwmkeys2(TCRDB *rdb, const char *pstr, int max){
 }
 
 
+/* Get keys of ranged records in a remote database object. */
+TCLIST *tcrdbrange(TCRDB *rdb, const void *bkbuf, int bksiz, const void *ekbuf, int eksiz,
+                   int max, bool vals){
+  assert(rdb && (!bkbuf || bksiz >= 0) && (!ekbuf || eksiz >= 0));
+  if(!tcrdblockmethod(rdb)) return tclistnew2(1);
+  TCLIST *rv;
+  pthread_cleanup_push((void (*)(void *))tcrdbunlockmethod, rdb);
+  rv = tcrdbrangeimpl(rdb, bkbuf, bksiz, ekbuf, eksiz, max, vals);
+  pthread_cleanup_pop(1);
+  return rv;
+}
+
+
 /* Add an integer to a record in a remote database object. */
 int tcrdbaddint(TCRDB *rdb, const void *kbuf, int ksiz, int num){
   assert(rdb && kbuf && ksiz >= 0);
@@ -3228,6 +4823,60 @@ static bool tcrdbputkeepimpl(TCRDB *rdb, const void *kbuf, int ksiz, const void
 }
 
 
+/* Store a record with an expiration time into a remote database object.
+   `rdb' specifies the remote database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time.
+   If successful, the return value is true, else, it is false. */
+static bool tcrdbputexpimpl(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                            int xtime){
+  assert(rdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(rdb->fd < 0){
+    if(!rdb->host || !(rdb->opts & RDBTRECON)){
+      tcrdbsetecode(rdb, TTEINVALID);
+      return false;
+    }
+    if(!tcrdbreconnect(rdb)) return false;
+  }
+  bool err = false;
+  int rsiz = 2 + sizeof(uint32_t) * 3 + ksiz + vsiz;
+  unsigned char stack[TTIOBUFSIZ];
+  unsigned char *buf = (rsiz < TTIOBUFSIZ) ? stack : tcmalloc(rsiz);
+  pthread_cleanup_push(free, (buf == stack) ? NULL : buf);
+  unsigned char *wp = buf;
+  *(wp++) = TTMAGICNUM;
+  *(wp++) = TTCMDPUTEXP;
+  uint32_t num;
+  num = htonl((uint32_t)ksiz);
+  memcpy(wp, &num, sizeof(uint32_t));
+  wp += sizeof(uint32_t);
+  num = htonl((uint32_t)vsiz);
+  memcpy(wp, &num, sizeof(uint32_t));
+  wp += sizeof(uint32_t);
+  num = htonl((uint32_t)xtime);
+  memcpy(wp, &num, sizeof(uint32_t));
+  wp += sizeof(uint32_t);
+  memcpy(wp, kbuf, ksiz);
+  wp += ksiz;
+  memcpy(wp, vbuf, vsiz);
+  wp += vsiz;
+  if(tcrdbsend(rdb, buf, wp - buf)){
+    int code = ttsockgetc(rdb->sock);
+    if(code != 0){
+      tcrdbsetecode(rdb, code == -1 ? TTERECV : TTEMISC);
+      err = true;
+    }
+  } else {
+    err = true;
+  }
+  pthread_cleanup_pop(1);
+  return !err;
+}
+
+
 /* Concatenate a value at the end of the existing record in a remote database object.
    `rdb' specifies the remote database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -3383,8 +5032,9 @@ static void *tcrdbgetimpl(TCRDB *rdb, const void *kbuf, int ksiz, int *sp){
   unsigned char *buf = (rsiz < TTIOBUFSIZ) ? stack : tcmalloc(rsiz);
   pthread_cleanup_push(free, (buf == stack) ? NULL : buf);
   unsigned char *wp = buf;
+  bool cmp = rdb->opts & RDBTCMP;
   *(wp++) = TTMAGICNUM;
-  *(wp++) = TTCMDGET;
+  *(wp++) = cmp ? TTCMDGETCMP : TTCMDGET;
   uint32_t num;
   num = htonl((uint32_t)ksiz);
   memcpy(wp, &num, sizeof(uint32_t));
@@ -3394,12 +5044,19 @@ static void *tcrdbgetimpl(TCRDB *rdb, const void *kbuf, int ksiz, int *sp){
   if(tcrdbsend(rdb, buf, wp - buf)){
     int code = ttsockgetc(rdb->sock);
     if(code == 0){
+      int zflag = cmp ? ttsockgetc(rdb->sock) : 0;
       int vsiz = ttsockgetint32(rdb->sock);
       if(!ttsockcheckend(rdb->sock) && vsiz >= 0){
         vbuf = tcmalloc(vsiz + 1);
         if(ttsockrecv(rdb->sock, vbuf, vsiz)){
           vbuf[vsiz] = '\0';
           *sp = vsiz;
+          if(zflag){
+            char *zbuf = vbuf;
+            vbuf = tclzdecode(zbuf, vsiz, sp);
+            free(zbuf);
+            if(!vbuf) tcrdbsetecode(rdb, TTERECV);
+          }
         } else {
           tcrdbsetecode(rdb, TTERECV);
           free(vbuf);
@@ -3611,6 +5268,82 @@ static void *tcrdbiternextimpl(TCRDB *rdb, int *sp){
 }
 
 
+/* Scan records of a remote database object with a cursor.
+   `rdb' specifies the remote database object.
+   `cp' specifies the pointer to the variable of the cursor.
+   `max' specifies the maximum number of records to be fetched.
+   `vals' specifies whether the values are fetched as well as the keys.
+   If successful, the return value is a list object of the keys, each followed by its value if
+   `vals' is true, else, it is `NULL'.  The response has the next cursor in front of the
+   records, and each record has the same layout as that of the mget command. */
+static TCLIST *tcrdbscanimpl(TCRDB *rdb, uint64_t *cp, int max, bool vals){
+  assert(rdb && cp);
+  if(rdb->fd < 0){
+    if(!rdb->host || !(rdb->opts & RDBTRECON)){
+      tcrdbsetecode(rdb, TTEINVALID);
+      return NULL;
+    }
+    if(!tcrdbreconnect(rdb)) return NULL;
+  }
+  if(max < 0) max = INT_MAX;
+  TCLIST *recs = NULL;
+  char stack[TTIOBUFSIZ];
+  unsigned char *wp = (unsigned char *)stack;
+  *(wp++) = TTMAGICNUM;
+  *(wp++) = TTCMDSCAN;
+  uint64_t llnum = htonll(*cp);
+  memcpy(wp, &llnum, sizeof(llnum));
+  wp += sizeof(llnum);
+  uint32_t num;
+  num = htonl((uint32_t)max);
+  memcpy(wp, &num, sizeof(num));
+  wp += sizeof(num);
+  num = htonl((uint32_t)vals);
+  memcpy(wp, &num, sizeof(num));
+  wp += sizeof(num);
+  if(tcrdbsend(rdb, stack, wp - (unsigned char *)stack)){
+    int code = ttsockgetc(rdb->sock);
+    if(code == 0){
+      uint64_t cur = ttsockgetint64(rdb->sock);
+      int rnum = ttsockgetint32(rdb->sock);
+      if(!ttsockcheckend(rdb->sock) && rnum >= 0){
+        recs = tclistnew();
+        for(int i = 0; i < rnum; i++){
+          int rksiz = ttsockgetint32(rdb->sock);
+          int rvsiz = ttsockgetint32(rdb->sock);
+          if(ttsockcheckend(rdb->sock) || rksiz < 0 || rvsiz < 0){
+            tcrdbsetecode(rdb, TTERECV);
+            tclistdel(recs);
+            recs = NULL;
+            break;
+          }
+          int rsiz = rksiz + rvsiz;
+          char *rbuf = (rsiz < TTIOBUFSIZ) ? stack : tcmalloc(rsiz + 1);
+          bool ok = ttsockrecv(rdb->sock, rbuf, rsiz);
+          if(ok){
+            tclistpush(recs, rbuf, rksiz);
+            if(vals) tclistpush(recs, rbuf + rksiz, rvsiz);
+          }
+          if(rbuf != stack) free(rbuf);
+          if(!ok){
+            tcrdbsetecode(rdb, TTERECV);
+            tclistdel(recs);
+            recs = NULL;
+            break;
+          }
+        }
+        if(recs) *cp = cur;
+      } else {
+        tcrdbsetecode(rdb, TTERECV);
+      }
+    } else {
+      tcrdbsetecode(rdb, code == -1 ? TTERECV : TTENOREC);
+    }
+  }
+  return recs;
+}
+
+
 /* Get forward matching keys in a remote database object.
    `rdb' specifies the remote database object.
    `pbuf' specifies the pointer to the region of the prefix.
@@ -3675,6 +5408,93 @@ static TCLIST *tcrdbfwmkeysimpl(TCRDB *rdb, const void *pbuf, int psiz, int max)
 }
 
 
+/* Get keys of ranged records in a remote database object.
+   `rdb' specifies the remote database object.
+   `bkbuf' specifies the pointer to the region of the beginning key or `NULL'.
+   `bksiz' specifies the size of the region of the beginning key.
+   `ekbuf' specifies the pointer to the region of the ending key or `NULL'.
+   `eksiz' specifies the size of the region of the ending key.
+   `max' specifies the maximum number of records to be fetched.
+   `vals' specifies whether the values are fetched as well as the keys.
+   The return value is a list object of the keys, each followed by its value if `vals' is true.
+   The size of the ending key is sent as -1 if it is `NULL'.  Each record of the response has
+   the same layout as that of the mget command, and its value is empty if `vals' is false. */
+static TCLIST *tcrdbrangeimpl(TCRDB *rdb, const void *bkbuf, int bksiz, const void *ekbuf,
+                              int eksiz, int max, bool vals){
+  assert(rdb && (!bkbuf || bksiz >= 0) && (!ekbuf || eksiz >= 0));
+  TCLIST *recs = tclistnew();
+  if(rdb->fd < 0){
+    if(!rdb->host || !(rdb->opts & RDBTRECON)){
+      tcrdbsetecode(rdb, TTEINVALID);
+      return recs;
+    }
+    if(!tcrdbreconnect(rdb)) return recs;
+  }
+  if(!bkbuf) bksiz = 0;
+  if(!ekbuf) eksiz = 0;
+  int rsiz = 2 + sizeof(uint32_t) * 4 + bksiz + eksiz;
+  if(max < 0) max = INT_MAX;
+  unsigned char stack[TTIOBUFSIZ];
+  unsigned char *buf = (rsiz < TTIOBUFSIZ) ? stack : tcmalloc(rsiz);
+  pthread_cleanup_push(free, (buf == stack) ? NULL : buf);
+  unsigned char *wp = buf;
+  *(wp++) = TTMAGICNUM;
+  *(wp++) = TTCMDRANGE;
+  uint32_t num;
+  num = htonl((uint32_t)bksiz);
+  memcpy(wp, &num, sizeof(uint32_t));
+  wp += sizeof(uint32_t);
+  num = htonl((uint32_t)(ekbuf ? eksiz : -1));
+  memcpy(wp, &num, sizeof(uint32_t));
+  wp += sizeof(uint32_t);
+  num = htonl((uint32_t)max);
+  memcpy(wp, &num, sizeof(uint32_t));
+  wp += sizeof(uint32_t);
+  num = htonl((uint32_t)vals);
+  memcpy(wp, &num, sizeof(uint32_t));
+  wp += sizeof(uint32_t);
+  if(bkbuf){
+    memcpy(wp, bkbuf, bksiz);
+    wp += bksiz;
+  }
+  if(ekbuf){
+    memcpy(wp, ekbuf, eksiz);
+    wp += eksiz;
+  }
+  if(tcrdbsend(rdb, buf, wp - buf)){
+    int code = ttsockgetc(rdb->sock);
+    if(code == 0){
+      int rnum = ttsockgetint32(rdb->sock);
+      if(!ttsockcheckend(rdb->sock) && rnum >= 0){
+        for(int i = 0; i < rnum; i++){
+          int rksiz = ttsockgetint32(rdb->sock);
+          int rvsiz = ttsockgetint32(rdb->sock);
+          if(ttsockcheckend(rdb->sock) || rksiz < 0 || rvsiz < 0){
+            tcrdbsetecode(rdb, TTERECV);
+            break;
+          }
+          int rsiz = rksiz + rvsiz;
+          char *rbuf = (rsiz < TTIOBUFSIZ) ? (char *)stack : tcmalloc(rsiz + 1);
+          if(ttsockrecv(rdb->sock, rbuf, rsiz)){
+            tclistpush(recs, rbuf, rksiz);
+            if(vals) tclistpush(recs, rbuf + rksiz, rvsiz);
+          } else {
+            tcrdbsetecode(rdb, TTERECV);
+          }
+          if(rbuf != (char *)stack) free(rbuf);
+        }
+      } else {
+        tcrdbsetecode(rdb, TTERECV);
+      }
+    } else {
+      tcrdbsetecode(rdb, code == -1 ? TTERECV : TTENOREC);
+    }
+  }
+  pthread_cleanup_pop(1);
+  return recs;
+}
+
+
 /* Add an integer to a record in a remote database object.
    `rdb' specifies the remote database object connected as a writer.
    `kbuf' specifies the pointer to the region of the key.
@@ -36,15 +36,23 @@ __NET_CLINKAGEBEGIN
 
 #define TTIOBUFSIZ     65536             /* size of an I/O buffer */
 #define TTADDRBUFSIZ   1024              /* size of an address buffer */
+#define TTIOVECNUM     16                /* number of regions sent without allocation */
+#define TTSOCKBUFSIZ   4096              /* initial size of the buffers of a socket */
 
 typedef struct {                         /* type of structure for a socket */
   int fd;                                /* file descriptor */
-  char buf[TTIOBUFSIZ];                  /* reading buffer */
+  char *buf;                             /* reading buffer */
+  int asiz;                              /* allocated size of the reading buffer */
   char *rp;                              /* reading pointer */
   char *ep;                              /* end pointer */
   bool end;                              /* end flag */
   double to;                             /* timeout */
   double dl;                             /* deadline time */
+  char *obuf;                            /* writing buffer */
+  int osiz;                              /* size of the buffered output */
+  int oasiz;                             /* allocated size of the writing buffer */
+  bool cork;                             /* whether output is buffered */
+  void *pool;                            /* pool of the buffers */
 } TTSOCK;
 
 
@@ -142,6 +150,33 @@ void ttsocksetlife(TTSOCK *sock, double lifetime);
 bool ttsocksend(TTSOCK *sock, const void *buf, int size);
 
 
+/* Send data in plural regions by a socket.
+   `sock' specifies the socket object.
+   `iov' specifies the array of the regions of the data to send.
+   `iovcnt' specifies the number of the elements of the array.
+   If successful, the return value is true, else, it is false.
+   The regions are sent in order by gathering output, so they need not be copied into one
+   buffer. */
+bool ttsocksendv(TTSOCK *sock, const struct iovec *iov, int iovcnt);
+
+
+/* Set the output buffering mode of a socket object.
+   `sock' specifies the socket object.
+   `cork' specifies whether output is buffered.  If it is true, data sent by `ttsocksend' and the
+   other sending functions is appended to the writing buffer, which is sent by one system call
+   when it is flushed, when the socket waits for input, or when the data would exceed
+   `TTIOBUFSIZ' bytes.  If it is false, buffered data is flushed and output is sent immediately.
+   By default, output is not buffered.
+   If successful, the return value is true, else, it is false. */
+bool ttsocksetcork(TTSOCK *sock, bool cork);
+
+
+/* Send the buffered output of a socket object.
+   `sock' specifies the socket object.
+   If successful, the return value is true, else, it is false. */
+bool ttsockflush(TTSOCK *sock);
+
+
 /* Send formatted data by a socket.
    `sock' specifies the socket object.
    `format' specifies the printf-like format string.
@@ -250,14 +285,19 @@ double ttunpackdouble(const char *buf);
 #define TTCMDPUT       0x10              /* ID of put command */
 #define TTCMDPUTKEEP   0x11              /* ID of putkeep command */
 #define TTCMDPUTCAT    0x12              /* ID of putcat command */
+#define TTCMDPUTEXP    0x14              /* ID of putexp command */
+#define TTCMDPUTKEEPEXP 0x15             /* ID of putkeepexp command */
 #define TTCMDPUTNR     0x18              /* ID of putnr command */
 #define TTCMDOUT       0x20              /* ID of out command */
 #define TTCMDGET       0x30              /* ID of get command */
 #define TTCMDMGET      0x31              /* ID of mget command */
+#define TTCMDGETCMP    0x32              /* ID of getcmp command */
 #define TTCMDVSIZ      0x38              /* ID of vsiz command */
 #define TTCMDITERINIT  0x50              /* ID of iterinit command */
 #define TTCMDITERNEXT  0x51              /* ID of iternext command */
+#define TTCMDSCAN      0x52              /* ID of scan command */
 #define TTCMDFWMKEYS   0x58              /* ID of fwmkeys command */
+#define TTCMDRANGE     0x59              /* ID of range command */
 #define TTCMDADDINT    0x60              /* ID of addint command */
 #define TTCMDADDDOUBLE 0x61              /* ID of adddouble command */
 #define TTCMDVANISH    0x72              /* ID of vanish command */
@@ -288,6 +328,12 @@ typedef struct _TTREQ {                  /* type of structure for a request */
   double mtime;                          /* last modified time */
   bool keep;                             /* keep-alive flag */
   int idx;                               /* ordinal index */
+  int lfd;                               /* listening file descriptor of the reactor */
+  int cfd;                               /* file descriptor of the current connection */
+  TTSOCK *sock;                          /* socket object of the current connection */
+  bool orphan;                           /* whether the reactor was handed over */
+  void *uring;                           /* I/O ring of the reactor */
+  void *pool;                            /* pool of the buffers of the connections */
 } TTREQ;
 
 typedef struct _TTSERV {                 /* type of structure for a server */
@@ -301,6 +347,11 @@ typedef struct _TTSERV {                 /* type of structure for a server */
   pthread_cond_t tcnd;                   /* condition variable for the timer */
   int thnum;                             /* number of threads */
   double timeout;                        /* timeout milliseconds of each task */
+  int opts;                              /* options */
+  struct _TTREQ **reqs;                  /* request objects of the workers */
+  uint32_t hnext;                        /* cursor of the accept handoff */
+  TTSOCK **socks;                        /* socket objects of the connections by descriptor */
+  int socknum;                           /* number of the elements of the socket objects */
   bool term;                             /* terminate flag */
   void (*do_log)(int, const char *, void *);  /* call back function for logging */
   void *opq_log;                         /* opaque pointer for logging */
@@ -312,6 +363,11 @@ typedef struct _TTSERV {                 /* type of structure for a server */
   void *opq_term;                        /* opaque pointer for termination */
 } TTSERV;
 
+enum {                                   /* enumeration for server options */
+  TTSERVREACTOR = 1 << 0,                /* each worker polls its own connections */
+  TTSERVURING = 1 << 1                   /* each worker uses an I/O ring of io_uring */
+};
+
 enum {                                   /* enumeration for logging levels */
   TTLOGDEBUG,                            /* debug */
   TTLOGINFO,                             /* information */
@@ -343,8 +399,18 @@ bool ttservconf(TTSERV *serv, const char *host, int port);
    `serv' specifies the server object.
    `thnum' specifies the number of worker threads.  By default, the number is 5.
    `timeout' specifies the timeout seconds of each task.  If it is not more than 0, no timeout is
-   specified.  By default, there is no timeout. */
-void ttservtune(TTSERV *serv, int thnum, double timeout);
+   specified.  By default, there is no timeout.
+   `opts' specifies options by bitwise-or: `TTSERVREACTOR' specifies that each worker thread owns
+   a polling descriptor and the connections registered to it, instead of sharing one queue of
+   ready connections.  With TCP/IP, each worker also listens on the port by `SO_REUSEPORT' so
+   that the kernel balances new connections; with a UNIX domain socket or if `SO_REUSEPORT' is
+   not available, the main thread accepts and hands connections to the workers by turns.
+   `TTSERVURING' specifies that each worker owns an io_uring instance instead, which accepts
+   connections by multishot accept and receives the first bytes of each request into a ring of
+   provided buffers, so that submissions and completions of all connections of a worker are
+   batched into one system call.  If io_uring is not available in the build or the kernel, it
+   falls back to `TTSERVREACTOR'. */
+void ttservtune(TTSERV *serv, int thnum, double timeout, int opts);
 
 
 /* Set the logging handler of a server object.
@@ -408,6 +474,17 @@ void ttservlog(TTSERV *serv, int level, const char *format, ...);
 bool ttserviskilled(TTSERV *serv);
 
 
+/* Hand over the other connections of the worker of a request to a new worker thread.
+   `req' specifies the request object of the current task.
+   If successful, the return value is true, else, it is false.
+   This function should be called by a task which occupies its worker for a long time, such as a
+   replication stream.  It is meaningful only with the `TTSERVREACTOR' or `TTSERVURING' option,
+   where the other connections would otherwise be stalled until the task returns.  The current
+   connection is not polled until the task returns and the calling thread finishes after that.
+   With `TTSERVURING', the current connection is closed after the task. */
+bool ttservhandoff(TTREQ *req);
+
+
 /* Break a simple server expression.
    `expr' specifies the simple server expression.  It is composed of two substrings separated
    by ":".  The former field specifies the name or the address of the server.  The latter field
@@ -531,10 +608,9 @@ bool tculogclose(TCULOG *ulog);
 
 /* Get the mutex index of a record.
    `ulog' specifies the update log object.
-   `kbuf' specifies the pointer to the region of the key.
-   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
    The return value is the mutex index of a record. */
-int tculogrmtxidx(TCULOG *ulog, const char *kbuf, int ksiz);
+int tculogrmtxidx(TCULOG *ulog, uint64_t hash);
 
 
 /* Begin the critical section of an update log object.
@@ -563,6 +639,42 @@ bool tculogwrite(TCULOG *ulog, uint64_t ts, uint32_t sid, uint32_t mid,
                  const void *ptr, int size);
 
 
+/* Get the position of the next message of an update log object.
+   `ulog' specifies the update log object.
+   `np' specifies the pointer to the variable into which the ID number of the file is assigned.
+   `op' specifies the pointer to the variable into which the offset in the file is assigned.
+   If successful, the return value is true, else, it is false.
+   The position is stable only while all record locks are held by `tculogbegin'. */
+bool tculogpos(TCULOG *ulog, int *np, uint64_t *op);
+
+
+/* Purge old files of an update log object.
+   `ulog' specifies the update log object.
+   `num' specifies the ID number of a file.  Only files before it can be purged.
+   `ts' specifies the time stamp.  Only files whose messages are older than it by more than the
+   allowed deviance of time can be purged.
+   `keep' specifies the number of the newest files to be kept.
+   `age' specifies the age in seconds.  Files having messages newer than it are kept.  If it is
+   not more than 0, no limit is specified.
+   `size' specifies the total size.  Files are kept while the total size of the files does not
+   exceed it.  If it is 0, no limit is specified.
+   `arcpath' specifies the path of a directory into which purged files are moved.  If it is
+   `NULL', purged files are removed.
+   The return value is the number of purged files or -1 on failure.
+   Files are purged from the oldest one and the current file is never purged.  The last time
+   stamp of each file is estimated by the first time stamp of the next file, so that no file is
+   read through. */
+int tculogpurge(TCULOG *ulog, int num, uint64_t ts, int keep, double age, uint64_t size,
+                const char *arcpath);
+
+
+/* Get the total size of files of an update log object.
+   `ulog' specifies the update log object.
+   `fnp' specifies the pointer to the variable into which the number of the files is assigned.
+   The return value is the total size of the files. */
+uint64_t tculogfsiz(TCULOG *ulog, int *fnp);
+
+
 /* Create a log reader object.
    `ulog' specifies the update log object.
    `ts' specifies the beginning timestamp.
@@ -595,6 +707,15 @@ void tculrdwait(TCULRD *ulrd);
 const void *tculrdread(TCULRD *ulrd, int *sp, uint64_t *tsp, uint32_t *sidp, uint32_t *midp);
 
 
+/* Move the position of a log reader object.
+   `ulrd' specifies the log reader object.
+   `num' specifies the ID number of the file.
+   `off' specifies the offset in the file, which should be a position given by `tculogpos'.
+   If successful, the return value is true, else, it is false.
+   The beginning timestamp is cleared so that every message after the position is read. */
+bool tculrdseek(TCULRD *ulrd, int num, uint64_t off);
+
+
 /* Store a record into a database object.
    `ulog' specifies the update log object.
    `sid' specifies the origin server ID of the message.
@@ -604,10 +725,11 @@ const void *tculrdread(TCULRD *ulrd, int *sp, uint64_t *tsp, uint32_t *sidp, uin
    `ksiz' specifies the size of the region of the key.
    `vbuf' specifies the pointer to the region of the value.
    `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
    If successful, the return value is true, else, it is false.
    If a record with the same key exists in the database, it is overwritten. */
 bool tculogdbput(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                  const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+                  const void *kbuf, int ksiz, const void *vbuf, int vsiz, uint64_t hash);
 
 
 /* Store a new record into a database object.
@@ -619,10 +741,11 @@ bool tculogdbput(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
    `ksiz' specifies the size of the region of the key.
    `vbuf' specifies the pointer to the region of the value.
    `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
    If successful, the return value is true, else, it is false.
    If a record with the same key exists in the database, this function has no effect. */
 bool tculogdbputkeep(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                      const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+                      const void *kbuf, int ksiz, const void *vbuf, int vsiz, uint64_t hash);
 
 
 /* Concatenate a value at the end of the existing record in a database object.
@@ -634,10 +757,52 @@ bool tculogdbputkeep(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
    `ksiz' specifies the size of the region of the key.
    `vbuf' specifies the pointer to the region of the value.
    `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
    If successful, the return value is true, else, it is false.
    If there is no corresponding record, a new record is created. */
 bool tculogdbputcat(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                     const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+                     const void *kbuf, int ksiz, const void *vbuf, int vsiz, uint64_t hash);
+
+
+/* Store a record with an expiration time into a database object.
+   `ulog' specifies the update log object.
+   `sid' specifies the origin server ID of the message.
+   `mid' specifies the master server ID of the message.
+   `mdb' specifies the database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.  If it is not more than 0,
+   the record never expires.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   If a record with the same key exists in the database, it is overwritten.  The absolute
+   expiration time is logged so that replaying the message sets the same time.  A record without
+   expiration time is logged as by `tculogdbput'. */
+bool tculogdbputexp(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                    const void *kbuf, int ksiz, const void *vbuf, int vsiz, int64_t xtime,
+                    uint64_t hash);
+
+
+/* Store a new record with an expiration time into a database object.
+   `ulog' specifies the update log object.
+   `sid' specifies the origin server ID of the message.
+   `mid' specifies the master server ID of the message.
+   `mdb' specifies the database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.  If it is not more than 0,
+   the record never expires.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   If a record with the same key exists in the database and has not expired, this function has no
+   effect. */
+bool tculogdbputkeepexp(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                        const void *kbuf, int ksiz, const void *vbuf, int vsiz, int64_t xtime,
+                        uint64_t hash);
 
 
 /* Remove a record of a database object.
@@ -647,9 +812,10 @@ bool tculogdbputcat(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
    `mdb' specifies the database object.
    `kbuf' specifies the pointer to the region of the key.
    `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
    If successful, the return value is true, else, it is false. */
 bool tculogdbout(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                  const void *kbuf, int ksiz);
+                  const void *kbuf, int ksiz, uint64_t hash);
 
 
 /* Add an integer to a record in a database object.
@@ -660,11 +826,12 @@ bool tculogdbout(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
    `kbuf' specifies the pointer to the region of the key.
    `ksiz' specifies the size of the region of the key.
    `num' specifies the additional value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
    If successful, the return value is the summation value, else, it is `INT_MIN'.
    If the corresponding record exists, the value is treated as an integer and is added to.  If no
    record corresponds, a new record of the additional value is stored. */
 int tculogdbaddint(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                    const void *kbuf, int ksiz, int num);
+                    const void *kbuf, int ksiz, int num, uint64_t hash);
 
 
 /* Add a real number to a record in a database object.
@@ -675,11 +842,31 @@ int tculogdbaddint(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
    `kbuf' specifies the pointer to the region of the key.
    `ksiz' specifies the size of the region of the key.
    `num' specifies the additional value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
    If successful, the return value is the summation value, else, it is `NAN'.
    If the corresponding record exists, the value is treated as a real number and is added to.  If
    no record corresponds, a new record of the additional value is stored. */
 double tculogdbadddouble(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
-                          const void *kbuf, int ksiz, double num);
+                          const void *kbuf, int ksiz, double num, uint64_t hash);
+
+
+/* Add an integer to a decimal counter of a record in a database object.
+   `ulog' specifies the update log object.
+   `sid' specifies the origin server ID of the message.
+   `mid' specifies the master server ID of the message.
+   `mdb' specifies the database object connected as a writer.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `np' specifies the pointer to the variable into which the resulting value is assigned.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is 1 on success, 0 if no record corresponds, or -1 on failure.  Failure of
+   logging is reported even though the counter has been updated.
+   The counter is updated by `tcmdbincrhash' and the resulting value is logged as a decimal
+   string stored by `tculogdbputexp', so that replaying the message does not depend on the
+   representation of the counter. */
+int tculogdbincr(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
+                 const void *kbuf, int ksiz, int64_t num, uint64_t *np, uint64_t hash);
 
 
 /* Remove all records of a database object.
@@ -691,6 +878,20 @@ double tculogdbadddouble(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 bool tculogdbvanish(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb);
 
 
+/* Remove expired records of a database object.
+   `ulog' specifies the update log object.
+   `sid' specifies the origin server ID of the message.
+   `mid' specifies the master server ID of the message.
+   `mdb' specifies the database object.
+   `now' specifies the current time in seconds since the epoch.
+   `max' specifies the maximum number of records to be removed.
+   The return value is the number of the removed records.
+   Each removal is logged as an out command so that slaves and restoration remove the same
+   records.  The keys are collected first so that no shard is locked while waiting for the update
+   log. */
+int tculogdbexpire(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb, int64_t now, int max);
+
+
 /* Call a versatile function for miscellaneous operations of a database object.
    `ulog' specifies the update log object.
    `sid' specifies the origin server ID of the message.
@@ -719,6 +920,21 @@ TCLIST *tculogdbmisc(TCULOG *ulog, uint32_t sid, uint32_t mid, TCMDB *mdb,
 bool tculogdbrestore(TCMDB *mdb, const char *path, uint64_t ts, bool con, TCULOG *ulog);
 
 
+/* Restore a database object from a position of the update log.
+   `mdb' specifies the database object.
+   `path' specifies the path of the update log directory.
+   `num' specifies the ID number of the file of the beginning position.
+   `off' specifies the offset of the beginning position, which should be given by `tculogpos'.
+   `ulog' specifies the update log object.
+   `rnp' specifies the pointer to the variable into which the number of redone messages is
+   assigned.  If it is `NULL', it is not used.
+   If successful, the return value is true, else, it is false.
+   This function is useful to replay the tail of the log after loading a snapshot, as the
+   position does not suffer from messages of the same timestamp. */
+bool tculogdbrestore2(TCMDB *mdb, const char *path, int num, uint64_t off, TCULOG *ulog,
+                      uint64_t *rnp);
+
+
 /* Redo an update log message.
    `mdb' specifies the database object.
    `ptr' specifies the pointer to the region of the message.
@@ -803,7 +1019,8 @@ enum {                                   /* enumeration for error codes */
 };
 
 enum {                                   /* enumeration for tuning options */
-  RDBTRECON = 1 << 0                     /* reconnect automatically */
+  RDBTRECON = 1 << 0,                    /* reconnect automatically */
+  RDBTCMP = 1 << 1                       /* receive values compressed */
 };
 
 enum {                                   /* enumeration for restore options */
@@ -846,7 +1063,8 @@ int tcrdbecode(TCRDB *rdb);
    `timeout' specifies the timeout of each query in seconds.  If it is not more than 0, the
    timeout is not specified.
    `opts' specifies options by bitwise-or: `RDBTRECON' specifies that the connection is recovered
-   automatically when it is disconnected.
+   automatically when it is disconnected, `RDBTCMP' specifies that values kept compressed by the
+   server are received in the compressed form and decompressed by `tcrdbget'.
    If successful, the return value is true, else, it is false.
    Note that the tuning parameters should be set before the database is opened. */
 bool tcrdbtune(TCRDB *rdb, double timeout, int opts);
@@ -899,6 +1117,20 @@ bool tcrdbput(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz
 bool tcrdbputkeep(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 
 
+/* Store a record with an expiration time into a remote database object.
+   `rdb' specifies the remote database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time.  If it is 0, the record never expires.  If it is
+   negative, the record expires at once.  If it is not more than 2592000, it means seconds from
+   now, else, it means seconds since the epoch.
+   If successful, the return value is true, else, it is false.
+   If a record with the same key exists in the database, it is overwritten. */
+bool tcrdbputexp(TCRDB *rdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz, int xtime);
+
+
 /* Concatenate a value at the end of the existing record in a remote database object.
    `rdb' specifies the remote database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -984,6 +1216,24 @@ bool tcrdbiterinit(TCRDB *rdb);
 void *tcrdbiternext(TCRDB *rdb, int *sp);
 
 
+/* Scan records of a remote database object with a cursor.
+   `rdb' specifies the remote database object.
+   `cp' specifies the pointer to the variable of the cursor.  It should be 0 at the beginning of
+   a scan.  The cursor to resume the scan is assigned into it, which is 0 at the end.
+   `max' specifies the maximum number of records to be fetched.  If it is negative, no limit is
+   specified.
+   `vals' specifies whether the values are fetched as well as the keys.
+   If successful, the return value is a list object of the keys of the fetched records, each
+   followed by its value if `vals' is true, else, it is `NULL'.  Fewer records than the maximum
+   may be fetched before the end of the scan.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use.  Unlike the iterator, the
+   cursor is kept by the caller, so that scans by multiple connections do not disturb each
+   other.  A record existing through the scan is fetched at least once, while some records may
+   be fetched twice. */
+TCLIST *tcrdbscan(TCRDB *rdb, uint64_t *cp, int max, bool vals);
+
+
 /* Get forward matching keys in a remote database object.
    `rdb' specifies the remote database object.
    `pbuf' specifies the pointer to the region of the prefix.
@@ -1009,6 +1259,28 @@ TCLIST *tcrdbfwmkeys(TCRDB *rdb, const void *pbuf, int psiz, int max);
 TCLIST *tcrdbfwmkeys2(TCRDB *rdb, const char *pstr, int max);
 
 
+/* Get keys of ranged records in a remote database object.
+   `rdb' specifies the remote database object.
+   `bkbuf' specifies the pointer to the region of the key of the beginning border.  If it is
+   `NULL', the first record is specified.
+   `bksiz' specifies the size of the region of the beginning key.
+   `ekbuf' specifies the pointer to the region of the key of the ending border.  If it is
+   `NULL', the last record is specified.
+   `eksiz' specifies the size of the region of the ending key.
+   `max' specifies the maximum number of records to be fetched.  If it is negative, no limit is
+   specified.
+   `vals' specifies whether the values are fetched as well as the keys.
+   The return value is a list object of the keys of the records whose keys are not less than the
+   beginning key and less than the ending key in ascending lexical order.  If `vals' is true,
+   each key is followed by its value.  This function does never fail.  It returns an empty list
+   even if no record corresponds.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use.  The server answers it
+   without scanning every key only if it keeps ordered indices. */
+TCLIST *tcrdbrange(TCRDB *rdb, const void *bkbuf, int bksiz, const void *ekbuf, int eksiz,
+                   int max, bool vals);
+
+
 /* Add an integer to a record in a remote database object.
    `rdb' specifies the remote database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -27,6 +27,14 @@
 #define TOKENUNIT      256               // unit number of tokens
 #define RECMTXNUM      31                // number of mutexes of records
 #define REPLPERIOD     1.0               // period of calling replication request
+#define ZCMINSIZ       4096              // minimum size of a value sent without copying
+#define XTIMERELMAX    2592000           // maximum expiration time relative to the current time
+#define EXPPERIOD      1.0               // period of calling expiration of records
+#define EXPUNIT        4096              // number of records expired at once
+#define EXPLOOPMAX     16                // maximum number of expiration units per period
+#define SNAPPERIOD     1.0               // period of checking requests of snapshots
+#define PURGEPERIOD    60.0              // period of purging the update log without snapshots
+#define PURGEMARGIN    60.0              // margin of time stamps sent to slaves
 
 enum {                                   // enumeration for command sequential numbers
   TTSEQPUT,                              // sequential number of put command
@@ -39,7 +47,9 @@ enum {                                   // enumeration for command sequential n
   TTSEQVSIZ,                             // sequential number of vsiz command
   TTSEQITERINIT,                         // sequential number of iterinit command
   TTSEQITERNEXT,                         // sequential number of iternext command
+  TTSEQSCAN,                             // sequential number of scan command
   TTSEQFWMKEYS,                          // sequential number of fwmkeys command
+  TTSEQRANGE,                            // sequential number of range command
   TTSEQADDINT,                           // sequential number of addint command
   TTSEQADDDOUBLE,                        // sequential number of adddouble command
   TTSEQEXT,                              // sequential number of ext command
@@ -86,6 +96,29 @@ typedef struct {                         // type of structure of master synchron
   uint64_t mts;                          // modified time stamp
 } REPLARG;
 
+typedef struct {                         // type of structure of snapshot opaque object
+  const char *path;                      // path of the snapshot file
+  double period;                         // interval of snapshots in seconds
+  TCMDB *mdb;                            // database object
+  TCULOG *ulog;                          // update log object
+  bool req;                              // request flag
+  double last;                           // time of the last trial
+  uint64_t cnt;                          // number of written snapshots
+  uint64_t ts;                           // time stamp of the last snapshot
+  int num;                               // ID number of the update log file of the last snapshot
+  uint64_t off;                          // offset of the update log of the last snapshot
+  double elapsed;                        // elapsed time of the last snapshot
+  bool fail;                             // failure flag
+  int keep;                              // number of update log files to be kept
+  double age;                            // age of update log files to be kept
+  uint64_t size;                         // total size of update log files to be kept
+  const char *arcpath;                   // path of the archive directory of update log files
+  int thnum;                             // number of threads
+  uint64_t *rtss;                        // time stamps sent to slaves by threads
+  double ptime;                          // time of the last purge
+  uint64_t pnum;                         // number of purged update log files
+} SNAPARG;
+
 typedef struct {                         // type of structure of task opaque object
   int thnum;                             // number of threads
   uint64_t *counts;                      // conunters of execution
@@ -94,9 +127,19 @@ typedef struct {                         // type of structure of task opaque obj
   TCULOG *ulog;                          // update log object
   uint32_t sid;                          // server ID number
   REPLARG *sarg;                         // replication object
+  SNAPARG *snarg;                        // snapshot object
+  uint64_t *rtss;                        // time stamps sent to slaves by threads
   pthread_mutex_t rmtxs[RECMTXNUM];      // mutex for records
 } TASKARG;
 
+typedef struct {                         // type of structure of record sending opaque object
+  TTSOCK *sock;                          // socket object
+  TCXSTR *xstr;                          // pending output
+  const char *kbuf;                      // pointer to the key
+  int ksiz;                              // size of the key
+  bool err;                              // error flag
+} SENDARG;
+
 typedef struct {                         // type of structure of termination opaque object
   int thnum;                             // number of threads
   TCMDB *mdb;                            // database object
@@ -119,28 +162,47 @@ static void usage(void);
 static uint64_t getcmdmask(const char *expr);
 static void sigtermhandler(int signum);
 static void sigchldhandler(int signum);
-static int proc(const char *host, int port, int thnum, int tout,
+static int proc(const char *host, int port, int thnum, int tout, int sopts,
                 bool dmn, const char *pidpath, bool kl, const char *logpath,
                 const char *ulogpath, uint64_t ulim, bool uas, uint32_t sid,
                 const char *mhost, int mport, const char *rtspath, int ropts,
-                uint64_t mask);
+                uint64_t mask, int mnum, int mopts, uint64_t maxmem, int cmpsiz,
+                const char *stprefix, int mpopts, const char *snappath, double snapint,
+                int ulkeep, double ulage, uint64_t ulsize, const char *ularc,
+                const char *dbname);
+static bool loadsnapshot(TCMDB *mdb, const char *snappath, const char *ulogpath, TCULOG *ulog,
+                         SNAPARG *snarg);
+static bool writesnapshot(SNAPARG *arg);
+static void purgeulog(SNAPARG *arg);
 static void do_log(int level, const char *msg, void *opq);
 static void do_slave(void *opq);
+static void do_expire(void *opq);
+static void do_snapshot(void *opq);
 static void do_task(TTSOCK *sock, void *opq, TTREQ *req);
 static char **tokenize(char *str, int *np);
-static uint32_t recmtxidx(const char *kbuf, int ksiz);
+static uint32_t recmtxidx(uint64_t hash);
+static int64_t calcxtime(int64_t xtime);
+static void visit_get(const void *vbuf, int vsiz, void *op);
+static void visit_getcmp(const void *vbuf, int vsiz, bool cmp, void *op);
+static void visit_mget(const void *vbuf, int vsiz, void *op);
+static void visit_mc_get(const void *vbuf, int vsiz, void *op);
+static void visit_http_get(const void *vbuf, int vsiz, void *op);
 static uint64_t sumstat(TASKARG *arg, int seq);
 static void do_put(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_putkeep(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_putcat(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_putnr(TTSOCK *sock, TASKARG *arg, TTREQ *req);
+static void do_putexp(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_out(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_get(TTSOCK *sock, TASKARG *arg, TTREQ *req);
+static void do_getcmp(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_mget(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_vsiz(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_iterinit(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_iternext(TTSOCK *sock, TASKARG *arg, TTREQ *req);
+static void do_scan(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_fwmkeys(TTSOCK *sock, TASKARG *arg, TTREQ *req);
+static void do_range(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_addint(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_adddouble(TTSOCK *sock, TASKARG *arg, TTREQ *req);
 static void do_vanish(TTSOCK *sock, TASKARG *arg, TTREQ *req);
@@ -186,6 +248,7 @@ int main(int argc, char **argv){
   int port = TTDEFPORT;
   int thnum = DEFTHNUM;
   int tout = 0;
+  int sopts = 0;
   bool dmn = false;
   bool kl = false;
   uint64_t ulim = DEFULIMSIZ;
@@ -194,6 +257,19 @@ int main(int argc, char **argv){
   int mport = TTDEFPORT;
   int ropts = 0;
   uint64_t mask = 0;
+  int mnum = 0;
+  int mopts = 0;
+  uint64_t maxmem = 0;
+  int cmpsiz = 0;
+  const char *stprefix = NULL;
+  int mpopts = 0;
+  const char *snappath = NULL;
+  double snapint = 0;
+  int ulkeep = 0;
+  double ulage = 0;
+  uint64_t ulsize = 0;
+  const char *ularc = NULL;
+  const char *dbname = NULL;
   for(int i = 1; i < argc; i++){
     if(argv[i][0] == '-'){
       if(!strcmp(argv[i], "-host")){
@@ -208,6 +284,10 @@ int main(int argc, char **argv){
       } else if(!strcmp(argv[i], "-tout")){
         if(++i >= argc) usage();
         tout = tcatoi(argv[i]);
+      } else if(!strcmp(argv[i], "-reactor")){
+        sopts |= TTSERVREACTOR;
+      } else if(!strcmp(argv[i], "-uring")){
+        sopts |= TTSERVURING;
       } else if(!strcmp(argv[i], "-dmn")){
         dmn = true;
       } else if(!strcmp(argv[i], "-pid")){
@@ -230,6 +310,18 @@ int main(int argc, char **argv){
         ulim = tcatoix(argv[i]);
       } else if(!strcmp(argv[i], "-uas")){
         uas = true;
+      } else if(!strcmp(argv[i], "-ulkeep")){
+        if(++i >= argc) usage();
+        ulkeep = tcatoi(argv[i]);
+      } else if(!strcmp(argv[i], "-ulage")){
+        if(++i >= argc) usage();
+        ulage = tcatof(argv[i]);
+      } else if(!strcmp(argv[i], "-ulsize")){
+        if(++i >= argc) usage();
+        ulsize = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-ularc")){
+        if(++i >= argc) usage();
+        ularc = argv[i];
       } else if(!strcmp(argv[i], "-sid")){
         if(++i >= argc) usage();
         sid = tcatoi(argv[i]);
@@ -250,6 +342,49 @@ int main(int argc, char **argv){
       } else if(!strcmp(argv[i], "-unmask")){
         if(++i >= argc) usage();
         mask &= ~getcmdmask(argv[i]);
+      } else if(!strcmp(argv[i], "-mnum")){
+        if(++i >= argc) usage();
+        mnum = tcatoi(argv[i]);
+      } else if(!strcmp(argv[i], "-flat")){
+        mopts |= MDBTFLAT;
+      } else if(!strcmp(argv[i], "-compact")){
+        mopts |= MDBTCOMPACT;
+      } else if(!strcmp(argv[i], "-order")){
+        mopts |= MDBTORDER;
+      } else if(!strcmp(argv[i], "-maxmem")){
+        if(++i >= argc) usage();
+        maxmem = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-cmp")){
+        if(++i >= argc) usage();
+        int64_t num = tcatoix(argv[i]);
+        cmpsiz = num > INT_MAX ? INT_MAX : num;
+      } else if(!strcmp(argv[i], "-stripe")){
+        if(++i >= argc) usage();
+        stprefix = argv[i];
+      } else if(!strcmp(argv[i], "-huge")){
+        if(++i >= argc) usage();
+        if(!tcstricmp(argv[i], "thp")){
+          mpopts |= TCMPTHP;
+        } else if(!tcstricmp(argv[i], "tlb")){
+          mpopts |= TCMPHUGETLB;
+        } else {
+          usage();
+        }
+      } else if(!strcmp(argv[i], "-numa")){
+        if(++i >= argc) usage();
+        if(!tcstricmp(argv[i], "inter")){
+          mpopts |= TCMPINTER;
+        } else if(!tcstricmp(argv[i], "local")){
+          mpopts |= TCMPLOCAL;
+        } else {
+          usage();
+        }
+      } else if(!strcmp(argv[i], "-snap")){
+        if(++i >= argc) usage();
+        snappath = argv[i];
+      } else if(!strcmp(argv[i], "-snapint")){
+        if(++i >= argc) usage();
+        snapint = tcatof(argv[i]);
       } else if(!strcmp(argv[i], "--version")){
         printf("Tokyo Tyrant version %s (%d:%s) for %s\n",
                ttversion, _TT_LIBVER, _TT_PROTVER, TCSYSNAME);
@@ -258,16 +393,21 @@ int main(int argc, char **argv){
       } else {
         usage();
       }
+    } else if(!dbname){
+      dbname = argv[i];
     } else {
       usage();
     }
   }
-  if(thnum < 1 || mport < 1) usage();
+  if(thnum < 1 || mport < 1 || mnum < 0 || cmpsiz < 0 || snapint < 0 || ulkeep < 0 ||
+     ulage < 0) usage();
   if(dmn && !pidpath) pidpath = DEFPIDPATH;
   if(!rtspath) rtspath = DEFRTSPATH;
   g_serv = ttservnew();
-  int rv = proc(host, port, thnum, tout, dmn, pidpath, kl, logpath,
-                ulogpath, ulim, uas, sid, mhost, mport, rtspath, ropts, mask);
+  int rv = proc(host, port, thnum, tout, sopts, dmn, pidpath, kl, logpath,
+                ulogpath, ulim, uas, sid, mhost, mport, rtspath, ropts, mask, mnum, mopts,
+                maxmem, cmpsiz, stprefix, mpopts, snappath, snapint,
+                ulkeep, ulage, ulsize, ularc, dbname);
   ttservdel(g_serv);
   return rv;
 }
@@ -278,10 +418,13 @@ static void usage(void){
   fprintf(stderr, "%s: the server of Tokyo Tyrant\n", g_progname);
   fprintf(stderr, "\n");
   fprintf(stderr, "usage:\n");
-  fprintf(stderr, "  %s [-host name] [-port num] [-thnum num] [-tout num]"
+  fprintf(stderr, "  %s [-host name] [-port num] [-thnum num] [-tout num] [-reactor|-uring]"
           " [-dmn] [-pid path] [-kl] [-log path] [-ld|-le] [-ulog path] [-ulim num] [-uas]"
+          " [-ulkeep num] [-ulage num] [-ulsize num] [-ularc path]"
           " [-sid num] [-mhost name] [-mport num] [-rts path] [-rcc]"
-          " [-mask expr] [-unmask expr]\n",
+          " [-mask expr] [-unmask expr] [-mnum num] [-flat|-compact] [-order] [-maxmem num]"
+          " [-cmp num] [-stripe str] [-huge thp|tlb] [-numa inter|local]"
+          " [-snap path] [-snapint num] [dbname]\n",
           g_progname);
   fprintf(stderr, "\n");
   exit(1);
@@ -316,8 +459,12 @@ static uint64_t getcmdmask(const char *expr){
       mask |= 1ULL << TTSEQITERINIT;
     } else if(!tcstricmp(name, "iternext")){
       mask |= 1ULL << TTSEQITERNEXT;
+    } else if(!tcstricmp(name, "scan")){
+      mask |= 1ULL << TTSEQSCAN;
     } else if(!tcstricmp(name, "fwmkeys")){
       mask |= 1ULL << TTSEQFWMKEYS;
+    } else if(!tcstricmp(name, "range")){
+      mask |= 1ULL << TTSEQRANGE;
     } else if(!tcstricmp(name, "addint")){
       mask |= 1ULL << TTSEQADDINT;
     } else if(!tcstricmp(name, "adddouble")){
@@ -377,11 +524,14 @@ static void sigchldhandler(int signum){
 
 
 /* perform the command */
-static int proc(const char *host, int port, int thnum, int tout,
+static int proc(const char *host, int port, int thnum, int tout, int sopts,
                 bool dmn, const char *pidpath, bool kl, const char *logpath,
                 const char *ulogpath, uint64_t ulim, bool uas, uint32_t sid,
                 const char *mhost, int mport, const char *rtspath, int ropts,
-                uint64_t mask){
+                uint64_t mask, int mnum, int mopts, uint64_t maxmem, int cmpsiz,
+                const char *stprefix, int mpopts, const char *snappath, double snapint,
+                int ulkeep, double ulage, uint64_t ulsize, const char *ularc,
+                const char *dbname){
   LOGARG larg;
   larg.fd = 1;
   ttservsetloghandler(g_serv, do_log, &larg);
@@ -398,6 +548,12 @@ static int proc(const char *host, int port, int thnum, int tout,
       ttservlog(g_serv, TTLOGINFO, "warning: mhost(%s) is not the absolute path", mhost);
     if(mhost && rtspath && *rtspath != MYPATHCHR)
       ttservlog(g_serv, TTLOGINFO, "warning: rts(%s) is not the absolute path", rtspath);
+    if(snappath && *snappath != MYPATHCHR)
+      ttservlog(g_serv, TTLOGINFO, "warning: snap(%s) is not the absolute path", snappath);
+    if(ularc && *ularc != MYPATHCHR)
+      ttservlog(g_serv, TTLOGINFO, "warning: ularc(%s) is not the absolute path", ularc);
+    if(dbname && *dbname != '*' && *dbname != MYPATHCHR)
+      ttservlog(g_serv, TTLOGINFO, "warning: dbname(%s) is not the absolute path", dbname);
     if(chdir("/") == -1){
       ttservlog(g_serv, TTLOGERROR, "chdir failed");
       return 1;
@@ -503,9 +659,85 @@ static int proc(const char *host, int port, int thnum, int tout,
     ttservlog(g_serv, TTLOGERROR, "getrlimit failed");
   }
   bool err = false;
-  TCMDB *mdb = tcmdbnew();
-  ttservlog(g_serv, TTLOGSYSTEM, "opening the database: on-memory hash database");
+  if(mpopts != 0){
+    tcsetmemplace(mpopts);
+    ttservlog(g_serv, TTLOGSYSTEM, "memory placement: huge=%s numa=%s nodes=%d",
+              (mpopts & TCMPHUGETLB) ? "tlb" : (mpopts & TCMPTHP) ? "thp" : "none",
+              (mpopts & TCMPLOCAL) ? "local" : (mpopts & TCMPINTER) ? "inter" : "none",
+              tcnumanodes());
+  }
+  TCMDB *mdb = tcmdbnew3(0, mnum, mopts);
+  if(dbname && *dbname != '*'){
+    TCLIST *elems = tcstrsplit(dbname, "#");
+    uint64_t bnum = 0;
+    for(int i = 1; i < tclistnum(elems); i++){
+      const char *elem = tclistval2(elems, i);
+      if(tcstrifwm(elem, "bnum=")) bnum = tcatoix(elem + 5);
+    }
+    const char *path = tclistval2(elems, 0);
+    if(!tcmdbopen(mdb, path, bnum)){
+      ttservlog(g_serv, TTLOGERROR, "tcmdbopen failed: %s", path);
+      tclistdel(elems);
+      tcmdbdel(mdb);
+      return 1;
+    }
+    ttservlog(g_serv, TTLOGSYSTEM,
+              "opening the database: file hash database (path=%s bnum=%llu rnum=%llu)",
+              path, (unsigned long long)tcmdbbnum(mdb, NULL, NULL),
+              (unsigned long long)tcmdbrnum(mdb));
+    tclistdel(elems);
+    if(snappath){
+      ttservlog(g_serv, TTLOGINFO, "warning: snapshots are not used with a database file");
+      snappath = NULL;
+    }
+  } else {
+    ttservlog(g_serv, TTLOGSYSTEM,
+              "opening the database: on-memory hash database (%s maps, %u shards%s)",
+              (mopts & MDBTCOMPACT) ? "compact" : (mopts & MDBTFLAT) ? "flat" : "tree",
+              (unsigned int)mdb->mnum, (mopts & MDBTORDER) ? ", ordered" : "");
+  }
+  if(maxmem > 0){
+    tcmdbsetcapsiz(mdb, maxmem);
+    ttservlog(g_serv, TTLOGSYSTEM, "capacity size: %llu", (unsigned long long)maxmem);
+  }
+  if(cmpsiz > 0){
+    tcmdbsetcmpsiz(mdb, cmpsiz);
+    ttservlog(g_serv, TTLOGSYSTEM, "compression size: %d", mdb->cmpsiz);
+  }
+  if(stprefix && *stprefix != '\0'){
+    tcmdbsetstripe(mdb, stprefix);
+    ttservlog(g_serv, TTLOGSYSTEM, "striped counters: prefix=%s slots=%d",
+              stprefix, mdb->stnum);
+  }
   TCULOG *ulog = tculognew();
+  uint64_t *rtss = tccalloc(sizeof(*rtss), thnum);
+  SNAPARG snarg;
+  snarg.path = snappath;
+  snarg.period = snapint;
+  snarg.mdb = mdb;
+  snarg.ulog = ulog;
+  snarg.req = false;
+  snarg.last = tctime();
+  snarg.cnt = 0;
+  snarg.ts = 0;
+  snarg.num = 0;
+  snarg.off = 0;
+  snarg.elapsed = 0.0;
+  snarg.fail = false;
+  snarg.keep = ulkeep;
+  snarg.age = ulage;
+  snarg.size = ulsize;
+  snarg.arcpath = ularc;
+  snarg.thnum = thnum;
+  snarg.rtss = rtss;
+  snarg.ptime = 0.0;
+  snarg.pnum = 0;
+  if(snappath && !loadsnapshot(mdb, snappath, ulogpath, ulog, &snarg)){
+    free(rtss);
+    tculogdel(ulog);
+    tcmdbdel(mdb);
+    return 1;
+  }
   if(ulogpath){
     ttservlog(g_serv, TTLOGSYSTEM,
               "update log configuration: path=%s limit=%llu async=%d sid=%d",
@@ -519,7 +751,7 @@ static int proc(const char *host, int port, int thnum, int tout,
       ttservlog(g_serv, TTLOGERROR, "tculogopen failed");
     }
   }
-  ttservtune(g_serv, thnum, tout);
+  ttservtune(g_serv, thnum, tout, sopts);
   if(mhost)
     ttservlog(g_serv, TTLOGSYSTEM, "replication configuration: host=%s port=%d ropts=%d",
               mhost, mport, ropts);
@@ -548,10 +780,22 @@ static int proc(const char *host, int port, int thnum, int tout,
   targ.ulog = ulog;
   targ.sid = sid;
   targ.sarg = &sarg;
+  targ.snarg = &snarg;
+  targ.rtss = rtss;
+  if(snappath){
+    ttservlog(g_serv, TTLOGSYSTEM, "snapshot configuration: path=%s interval=%.3f",
+              snappath, snapint);
+    if(ulogpath)
+      ttservlog(g_serv, TTLOGSYSTEM,
+                "update log retention: keep=%d age=%.3f size=%llu archive=%s",
+                ulkeep, ulage, (unsigned long long)ulsize, ularc ? ularc : "(none)");
+    ttservaddtimedhandler(g_serv, SNAPPERIOD, do_snapshot, &snarg);
+  }
   for(int i = 0; i < RECMTXNUM; i++){
     if(pthread_mutex_init(targ.rmtxs + i, NULL) != 0)
       ttservlog(g_serv, TTLOGERROR, "pthread_mutex_init failed");
   }
+  ttservaddtimedhandler(g_serv, EXPPERIOD, do_expire, &targ);
   ttservsettaskhandler(g_serv, do_task, &targ);
   TERMARG karg;
   karg.thnum = thnum;
@@ -588,6 +832,7 @@ static int proc(const char *host, int port, int thnum, int tout,
       ttservlog(g_serv, TTLOGERROR, "pthread_mutex_destroy failed");
   }
   free(counts);
+  free(rtss);
   if(ulogpath && !tculogclose(ulog)){
     err = true;
     ttservlog(g_serv, TTLOGERROR, "tculogclose failed");
@@ -604,6 +849,53 @@ static int proc(const char *host, int port, int thnum, int tout,
 }
 
 
+/* load the snapshot and replay the tail of the update log */
+static bool loadsnapshot(TCMDB *mdb, const char *snappath, const char *ulogpath, TCULOG *ulog,
+                         SNAPARG *snarg){
+  struct stat sbuf;
+  if(stat(snappath, &sbuf) != 0){
+    ttservlog(g_serv, TTLOGINFO, "warning: snapshot(%s) does not exist", snappath);
+    return true;
+  }
+  double stime = tctime();
+  int msiz;
+  char *mbuf = tcmdbload(mdb, snappath, &msiz);
+  if(!mbuf){
+    ttservlog(g_serv, TTLOGERROR, "tcmdbload failed");
+    return false;
+  }
+  TCLIST *fields = tcstrsplit(mbuf, "\t");
+  uint64_t ts = tclistnum(fields) > 0 ? tcatoi(tclistval2(fields, 0)) : 0;
+  int num = tclistnum(fields) > 1 ? tcatoi(tclistval2(fields, 1)) : 0;
+  uint64_t off = tclistnum(fields) > 2 ? tcatoi(tclistval2(fields, 2)) : 0;
+  tclistdel(fields);
+  free(mbuf);
+  ttservlog(g_serv, TTLOGSYSTEM,
+            "snapshot loaded: path=%s ts=%llu rnum=%llu size=%llu time=%.3f",
+            snappath, (unsigned long long)ts, (unsigned long long)tcmdbrnum(mdb),
+            (unsigned long long)sbuf.st_size, tctime() - stime);
+  snarg->ts = ts;
+  snarg->num = num;
+  snarg->off = off;
+  if(!ulogpath) return true;
+  if(num < 1){
+    ttservlog(g_serv, TTLOGINFO,
+              "warning: the update log is not replayed because the snapshot has no position");
+    return true;
+  }
+  stime = tctime();
+  uint64_t rnum;
+  if(!tculogdbrestore2(mdb, ulogpath, num, off, ulog, &rnum)){
+    ttservlog(g_serv, TTLOGERROR, "tculogdbrestore2 failed");
+    return false;
+  }
+  ttservlog(g_serv, TTLOGSYSTEM,
+            "update log replayed: path=%s from=%08d:%llu messages=%llu time=%.3f",
+            ulogpath, num, (unsigned long long)off, (unsigned long long)rnum, tctime() - stime);
+  return true;
+}
+
+
 /* handle a log message */
 static void do_log(int level, const char *msg, void *opq){
   if(level < g_loglevel) return;
@@ -710,6 +1002,102 @@ static void do_slave(void *opq){
 }
 
 
+/* remove expired records */
+static void do_expire(void *opq){
+  TASKARG *arg = opq;
+  if(arg->sarg->host[0] != '\0') return;
+  int64_t now = time(NULL);
+  int xnum = 0;
+  for(int i = 0; i < EXPLOOPMAX; i++){
+    int num = tculogdbexpire(arg->ulog, arg->sid, 0, arg->mdb, now, EXPUNIT);
+    xnum += num;
+    if(num < EXPUNIT) break;
+  }
+  if(xnum > 0) ttservlog(g_serv, TTLOGDEBUG, "do_expire: %d records expired", xnum);
+}
+
+
+/* write the snapshot of the database */
+static bool writesnapshot(SNAPARG *arg){
+  double stime = tctime();
+  arg->req = false;
+  arg->last = stime;
+  TCULOG *ulog = arg->ulog;
+  bool dolog = tculogbegin(ulog, -1);
+  int num = 0;
+  uint64_t off = 0;
+  if(dolog && !tculogpos(ulog, &num, &off)){
+    ttservlog(g_serv, TTLOGERROR, "do_snapshot: tculogpos failed");
+    num = 0;
+  }
+  uint64_t ts = (uint64_t)(tctime() * 1000000);
+  char mbuf[NUMBUFSIZ*3];
+  int msiz = sprintf(mbuf, "%llu\t%d\t%llu",
+                     (unsigned long long)ts, num, (unsigned long long)off);
+  pid_t pid = tcmdbdumpbg(arg->mdb, arg->path, mbuf, msiz);
+  if(dolog) tculogend(ulog, -1);
+  if(pid == -1){
+    arg->fail = true;
+    ttservlog(g_serv, TTLOGERROR, "do_snapshot: tcmdbdumpbg failed");
+    return false;
+  }
+  int status;
+  while(waitpid(pid, &status, 0) == -1){
+    if(errno != EINTR){
+      status = -1;
+      break;
+    }
+  }
+  if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+    arg->fail = true;
+    ttservlog(g_serv, TTLOGERROR, "do_snapshot: writing %s failed", arg->path);
+    return false;
+  }
+  arg->fail = false;
+  arg->ts = ts;
+  arg->num = num;
+  arg->off = off;
+  arg->elapsed = tctime() - stime;
+  arg->cnt++;
+  ttservlog(g_serv, TTLOGINFO, "snapshot written: path=%s ts=%llu ulog=%08d:%llu time=%.3f",
+            arg->path, (unsigned long long)ts, num, (unsigned long long)off, arg->elapsed);
+  return true;
+}
+
+
+/* purge update log files covered by the snapshot and by slaves */
+static void purgeulog(SNAPARG *arg){
+  arg->ptime = tctime();
+  if(!arg->ulog->base || arg->num < 1) return;
+  uint64_t ts = UINT64_MAX;
+  for(int i = 0; i < arg->thnum; i++){
+    uint64_t rts = arg->rtss[i];
+    if(rts > 0 && rts < ts) ts = rts;
+  }
+  if(ts < UINT64_MAX) ts = (ts > PURGEMARGIN * 1000000) ? ts - PURGEMARGIN * 1000000 : 0;
+  int pnum = tculogpurge(arg->ulog, arg->num, ts, arg->keep, arg->age, arg->size,
+                         arg->arcpath);
+  if(pnum < 0){
+    ttservlog(g_serv, TTLOGERROR, "do_snapshot: tculogpurge failed");
+  } else if(pnum > 0){
+    arg->pnum += pnum;
+    ttservlog(g_serv, TTLOGINFO, "update log purged: files=%d before=%08d %s",
+              pnum, arg->num, arg->arcpath ? "archived" : "removed");
+  }
+}
+
+
+/* write the snapshot of the database and purge the update log */
+static void do_snapshot(void *opq){
+  SNAPARG *arg = opq;
+  double now = tctime();
+  bool done = false;
+  if(arg->req || (arg->period > 0 && now - arg->last >= arg->period))
+    done = writesnapshot(arg);
+  if(done || now - arg->ptime >= PURGEPERIOD) purgeulog(arg);
+}
+
+
 /* handle a task and dispatch it */
 static void do_task(TTSOCK *sock, void *opq, TTREQ *req){
   TASKARG *arg = (TASKARG *)opq;
@@ -728,6 +1116,9 @@ static void do_task(TTSOCK *sock, void *opq, TTREQ *req){
       case TTCMDPUTNR:
         do_putnr(sock, arg, req);
         break;
+      case TTCMDPUTEXP:
+        do_putexp(sock, arg, req);
+        break;
       case TTCMDOUT:
         do_out(sock, arg, req);
         break;
@@ -737,6 +1128,9 @@ static void do_task(TTSOCK *sock, void *opq, TTREQ *req){
       case TTCMDMGET:
         do_mget(sock, arg, req);
         break;
+      case TTCMDGETCMP:
+        do_getcmp(sock, arg, req);
+        break;
       case TTCMDVSIZ:
         do_vsiz(sock, arg, req);
         break;
@@ -746,9 +1140,15 @@ static void do_task(TTSOCK *sock, void *opq, TTREQ *req){
       case TTCMDITERNEXT:
         do_iternext(sock, arg, req);
         break;
+      case TTCMDSCAN:
+        do_scan(sock, arg, req);
+        break;
       case TTCMDFWMKEYS:
         do_fwmkeys(sock, arg, req);
         break;
+      case TTCMDRANGE:
+        do_range(sock, arg, req);
+        break;
       case TTCMDADDINT:
         do_addint(sock, arg, req);
         break;
@@ -875,15 +1275,103 @@ static char **tokenize(char *str, int *np){
 
 
 /* get the mutex index of a record */
-static uint32_t recmtxidx(const char *kbuf, int ksiz){
-  uint32_t hash = 725;
-  while(ksiz--){
-    hash = hash * 29 + *(uint8_t *)kbuf++;
-  }
+static uint32_t recmtxidx(uint64_t hash){
   return hash % RECMTXNUM;
 }
 
 
+/* get the absolute expiration time from an expiration time given by a client */
+static int64_t calcxtime(int64_t xtime){
+  if(xtime == 0) return 0;
+  if(xtime < 0) return 1;
+  if(xtime <= XTIMERELMAX) return (int64_t)time(NULL) + xtime;
+  return xtime;
+}
+
+
+/* send the value of a record for the get command */
+static void visit_get(const void *vbuf, int vsiz, void *op){
+  SENDARG *sarg = op;
+  char hbuf[sizeof(uint8_t)+sizeof(uint32_t)];
+  *hbuf = 0;
+  uint32_t num = htonl((uint32_t)vsiz);
+  memcpy(hbuf + sizeof(uint8_t), &num, sizeof(num));
+  struct iovec iov[2];
+  iov[0].iov_base = hbuf;
+  iov[0].iov_len = sizeof(hbuf);
+  iov[1].iov_base = (void *)vbuf;
+  iov[1].iov_len = vsiz;
+  if(!ttsocksendv(sarg->sock, iov, 2)) sarg->err = true;
+}
+
+
+/* send the value of a record in the form as stored */
+static void visit_getcmp(const void *vbuf, int vsiz, bool cmp, void *op){
+  SENDARG *sarg = op;
+  char hbuf[sizeof(uint8_t)+sizeof(uint8_t)+sizeof(uint32_t)];
+  hbuf[0] = 0;
+  hbuf[1] = cmp;
+  uint32_t num = htonl((uint32_t)vsiz);
+  memcpy(hbuf + sizeof(uint8_t) + sizeof(uint8_t), &num, sizeof(num));
+  struct iovec iov[2];
+  iov[0].iov_base = hbuf;
+  iov[0].iov_len = sizeof(hbuf);
+  iov[1].iov_base = (void *)vbuf;
+  iov[1].iov_len = vsiz;
+  if(!ttsocksendv(sarg->sock, iov, 2)) sarg->err = true;
+}
+
+
+/* add the key and the value of a record for the mget command */
+static void visit_mget(const void *vbuf, int vsiz, void *op){
+  SENDARG *sarg = op;
+  uint32_t num;
+  num = htonl((uint32_t)sarg->ksiz);
+  tcxstrcat(sarg->xstr, &num, sizeof(num));
+  num = htonl((uint32_t)vsiz);
+  tcxstrcat(sarg->xstr, &num, sizeof(num));
+  tcxstrcat(sarg->xstr, sarg->kbuf, sarg->ksiz);
+  tcxstrcat(sarg->xstr, vbuf, vsiz);
+}
+
+
+/* add or send the value of a record for the memcached get command */
+static void visit_mc_get(const void *vbuf, int vsiz, void *op){
+  SENDARG *sarg = op;
+  tcxstrprintf(sarg->xstr, "VALUE %s 0 %d\r\n", sarg->kbuf, vsiz);
+  if(vsiz < ZCMINSIZ){
+    tcxstrcat(sarg->xstr, vbuf, vsiz);
+    tcxstrcat(sarg->xstr, "\r\n", 2);
+    return;
+  }
+  struct iovec iov[3];
+  iov[0].iov_base = (void *)tcxstrptr(sarg->xstr);
+  iov[0].iov_len = tcxstrsize(sarg->xstr);
+  iov[1].iov_base = (void *)vbuf;
+  iov[1].iov_len = vsiz;
+  iov[2].iov_base = "\r\n";
+  iov[2].iov_len = 2;
+  if(!ttsocksendv(sarg->sock, iov, 3)) sarg->err = true;
+  tcxstrclear(sarg->xstr);
+}
+
+
+/* send the value of a record for the HTTP GET command */
+static void visit_http_get(const void *vbuf, int vsiz, void *op){
+  SENDARG *sarg = op;
+  tcxstrprintf(sarg->xstr, "HTTP/1.1 200 OK\r\n");
+  tcxstrprintf(sarg->xstr, "Content-Type: application/octet-stream\r\n");
+  tcxstrprintf(sarg->xstr, "Content-Length: %d\r\n", vsiz);
+  tcxstrprintf(sarg->xstr, "\r\n");
+  struct iovec iov[2];
+  iov[0].iov_base = (void *)tcxstrptr(sarg->xstr);
+  iov[0].iov_len = tcxstrsize(sarg->xstr);
+  iov[1].iov_base = (void *)vbuf;
+  iov[1].iov_len = vsiz;
+  if(!ttsocksendv(sarg->sock, iov, 2)) sarg->err = true;
+}
+
+
 /* get the summation of status information of a command */
 static uint64_t sumstat(TASKARG *arg, int seq){
   int thnum = arg->thnum;
@@ -919,7 +1407,7 @@ static void do_put(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     if(mask & ((1ULL << TTSEQPUT) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLWRITE))){
       code = 1;
       ttservlog(g_serv, TTLOGINFO, "do_put: forbidden");
-    } else if(!tculogdbput(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz)){
+    } else if(!tculogdbput(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz, tcmdbhash(buf, ksiz))){
       arg->counts[TTSEQNUM*req->idx+TTSEQPUTMISS]++;
       code = 1;
       ttservlog(g_serv, TTLOGERROR, "do_put: operation failed");
@@ -959,7 +1447,8 @@ static void do_putkeep(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     if(mask & ((1ULL << TTSEQPUTKEEP) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLWRITE))){
       code = 1;
       ttservlog(g_serv, TTLOGINFO, "do_putkeep: forbidden");
-    } else if(!tculogdbputkeep(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz)){
+    } else if(!tculogdbputkeep(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz,
+                               tcmdbhash(buf, ksiz))){
       arg->counts[TTSEQNUM*req->idx+TTSEQPUTMISS]++;
       code = 1;
     }
@@ -998,7 +1487,8 @@ static void do_putcat(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     if(mask & ((1ULL << TTSEQPUTCAT) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLWRITE))){
       code = 1;
       ttservlog(g_serv, TTLOGINFO, "do_putcat: forbidden");
-    } else if(!tculogdbputcat(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz)){
+    } else if(!tculogdbputcat(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz,
+                              tcmdbhash(buf, ksiz))){
       arg->counts[TTSEQNUM*req->idx+TTSEQPUTMISS]++;
       code = 1;
       ttservlog(g_serv, TTLOGERROR, "do_putcat: operation failed");
@@ -1038,7 +1528,7 @@ static void do_putnr(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     if(mask & ((1ULL << TTSEQPUTNR) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLWRITE))){
       code = 1;
       ttservlog(g_serv, TTLOGINFO, "do_putnr: forbidden");
-    } else if(!tculogdbput(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz)){
+    } else if(!tculogdbput(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz, tcmdbhash(buf, ksiz))){
       arg->counts[TTSEQNUM*req->idx+TTSEQPUTMISS]++;
       code = 1;
       ttservlog(g_serv, TTLOGERROR, "do_putnr: operation failed");
@@ -1051,6 +1541,48 @@ static void do_putnr(TTSOCK *sock, TASKARG *arg, TTREQ *req){
 }
 
 
+/* handle the putexp command */
+static void do_putexp(TTSOCK *sock, TASKARG *arg, TTREQ *req){
+  ttservlog(g_serv, TTLOGDEBUG, "doing putexp command");
+  arg->counts[TTSEQNUM*req->idx+TTSEQPUT]++;
+  uint64_t mask = arg->mask;
+  TCMDB *mdb = arg->mdb;
+  TCULOG *ulog = arg->ulog;
+  uint32_t sid = arg->sid;
+  int ksiz = ttsockgetint32(sock);
+  int vsiz = ttsockgetint32(sock);
+  int xtime = ttsockgetint32(sock);
+  if(ttsockcheckend(sock) || ksiz < 0 || ksiz > MAXARGSIZ || vsiz < 0 || vsiz > MAXARGSIZ){
+    ttservlog(g_serv, TTLOGINFO, "do_putexp: invalid parameters");
+    return;
+  }
+  int rsiz = ksiz + vsiz;
+  char stack[TTIOBUFSIZ];
+  char *buf = (rsiz < TTIOBUFSIZ) ? stack : tcmalloc(rsiz + 1);
+  pthread_cleanup_push(free, (buf == stack) ? NULL : buf);
+  if(ttsockrecv(sock, buf, rsiz) && !ttsockcheckend(sock)){
+    uint8_t code = 0;
+    if(mask & ((1ULL << TTSEQPUT) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLWRITE))){
+      code = 1;
+      ttservlog(g_serv, TTLOGINFO, "do_putexp: forbidden");
+    } else if(!tculogdbputexp(ulog, sid, 0, mdb, buf, ksiz, buf + ksiz, vsiz, calcxtime(xtime),
+                              tcmdbhash(buf, ksiz))){
+      arg->counts[TTSEQNUM*req->idx+TTSEQPUTMISS]++;
+      code = 1;
+      ttservlog(g_serv, TTLOGERROR, "do_putexp: operation failed");
+    }
+    if(ttsocksend(sock, &code, sizeof(code))){
+      req->keep = true;
+    } else {
+      ttservlog(g_serv, TTLOGINFO, "do_putexp: response failed");
+    }
+  } else {
+    ttservlog(g_serv, TTLOGINFO, "do_putexp: invalid entity");
+  }
+  pthread_cleanup_pop(1);
+}
+
+
 /* handle the out command */
 static void do_out(TTSOCK *sock, TASKARG *arg, TTREQ *req){
   ttservlog(g_serv, TTLOGDEBUG, "doing out command");
@@ -1072,7 +1604,7 @@ static void do_out(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     if(mask & ((1ULL << TTSEQOUT) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLWRITE))){
       code = 1;
       ttservlog(g_serv, TTLOGINFO, "do_out: forbidden");
-    } else if(!tculogdbout(ulog, sid, 0, mdb, buf, ksiz)){
+    } else if(!tculogdbout(ulog, sid, 0, mdb, buf, ksiz, tcmdbhash(buf, ksiz))){
       arg->counts[TTSEQNUM*req->idx+TTSEQOUTMISS]++;
       code = 1;
     }
@@ -1103,31 +1635,22 @@ static void do_get(TTSOCK *sock, TASKARG *arg, TTREQ *req){
   char *buf = (ksiz < TTIOBUFSIZ) ? stack : tcmalloc(ksiz + 1);
   pthread_cleanup_push(free, (buf == stack) ? NULL : buf);
   if(ttsockrecv(sock, buf, ksiz) && !ttsockcheckend(sock)){
-    char *vbuf;
-    int vsiz;
+    SENDARG sarg;
+    sarg.sock = sock;
+    sarg.err = false;
+    bool hit;
     if(mask & ((1ULL << TTSEQGET) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLREAD))){
-      vbuf = NULL;
-      vsiz = 0;
+      hit = false;
       ttservlog(g_serv, TTLOGINFO, "do_get: forbidden");
     } else {
-      vbuf = tcmdbget(mdb, buf, ksiz, &vsiz);
+      hit = tcmdbvisit(mdb, buf, ksiz, visit_get, &sarg);
     }
-    if(vbuf){
-      int rsiz = vsiz + sizeof(uint8_t) + sizeof(uint32_t);
-      char *rbuf = (rsiz < TTIOBUFSIZ) ? stack : tcmalloc(rsiz);
-      pthread_cleanup_push(free, (rbuf == stack) ? NULL : rbuf);
-      *rbuf = 0;
-      uint32_t num;
-      num = htonl((uint32_t)vsiz);
-      memcpy(rbuf + sizeof(uint8_t), &num, sizeof(uint32_t));
-      memcpy(rbuf + sizeof(uint8_t) + sizeof(uint32_t), vbuf, vsiz);
-      free(vbuf);
-      if(ttsocksend(sock, rbuf, rsiz)){
+    if(hit){
+      if(!sarg.err){
         req->keep = true;
       } else {
         ttservlog(g_serv, TTLOGINFO, "do_get: response failed");
       }
-      pthread_cleanup_pop(1);
     } else {
       arg->counts[TTSEQNUM*req->idx+TTSEQGETMISS]++;
       uint8_t code = 1;
@@ -1144,6 +1667,53 @@ static void do_get(TTSOCK *sock, TASKARG *arg, TTREQ *req){
 }
 
 
+/* handle the getcmp command */
+static void do_getcmp(TTSOCK *sock, TASKARG *arg, TTREQ *req){
+  ttservlog(g_serv, TTLOGDEBUG, "doing getcmp command");
+  arg->counts[TTSEQNUM*req->idx+TTSEQGET]++;
+  uint64_t mask = arg->mask;
+  TCMDB *mdb = arg->mdb;
+  int ksiz = ttsockgetint32(sock);
+  if(ttsockcheckend(sock) || ksiz < 0 || ksiz > MAXARGSIZ){
+    ttservlog(g_serv, TTLOGINFO, "do_getcmp: invalid parameters");
+    return;
+  }
+  char stack[TTIOBUFSIZ];
+  char *buf = (ksiz < TTIOBUFSIZ) ? stack : tcmalloc(ksiz + 1);
+  pthread_cleanup_push(free, (buf == stack) ? NULL : buf);
+  if(ttsockrecv(sock, buf, ksiz) && !ttsockcheckend(sock)){
+    SENDARG sarg;
+    sarg.sock = sock;
+    sarg.err = false;
+    bool hit;
+    if(mask & ((1ULL << TTSEQGET) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLREAD))){
+      hit = false;
+      ttservlog(g_serv, TTLOGINFO, "do_getcmp: forbidden");
+    } else {
+      hit = tcmdbvisitrawhash(mdb, buf, ksiz, visit_getcmp, &sarg, tcmdbhash(buf, ksiz));
+    }
+    if(hit){
+      if(!sarg.err){
+        req->keep = true;
+      } else {
+        ttservlog(g_serv, TTLOGINFO, "do_getcmp: response failed");
+      }
+    } else {
+      arg->counts[TTSEQNUM*req->idx+TTSEQGETMISS]++;
+      uint8_t code = 1;
+      if(ttsocksend(sock, &code, sizeof(code))){
+        req->keep = true;
+      } else {
+        ttservlog(g_serv, TTLOGINFO, "do_getcmp: response failed");
+      }
+    }
+  } else {
+    ttservlog(g_serv, TTLOGINFO, "do_getcmp: invalid entity");
+  }
+  pthread_cleanup_pop(1);
+}
+
+
 /* handle the mget command */
 static void do_mget(TTSOCK *sock, TASKARG *arg, TTREQ *req){
   ttservlog(g_serv, TTLOGDEBUG, "doing mget command");
@@ -1177,21 +1747,13 @@ static void do_mget(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     if(mask & ((1ULL << TTSEQMGET) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLREAD))){
       ttservlog(g_serv, TTLOGINFO, "do_mget: forbidden");
     } else {
+      SENDARG sarg;
+      sarg.sock = sock;
+      sarg.xstr = xstr;
+      sarg.err = false;
       for(int i = 0; i < tclistnum(keys); i++){
-        int ksiz;
-        const char *kbuf = tclistval(keys, i, &ksiz);
-        int vsiz;
-        char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-        if(vbuf){
-          num = htonl((uint32_t)ksiz);
-          tcxstrcat(xstr, &num, sizeof(num));
-          num = htonl((uint32_t)vsiz);
-          tcxstrcat(xstr, &num, sizeof(num));
-          tcxstrcat(xstr, kbuf, ksiz);
-          tcxstrcat(xstr, vbuf, vsiz);
-          free(vbuf);
-          rnum++;
-        }
+        sarg.kbuf = tclistval(keys, i, &sarg.ksiz);
+        if(tcmdbvisit(mdb, sarg.kbuf, sarg.ksiz, visit_mget, &sarg)) rnum++;
       }
     }
     num = htonl((uint32_t)rnum);
@@ -1320,6 +1882,63 @@ static void do_iternext(TTSOCK *sock, TASKARG *arg, TTREQ *req){
 }
 
 
+/* handle the scan command */
+static void do_scan(TTSOCK *sock, TASKARG *arg, TTREQ *req){
+  ttservlog(g_serv, TTLOGDEBUG, "doing scan command");
+  arg->counts[TTSEQNUM*req->idx+TTSEQSCAN]++;
+  uint64_t mask = arg->mask;
+  TCMDB *mdb = arg->mdb;
+  uint64_t cur = ttsockgetint64(sock);
+  int max = ttsockgetint32(sock);
+  bool vals = ttsockgetint32(sock) != 0;
+  if(ttsockcheckend(sock)){
+    ttservlog(g_serv, TTLOGINFO, "do_scan: invalid parameters");
+    return;
+  }
+  if(max < 0 || max > MAXARGNUM) max = MAXARGNUM;
+  if(mask & ((1ULL << TTSEQSCAN) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLREAD))){
+    ttservlog(g_serv, TTLOGINFO, "do_scan: forbidden");
+    uint8_t code = 1;
+    if(ttsocksend(sock, &code, sizeof(code))){
+      req->keep = true;
+    } else {
+      ttservlog(g_serv, TTLOGINFO, "do_scan: response failed");
+    }
+    return;
+  }
+  TCLIST *recs = tcmdbscan(mdb, &cur, max, vals);
+  pthread_cleanup_push((void (*)(void *))tclistdel, recs);
+  TCXSTR *xstr = tcxstrnew();
+  pthread_cleanup_push((void (*)(void *))tcxstrdel, xstr);
+  uint8_t code = 0;
+  tcxstrcat(xstr, &code, sizeof(code));
+  uint64_t llnum = htonll(cur);
+  tcxstrcat(xstr, &llnum, sizeof(llnum));
+  int step = vals ? 2 : 1;
+  uint32_t num = htonl((uint32_t)(tclistnum(recs) / step));
+  tcxstrcat(xstr, &num, sizeof(num));
+  for(int i = 0; i < tclistnum(recs); i += step){
+    int ksiz;
+    const char *kbuf = tclistval(recs, i, &ksiz);
+    int vsiz = 0;
+    const char *vbuf = vals ? tclistval(recs, i + 1, &vsiz) : "";
+    num = htonl((uint32_t)ksiz);
+    tcxstrcat(xstr, &num, sizeof(num));
+    num = htonl((uint32_t)vsiz);
+    tcxstrcat(xstr, &num, sizeof(num));
+    tcxstrcat(xstr, kbuf, ksiz);
+    tcxstrcat(xstr, vbuf, vsiz);
+  }
+  if(ttsocksend(sock, tcxstrptr(xstr), tcxstrsize(xstr))){
+    req->keep = true;
+  } else {
+    ttservlog(g_serv, TTLOGINFO, "do_scan: response failed");
+  }
+  pthread_cleanup_pop(1);
+  pthread_cleanup_pop(1);
+}
+
+
 /* handle the fwmkeys command */
 static void do_fwmkeys(TTSOCK *sock, TASKARG *arg, TTREQ *req){
   ttservlog(g_serv, TTLOGDEBUG, "doing fwmkeys command");
@@ -1373,6 +1992,69 @@ static void do_fwmkeys(TTSOCK *sock, TASKARG *arg, TTREQ *req){
 }
 
 
+/* handle the range command */
+static void do_range(TTSOCK *sock, TASKARG *arg, TTREQ *req){
+  ttservlog(g_serv, TTLOGDEBUG, "doing range command");
+  arg->counts[TTSEQNUM*req->idx+TTSEQRANGE]++;
+  uint64_t mask = arg->mask;
+  TCMDB *mdb = arg->mdb;
+  int bksiz = ttsockgetint32(sock);
+  int eksiz = ttsockgetint32(sock);
+  int max = ttsockgetint32(sock);
+  bool vals = ttsockgetint32(sock) != 0;
+  if(ttsockcheckend(sock) || bksiz < 0 || bksiz > MAXARGSIZ || eksiz < -1 || eksiz > MAXARGSIZ){
+    ttservlog(g_serv, TTLOGINFO, "do_range: invalid parameters");
+    return;
+  }
+  bool ebound = eksiz >= 0;
+  if(!ebound) eksiz = 0;
+  int rsiz = bksiz + eksiz;
+  char stack[TTIOBUFSIZ];
+  char *buf = (rsiz < TTIOBUFSIZ) ? stack : tcmalloc(rsiz + 1);
+  pthread_cleanup_push(free, (buf == stack) ? NULL : buf);
+  if(ttsockrecv(sock, buf, rsiz) && !ttsockcheckend(sock)){
+    TCXSTR *xstr = tcxstrnew();
+    pthread_cleanup_push((void (*)(void *))tcxstrdel, xstr);
+    uint8_t code = 0;
+    tcxstrcat(xstr, &code, sizeof(code));
+    uint32_t num = 0;
+    tcxstrcat(xstr, &num, sizeof(num));
+    int rnum = 0;
+    if(mask & ((1ULL << TTSEQRANGE) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLREAD))){
+      ttservlog(g_serv, TTLOGINFO, "do_range: forbidden");
+    } else {
+      TCLIST *recs = tcmdbrange(mdb, buf, bksiz, ebound ? buf + bksiz : NULL, eksiz, max, vals);
+      int step = vals ? 2 : 1;
+      for(int i = 0; i < tclistnum(recs); i += step){
+        int ksiz;
+        const char *kbuf = tclistval(recs, i, &ksiz);
+        int vsiz = 0;
+        const char *vbuf = vals ? tclistval(recs, i + 1, &vsiz) : "";
+        num = htonl((uint32_t)ksiz);
+        tcxstrcat(xstr, &num, sizeof(num));
+        num = htonl((uint32_t)vsiz);
+        tcxstrcat(xstr, &num, sizeof(num));
+        tcxstrcat(xstr, kbuf, ksiz);
+        tcxstrcat(xstr, vbuf, vsiz);
+        rnum++;
+      }
+      tclistdel(recs);
+    }
+    num = htonl((uint32_t)rnum);
+    memcpy((char *)tcxstrptr(xstr) + sizeof(code), &num, sizeof(num));
+    if(ttsocksend(sock, tcxstrptr(xstr), tcxstrsize(xstr))){
+      req->keep = true;
+    } else {
+      ttservlog(g_serv, TTLOGINFO, "do_range: response failed");
+    }
+    pthread_cleanup_pop(1);
+  } else {
+    ttservlog(g_serv, TTLOGINFO, "do_range: invalid entity");
+  }
+  pthread_cleanup_pop(1);
+}
+
+
 /* handle the addint command */
 static void do_addint(TTSOCK *sock, TASKARG *arg, TTREQ *req){
   ttservlog(g_serv, TTLOGDEBUG, "doing addint command");
@@ -1396,7 +2078,7 @@ static void do_addint(TTSOCK *sock, TASKARG *arg, TTREQ *req){
       snum = INT_MIN;
       ttservlog(g_serv, TTLOGINFO, "do_addint: forbidden");
     } else {
-      snum = tculogdbaddint(ulog, sid, 0, mdb, buf, ksiz, anum);
+      snum = tculogdbaddint(ulog, sid, 0, mdb, buf, ksiz, anum, tcmdbhash(buf, ksiz));
     }
     if(snum != INT_MIN){
       *stack = 0;
@@ -1448,7 +2130,7 @@ static void do_adddouble(TTSOCK *sock, TASKARG *arg, TTREQ *req){
       snum = nan("");
       ttservlog(g_serv, TTLOGINFO, "do_adddouble: forbidden");
     } else {
-      snum = tculogdbadddouble(ulog, sid, 0, mdb, buf, ksiz, anum);
+      snum = tculogdbadddouble(ulog, sid, 0, mdb, buf, ksiz, anum, tcmdbhash(buf, ksiz));
     }
     if(!isnan(snum)){
       *stack = 0;
@@ -1651,11 +2333,51 @@ static void do_stat(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     wp += sprintf(wp, "time\t%.6f\n", now);
     wp += sprintf(wp, "pid\t%lld\n", (long long)getpid());
     wp += sprintf(wp, "sid\t%d\n", arg->sid);
-    wp += sprintf(wp, "type\ton-memory hash\n");
+    wp += sprintf(wp, "type\t%s\n", mdb->hdb ? "hash" : "on-memory hash");
+    wp += sprintf(wp, "engine\t%s\n", mdb->hdb ? "file" : (mdb->opts & MDBTCOMPACT) ? "compact" :
+                  (mdb->opts & MDBTFLAT) ? "flat" : "tree");
+    wp += sprintf(wp, "mnum\t%u\n", (unsigned int)mdb->mnum);
     const char *path = tcmdbpath(mdb);
     if(path) wp += sprintf(wp, "path\t%s\n", path);
     wp += sprintf(wp, "rnum\t%llu\n", (unsigned long long)tcmdbrnum(mdb));
     wp += sprintf(wp, "size\t%llu\n", (unsigned long long)tcmdbmsiz(mdb));
+    uint64_t obnum, rbnum;
+    uint64_t bnum = tcmdbbnum(mdb, &obnum, &rbnum);
+    wp += sprintf(wp, "bnum\t%llu\n", (unsigned long long)bnum);
+    wp += sprintf(wp, "loadfactor\t%.3f\n", bnum > 0 ? (double)tcmdbrnum(mdb) / bnum : 0.0);
+    wp += sprintf(wp, "rehash_bnum\t%llu\n", (unsigned long long)obnum);
+    wp += sprintf(wp, "rehash_done\t%llu\n", (unsigned long long)rbnum);
+    uint64_t slabused, slabpnum;
+    uint64_t slabsiz = tcmdbslab(mdb, &slabused, &slabpnum);
+    wp += sprintf(wp, "slab_pages\t%llu\n", (unsigned long long)slabpnum);
+    wp += sprintf(wp, "slab_size\t%llu\n", (unsigned long long)slabsiz);
+    wp += sprintf(wp, "slab_used\t%llu\n", (unsigned long long)slabused);
+    wp += sprintf(wp, "slab_waste\t%llu\n", (unsigned long long)(slabsiz - slabused));
+    int mpopts = tcmemplace();
+    wp += sprintf(wp, "huge\t%s\n", (mpopts & TCMPHUGETLB) ? "tlb" :
+                  (mpopts & TCMPTHP) ? "thp" : "none");
+    wp += sprintf(wp, "numa\t%s\n", (mpopts & TCMPLOCAL) ? "local" :
+                  (mpopts & TCMPINTER) ? "inter" : "none");
+    wp += sprintf(wp, "numa_nodes\t%d\n", tcnumanodes());
+    wp += sprintf(wp, "capsiz\t%llu\n", (unsigned long long)mdb->capsiz);
+    wp += sprintf(wp, "evictions\t%llu\n", (unsigned long long)tcmdbevnum(mdb));
+    uint64_t exnum;
+    uint64_t xnum = tcmdbxnum(mdb, &exnum);
+    wp += sprintf(wp, "ttl_rnum\t%llu\n", (unsigned long long)xnum);
+    wp += sprintf(wp, "expired\t%llu\n", (unsigned long long)exnum);
+    uint64_t cmpisiz, cmposiz;
+    double cmptime, dectime;
+    uint64_t cmpnum = tcmdbcmpstat(mdb, &cmpisiz, &cmposiz, &cmptime, &dectime);
+    wp += sprintf(wp, "cmpsiz\t%d\n", mdb->cmpsiz);
+    wp += sprintf(wp, "cmp_num\t%llu\n", (unsigned long long)cmpnum);
+    wp += sprintf(wp, "cmp_isiz\t%llu\n", (unsigned long long)cmpisiz);
+    wp += sprintf(wp, "cmp_osiz\t%llu\n", (unsigned long long)cmposiz);
+    wp += sprintf(wp, "cmp_ratio\t%.3f\n", cmposiz > 0 ? (double)cmpisiz / cmposiz : 1.0);
+    wp += sprintf(wp, "cmp_time\t%.6f\n", cmptime);
+    wp += sprintf(wp, "decmp_time\t%.6f\n", dectime);
+    uint64_t rnum = tcmdbrnum(mdb);
+    wp += sprintf(wp, "bytes_per_record\t%.1f\n",
+                  rnum > 0 ? (double)(slabused + tcmdbisiz(mdb)) / rnum : 0.0);
     TCLIST *args = tclistnew2(1);
     pthread_cleanup_push((void (*)(void *))tclistdel, args);
     TCLIST *res = tcmdbmisc(mdb, "error", args);
@@ -1675,6 +2397,22 @@ static void do_stat(TTSOCK *sock, TASKARG *arg, TTREQ *req){
       tclistdel(res);
     }
     pthread_cleanup_pop(1);
+    SNAPARG *snarg = arg->snarg;
+    if(snarg->path){
+      wp += sprintf(wp, "snap_path\t%s\n", snarg->path);
+      wp += sprintf(wp, "snap_count\t%llu\n", (unsigned long long)snarg->cnt);
+      wp += sprintf(wp, "snap_ts\t%llu\n", (unsigned long long)snarg->ts);
+      wp += sprintf(wp, "snap_ulog\t%08d:%llu\n", snarg->num, (unsigned long long)snarg->off);
+      wp += sprintf(wp, "snap_time\t%.6f\n", snarg->elapsed);
+      if(snarg->fail) wp += sprintf(wp, "snap_fail\t1\n");
+    }
+    if(arg->ulog->base){
+      int fnum;
+      uint64_t fsiz = tculogfsiz(arg->ulog, &fnum);
+      wp += sprintf(wp, "ulog_files\t%d\n", fnum);
+      wp += sprintf(wp, "ulog_size\t%llu\n", (unsigned long long)fsiz);
+      wp += sprintf(wp, "ulog_purged\t%llu\n", (unsigned long long)snarg->pnum);
+    }
     wp += sprintf(wp, "bigend\t%d\n", TCBIGEND);
     if(sarg->host[0] != '\0'){
       wp += sprintf(wp, "mhost\t%s\n", sarg->host);
@@ -1709,7 +2447,9 @@ static void do_stat(TTSOCK *sock, TASKARG *arg, TTREQ *req){
   wp += sprintf(wp, "cnt_vsiz\t%llu\n", (unsigned long long)sumstat(arg, TTSEQVSIZ));
   wp += sprintf(wp, "cnt_iterinit\t%llu\n", (unsigned long long)sumstat(arg, TTSEQITERINIT));
   wp += sprintf(wp, "cnt_iternext\t%llu\n", (unsigned long long)sumstat(arg, TTSEQITERNEXT));
+  wp += sprintf(wp, "cnt_scan\t%llu\n", (unsigned long long)sumstat(arg, TTSEQSCAN));
   wp += sprintf(wp, "cnt_fwmkeys\t%llu\n", (unsigned long long)sumstat(arg, TTSEQFWMKEYS));
+  wp += sprintf(wp, "cnt_range\t%llu\n", (unsigned long long)sumstat(arg, TTSEQRANGE));
   wp += sprintf(wp, "cnt_addint\t%llu\n", (unsigned long long)sumstat(arg, TTSEQADDINT));
   wp += sprintf(wp, "cnt_adddouble\t%llu\n", (unsigned long long)sumstat(arg, TTSEQADDDOUBLE));
   wp += sprintf(wp, "cnt_ext\t%llu\n", (unsigned long long)sumstat(arg, TTSEQEXT));
@@ -1779,8 +2519,14 @@ static void do_misc(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     if(mask & ((1ULL << TTSEQMISC) | (1ULL << TTSEQALLORG) | (1ULL << TTSEQALLWRITE))){
       ttservlog(g_serv, TTLOGINFO, "do_misc: forbidden");
     } else {
-      TCLIST *res = (opts & RDBMONOULOG) ?
-        tcmdbmisc(mdb, name, args) : tculogdbmisc(ulog, sid, 0, mdb, name, args);
+      TCLIST *res;
+      if(!strcmp(name, "snapshot")){
+        res = arg->snarg->path ? tclistnew2(1) : NULL;
+        arg->snarg->req = true;
+      } else {
+        res = (opts & RDBMONOULOG) ?
+          tcmdbmisc(mdb, name, args) : tculogdbmisc(ulog, sid, 0, mdb, name, args);
+      }
       if(res){
         for(int i = 0; i < tclistnum(res); i++){
           int esiz;
@@ -1831,7 +2577,7 @@ static void do_repl(TTSOCK *sock, TASKARG *arg, TTREQ *req){
     return;
   }
   uint32_t lnum = htonl(arg->sid);
-  if(!ttsocksend(sock, &lnum, sizeof(lnum))){
+  if(!ttsocksetcork(sock, false) || !ttsocksend(sock, &lnum, sizeof(lnum))){
     ttservlog(g_serv, TTLOGINFO, "do_repl: response failed");
     return;
   }
@@ -1839,6 +2585,8 @@ static void do_repl(TTSOCK *sock, TASKARG *arg, TTREQ *req){
   if(ulrd){
     ttservlog(g_serv, TTLOGINFO, "replicating to sid=%u after %llu",
               (unsigned int)sid, (unsigned long long)ts - 1);
+    arg->rtss[req->idx] = ts;
+    ttservhandoff(req);
     pthread_cleanup_push((void (*)(void *))tculrddel, ulrd);
     bool err = false;
     double noptime = 0;
@@ -1862,6 +2610,7 @@ static void do_repl(TTSOCK *sock, TASKARG *arg, TTREQ *req){
       uint64_t rts;
       uint32_t rsid, rmid;
       while(!err && (rbuf = tculrdread(ulrd, &rsiz, &rts, &rsid, &rmid)) != NULL){
+        arg->rtss[req->idx] = rts;
         if(rsid == sid || rmid == sid){
           if((nopcnt++ & 0xff) == 0){
             now = tctime();
@@ -1898,6 +2647,7 @@ static void do_repl(TTSOCK *sock, TASKARG *arg, TTREQ *req){
         pthread_cleanup_pop(1);
       }
     }
+    arg->rtss[req->idx] = 0;
     pthread_cleanup_pop(1);
   } else {
     ttservlog(g_serv, TTLOGERROR, "do_repl: tculrdnew failed");
@@ -1920,6 +2670,7 @@ static void do_mc_set(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, int
   bool nr = tnum > 5 && !strcmp(tokens[5], "noreply");
   const char *kbuf = tokens[1];
   int ksiz = strlen(kbuf);
+  int64_t xtime = calcxtime(tcatoi(tokens[3]));
   int vsiz = tclmax(tcatoi(tokens[4]), 0);
   char stack[TTIOBUFSIZ];
   char *vbuf = (vsiz < TTIOBUFSIZ) ? stack : tcmalloc(vsiz + 1);
@@ -1930,7 +2681,8 @@ static void do_mc_set(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, int
     if(mask & ((1ULL << TTSEQPUT) | (1ULL << TTSEQALLMC) | (1ULL << TTSEQALLWRITE))){
       len = sprintf(stack, "CLIENT_ERROR forbidden\r\n");
       ttservlog(g_serv, TTLOGINFO, "do_mc_set: forbidden");
-    } else if(tculogdbput(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz)){
+    } else if(tculogdbputexp(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz, xtime,
+                             tcmdbhash(kbuf, ksiz))){
       len = sprintf(stack, "STORED\r\n");
     } else {
       arg->counts[TTSEQNUM*req->idx+TTSEQPUTMISS]++;
@@ -1964,6 +2716,7 @@ static void do_mc_add(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, int
   bool nr = tnum > 5 && !strcmp(tokens[5], "noreply");
   const char *kbuf = tokens[1];
   int ksiz = strlen(kbuf);
+  int64_t xtime = calcxtime(tcatoi(tokens[3]));
   int vsiz = tclmax(tcatoi(tokens[4]), 0);
   char stack[TTIOBUFSIZ];
   char *vbuf = (vsiz < TTIOBUFSIZ) ? stack : tcmalloc(vsiz + 1);
@@ -1974,7 +2727,8 @@ static void do_mc_add(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, int
     if(mask & ((1ULL << TTSEQPUTKEEP) | (1ULL << TTSEQALLMC) | (1ULL << TTSEQALLWRITE))){
       len = sprintf(stack, "CLIENT_ERROR forbidden\r\n");
       ttservlog(g_serv, TTLOGINFO, "do_mc_add: forbidden");
-    } else if(tculogdbputkeep(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz)){
+    } else if(tculogdbputkeepexp(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz, xtime,
+                                 tcmdbhash(kbuf, ksiz))){
       len = sprintf(stack, "STORED\r\n");
     } else {
       arg->counts[TTSEQNUM*req->idx+TTSEQPUTMISS]++;
@@ -2008,8 +2762,10 @@ static void do_mc_replace(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens,
   bool nr = tnum > 5 && !strcmp(tokens[5], "noreply");
   const char *kbuf = tokens[1];
   int ksiz = strlen(kbuf);
+  int64_t xtime = calcxtime(tcatoi(tokens[3]));
   int vsiz = tclmax(tcatoi(tokens[4]), 0);
-  int mtxidx = recmtxidx(kbuf, ksiz);
+  uint64_t hash = tcmdbhash(kbuf, ksiz);
+  int mtxidx = recmtxidx(hash);
   char stack[TTIOBUFSIZ];
   char *vbuf = (vsiz < TTIOBUFSIZ) ? stack : tcmalloc(vsiz + 1);
   pthread_cleanup_push(free, (vbuf == stack) ? NULL : vbuf);
@@ -2023,8 +2779,8 @@ static void do_mc_replace(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens,
       if(pthread_mutex_lock(rmtxs + mtxidx) != 0){
         len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
         ttservlog(g_serv, TTLOGERROR, "do_mc_replace: pthread_mutex_lock failed");
-      } else if(tcmdbvsiz(mdb, kbuf, ksiz) >= 0){
-        if(tculogdbput(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz)){
+      } else if(tcmdbvsizhash(mdb, kbuf, ksiz, hash) >= 0){
+        if(tculogdbputexp(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz, xtime, hash)){
           len = sprintf(stack, "STORED\r\n");
         } else {
           len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
@@ -2066,7 +2822,8 @@ static void do_mc_append(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens,
   const char *kbuf = tokens[1];
   int ksiz = strlen(kbuf);
   int vsiz = tclmax(tcatoi(tokens[4]), 0);
-  int mtxidx = recmtxidx(kbuf, ksiz);
+  uint64_t hash = tcmdbhash(kbuf, ksiz);
+  int mtxidx = recmtxidx(hash);
   char stack[TTIOBUFSIZ];
   char *vbuf = (vsiz < TTIOBUFSIZ) ? stack : tcmalloc(vsiz + 1);
   pthread_cleanup_push(free, (vbuf == stack) ? NULL : vbuf);
@@ -2080,8 +2837,8 @@ static void do_mc_append(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens,
       if(pthread_mutex_lock(rmtxs + mtxidx) != 0){
         len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
         ttservlog(g_serv, TTLOGERROR, "do_mc_append: pthread_mutex_lock failed");
-      } else if(tcmdbvsiz(mdb, kbuf, ksiz) >= 0){
-        if(tculogdbputcat(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz)){
+      } else if(tcmdbvsizhash(mdb, kbuf, ksiz, hash) >= 0){
+        if(tculogdbputcat(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz, hash)){
           len = sprintf(stack, "STORED\r\n");
         } else {
           len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
@@ -2123,7 +2880,8 @@ static void do_mc_prepend(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens,
   const char *kbuf = tokens[1];
   int ksiz = strlen(kbuf);
   int vsiz = tclmax(tcatoi(tokens[4]), 0);
-  int mtxidx = recmtxidx(kbuf, ksiz);
+  uint64_t hash = tcmdbhash(kbuf, ksiz);
+  int mtxidx = recmtxidx(hash);
   char stack[TTIOBUFSIZ];
   char *vbuf = (vsiz < TTIOBUFSIZ) ? stack : tcmalloc(vsiz + 1);
   pthread_cleanup_push(free, (vbuf == stack) ? NULL : vbuf);
@@ -2139,11 +2897,12 @@ static void do_mc_prepend(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens,
       if(pthread_mutex_lock(rmtxs + mtxidx) != 0){
         len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
         ttservlog(g_serv, TTLOGERROR, "do_mc_prepend: pthread_mutex_lock failed");
-      } else if((obuf = tcmdbget(mdb, kbuf, ksiz, &osiz)) != NULL){
+      } else if((obuf = tcmdbgethash(mdb, kbuf, ksiz, &osiz, hash)) != NULL){
         char *nbuf = tcmalloc(vsiz + osiz + 1);
         memcpy(nbuf, vbuf, vsiz);
         memcpy(nbuf + vsiz, obuf, osiz);
-        tculogdbput(ulog, sid, 0, mdb, kbuf, ksiz, nbuf, vsiz + osiz);
+        tculogdbputexp(ulog, sid, 0, mdb, kbuf, ksiz, nbuf, vsiz + osiz,
+                       tcmdbxtimehash(mdb, kbuf, ksiz, hash), hash);
         len = sprintf(stack, "STORED\r\n");
         free(nbuf);
         free(obuf);
@@ -2177,30 +2936,25 @@ static void do_mc_get(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, int
   }
   TCXSTR *xstr = tcxstrnew();
   pthread_cleanup_push((void (*)(void *))tcxstrdel, xstr);
-  for(int i = 1; i < tnum; i++){
+  SENDARG sarg;
+  sarg.sock = sock;
+  sarg.xstr = xstr;
+  sarg.err = false;
+  for(int i = 1; i < tnum && !sarg.err; i++){
     arg->counts[TTSEQNUM*req->idx+TTSEQGET]++;
-    const char *kbuf = tokens[i];
-    int ksiz = strlen(kbuf);
-    int vsiz;
-    char *vbuf;
+    sarg.kbuf = tokens[i];
+    sarg.ksiz = strlen(sarg.kbuf);
+    bool hit;
     if(mask & ((1ULL << TTSEQGET) | (1ULL << TTSEQALLMC) | (1ULL << TTSEQALLREAD))){
-      vbuf = NULL;
-      vsiz = 0;
+      hit = false;
       ttservlog(g_serv, TTLOGINFO, "do_mc_get: forbidden");
     } else {
-      vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-    }
-    if(vbuf){
-      tcxstrprintf(xstr, "VALUE %s 0 %d\r\n", kbuf, vsiz);
-      tcxstrcat(xstr, vbuf, vsiz);
-      tcxstrcat(xstr, "\r\n", 2);
-      free(vbuf);
-    } else {
-      arg->counts[TTSEQNUM*req->idx+TTSEQGETMISS]++;
+      hit = tcmdbvisit(mdb, sarg.kbuf, sarg.ksiz, visit_mc_get, &sarg);
     }
+    if(!hit) arg->counts[TTSEQNUM*req->idx+TTSEQGETMISS]++;
   }
   tcxstrprintf(xstr, "END\r\n");
-  if(ttsocksend(sock, tcxstrptr(xstr), tcxstrsize(xstr))){
+  if(!sarg.err && ttsocksend(sock, tcxstrptr(xstr), tcxstrsize(xstr))){
     req->keep = true;
   } else {
     ttservlog(g_serv, TTLOGINFO, "do_mc_get: response failed");
@@ -2230,7 +2984,7 @@ static void do_mc_delete(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens,
   if(mask & ((1ULL << TTSEQOUT) | (1ULL << TTSEQALLMC) | (1ULL << TTSEQALLWRITE))){
     len = sprintf(stack, "CLIENT_ERROR forbidden\r\n");
     ttservlog(g_serv, TTLOGINFO, "do_mc_delete: forbidden");
-  } else if(tculogdbout(ulog, sid, 0, mdb, kbuf, ksiz)){
+  } else if(tculogdbout(ulog, sid, 0, mdb, kbuf, ksiz, tcmdbhash(kbuf, ksiz))){
     len = sprintf(stack, "DELETED\r\n");
   } else {
     arg->counts[TTSEQNUM*req->idx+TTSEQOUTMISS]++;
@@ -2261,33 +3015,26 @@ static void do_mc_incr(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, in
   const char *kbuf = tokens[1];
   int ksiz = strlen(kbuf);
   int64_t num = tcatoi(tokens[2]);
-  int mtxidx = recmtxidx(kbuf, ksiz);
+  uint64_t hash = tcmdbhash(kbuf, ksiz);
+  int mtxidx = recmtxidx(hash);
   char stack[TTIOBUFSIZ];
   int len;
+  uint64_t rnum;
   if(mask & ((1ULL << TTSEQADDINT) | (1ULL << TTSEQALLMC) | (1ULL << TTSEQALLWRITE))){
     len = sprintf(stack, "CLIENT_ERROR forbidden\r\n");
     ttservlog(g_serv, TTLOGINFO, "do_mc_incr: forbidden");
+  } else if(pthread_mutex_lock(rmtxs + mtxidx) != 0){
+    len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
+    ttservlog(g_serv, TTLOGERROR, "do_mc_incr: pthread_mutex_lock failed");
   } else {
-    if(pthread_mutex_lock(rmtxs + mtxidx) != 0){
-      ttsockprintf(sock, "SERVER_ERROR unexpected\r\n");
-      ttservlog(g_serv, TTLOGERROR, "do_mc_incr: pthread_mutex_lock failed");
-      return;
-    }
-    int vsiz;
-    char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-    if(vbuf){
-      num += tcatoi(vbuf);
-      if(num < 0) num = 0;
-      len = sprintf(stack, "%lld", (long long)num);
-      if(tculogdbput(ulog, sid, 0, mdb, kbuf, ksiz, stack, len)){
-        len = sprintf(stack, "%lld\r\n", (long long)num);
-      } else {
-        len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
-        ttservlog(g_serv, TTLOGERROR, "do_mc_incr: operation failed");
-      }
-      free(vbuf);
-    } else {
+    int rv = tculogdbincr(ulog, sid, 0, mdb, kbuf, ksiz, num, &rnum, hash);
+    if(rv > 0){
+      len = sprintf(stack, "%llu\r\n", (unsigned long long)rnum);
+    } else if(rv == 0){
       len = sprintf(stack, "NOT_FOUND\r\n");
+    } else {
+      len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
+      ttservlog(g_serv, TTLOGERROR, "do_mc_incr: operation failed");
     }
     if(pthread_mutex_unlock(rmtxs + mtxidx) != 0)
       ttservlog(g_serv, TTLOGERROR, "do_mc_incr: pthread_mutex_unlock failed");
@@ -2317,33 +3064,26 @@ static void do_mc_decr(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, in
   const char *kbuf = tokens[1];
   int ksiz = strlen(kbuf);
   int64_t num = tcatoi(tokens[2]) * -1;
-  int mtxidx = recmtxidx(kbuf, ksiz);
+  uint64_t hash = tcmdbhash(kbuf, ksiz);
+  int mtxidx = recmtxidx(hash);
   char stack[TTIOBUFSIZ];
   int len;
+  uint64_t rnum;
   if(mask & ((1ULL << TTSEQADDINT) | (1ULL << TTSEQALLMC) | (1ULL << TTSEQALLWRITE))){
     len = sprintf(stack, "CLIENT_ERROR forbidden\r\n");
     ttservlog(g_serv, TTLOGINFO, "do_mc_decr: forbidden");
+  } else if(pthread_mutex_lock(rmtxs + mtxidx) != 0){
+    len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
+    ttservlog(g_serv, TTLOGERROR, "do_mc_decr: pthread_mutex_lock failed");
   } else {
-    if(pthread_mutex_lock(rmtxs + mtxidx) != 0){
-      ttsockprintf(sock, "SERVER_ERROR unexpected\r\n");
-      ttservlog(g_serv, TTLOGERROR, "do_mc_decr: pthread_mutex_lock failed");
-      return;
-    }
-    int vsiz;
-    char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-    if(vbuf){
-      num += tcatoi(vbuf);
-      if(num < 0) num = 0;
-      len = sprintf(stack, "%lld", (long long)num);
-      if(tculogdbput(ulog, sid, 0, mdb, kbuf, ksiz, stack, len)){
-        len = sprintf(stack, "%lld\r\n", (long long)num);
-      } else {
-        len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
-        ttservlog(g_serv, TTLOGERROR, "do_mc_decr: operation failed");
-      }
-      free(vbuf);
-    } else {
+    int rv = tculogdbincr(ulog, sid, 0, mdb, kbuf, ksiz, num, &rnum, hash);
+    if(rv > 0){
+      len = sprintf(stack, "%llu\r\n", (unsigned long long)rnum);
+    } else if(rv == 0){
       len = sprintf(stack, "NOT_FOUND\r\n");
+    } else {
+      len = sprintf(stack, "SERVER_ERROR unexpected\r\n");
+      ttservlog(g_serv, TTLOGERROR, "do_mc_decr: operation failed");
     }
     if(pthread_mutex_unlock(rmtxs + mtxidx) != 0)
       ttservlog(g_serv, TTLOGERROR, "do_mc_decr: pthread_mutex_unlock failed");
@@ -2402,6 +3142,8 @@ static void do_mc_stats(TTSOCK *sock, TASKARG *arg, TTREQ *req, char **tokens, i
     wp += sprintf(wp, "STAT curr_items %lld\r\n", (long long)rnum);
     wp += sprintf(wp, "STAT total_items %lld\r\n", (long long)rnum);
     wp += sprintf(wp, "STAT bytes %lld\r\n", (long long)tcmdbmsiz(mdb));
+    wp += sprintf(wp, "STAT limit_maxbytes %llu\r\n", (unsigned long long)mdb->capsiz);
+    wp += sprintf(wp, "STAT evictions %llu\r\n", (unsigned long long)tcmdbevnum(mdb));
     wp += sprintf(wp, "STAT threads %d\r\n", arg->thnum);
     wp += sprintf(wp, "END\r\n");
   }
@@ -2498,6 +3240,7 @@ static void do_http_get(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
   pthread_cleanup_push(free, kbuf);
   TCXSTR *xstr = tcxstrnew();
   pthread_cleanup_push((void (*)(void *))tcxstrdel, xstr);
+  bool sent = false;
   if(mask & ((1ULL << TTSEQGET) | (1ULL << TTSEQALLHTTP) | (1ULL << TTSEQALLREAD))){
     int len = sprintf(line, "Forbidden\n");
     tcxstrprintf(xstr, "HTTP/1.1 403 Forbidden\r\n");
@@ -2507,15 +3250,17 @@ static void do_http_get(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
     tcxstrcat(xstr, line, len);
     ttservlog(g_serv, TTLOGINFO, "do_http_get: forbidden");
   } else {
-    int vsiz;
-    char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-    if(vbuf){
-      tcxstrprintf(xstr, "HTTP/1.1 200 OK\r\n");
-      tcxstrprintf(xstr, "Content-Type: application/octet-stream\r\n");
-      tcxstrprintf(xstr, "Content-Length: %d\r\n", vsiz);
-      tcxstrprintf(xstr, "\r\n");
-      tcxstrcat(xstr, vbuf, vsiz);
-      free(vbuf);
+    SENDARG sarg;
+    sarg.sock = sock;
+    sarg.xstr = xstr;
+    sarg.err = false;
+    if(tcmdbvisit(mdb, kbuf, ksiz, visit_http_get, &sarg)){
+      sent = true;
+      if(!sarg.err){
+        req->keep = keep;
+      } else {
+        ttservlog(g_serv, TTLOGINFO, "do_http_get: response failed");
+      }
     } else {
       arg->counts[TTSEQNUM*req->idx+TTSEQGETMISS]++;
       int len = sprintf(line, "Not Found\n");
@@ -2526,10 +3271,12 @@ static void do_http_get(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
       tcxstrcat(xstr, line, len);
     }
   }
-  if(ttsocksend(sock, tcxstrptr(xstr), tcxstrsize(xstr))){
-    req->keep = keep;
-  } else {
-    ttservlog(g_serv, TTLOGINFO, "do_http_get: response failed");
+  if(!sent){
+    if(ttsocksend(sock, tcxstrptr(xstr), tcxstrsize(xstr))){
+      req->keep = keep;
+    } else {
+      ttservlog(g_serv, TTLOGINFO, "do_http_get: response failed");
+    }
   }
   pthread_cleanup_pop(1);
   pthread_cleanup_pop(1);
@@ -2602,6 +3349,7 @@ static void do_http_put(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
   bool keep = ver >= 1;
   int vsiz = 0;
   int pdmode = 0;
+  int64_t xtime = 0;
   char line[LINEBUFSIZ];
   while(ttsockgets(sock, line, LINEBUFSIZ) && *line != '\0'){
     char *pv = strchr(line, ':');
@@ -2620,6 +3368,8 @@ static void do_http_put(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
       vsiz = tcatoi(pv);
     } else if(!tcstricmp(line, "x-tt-pdmode")){
       pdmode = tcatoi(pv);
+    } else if(!tcstricmp(line, "x-tt-ttl")){
+      xtime = calcxtime(tcatoi(pv));
     }
   }
   if(*uri == '/') uri++;
@@ -2643,7 +3393,8 @@ static void do_http_put(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
     } else {
       switch(pdmode){
         case 1:
-          if(tculogdbputkeep(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz)){
+          if(tculogdbputkeepexp(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz, xtime,
+                                tcmdbhash(kbuf, ksiz))){
             int len = sprintf(line, "Created\n");
             tcxstrprintf(xstr, "HTTP/1.1 201 Created\r\n");
             tcxstrprintf(xstr, "Content-Type: text/plain\r\n");
@@ -2661,7 +3412,7 @@ static void do_http_put(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
           }
           break;
         case 2:
-          if(tculogdbputcat(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz)){
+          if(tculogdbputcat(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz, tcmdbhash(kbuf, ksiz))){
             int len = sprintf(line, "Created\n");
             tcxstrprintf(xstr, "HTTP/1.1 201 Created\r\n");
             tcxstrprintf(xstr, "Content-Type: text/plain\r\n");
@@ -2680,7 +3431,8 @@ static void do_http_put(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, const c
           }
           break;
         default:
-          if(tculogdbput(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz)){
+          if(tculogdbputexp(ulog, sid, 0, mdb, kbuf, ksiz, vbuf, vsiz, xtime,
+                            tcmdbhash(kbuf, ksiz))){
             int len = sprintf(line, "Created\n");
             tcxstrprintf(xstr, "HTTP/1.1 201 Created\r\n");
             tcxstrprintf(xstr, "Content-Type: text/plain\r\n");
@@ -2909,7 +3661,7 @@ static void do_http_delete(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, cons
     tcxstrcat(xstr, line, len);
     ttservlog(g_serv, TTLOGINFO, "do_http_delete: forbidden");
   } else {
-    if(tculogdbout(ulog, sid, 0, mdb, kbuf, ksiz)){
+    if(tculogdbout(ulog, sid, 0, mdb, kbuf, ksiz, tcmdbhash(kbuf, ksiz))){
       int len = sprintf(line, "OK\n");
       tcxstrprintf(xstr, "HTTP/1.1 200 OK\r\n");
       tcxstrprintf(xstr, "Content-Type: text/plain\r\n");
@@ -2988,7 +3740,7 @@ static void do_http_options(TTSOCK *sock, TASKARG *arg, TTREQ *req, int ver, con
     tcxstrprintf(xstr, "X-TT-TIME: %.6f\r\n", now);
     tcxstrprintf(xstr, "X-TT-PID: %lld\r\n", (long long)getpid());
     tcxstrprintf(xstr, "X-TT-SID: %d\r\n", arg->sid);
-    tcxstrprintf(xstr, "X-TT-TYPE: on-memory hash\r\n");
+    tcxstrprintf(xstr, "X-TT-TYPE: %s\r\n", mdb->hdb ? "hash" : "on-memory hash");
     const char *path = tcmdbpath(mdb);
     if(path) tcxstrprintf(xstr, "X-TT-PATH: %s\r\n", path);
     tcxstrprintf(xstr, "X-TT-RNUM: %llu\r\n", (unsigned long long)tcmdbrnum(mdb));
@@ -16,6 +16,10 @@
 
 #include "util.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 
 /*************************************************************************************************
@@ -459,6 +463,560 @@ void tclistpushmalloc(TCLIST *list, void *ptr, int size){
 }
 
 
+/*************************************************************************************************
+ * deferred reclamation
+ *************************************************************************************************/
+
+
+#define TCRCLSLOTNUM   1024              // maximum number of reading threads
+#define TCRCLUNIT      64                // number of retired regions to trigger reclamation
+
+typedef struct {                         // type of structure for a slot of a reading thread
+  uint64_t epoch;                        // epoch at entering or 0 while quiescent
+  int depth;                             // depth of nested entering
+  int used;                              // whether the slot is owned by a thread
+} __attribute__((aligned(64))) TCRCLSLOT;
+
+typedef struct {                         // type of structure for a retired region
+  void (*proc)(void *, uint32_t);        // function to release the region or `NULL' for `free'
+  void *ptr;                             // pointer to the region
+  uint32_t num;                          // number of elements given to the function
+  uint64_t epoch;                        // epoch at retiring
+} TCRCLELEM;
+
+typedef struct {                         // type of structure for a reclaimer
+  TCRCLELEM *elems;                      // array of retired regions
+  int num;                               // number of retired regions
+  int anum;                              // number of allocated elements
+  int lim;                               // number of retired regions to trigger reclamation
+} TCRCL;
+
+
+/* Global epoch of reclamation. */
+static uint64_t tcrclepoch = 1;
+
+
+/* Slots of reading threads. */
+static TCRCLSLOT tcrclslots[TCRCLSLOTNUM];
+
+
+/* Number of slots ever used. */
+static uint32_t tcrclsnum = 0;
+
+
+/* Key of the slot of each thread. */
+static pthread_key_t tcrclkey;
+
+
+/* Flag to create the key of slots. */
+static pthread_once_t tcrclonce = PTHREAD_ONCE_INIT;
+
+
+/* private function prototypes */
+static void tcrclinit(void);
+static void tcrclslotdel(void *ptr);
+static TCRCL *tcrclnew(void);
+static void tcrcldel(TCRCL *rcl);
+static TCRCLSLOT *tcrclenter(void);
+static void tcrclleave(TCRCLSLOT *slot);
+static void tcrclretire(TCRCL *rcl, void (*proc)(void *, uint32_t), void *ptr, uint32_t num);
+static void tcrclcollect(TCRCL *rcl);
+static uint64_t tcrclstamp(void);
+static uint64_t tcrclmin(void);
+static bool tcseqcheck(const uint32_t *seqp, uint32_t seq);
+
+
+/* Create the key of slots of reading threads. */
+static void tcrclinit(void){
+  if(pthread_key_create(&tcrclkey, tcrclslotdel) != 0) tcmyfatal("pthread_key_create failed");
+}
+
+
+/* Release the slot of a finished thread.
+   `ptr' specifies the pointer to the slot. */
+static void tcrclslotdel(void *ptr){
+  TCRCLSLOT *slot = ptr;
+  slot->depth = 0;
+  __atomic_store_n(&slot->epoch, 0, __ATOMIC_RELEASE);
+  __atomic_store_n(&slot->used, 0, __ATOMIC_RELEASE);
+}
+
+
+/* Create a reclaimer object.
+   The return value is the new reclaimer object. */
+static TCRCL *tcrclnew(void){
+  pthread_once(&tcrclonce, tcrclinit);
+  TCRCL *rcl;
+  TCMALLOC(rcl, sizeof(*rcl));
+  rcl->anum = TCRCLUNIT;
+  TCMALLOC(rcl->elems, sizeof(*rcl->elems) * rcl->anum);
+  rcl->num = 0;
+  rcl->lim = TCRCLUNIT;
+  return rcl;
+}
+
+
+/* Delete a reclaimer object.
+   `rcl' specifies the reclaimer object.
+   All retired regions are released at once, so no thread may be reading them. */
+static void tcrcldel(TCRCL *rcl){
+  assert(rcl);
+  for(int i = 0; i < rcl->num; i++){
+    TCRCLELEM *elem = rcl->elems + i;
+    if(elem->proc){
+      elem->proc(elem->ptr, elem->num);
+    } else {
+      free(elem->ptr);
+    }
+  }
+  free(rcl->elems);
+  free(rcl);
+}
+
+
+/* Enter a section reading regions which may be retired concurrently.
+   The return value is the slot of the calling thread or `NULL' if no slot is available.
+   Regions retired after entering are not released until `tcrclleave' is called. */
+static TCRCLSLOT *tcrclenter(void){
+  TCRCLSLOT *slot = pthread_getspecific(tcrclkey);
+  if(!slot){
+    for(int i = 0; i < TCRCLSLOTNUM && !slot; i++){
+      if(!__atomic_load_n(&tcrclslots[i].used, __ATOMIC_RELAXED) &&
+         __sync_bool_compare_and_swap(&tcrclslots[i].used, 0, 1)) slot = tcrclslots + i;
+    }
+    if(!slot) return NULL;
+    if(pthread_setspecific(tcrclkey, slot) != 0){
+      __atomic_store_n(&slot->used, 0, __ATOMIC_RELEASE);
+      return NULL;
+    }
+    uint32_t snum = __atomic_load_n(&tcrclsnum, __ATOMIC_RELAXED);
+    uint32_t sidx = slot - tcrclslots + 1;
+    while(snum < sidx && !__sync_bool_compare_and_swap(&tcrclsnum, snum, sidx)){
+      snum = __atomic_load_n(&tcrclsnum, __ATOMIC_RELAXED);
+    }
+  }
+  if(slot->depth++ < 1){
+    __atomic_store_n(&slot->epoch, __atomic_load_n(&tcrclepoch, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  }
+  return slot;
+}
+
+
+/* Leave a section reading regions which may be retired concurrently.
+   `slot' specifies the slot returned by `tcrclenter'. */
+static void tcrclleave(TCRCLSLOT *slot){
+  assert(slot);
+  if(--slot->depth < 1) __atomic_store_n(&slot->epoch, 0, __ATOMIC_RELEASE);
+}
+
+
+/* Retire a region which has been unlinked from shared structures.
+   `rcl' specifies the reclaimer object.
+   `proc' specifies the function to release the region.  If it is `NULL', `free' is used.
+   `ptr' specifies the pointer to the region.
+   `num' specifies the number given to the function with the region.
+   The region is released after all threads reading it have left their sections. */
+static void tcrclretire(TCRCL *rcl, void (*proc)(void *, uint32_t), void *ptr, uint32_t num){
+  assert(rcl && ptr);
+  if(rcl->num >= rcl->anum){
+    rcl->anum *= 2;
+    TCREALLOC(rcl->elems, rcl->elems, sizeof(*rcl->elems) * rcl->anum);
+  }
+  TCRCLELEM *elem = rcl->elems + rcl->num++;
+  elem->proc = proc;
+  elem->ptr = ptr;
+  elem->num = num;
+  elem->epoch = tcrclstamp();
+  if(rcl->num >= rcl->lim) tcrclcollect(rcl);
+}
+
+
+/* Release retired regions which no thread can be reading any longer.
+   `rcl' specifies the reclaimer object. */
+static void tcrclcollect(TCRCL *rcl){
+  assert(rcl);
+  uint64_t min = tcrclmin();
+  int num = 0;
+  for(int i = 0; i < rcl->num; i++){
+    TCRCLELEM *elem = rcl->elems + i;
+    if(elem->epoch >= min){
+      rcl->elems[num++] = *elem;
+    } else if(elem->proc){
+      elem->proc(elem->ptr, elem->num);
+    } else {
+      free(elem->ptr);
+    }
+  }
+  rcl->num = num;
+  rcl->lim = num + TCRCLUNIT;
+}
+
+
+/* Get the epoch of regions being retired now.
+   The return value is the epoch to be compared with the result of `tcrclmin'.
+   Regions must have been unlinked from shared structures before calling this function. */
+static uint64_t tcrclstamp(void){
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  return __atomic_load_n(&tcrclepoch, __ATOMIC_RELAXED);
+}
+
+
+/* Get the minimum epoch of threads in reading sections.
+   The return value is the minimum epoch.  Regions retired at epochs less than it can be
+   released because no thread can be reading them any longer. */
+static uint64_t tcrclmin(void){
+  uint64_t min = __atomic_add_fetch(&tcrclepoch, 1, __ATOMIC_SEQ_CST);
+  uint32_t snum = __atomic_load_n(&tcrclsnum, __ATOMIC_ACQUIRE);
+  for(uint32_t i = 0; i < snum; i++){
+    uint64_t epoch = __atomic_load_n(&tcrclslots[i].epoch, __ATOMIC_ACQUIRE);
+    if(epoch > 0 && epoch < min) min = epoch;
+  }
+  return min;
+}
+
+
+/* Check whether a sequence number is unchanged since an optimistic reading started.
+   `seqp' specifies the pointer to the sequence number.
+   `seq' specifies the value read at starting.
+   The return value is true if no update has been done, else, it is false. */
+static bool tcseqcheck(const uint32_t *seqp, uint32_t seq){
+  assert(seqp);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return __atomic_load_n(seqp, __ATOMIC_RELAXED) == seq;
+}
+
+
+
+/*************************************************************************************************
+ * slab allocator
+ *************************************************************************************************/
+
+
+#define TCSLABPAGESIZ  (1U<<20)          // size of each page
+#define TCSLABMINSIZ   16                // size of chunks of the smallest class
+#define TCSLABMAXSIZ   (TCSLABPAGESIZ/8) // maximum size of chunks carved from pages
+#define TCSLABFACTOR   1.25              // growth factor of sizes of classes
+#define TCSLABCLSMAX   64                // maximum number of classes
+#define TCSLABLARGE    UINT32_MAX        // class index of a page holding a large region
+#define TCSLABHUGESIZ  (1U<<21)          // size of each page backed by huge pages
+#define TCMPHUGESIZ    (1U<<21)          // size of each huge page
+#define TCMPNODEMAX    64                // maximum number of NUMA nodes
+#define TCMPPREFERRED  1                 // memory policy to prefer a node
+#define TCMPINTERLEAVE 3                 // memory policy to interleave nodes
+
+typedef struct _TCSLABPAGE {             // type of structure for a page of a slab allocator
+  struct _TCSLABPAGE *prev;              // previous page having free chunks
+  struct _TCSLABPAGE *next;              // next page having free chunks
+  void *slab;                            // slab allocator owning the page
+  void *free;                            // list of free chunks
+  uint64_t size;                         // size of the mapped region
+  uint32_t cls;                          // index of the class
+  uint32_t used;                         // number of chunks in use
+  uint32_t bump;                         // offset of the area never used
+  bool listed;                           // whether the page is in the list of its class
+} __attribute__((aligned(64))) TCSLABPAGE;
+
+typedef struct {                         // type of structure for a class of a slab allocator
+  uint32_t size;                         // size of each chunk
+  TCSLABPAGE *pages;                     // list of pages having free chunks
+} TCSLABCLS;
+
+typedef struct {                         // type of structure for a slab allocator
+  TCSLABCLS classes[TCSLABCLSMAX];       // size classes
+  int cnum;                              // number of the classes
+  uint64_t pnum;                         // number of pages
+  uint64_t msiz;                         // total size of mapped regions
+  uint64_t usiz;                         // total size of chunks in use
+  int node;                              // NUMA node of the pages or -1
+} TCSLAB;
+
+
+/* Options of memory placement. */
+static int tcmpopts = 0;
+
+
+/* Size of each page of slab allocators. */
+static uint32_t tcslabpsiz = TCSLABPAGESIZ;
+
+
+/* private function prototypes */
+static TCSLAB *tcslabnew(void);
+static void tcslabdel(TCSLAB *slab);
+static void *tcslaballoc(TCSLAB *slab, size_t size);
+static void tcslabfree(TCSLAB *slab, void *ptr);
+static void tcslabrelease(void *ptr, uint32_t num);
+static TCSLABPAGE *tcslabmap(TCSLAB *slab, uint64_t size, uint32_t cls);
+static void tcslabunmap(TCSLABPAGE *page);
+static void *tcmpmap(uint64_t *sp, uint64_t align, int node);
+static void tcmpbind(void *ptr, uint64_t size, int node);
+static void *tcmpzeromap(uint64_t size, int node);
+
+
+/* Create a slab allocator object.
+   The return value is the new slab allocator object. */
+static TCSLAB *tcslabnew(void){
+  TCSLAB *slab;
+  TCMALLOC(slab, sizeof(*slab));
+  double size = TCSLABMINSIZ;
+  int cnum = 0;
+  while(cnum < TCSLABCLSMAX && size <= TCSLABMAXSIZ){
+    uint32_t csiz = TCALIGNPAD((uint32_t)size) + (uint32_t)size;
+    if(cnum < 1 || csiz > slab->classes[cnum-1].size){
+      slab->classes[cnum].size = csiz;
+      slab->classes[cnum].pages = NULL;
+      cnum++;
+    }
+    size *= TCSLABFACTOR;
+  }
+  slab->classes[cnum-1].size = TCSLABMAXSIZ;
+  slab->cnum = cnum;
+  slab->pnum = 0;
+  slab->msiz = 0;
+  slab->usiz = 0;
+  slab->node = -1;
+  return slab;
+}
+
+
+/* Delete a slab allocator object.
+   `slab' specifies the slab allocator object.
+   All chunks should have been released beforehand. */
+static void tcslabdel(TCSLAB *slab){
+  assert(slab);
+  for(int i = 0; i < slab->cnum; i++){
+    TCSLABPAGE *page = slab->classes[i].pages;
+    while(page){
+      TCSLABPAGE *next = page->next;
+      tcslabunmap(page);
+      page = next;
+    }
+  }
+  free(slab);
+}
+
+
+/* Allocate a region with a slab allocator.
+   `slab' specifies the slab allocator object.  If it is `NULL', `malloc' is used.
+   `size' specifies the size of the region.
+   The return value is the pointer to the allocated region.
+   A region larger than the biggest class is mapped separately. */
+static void *tcslaballoc(TCSLAB *slab, size_t size){
+  if(!slab){
+    void *ptr;
+    TCMALLOC(ptr, size);
+    return ptr;
+  }
+  if(size > TCSLABMAXSIZ){
+    TCSLABPAGE *page = tcslabmap(slab, sizeof(*page) + size, TCSLABLARGE);
+    page->used = 1;
+    slab->usiz += page->size;
+    return (char *)page + sizeof(*page);
+  }
+  int left = 0;
+  int right = slab->cnum - 1;
+  while(left < right){
+    int mid = (left + right) / 2;
+    if(slab->classes[mid].size < size){
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  TCSLABCLS *cls = slab->classes + left;
+  TCSLABPAGE *page = cls->pages;
+  if(!page){
+    page = tcslabmap(slab, tcslabpsiz, left);
+    page->listed = true;
+    cls->pages = page;
+  }
+  void *ptr;
+  if(page->free){
+    ptr = page->free;
+    page->free = *(void **)ptr;
+  } else {
+    ptr = (char *)page + page->bump;
+    page->bump += cls->size;
+  }
+  page->used++;
+  slab->usiz += cls->size;
+  if(!page->free && page->bump + cls->size > tcslabpsiz){
+    cls->pages = page->next;
+    if(page->next) page->next->prev = NULL;
+    page->next = NULL;
+    page->listed = false;
+  }
+  return ptr;
+}
+
+
+/* Free a region allocated with a slab allocator.
+   `slab' specifies the slab allocator object.  If it is `NULL', `free' is used.
+   `ptr' specifies the pointer to the region.
+   A page whose chunks are all free is returned to the system unless it is the last page having
+   free chunks in its class. */
+static void tcslabfree(TCSLAB *slab, void *ptr){
+  if(!slab){
+    free(ptr);
+    return;
+  }
+  assert(ptr);
+  TCSLABPAGE *page = (TCSLABPAGE *)((uintptr_t)ptr & ~(uintptr_t)(tcslabpsiz - 1));
+  assert(page->slab == slab);
+  if(page->cls == TCSLABLARGE){
+    slab->usiz -= page->size;
+    tcslabunmap(page);
+    return;
+  }
+  TCSLABCLS *cls = slab->classes + page->cls;
+  *(void **)ptr = page->free;
+  page->free = ptr;
+  page->used--;
+  slab->usiz -= cls->size;
+  if(!page->listed){
+    page->prev = NULL;
+    page->next = cls->pages;
+    if(cls->pages) cls->pages->prev = page;
+    cls->pages = page;
+    page->listed = true;
+  }
+  if(page->used < 1 && (page->prev || page->next)){
+    if(page->prev){
+      page->prev->next = page->next;
+    } else {
+      cls->pages = page->next;
+    }
+    if(page->next) page->next->prev = page->prev;
+    tcslabunmap(page);
+  }
+}
+
+
+/* Free a region allocated with a slab allocator found by the region itself.
+   `ptr' specifies the pointer to the region.
+   `num' is not used.
+   This function is suitable as a function to release a retired region. */
+static void tcslabrelease(void *ptr, uint32_t num){
+  assert(ptr);
+  TCSLABPAGE *page = (TCSLABPAGE *)((uintptr_t)ptr & ~(uintptr_t)(tcslabpsiz - 1));
+  tcslabfree(page->slab, ptr);
+}
+
+
+/* Map a page of a slab allocator.
+   `slab' specifies the slab allocator object.
+   `size' specifies the size of the page including the header.
+   `cls' specifies the index of the class or `TCSLABLARGE'.
+   The return value is the new page aligned to the page size.
+   The page is placed by the options of memory placement and the node of the allocator. */
+static TCSLABPAGE *tcslabmap(TCSLAB *slab, uint64_t size, uint32_t cls){
+  assert(slab && size >= sizeof(TCSLABPAGE));
+  TCSLABPAGE *page = tcmpmap(&size, tcslabpsiz, slab->node);
+  page->prev = NULL;
+  page->next = NULL;
+  page->slab = slab;
+  page->free = NULL;
+  page->size = size;
+  page->cls = cls;
+  page->used = 0;
+  page->bump = sizeof(*page);
+  page->listed = false;
+  slab->pnum++;
+  slab->msiz += size;
+  return page;
+}
+
+
+/* Map an anonymous region by the options of memory placement.
+   `sp' specifies the pointer to the variable of the size of the region.  The size as mapped, which
+   may be rounded up, is assigned to it.
+   `align' specifies the alignment of the region.  It should be a power of two.
+   `node' specifies the NUMA node to be preferred, or -1 to follow the options.
+   The return value is the pointer to the mapped region.
+   Huge pages of the pool are tried first if they are enabled and the region is not smaller than
+   a huge page, and the region is mapped with ordinary pages if the pool is exhausted. */
+static void *tcmpmap(uint64_t *sp, uint64_t align, int node){
+  assert(sp && *sp > 0 && align > 0);
+  long psiz = sysconf(_SC_PAGESIZE);
+  if(psiz < 1) psiz = 4096;
+  uint64_t size = (*sp + psiz - 1) / psiz * psiz;
+  char *map = MAP_FAILED;
+  if((tcmpopts & TCMPHUGETLB) && size >= TCMPHUGESIZ && align <= TCMPHUGESIZ){
+    uint64_t hsiz = (size + TCMPHUGESIZ - 1) & ~(uint64_t)(TCMPHUGESIZ - 1);
+    map = mmap(0, hsiz, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(map != MAP_FAILED) size = hsiz;
+  }
+  if(map == MAP_FAILED){
+    uint64_t pad = align > (uint64_t)psiz ? align : 0;
+    map = mmap(0, size + pad, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(map == MAP_FAILED) tcmyfatal("out of memory");
+    if(pad > 0){
+      char *base = (char *)(((uintptr_t)map + align - 1) & ~(uintptr_t)(align - 1));
+      if(base > map) munmap(map, base - map);
+      if(map + pad > base) munmap(base + size, map + pad - base);
+      map = base;
+    }
+    if(tcmpopts & (TCMPTHP | TCMPHUGETLB)) madvise(map, size, MADV_HUGEPAGE);
+  }
+  tcmpbind(map, size, node);
+  *sp = size;
+  return map;
+}
+
+
+/* Set the NUMA memory policy of a mapped region.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region.
+   `node' specifies the NUMA node to be preferred, or -1 to follow the options.
+   The policy takes effect on pages faulted afterwards.  Failure is ignored as the policy is only
+   a hint. */
+static void tcmpbind(void *ptr, uint64_t size, int node){
+  assert(ptr && size > 0);
+  int nnum = tcnumanodes();
+  if(nnum < 2) return;
+  unsigned long mask;
+  int mode;
+  if(node >= 0){
+    mode = TCMPPREFERRED;
+    mask = 1UL << (node % nnum);
+  } else if(tcmpopts & TCMPINTER){
+    mode = TCMPINTERLEAVE;
+    mask = (nnum >= TCMPNODEMAX) ? ~0UL : (1UL << nnum) - 1;
+  } else {
+    return;
+  }
+  syscall(SYS_mbind, ptr, size, mode, &mask, sizeof(mask) * 8, 0);
+}
+
+
+/* Allocate a large nullified region by the options of memory placement.
+   `size' specifies the size of the region.
+   `node' specifies the NUMA node to be preferred, or -1 to follow the options.
+   The return value is the pointer to the allocated nullified region, which should be released
+   with the function `tczerounmap'. */
+static void *tcmpzeromap(uint64_t size, int node){
+  assert(size > 0);
+  uint64_t msiz = sizeof(size) + size;
+  void *ptr = tcmpmap(&msiz, 1, node);
+  *(uint64_t *)ptr = msiz - sizeof(size);
+  return (char *)ptr + sizeof(size);
+}
+
+
+/* Unmap a page of a slab allocator.
+   `page' specifies the page. */
+static void tcslabunmap(TCSLABPAGE *page){
+  assert(page);
+  TCSLAB *slab = page->slab;
+  slab->pnum--;
+  slab->msiz -= page->size;
+  munmap(page, page->size);
+}
+
+
+
 /*************************************************************************************************
  * hash map
  *************************************************************************************************/
@@ -470,31 +1028,54 @@ void tclistpushmalloc(TCLIST *list, void *ptr, int size){
 #define TCMAPCSUNIT    52                // small allocation unit size of map concatenation
 #define TCMAPCBUNIT    252               // big allocation unit size of map concatenation
 #define TCMAPTINYBNUM  31                // bucket number of a tiny map
+#define TCMAPRHLOAD    2                 // load factor to start rehashing
+#define TCMAPRHUNIT    8                 // number of buckets moved by each update
+#define TCMAPOPTSTEP   16                // number of steps between checks of optimistic reading
 
-/* get the first hash value */
-#define TCMAPHASH1(TC_res, TC_kbuf, TC_ksiz)                            \
-  do {                                                                  \
-    const unsigned char *_TC_p = (const unsigned char *)(TC_kbuf);      \
-    int _TC_ksiz = TC_ksiz;                                             \
-    for((TC_res) = 19780211; _TC_ksiz--;){                              \
-      (TC_res) = (TC_res) * 37 + *(_TC_p)++;                            \
-    }                                                                   \
-  } while(false)
+/* get the first hash value of a key from its 64-bit hash value */
+#define TCMAPHASH1(TC_hash) \
+  ((uint32_t)(TC_hash))
 
-/* get the second hash value */
-#define TCMAPHASH2(TC_res, TC_kbuf, TC_ksiz)                            \
-  do {                                                                  \
-    const unsigned char *_TC_p = (const unsigned char *)(TC_kbuf) + TC_ksiz - 1; \
-    int _TC_ksiz = TC_ksiz;                                             \
-    for((TC_res) = 0x13579bdf; _TC_ksiz--;){                            \
-      (TC_res) = (TC_res) * 31 + *(_TC_p)--;                            \
-    }                                                                   \
-  } while(false)
+/* get the second hash value of a key from its 64-bit hash value */
+#define TCMAPHASH2(TC_hash) \
+  ((uint32_t)((TC_hash) >> 32) & ~TCMAPKMAXSIZ)
 
 /* compare two keys */
 #define TCKEYCMP(TC_abuf, TC_asiz, TC_bbuf, TC_bsiz)                    \
   ((TC_asiz > TC_bsiz) ? 1 : (TC_asiz < TC_bsiz) ? -1 : memcmp(TC_abuf, TC_bbuf, TC_asiz))
 
+/* get the entry of the bucket of the first hash value */
+#define TCMAPBUCKET(TC_map, TC_hash)                                    \
+  (((TC_map)->obuckets && (TC_hash) % (TC_map)->obnum >= (TC_map)->ridx) ? \
+   (TC_map)->obuckets + (TC_hash) % (TC_map)->obnum :                   \
+   (TC_map)->buckets + (TC_hash) % (TC_map)->bnum)
+
+
+/* private function prototypes */
+static TCMAP *tcmapnewimpl(uint32_t bnum, void *slab);
+static TCMAPREC **tcmapbucketsnew(void *slab, uint32_t bnum);
+static void tcmapbucketsdel(TCMAPREC **buckets, uint32_t bnum);
+static void tcmaprehash(TCMAP *map);
+static void tcmaprehashstep(TCMAP *map, int num);
+static void tcmapputimpl(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                         uint64_t khash);
+static bool tcmapputkeepimpl(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                             uint64_t khash);
+static void tcmapputcatimpl(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                            uint64_t khash);
+static bool tcmapoutimpl(TCMAP *map, const void *kbuf, int ksiz, uint64_t khash);
+static const void *tcmapgetimpl(const TCMAP *map, const void *kbuf, int ksiz, int *sp,
+                                uint64_t khash);
+static int tcmapaddintimpl(TCMAP *map, const void *kbuf, int ksiz, int num, uint64_t khash);
+static double tcmapadddoubleimpl(TCMAP *map, const void *kbuf, int ksiz, double num,
+                                 uint64_t khash);
+static void tcmapiterinit2impl(TCMAP *map, const void *kbuf, int ksiz, uint64_t khash);
+static TCMAPREC *tcmaprecdup(TCMAP *map, const TCMAPREC *rec, int csiz, int asiz);
+static void tcmapswaprec(TCMAP *map, TCMAPREC **entp, TCMAPREC *old, TCMAPREC *rec);
+static bool tcmapgetopt(const TCMAP *map, const void *kbuf, int ksiz, uint64_t khash,
+                        const uint32_t *seqp, uint32_t seq, const char **vp, int *sp);
+static void tcmapmovelast(TCMAP *map, TCMAPREC *rec);
+
 
 /* Create a map object. */
 TCMAP *tcmapnew(void){
@@ -504,22 +1085,31 @@ TCMAP *tcmapnew(void){
 
 /* Create a map object with specifying the number of the buckets. */
 TCMAP *tcmapnew2(uint32_t bnum){
+  return tcmapnewimpl(bnum, NULL);
+}
+
+
+/* Create a map object with a slab allocator.
+   `bnum' specifies the number of the buckets.
+   `slab' specifies the slab allocator of the records or `NULL'.
+   The return value is the new map object. */
+static TCMAP *tcmapnewimpl(uint32_t bnum, void *slab){
   if(bnum < 1) bnum = 1;
   TCMAP *map;
   TCMALLOC(map, sizeof(*map));
-  TCMAPREC **buckets;
-  if(bnum >= TCMAPZMMINSIZ / sizeof(*buckets)){
-    buckets = tczeromap(bnum * sizeof(*buckets));
-  } else {
-    TCCALLOC(buckets, bnum, sizeof(*buckets));
-  }
-  map->buckets = buckets;
+  map->buckets = tcmapbucketsnew(slab, bnum);
   map->first = NULL;
   map->last = NULL;
   map->cur = NULL;
   map->bnum = bnum;
   map->rnum = 0;
   map->msiz = 0;
+  map->obuckets = NULL;
+  map->obnum = 0;
+  map->ridx = 0;
+  map->rhnum = 0;
+  map->reclaim = NULL;
+  map->slab = slab;
   return map;
 }
 
@@ -530,14 +1120,11 @@ void tcmapdel(TCMAP *map){
   TCMAPREC *rec = map->first;
   while(rec){
     TCMAPREC *next = rec->next;
-    free(rec);
+    tcslabfree(map->slab, rec);
     rec = next;
   }
-  if(map->bnum >= TCMAPZMMINSIZ / sizeof(map->buckets[0])){
-    tczerounmap(map->buckets);
-  } else {
-    free(map->buckets);
-  }
+  if(map->obuckets) tcmapbucketsdel(map->obuckets, map->obnum);
+  tcmapbucketsdel(map->buckets, map->bnum);
   free(map);
 }
 
@@ -546,73 +1133,7 @@ void tcmapdel(TCMAP *map){
 void tcmapput(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
   assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  int bidx = hash % map->bnum;
-  TCMAPREC *rec = map->buckets[bidx];
-  TCMAPREC **entp = map->buckets + bidx;
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      entp = &(rec->left);
-      rec = rec->left;
-    } else if(hash < rhash){
-      entp = &(rec->right);
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        entp = &(rec->left);
-        rec = rec->left;
-      } else if(kcmp > 0){
-        entp = &(rec->right);
-        rec = rec->right;
-      } else {
-        map->msiz += vsiz - rec->vsiz;
-        int psiz = TCALIGNPAD(ksiz);
-        if(vsiz > rec->vsiz){
-          TCMAPREC *old = rec;
-          TCREALLOC(rec, rec, sizeof(*rec) + ksiz + psiz + vsiz + 1);
-          if(rec != old){
-            if(map->first == old) map->first = rec;
-            if(map->last == old) map->last = rec;
-            if(map->cur == old) map->cur = rec;
-            *entp = rec;
-            if(rec->prev) rec->prev->next = rec;
-            if(rec->next) rec->next->prev = rec;
-            dbuf = (char *)rec + sizeof(*rec);
-          }
-        }
-        memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
-        dbuf[ksiz+psiz+vsiz] = '\0';
-        rec->vsiz = vsiz;
-        return;
-      }
-    }
-  }
-  int psiz = TCALIGNPAD(ksiz);
-  map->msiz += ksiz + vsiz;
-  TCMALLOC(rec, sizeof(*rec) + ksiz + psiz + vsiz + 1);
-  char *dbuf = (char *)rec + sizeof(*rec);
-  memcpy(dbuf, kbuf, ksiz);
-  dbuf[ksiz] = '\0';
-  rec->ksiz = ksiz | hash;
-  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
-  dbuf[ksiz+psiz+vsiz] = '\0';
-  rec->vsiz = vsiz;
-  rec->left = NULL;
-  rec->right = NULL;
-  rec->prev = map->last;
-  rec->next = NULL;
-  *entp = rec;
-  if(!map->first) map->first = rec;
-  if(map->last) map->last->next = rec;
-  map->last = rec;
-  map->rnum++;
+  tcmapputimpl(map, kbuf, ksiz, vbuf, vsiz, tchash64(kbuf, ksiz));
 }
 
 
@@ -627,56 +1148,7 @@ void tcmapput2(TCMAP *map, const char *kstr, const char *vstr){
 bool tcmapputkeep(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
   assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  int bidx = hash % map->bnum;
-  TCMAPREC *rec = map->buckets[bidx];
-  TCMAPREC **entp = map->buckets + bidx;
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      entp = &(rec->left);
-      rec = rec->left;
-    } else if(hash < rhash){
-      entp = &(rec->right);
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        entp = &(rec->left);
-        rec = rec->left;
-      } else if(kcmp > 0){
-        entp = &(rec->right);
-        rec = rec->right;
-      } else {
-        return false;
-      }
-    }
-  }
-  int psiz = TCALIGNPAD(ksiz);
-  map->msiz += ksiz + vsiz;
-  TCMALLOC(rec, sizeof(*rec) + ksiz + psiz + vsiz + 1);
-  char *dbuf = (char *)rec + sizeof(*rec);
-  memcpy(dbuf, kbuf, ksiz);
-  dbuf[ksiz] = '\0';
-  rec->ksiz = ksiz | hash;
-  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
-  dbuf[ksiz+psiz+vsiz] = '\0';
-  rec->vsiz = vsiz;
-  rec->left = NULL;
-  rec->right = NULL;
-  rec->prev = map->last;
-  rec->next = NULL;
-  *entp = rec;
-  if(!map->first) map->first = rec;
-  if(map->last) map->last->next = rec;
-  map->last = rec;
-  map->rnum++;
-  return true;
+  return tcmapputkeepimpl(map, kbuf, ksiz, vbuf, vsiz, tchash64(kbuf, ksiz));
 }
 
 
@@ -684,77 +1156,7 @@ bool tcmapputkeep(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int
 void tcmapputcat(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
   assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  int bidx = hash % map->bnum;
-  TCMAPREC *rec = map->buckets[bidx];
-  TCMAPREC **entp = map->buckets + bidx;
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      entp = &(rec->left);
-      rec = rec->left;
-    } else if(hash < rhash){
-      entp = &(rec->right);
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        entp = &(rec->left);
-        rec = rec->left;
-      } else if(kcmp > 0){
-        entp = &(rec->right);
-        rec = rec->right;
-      } else {
-        map->msiz += vsiz;
-        int psiz = TCALIGNPAD(ksiz);
-        int asiz = sizeof(*rec) + ksiz + psiz + rec->vsiz + vsiz + 1;
-        int unit = (asiz <= TCMAPCSUNIT) ? TCMAPCSUNIT : TCMAPCBUNIT;
-        asiz = (asiz - 1) + unit - (asiz - 1) % unit;
-        TCMAPREC *old = rec;
-        TCREALLOC(rec, rec, asiz);
-        if(rec != old){
-          if(map->first == old) map->first = rec;
-          if(map->last == old) map->last = rec;
-          if(map->cur == old) map->cur = rec;
-          *entp = rec;
-          if(rec->prev) rec->prev->next = rec;
-          if(rec->next) rec->next->prev = rec;
-          dbuf = (char *)rec + sizeof(*rec);
-        }
-        memcpy(dbuf + ksiz + psiz + rec->vsiz, vbuf, vsiz);
-        rec->vsiz += vsiz;
-        dbuf[ksiz+psiz+rec->vsiz] = '\0';
-        return;
-      }
-    }
-  }
-  int psiz = TCALIGNPAD(ksiz);
-  int asiz = sizeof(*rec) + ksiz + psiz + vsiz + 1;
-  int unit = (asiz <= TCMAPCSUNIT) ? TCMAPCSUNIT : TCMAPCBUNIT;
-  asiz = (asiz - 1) + unit - (asiz - 1) % unit;
-  map->msiz += ksiz + vsiz;
-  TCMALLOC(rec, asiz);
-  char *dbuf = (char *)rec + sizeof(*rec);
-  memcpy(dbuf, kbuf, ksiz);
-  dbuf[ksiz] = '\0';
-  rec->ksiz = ksiz | hash;
-  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
-  dbuf[ksiz+psiz+vsiz] = '\0';
-  rec->vsiz = vsiz;
-  rec->left = NULL;
-  rec->right = NULL;
-  rec->prev = map->last;
-  rec->next = NULL;
-  *entp = rec;
-  if(!map->first) map->first = rec;
-  if(map->last) map->last->next = rec;
-  map->last = rec;
-  map->rnum++;
+  tcmapputcatimpl(map, kbuf, ksiz, vbuf, vsiz, tchash64(kbuf, ksiz));
 }
 
 
@@ -762,59 +1164,7 @@ void tcmapputcat(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int v
 bool tcmapout(TCMAP *map, const void *kbuf, int ksiz){
   assert(map && kbuf && ksiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  int bidx = hash % map->bnum;
-  TCMAPREC *rec = map->buckets[bidx];
-  TCMAPREC **entp = map->buckets + bidx;
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      entp = &(rec->left);
-      rec = rec->left;
-    } else if(hash < rhash){
-      entp = &(rec->right);
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        entp = &(rec->left);
-        rec = rec->left;
-      } else if(kcmp > 0){
-        entp = &(rec->right);
-        rec = rec->right;
-      } else {
-        map->rnum--;
-        map->msiz -= rksiz + rec->vsiz;
-        if(rec->prev) rec->prev->next = rec->next;
-        if(rec->next) rec->next->prev = rec->prev;
-        if(rec == map->first) map->first = rec->next;
-        if(rec == map->last) map->last = rec->prev;
-        if(rec == map->cur) map->cur = rec->next;
-        if(rec->left && !rec->right){
-          *entp = rec->left;
-        } else if(!rec->left && rec->right){
-          *entp = rec->right;
-        } else if(!rec->left){
-          *entp = NULL;
-        } else {
-          *entp = rec->left;
-          TCMAPREC *tmp = *entp;
-          while(tmp->right){
-            tmp = tmp->right;
-          }
-          tmp->right = rec->right;
-        }
-        free(rec);
-        return true;
-      }
-    }
-  }
-  return false;
+  return tcmapoutimpl(map, kbuf, ksiz, tchash64(kbuf, ksiz));
 }
 
 
@@ -829,34 +1179,7 @@ bool tcmapout2(TCMAP *map, const char *kstr){
 const void *tcmapget(const TCMAP *map, const void *kbuf, int ksiz, int *sp){
   assert(map && kbuf && ksiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  TCMAPREC *rec = map->buckets[hash%map->bnum];
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      rec = rec->left;
-    } else if(hash < rhash){
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        rec = rec->left;
-      } else if(kcmp > 0){
-        rec = rec->right;
-      } else {
-        if (sp) {
-          *sp = rec->vsiz;
-        }
-        return dbuf + rksiz + TCALIGNPAD(rksiz);
-      }
-    }
-  }
-  return NULL;
+  return tcmapgetimpl(map, kbuf, ksiz, sp, tchash64(kbuf, ksiz));
 }
 
 
@@ -909,7 +1232,7 @@ uint64_t tcmaprnum(const TCMAP *map){
 uint64_t tcmapmsiz(const TCMAP *map){
   assert(map);
   return map->msiz + map->rnum * (sizeof(*map->first) + sizeof(TCUNION_FOO)) +
-    map->bnum * sizeof(void *);
+    ((uint64_t)map->bnum + map->obnum) * sizeof(void *);
 }
 
 
@@ -946,57 +1269,7 @@ TCLIST *tcmapvals(const TCMAP *map){
 int tcmapaddint(TCMAP *map, const void *kbuf, int ksiz, int num){
   assert(map && kbuf && ksiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  int bidx = hash % map->bnum;
-  TCMAPREC *rec = map->buckets[bidx];
-  TCMAPREC **entp = map->buckets + bidx;
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      entp = &(rec->left);
-      rec = rec->left;
-    } else if(hash < rhash){
-      entp = &(rec->right);
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        entp = &(rec->left);
-        rec = rec->left;
-      } else if(kcmp > 0){
-        entp = &(rec->right);
-        rec = rec->right;
-      } else {
-        if(rec->vsiz != sizeof(num)) return INT_MIN;
-        int *resp = (int *)(dbuf + ksiz + TCALIGNPAD(ksiz));
-        return *resp += num;
-      }
-    }
-  }
-  int psiz = TCALIGNPAD(ksiz);
-  TCMALLOC(rec, sizeof(*rec) + ksiz + psiz + sizeof(num) + 1);
-  char *dbuf = (char *)rec + sizeof(*rec);
-  memcpy(dbuf, kbuf, ksiz);
-  dbuf[ksiz] = '\0';
-  rec->ksiz = ksiz | hash;
-  memcpy(dbuf + ksiz + psiz, &num, sizeof(num));
-  dbuf[ksiz+psiz+sizeof(num)] = '\0';
-  rec->vsiz = sizeof(num);
-  rec->left = NULL;
-  rec->right = NULL;
-  rec->prev = map->last;
-  rec->next = NULL;
-  *entp = rec;
-  if(!map->first) map->first = rec;
-  if(map->last) map->last->next = rec;
-  map->last = rec;
-  map->rnum++;
-  return num;
+  return tcmapaddintimpl(map, kbuf, ksiz, num, tchash64(kbuf, ksiz));
 }
 
 
@@ -1004,57 +1277,7 @@ int tcmapaddint(TCMAP *map, const void *kbuf, int ksiz, int num){
 double tcmapadddouble(TCMAP *map, const void *kbuf, int ksiz, double num){
   assert(map && kbuf && ksiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  int bidx = hash % map->bnum;
-  TCMAPREC *rec = map->buckets[bidx];
-  TCMAPREC **entp = map->buckets + bidx;
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      entp = &(rec->left);
-      rec = rec->left;
-    } else if(hash < rhash){
-      entp = &(rec->right);
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        entp = &(rec->left);
-        rec = rec->left;
-      } else if(kcmp > 0){
-        entp = &(rec->right);
-        rec = rec->right;
-      } else {
-        if(rec->vsiz != sizeof(num)) return nan("");
-        double *resp = (double *)(dbuf + ksiz + TCALIGNPAD(ksiz));
-        return *resp += num;
-      }
-    }
-  }
-  int psiz = TCALIGNPAD(ksiz);
-  TCMALLOC(rec, sizeof(*rec) + ksiz + psiz + sizeof(num) + 1);
-  char *dbuf = (char *)rec + sizeof(*rec);
-  memcpy(dbuf, kbuf, ksiz);
-  dbuf[ksiz] = '\0';
-  rec->ksiz = ksiz | hash;
-  memcpy(dbuf + ksiz + psiz, &num, sizeof(num));
-  dbuf[ksiz+psiz+sizeof(num)] = '\0';
-  rec->vsiz = sizeof(num);
-  rec->left = NULL;
-  rec->right = NULL;
-  rec->prev = map->last;
-  rec->next = NULL;
-  *entp = rec;
-  if(!map->first) map->first = rec;
-  if(map->last) map->last->next = rec;
-  map->last = rec;
-  map->rnum++;
-  return num;
+  return tcmapadddoubleimpl(map, kbuf, ksiz, num, tchash64(kbuf, ksiz));
 }
 
 
@@ -1064,14 +1287,16 @@ void tcmapclear(TCMAP *map){
   TCMAPREC *rec = map->first;
   while(rec){
     TCMAPREC *next = rec->next;
-    free(rec);
+    tcslabfree(map->slab, rec);
     rec = next;
   }
-  TCMAPREC **buckets = map->buckets;
-  int bnum = map->bnum;
-  for(int i = 0; i < bnum; i++){
-    buckets[i] = NULL;
+  if(map->obuckets){
+    tcmapbucketsdel(map->obuckets, map->obnum);
+    map->obuckets = NULL;
+    map->obnum = 0;
+    map->ridx = 0;
   }
+  memset(map->buckets, 0, map->bnum * sizeof(*map->buckets));
   map->first = NULL;
   map->last = NULL;
   map->cur = NULL;
@@ -1097,31 +1322,7 @@ void tcmapcutfront(TCMAP *map, int num){
 void tcmapiterinit2(TCMAP *map, const void *kbuf, int ksiz){
   assert(map && kbuf && ksiz >= 0);
   if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
-  uint32_t hash;
-  TCMAPHASH1(hash, kbuf, ksiz);
-  TCMAPREC *rec = map->buckets[hash%map->bnum];
-  TCMAPHASH2(hash, kbuf, ksiz);
-  hash &= ~TCMAPKMAXSIZ;
-  while(rec){
-    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
-    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
-    if(hash > rhash){
-      rec = rec->left;
-    } else if(hash < rhash){
-      rec = rec->right;
-    } else {
-      char *dbuf = (char *)rec + sizeof(*rec);
-      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
-      if(kcmp < 0){
-        rec = rec->left;
-      } else if(kcmp > 0){
-        rec = rec->right;
-      } else {
-        map->cur = rec;
-        return;
-      }
-    }
-  }
+  tcmapiterinit2impl(map, kbuf, ksiz, tchash64(kbuf, ksiz));
 }
 
 
@@ -1157,497 +1358,6109 @@ void tcmapprintf(TCMAP *map, const char *kstr, const char *format, ...){
 }
 
 
+/* Allocate a bucket array of a map object.
+   `slab' specifies the slab allocator of the records or `NULL'.  A large array is placed on the
+   NUMA node of the allocator.
+   `bnum' specifies the number of the buckets.
+   The return value is the new nullified bucket array. */
+static TCMAPREC **tcmapbucketsnew(void *slab, uint32_t bnum){
+  TCMAPREC **buckets;
+  if(bnum >= TCMAPZMMINSIZ / sizeof(*buckets)){
+    buckets = tcmpzeromap(bnum * sizeof(*buckets), slab ? ((TCSLAB *)slab)->node : -1);
+  } else {
+    TCCALLOC(buckets, bnum, sizeof(*buckets));
+  }
+  return buckets;
+}
 
-/*************************************************************************************************
- * on-memory hash database
- *************************************************************************************************/
-
-
-#define TCMDBMNUM      8                 // number of internal maps
-#define TCMDBDEFBNUM   65536             // default bucket number
 
-/* get the first hash value */
-#define TCMDBHASH(TC_res, TC_kbuf, TC_ksiz)                             \
+/* Free a bucket array of a map object.
+   `buckets' specifies the bucket array.
+   `bnum' specifies the number of the buckets. */
+static void tcmapbucketsdel(TCMAPREC **buckets, uint32_t bnum){
+  assert(buckets);
+  if(bnum >= TCMAPZMMINSIZ / sizeof(*buckets)){
+    tczerounmap(buckets);
+  } else {
+    free(buckets);
+  }
+}
+
+
+/* Start rehashing a map object into a bucket array of twice the size.
+   `map' specifies the map object. */
+static void tcmaprehash(TCMAP *map){
+  assert(map && !map->obuckets);
+  if(map->bnum > UINT32_MAX / 2 - 1) return;
+  map->obuckets = map->buckets;
+  map->obnum = map->bnum;
+  map->ridx = 0;
+  map->rhnum++;
+  map->bnum = map->bnum * 2 + 1;
+  map->buckets = tcmapbucketsnew(map->slab, map->bnum);
+}
+
+
+/* Move records in old buckets of a map object under rehashing into the new buckets.
+   `map' specifies the map object.
+   `num' specifies the number of the old buckets to be moved. */
+static void tcmaprehashstep(TCMAP *map, int num){
+  assert(map && map->obuckets && num >= 0);
+  while(num-- > 0 && map->ridx < map->obnum){
+    TCMAPREC *rec = map->obuckets[map->ridx];
+    map->obuckets[map->ridx++] = NULL;
+    while(rec){
+      if(rec->left){
+        TCMAPREC *left = rec->left;
+        rec->left = left->right;
+        left->right = rec;
+        rec = left;
+        continue;
+      }
+      TCMAPREC *next = rec->right;
+      char *dbuf = (char *)rec + sizeof(*rec);
+      uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+      uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+      uint32_t hash = TCMAPHASH1(tchash64(dbuf, rksiz));
+      TCMAPREC **entp = map->buckets + hash % map->bnum;
+      while(*entp){
+        TCMAPREC *cur = *entp;
+        uint32_t chash = cur->ksiz & ~TCMAPKMAXSIZ;
+        if(rhash > chash){
+          entp = &(cur->left);
+        } else if(rhash < chash){
+          entp = &(cur->right);
+        } else {
+          uint32_t cksiz = cur->ksiz & TCMAPKMAXSIZ;
+          if(TCKEYCMP(dbuf, rksiz, (char *)cur + sizeof(*cur), cksiz) < 0){
+            entp = &(cur->left);
+          } else {
+            entp = &(cur->right);
+          }
+        }
+      }
+      rec->left = NULL;
+      rec->right = NULL;
+      *entp = rec;
+      rec = next;
+    }
+  }
+  if(map->ridx >= map->obnum){
+    if(map->reclaim){
+      tcrclretire(map->reclaim, (void (*)(void *, uint32_t))tcmapbucketsdel, map->obuckets,
+                  map->obnum);
+    } else {
+      tcmapbucketsdel(map->obuckets, map->obnum);
+    }
+    map->obuckets = NULL;
+    map->obnum = 0;
+    map->ridx = 0;
+    map->rhnum++;
+  }
+}
+
+
+/* Store a record into a map object with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static void tcmapputimpl(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                         uint64_t khash){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->obuckets) tcmaprehashstep(map, TCMAPRHUNIT);
+  TCMAPREC **entp = TCMAPBUCKET(map, TCMAPHASH1(khash));
+  TCMAPREC *rec = *entp;
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      entp = &(rec->left);
+      rec = rec->left;
+    } else if(hash < rhash){
+      entp = &(rec->right);
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        entp = &(rec->left);
+        rec = rec->left;
+      } else if(kcmp > 0){
+        entp = &(rec->right);
+        rec = rec->right;
+      } else {
+        map->msiz += vsiz - rec->vsiz;
+        int psiz = TCALIGNPAD(ksiz);
+        if(map->reclaim){
+          TCMAPREC *old = rec;
+          rec = tcmaprecdup(map, old, 0, sizeof(*rec) + ksiz + psiz + vsiz + 1);
+          dbuf = (char *)rec + sizeof(*rec);
+          memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
+          dbuf[ksiz+psiz+vsiz] = '\0';
+          rec->vsiz = vsiz;
+          tcmapswaprec(map, entp, old, rec);
+          return;
+        }
+        if(vsiz > rec->vsiz){
+          TCMAPREC *old = rec;
+          TCREALLOC(rec, rec, sizeof(*rec) + ksiz + psiz + vsiz + 1);
+          if(rec != old){
+            if(map->first == old) map->first = rec;
+            if(map->last == old) map->last = rec;
+            if(map->cur == old) map->cur = rec;
+            *entp = rec;
+            if(rec->prev) rec->prev->next = rec;
+            if(rec->next) rec->next->prev = rec;
+            dbuf = (char *)rec + sizeof(*rec);
+          }
+        }
+        memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
+        dbuf[ksiz+psiz+vsiz] = '\0';
+        rec->vsiz = vsiz;
+        return;
+      }
+    }
+  }
+  int psiz = TCALIGNPAD(ksiz);
+  map->msiz += ksiz + vsiz;
+  rec = tcslaballoc(map->slab, sizeof(*rec) + ksiz + psiz + vsiz + 1);
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf, kbuf, ksiz);
+  dbuf[ksiz] = '\0';
+  rec->ksiz = ksiz | hash;
+  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
+  dbuf[ksiz+psiz+vsiz] = '\0';
+  rec->vsiz = vsiz;
+  rec->left = NULL;
+  rec->right = NULL;
+  rec->prev = map->last;
+  rec->next = NULL;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  *entp = rec;
+  if(!map->first) map->first = rec;
+  if(map->last) map->last->next = rec;
+  map->last = rec;
+  map->rnum++;
+  if(map->rnum > (uint64_t)map->bnum * TCMAPRHLOAD && !map->obuckets) tcmaprehash(map);
+}
+
+
+/* Store a new record into a map object with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static bool tcmapputkeepimpl(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                             uint64_t khash){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->obuckets) tcmaprehashstep(map, TCMAPRHUNIT);
+  TCMAPREC **entp = TCMAPBUCKET(map, TCMAPHASH1(khash));
+  TCMAPREC *rec = *entp;
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      entp = &(rec->left);
+      rec = rec->left;
+    } else if(hash < rhash){
+      entp = &(rec->right);
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        entp = &(rec->left);
+        rec = rec->left;
+      } else if(kcmp > 0){
+        entp = &(rec->right);
+        rec = rec->right;
+      } else {
+        return false;
+      }
+    }
+  }
+  int psiz = TCALIGNPAD(ksiz);
+  map->msiz += ksiz + vsiz;
+  rec = tcslaballoc(map->slab, sizeof(*rec) + ksiz + psiz + vsiz + 1);
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf, kbuf, ksiz);
+  dbuf[ksiz] = '\0';
+  rec->ksiz = ksiz | hash;
+  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
+  dbuf[ksiz+psiz+vsiz] = '\0';
+  rec->vsiz = vsiz;
+  rec->left = NULL;
+  rec->right = NULL;
+  rec->prev = map->last;
+  rec->next = NULL;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  *entp = rec;
+  if(!map->first) map->first = rec;
+  if(map->last) map->last->next = rec;
+  map->last = rec;
+  map->rnum++;
+  if(map->rnum > (uint64_t)map->bnum * TCMAPRHLOAD && !map->obuckets) tcmaprehash(map);
+  return true;
+}
+
+
+/* Concatenate a value at the end of the value of the existing record with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static void tcmapputcatimpl(TCMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                            uint64_t khash){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->obuckets) tcmaprehashstep(map, TCMAPRHUNIT);
+  TCMAPREC **entp = TCMAPBUCKET(map, TCMAPHASH1(khash));
+  TCMAPREC *rec = *entp;
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      entp = &(rec->left);
+      rec = rec->left;
+    } else if(hash < rhash){
+      entp = &(rec->right);
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        entp = &(rec->left);
+        rec = rec->left;
+      } else if(kcmp > 0){
+        entp = &(rec->right);
+        rec = rec->right;
+      } else {
+        map->msiz += vsiz;
+        int psiz = TCALIGNPAD(ksiz);
+        int asiz = sizeof(*rec) + ksiz + psiz + rec->vsiz + vsiz + 1;
+        if(map->reclaim){
+          TCMAPREC *old = rec;
+          rec = tcmaprecdup(map, old, old->vsiz, asiz);
+          dbuf = (char *)rec + sizeof(*rec);
+          memcpy(dbuf + ksiz + psiz + rec->vsiz, vbuf, vsiz);
+          rec->vsiz += vsiz;
+          dbuf[ksiz+psiz+rec->vsiz] = '\0';
+          tcmapswaprec(map, entp, old, rec);
+          return;
+        }
+        int unit = (asiz <= TCMAPCSUNIT) ? TCMAPCSUNIT : TCMAPCBUNIT;
+        asiz = (asiz - 1) + unit - (asiz - 1) % unit;
+        TCMAPREC *old = rec;
+        TCREALLOC(rec, rec, asiz);
+        if(rec != old){
+          if(map->first == old) map->first = rec;
+          if(map->last == old) map->last = rec;
+          if(map->cur == old) map->cur = rec;
+          *entp = rec;
+          if(rec->prev) rec->prev->next = rec;
+          if(rec->next) rec->next->prev = rec;
+          dbuf = (char *)rec + sizeof(*rec);
+        }
+        memcpy(dbuf + ksiz + psiz + rec->vsiz, vbuf, vsiz);
+        rec->vsiz += vsiz;
+        dbuf[ksiz+psiz+rec->vsiz] = '\0';
+        return;
+      }
+    }
+  }
+  int psiz = TCALIGNPAD(ksiz);
+  int asiz = sizeof(*rec) + ksiz + psiz + vsiz + 1;
+  int unit = (asiz <= TCMAPCSUNIT) ? TCMAPCSUNIT : TCMAPCBUNIT;
+  asiz = (asiz - 1) + unit - (asiz - 1) % unit;
+  map->msiz += ksiz + vsiz;
+  rec = tcslaballoc(map->slab, asiz);
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf, kbuf, ksiz);
+  dbuf[ksiz] = '\0';
+  rec->ksiz = ksiz | hash;
+  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
+  dbuf[ksiz+psiz+vsiz] = '\0';
+  rec->vsiz = vsiz;
+  rec->left = NULL;
+  rec->right = NULL;
+  rec->prev = map->last;
+  rec->next = NULL;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  *entp = rec;
+  if(!map->first) map->first = rec;
+  if(map->last) map->last->next = rec;
+  map->last = rec;
+  map->rnum++;
+  if(map->rnum > (uint64_t)map->bnum * TCMAPRHLOAD && !map->obuckets) tcmaprehash(map);
+}
+
+
+/* Remove a record of a map object with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static bool tcmapoutimpl(TCMAP *map, const void *kbuf, int ksiz, uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->obuckets) tcmaprehashstep(map, TCMAPRHUNIT);
+  TCMAPREC **entp = TCMAPBUCKET(map, TCMAPHASH1(khash));
+  TCMAPREC *rec = *entp;
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      entp = &(rec->left);
+      rec = rec->left;
+    } else if(hash < rhash){
+      entp = &(rec->right);
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        entp = &(rec->left);
+        rec = rec->left;
+      } else if(kcmp > 0){
+        entp = &(rec->right);
+        rec = rec->right;
+      } else {
+        map->rnum--;
+        map->msiz -= rksiz + rec->vsiz;
+        if(rec->prev) rec->prev->next = rec->next;
+        if(rec->next) rec->next->prev = rec->prev;
+        if(rec == map->first) map->first = rec->next;
+        if(rec == map->last) map->last = rec->prev;
+        if(rec == map->cur) map->cur = rec->next;
+        if(rec->left && !rec->right){
+          *entp = rec->left;
+        } else if(!rec->left && rec->right){
+          *entp = rec->right;
+        } else if(!rec->left){
+          *entp = NULL;
+        } else {
+          *entp = rec->left;
+          TCMAPREC *tmp = *entp;
+          while(tmp->right){
+            tmp = tmp->right;
+          }
+          tmp->right = rec->right;
+        }
+        if(map->reclaim){
+          tcrclretire(map->reclaim, map->slab ? tcslabrelease : NULL, rec, 0);
+        } else {
+          tcslabfree(map->slab, rec);
+        }
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+
+/* Retrieve a record in a map object with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static const void *tcmapgetimpl(const TCMAP *map, const void *kbuf, int ksiz, int *sp,
+                                uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  TCMAPREC *rec = *TCMAPBUCKET(map, TCMAPHASH1(khash));
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      rec = rec->left;
+    } else if(hash < rhash){
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        rec = rec->left;
+      } else if(kcmp > 0){
+        rec = rec->right;
+      } else {
+        if (sp) {
+          *sp = rec->vsiz;
+        }
+        return dbuf + rksiz + TCALIGNPAD(rksiz);
+      }
+    }
+  }
+  return NULL;
+}
+
+
+/* Add an integer to a record in a map object with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static int tcmapaddintimpl(TCMAP *map, const void *kbuf, int ksiz, int num, uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->obuckets) tcmaprehashstep(map, TCMAPRHUNIT);
+  TCMAPREC **entp = TCMAPBUCKET(map, TCMAPHASH1(khash));
+  TCMAPREC *rec = *entp;
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      entp = &(rec->left);
+      rec = rec->left;
+    } else if(hash < rhash){
+      entp = &(rec->right);
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        entp = &(rec->left);
+        rec = rec->left;
+      } else if(kcmp > 0){
+        entp = &(rec->right);
+        rec = rec->right;
+      } else {
+        if(rec->vsiz != sizeof(num)) return INT_MIN;
+        int *resp = (int *)(dbuf + ksiz + TCALIGNPAD(ksiz));
+        if(map->reclaim){
+          TCMAPREC *old = rec;
+          rec = tcmaprecdup(map, old, sizeof(num) + 1, sizeof(*rec) + ksiz + TCALIGNPAD(ksiz) +
+                            sizeof(num) + 1);
+          resp = (int *)((char *)rec + ((char *)resp - (char *)old));
+          *resp += num;
+          tcmapswaprec(map, entp, old, rec);
+          return *resp;
+        }
+        return *resp += num;
+      }
+    }
+  }
+  int psiz = TCALIGNPAD(ksiz);
+  rec = tcslaballoc(map->slab, sizeof(*rec) + ksiz + psiz + sizeof(num) + 1);
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf, kbuf, ksiz);
+  dbuf[ksiz] = '\0';
+  rec->ksiz = ksiz | hash;
+  memcpy(dbuf + ksiz + psiz, &num, sizeof(num));
+  dbuf[ksiz+psiz+sizeof(num)] = '\0';
+  rec->vsiz = sizeof(num);
+  rec->left = NULL;
+  rec->right = NULL;
+  rec->prev = map->last;
+  rec->next = NULL;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  *entp = rec;
+  if(!map->first) map->first = rec;
+  if(map->last) map->last->next = rec;
+  map->last = rec;
+  map->rnum++;
+  if(map->rnum > (uint64_t)map->bnum * TCMAPRHLOAD && !map->obuckets) tcmaprehash(map);
+  return num;
+}
+
+
+/* Add a real number to a record in a map object with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static double tcmapadddoubleimpl(TCMAP *map, const void *kbuf, int ksiz, double num,
+                                 uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->obuckets) tcmaprehashstep(map, TCMAPRHUNIT);
+  TCMAPREC **entp = TCMAPBUCKET(map, TCMAPHASH1(khash));
+  TCMAPREC *rec = *entp;
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      entp = &(rec->left);
+      rec = rec->left;
+    } else if(hash < rhash){
+      entp = &(rec->right);
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        entp = &(rec->left);
+        rec = rec->left;
+      } else if(kcmp > 0){
+        entp = &(rec->right);
+        rec = rec->right;
+      } else {
+        if(rec->vsiz != sizeof(num)) return nan("");
+        double *resp = (double *)(dbuf + ksiz + TCALIGNPAD(ksiz));
+        if(map->reclaim){
+          TCMAPREC *old = rec;
+          rec = tcmaprecdup(map, old, sizeof(num) + 1, sizeof(*rec) + ksiz + TCALIGNPAD(ksiz) +
+                            sizeof(num) + 1);
+          resp = (double *)((char *)rec + ((char *)resp - (char *)old));
+          *resp += num;
+          tcmapswaprec(map, entp, old, rec);
+          return *resp;
+        }
+        return *resp += num;
+      }
+    }
+  }
+  int psiz = TCALIGNPAD(ksiz);
+  rec = tcslaballoc(map->slab, sizeof(*rec) + ksiz + psiz + sizeof(num) + 1);
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf, kbuf, ksiz);
+  dbuf[ksiz] = '\0';
+  rec->ksiz = ksiz | hash;
+  memcpy(dbuf + ksiz + psiz, &num, sizeof(num));
+  dbuf[ksiz+psiz+sizeof(num)] = '\0';
+  rec->vsiz = sizeof(num);
+  rec->left = NULL;
+  rec->right = NULL;
+  rec->prev = map->last;
+  rec->next = NULL;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  *entp = rec;
+  if(!map->first) map->first = rec;
+  if(map->last) map->last->next = rec;
+  map->last = rec;
+  map->rnum++;
+  if(map->rnum > (uint64_t)map->bnum * TCMAPRHLOAD && !map->obuckets) tcmaprehash(map);
+  return num;
+}
+
+
+/* Initialize the iterator of a map object at the record corresponding a key with a hash value.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static void tcmapiterinit2impl(TCMAP *map, const void *kbuf, int ksiz, uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  TCMAPREC *rec = *TCMAPBUCKET(map, TCMAPHASH1(khash));
+  uint32_t hash = TCMAPHASH2(khash);
+  while(rec){
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      rec = rec->left;
+    } else if(hash < rhash){
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        rec = rec->left;
+      } else if(kcmp > 0){
+        rec = rec->right;
+      } else {
+        map->cur = rec;
+        return;
+      }
+    }
+  }
+}
+
+
+/* Duplicate a record of a map object to update it without modifying the original.
+   `map' specifies the map object.
+   `rec' specifies the record object.
+   `csiz' specifies the size of the leading part of the value to be copied.
+   `asiz' specifies the size of the region to be allocated.
+   The return value is the new record object whose header and key are copied. */
+static TCMAPREC *tcmaprecdup(TCMAP *map, const TCMAPREC *rec, int csiz, int asiz){
+  assert(map && rec && csiz >= 0 && asiz >= sizeof(*rec));
+  uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+  TCMAPREC *nrec = tcslaballoc(map->slab, asiz);
+  memcpy(nrec, rec, sizeof(*rec) + rksiz + TCALIGNPAD(rksiz) + csiz);
+  return nrec;
+}
+
+
+/* Replace a record of a map object with its updated duplication.
+   `map' specifies the map object.
+   `entp' specifies the pointer to the link to the original record.
+   `old' specifies the original record object.
+   `rec' specifies the duplicated record object.
+   The original is retired so that readers without locking never see a partial update. */
+static void tcmapswaprec(TCMAP *map, TCMAPREC **entp, TCMAPREC *old, TCMAPREC *rec){
+  assert(map && map->reclaim && entp && old && rec);
+  if(map->first == old) map->first = rec;
+  if(map->last == old) map->last = rec;
+  if(map->cur == old) map->cur = rec;
+  if(rec->prev) rec->prev->next = rec;
+  if(rec->next) rec->next->prev = rec;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  *entp = rec;
+  tcrclretire(map->reclaim, map->slab ? tcslabrelease : NULL, old, 0);
+}
+
+
+/* Retrieve a record in a map object which may be updated concurrently.
+   `map' specifies the map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `khash' specifies the hash value of the key calculated with `tchash64'.
+   `seqp' specifies the pointer to the sequence number bumped by updates of the map.
+   `seq' specifies the even sequence number read before reading the map.
+   `vp' specifies the pointer to the variable into which the pointer to the region of the value
+   or `NULL' is assigned.
+   `sp' specifies the pointer to the variable into which the size of the value is assigned.
+   The return value is true if the result is consistent, or false if an update interfered.
+   The caller must have entered a reading section of the reclaimer of the map. */
+static bool tcmapgetopt(const TCMAP *map, const void *kbuf, int ksiz, uint64_t khash,
+                        const uint32_t *seqp, uint32_t seq, const char **vp, int *sp){
+  assert(map && kbuf && ksiz >= 0 && seqp && vp && sp);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  TCMAPREC **buckets = map->buckets;
+  uint32_t bnum = map->bnum;
+  TCMAPREC **obuckets = map->obuckets;
+  uint32_t obnum = map->obnum;
+  uint32_t ridx = map->ridx;
+  if(!tcseqcheck(seqp, seq)) return false;
+  uint32_t bidx = TCMAPHASH1(khash);
+  TCMAPREC *rec = (obuckets && bidx % obnum >= ridx) ? obuckets[bidx%obnum] : buckets[bidx%bnum];
+  uint32_t hash = TCMAPHASH2(khash);
+  *vp = NULL;
+  for(int step = 1; rec; step++){
+    if(step % TCMAPOPTSTEP == 0 && !tcseqcheck(seqp, seq)) return false;
+    uint32_t rhash = rec->ksiz & ~TCMAPKMAXSIZ;
+    uint32_t rksiz = rec->ksiz & TCMAPKMAXSIZ;
+    if(hash > rhash){
+      rec = rec->left;
+    } else if(hash < rhash){
+      rec = rec->right;
+    } else {
+      char *dbuf = (char *)rec + sizeof(*rec);
+      int kcmp = TCKEYCMP(kbuf, ksiz, dbuf, rksiz);
+      if(kcmp < 0){
+        rec = rec->left;
+      } else if(kcmp > 0){
+        rec = rec->right;
+      } else {
+        *vp = dbuf + rksiz + TCALIGNPAD(rksiz);
+        *sp = rec->vsiz;
+        break;
+      }
+    }
+  }
+  return tcseqcheck(seqp, seq);
+}
+
+
+/* Move a record of a map object to the end of the stored order.
+   `map' specifies the map object.
+   `rec' specifies the record object.
+   If the iterator points to the record, it is advanced to the next one. */
+static void tcmapmovelast(TCMAP *map, TCMAPREC *rec){
+  assert(map && rec);
+  if(rec == map->last) return;
+  if(map->cur == rec) map->cur = rec->next;
+  if(rec->prev){
+    rec->prev->next = rec->next;
+  } else {
+    map->first = rec->next;
+  }
+  rec->next->prev = rec->prev;
+  rec->prev = map->last;
+  rec->next = NULL;
+  map->last->next = rec;
+  map->last = rec;
+}
+
+
+
+/*************************************************************************************************
+ * flat hash map
+ *************************************************************************************************/
+
+
+#define TCFMAPGRPSIZ   16                // number of slots in a group
+#define TCFMAPMINSNUM  64                // minimum number of slots
+#define TCFMAPMAXSNUM  (1U<<31)          // maximum number of slots
+#define TCFMAPEMPTY    0x80              // control byte of an empty slot
+#define TCFMAPDELETED  0xfe              // control byte of a deleted slot
+#define TCFMAPRHUNIT   8                 // number of groups moved by each update
+
+/* get the hash value of a key from its 64-bit hash value */
+#define TCFMAPHASH(TC_hash) \
+  ((uint32_t)(TC_hash))
+
+/* get the tag of a hash value */
+#define TCFMAPTAG(TC_hash) \
+  ((uint8_t)((TC_hash) >> 25))
+
+
+/* private function prototypes */
+static uint32_t tcfmapmatch(const uint8_t *group, uint8_t c);
+static uint32_t tcfmapmatchfree(const uint8_t *group);
+static TCFMAP *tcfmapnewimpl(uint32_t bnum, void *slab);
+static void tcfmapalloc(TCFMAP *map, uint32_t snum);
+static void tcfmaparraydel(void *array, uint32_t snum);
+static void tcfmapfreearrays(uint8_t *ctrls, TCFMAPREC **slots, uint32_t snum);
+static void tcfmapfreerecs(void *slab, const uint8_t *ctrls, TCFMAPREC **slots, uint32_t snum);
+static const char *tcfmaprecbody(bool compact, const TCFMAPREC *rec, int *ksp, const char **vp,
+                                 int *vsp);
+static int64_t tcfmapprobe(const uint8_t *ctrls, TCFMAPREC **slots, uint32_t snum, bool compact,
+                           const void *kbuf, int ksiz, uint32_t hash, int64_t *ip);
+static TCFMAPREC **tcfmapsearch(const TCFMAP *map, const void *kbuf, int ksiz, uint32_t hash,
+                                uint8_t **cp, int64_t *ip);
+static int64_t tcfmapfreeslot(const TCFMAP *map, uint32_t hash);
+static void tcfmaprehash(TCFMAP *map, uint32_t snum);
+static void tcfmaprehashstep(TCFMAP *map, int num);
+static TCFMAPREC *tcfmaprecnew(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf,
+                               int vsiz, uint32_t hash, int asiz);
+static void tcfmapstore(TCFMAP *map, int64_t sidx, TCFMAPREC *rec, uint32_t hash);
+static void tcfmapputimpl(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                          uint64_t khash);
+static bool tcfmapputkeepimpl(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                              uint64_t khash);
+static void tcfmapputcatimpl(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                             uint64_t khash);
+static bool tcfmapoutimpl(TCFMAP *map, const void *kbuf, int ksiz, uint64_t khash);
+static const void *tcfmapgetimpl(const TCFMAP *map, const void *kbuf, int ksiz, int *sp,
+                                 uint64_t khash);
+static void tcfmapiterinit2impl(TCFMAP *map, const void *kbuf, int ksiz, uint64_t khash);
+static int tcfmapaddintimpl(TCFMAP *map, const void *kbuf, int ksiz, int num, uint64_t khash);
+static double tcfmapadddoubleimpl(TCFMAP *map, const void *kbuf, int ksiz, double num,
+                                  uint64_t khash);
+static void tcfmapswaprec(TCFMAP *map, TCFMAPREC **entp, TCFMAPREC *old, TCFMAPREC *rec);
+static bool tcfmapgetopt(const TCFMAP *map, const void *kbuf, int ksiz, uint64_t khash,
+                         const uint32_t *seqp, uint32_t seq, const char **vp, int *sp);
+
+
+/* Create a flat map object with specifying the number of the buckets. */
+TCFMAP *tcfmapnew2(uint32_t bnum){
+  return tcfmapnewimpl(bnum, NULL);
+}
+
+
+/* Create a flat map object with a slab allocator.
+   `bnum' specifies the number of the buckets.
+   `slab' specifies the slab allocator of the records or `NULL'.
+   The return value is the new flat map object. */
+static TCFMAP *tcfmapnewimpl(uint32_t bnum, void *slab){
+  uint32_t snum = TCFMAPMINSNUM;
+  while(snum < TCFMAPMAXSNUM && snum / 8 * 7 < bnum){
+    snum <<= 1;
+  }
+  TCFMAP *map;
+  TCMALLOC(map, sizeof(*map));
+  map->slab = slab;
+  tcfmapalloc(map, snum);
+  map->dnum = 0;
+  map->cur = 0;
+  map->rnum = 0;
+  map->msiz = 0;
+  map->octrls = NULL;
+  map->oslots = NULL;
+  map->osnum = 0;
+  map->ridx = 0;
+  map->rhnum = 0;
+  map->reclaim = NULL;
+  map->compact = false;
+  return map;
+}
+
+
+/* Delete a flat map object. */
+void tcfmapdel(TCFMAP *map){
+  assert(map);
+  if(map->octrls){
+    tcfmapfreerecs(map->slab, map->octrls, map->oslots, map->osnum);
+    tcfmapfreearrays(map->octrls, map->oslots, map->osnum);
+  }
+  tcfmapfreerecs(map->slab, map->ctrls, map->slots, map->snum);
+  tcfmapfreearrays(map->ctrls, map->slots, map->snum);
+  free(map);
+}
+
+
+/* Store a record into a flat map object. */
+void tcfmapput(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  tcfmapputimpl(map, kbuf, ksiz, vbuf, vsiz, tchash64(kbuf, ksiz));
+}
+
+
+/* Store a new record into a flat map object. */
+bool tcfmapputkeep(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  return tcfmapputkeepimpl(map, kbuf, ksiz, vbuf, vsiz, tchash64(kbuf, ksiz));
+}
+
+
+/* Concatenate a value at the end of the value of the existing record in a flat map object. */
+void tcfmapputcat(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  tcfmapputcatimpl(map, kbuf, ksiz, vbuf, vsiz, tchash64(kbuf, ksiz));
+}
+
+
+/* Remove a record of a flat map object. */
+bool tcfmapout(TCFMAP *map, const void *kbuf, int ksiz){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  return tcfmapoutimpl(map, kbuf, ksiz, tchash64(kbuf, ksiz));
+}
+
+
+/* Retrieve a record in a flat map object. */
+const void *tcfmapget(const TCFMAP *map, const void *kbuf, int ksiz, int *sp){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  return tcfmapgetimpl(map, kbuf, ksiz, sp, tchash64(kbuf, ksiz));
+}
+
+
+/* Initialize the iterator of a flat map object. */
+void tcfmapiterinit(TCFMAP *map){
+  assert(map);
+  map->cur = 0;
+}
+
+
+/* Initialize the iterator of a flat map object at the record corresponding a key. */
+void tcfmapiterinit2(TCFMAP *map, const void *kbuf, int ksiz){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  tcfmapiterinit2impl(map, kbuf, ksiz, tchash64(kbuf, ksiz));
+}
+
+
+/* Get the next key of the iterator of a flat map object. */
+const void *tcfmapiternext(TCFMAP *map, int *sp){
+  assert(map && sp);
+  uint64_t osnum = map->octrls ? map->osnum : 0;
+  while(map->cur < osnum + map->snum){
+    uint64_t sidx = map->cur++;
+    const uint8_t *ctrls = map->ctrls;
+    TCFMAPREC **slots = map->slots;
+    if(sidx < osnum){
+      ctrls = map->octrls;
+      slots = map->oslots;
+    } else {
+      sidx -= osnum;
+    }
+    if(!(ctrls[sidx] & TCFMAPEMPTY)){
+      const char *vbuf;
+      int vsiz;
+      return tcfmaprecbody(map->compact, slots[sidx], sp, &vbuf, &vsiz);
+    }
+  }
+  return NULL;
+}
+
+
+/* Get the number of records stored in a flat map object. */
+uint64_t tcfmaprnum(const TCFMAP *map){
+  assert(map);
+  return map->rnum;
+}
+
+
+/* Get the total size of memory used in a flat map object. */
+uint64_t tcfmapmsiz(const TCFMAP *map){
+  assert(map);
+  uint64_t rsiz = map->compact ? 3 : sizeof(TCFMAPREC) + sizeof(TCUNION_FOO);
+  return map->msiz + map->rnum * rsiz + ((uint64_t)map->snum + map->osnum) * (sizeof(void *) + 1);
+}
+
+
+/* Add an integer to a record in a flat map object. */
+int tcfmapaddint(TCFMAP *map, const void *kbuf, int ksiz, int num){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  return tcfmapaddintimpl(map, kbuf, ksiz, num, tchash64(kbuf, ksiz));
+}
+
+
+/* Add a real number to a record in a flat map object. */
+double tcfmapadddouble(TCFMAP *map, const void *kbuf, int ksiz, double num){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  return tcfmapadddoubleimpl(map, kbuf, ksiz, num, tchash64(kbuf, ksiz));
+}
+
+
+/* Clear a flat map object. */
+void tcfmapclear(TCFMAP *map){
+  assert(map);
+  if(map->octrls){
+    tcfmapfreerecs(map->slab, map->octrls, map->oslots, map->osnum);
+    tcfmapfreearrays(map->octrls, map->oslots, map->osnum);
+    map->octrls = NULL;
+    map->oslots = NULL;
+    map->osnum = 0;
+    map->ridx = 0;
+  }
+  tcfmapfreerecs(map->slab, map->ctrls, map->slots, map->snum);
+  memset(map->ctrls, TCFMAPEMPTY, map->snum);
+  map->dnum = 0;
+  map->cur = 0;
+  map->rnum = 0;
+  map->msiz = 0;
+}
+
+
+/* Get the bit mask of the slots whose control bytes are the same as a value in a group.
+   `group' specifies the pointer to the control bytes of the group.
+   `c' specifies the value.
+   The return value is the bit mask whose n-th bit means the n-th slot. */
+static uint32_t tcfmapmatch(const uint8_t *group, uint8_t c){
+  assert(group);
+#if defined(__SSE2__)
+  __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(c)));
+#else
+  uint32_t mask = 0;
+  for(int i = 0; i < TCFMAPGRPSIZ; i++){
+    if(group[i] == c) mask |= 1U << i;
+  }
+  return mask;
+#endif
+}
+
+
+/* Get the bit mask of the empty or deleted slots in a group.
+   `group' specifies the pointer to the control bytes of the group.
+   The return value is the bit mask whose n-th bit means the n-th slot. */
+static uint32_t tcfmapmatchfree(const uint8_t *group){
+  assert(group);
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+  uint32_t mask = 0;
+  for(int i = 0; i < TCFMAPGRPSIZ; i++){
+    if(group[i] & TCFMAPEMPTY) mask |= 1U << i;
+  }
+  return mask;
+#endif
+}
+
+
+/* Allocate the arrays of a flat map object.
+   `map' specifies the flat map object.
+   `snum' specifies the number of the slots. */
+static void tcfmapalloc(TCFMAP *map, uint32_t snum){
+  assert(map && snum >= TCFMAPGRPSIZ);
+  if(snum * sizeof(*map->slots) >= TCMAPZMMINSIZ){
+    int node = map->slab ? ((TCSLAB *)map->slab)->node : -1;
+    map->ctrls = tcmpzeromap(snum, node);
+    map->slots = tcmpzeromap(snum * sizeof(*map->slots), node);
+  } else {
+    TCMALLOC(map->ctrls, snum);
+    TCMALLOC(map->slots, snum * sizeof(*map->slots));
+  }
+  memset(map->ctrls, TCFMAPEMPTY, snum);
+  map->snum = snum;
+}
+
+
+/* Free one of the arrays of a flat map object.
+   `array' specifies the control byte array or the slot array.
+   `snum' specifies the number of the slots. */
+static void tcfmaparraydel(void *array, uint32_t snum){
+  assert(array);
+  if(snum * sizeof(TCFMAPREC *) >= TCMAPZMMINSIZ){
+    tczerounmap(array);
+  } else {
+    free(array);
+  }
+}
+
+
+/* Free the arrays of a flat map object.
+   `ctrls' specifies the control byte array.
+   `slots' specifies the slot array.
+   `snum' specifies the number of the slots. */
+static void tcfmapfreearrays(uint8_t *ctrls, TCFMAPREC **slots, uint32_t snum){
+  assert(ctrls && slots);
+  tcfmaparraydel(slots, snum);
+  tcfmaparraydel(ctrls, snum);
+}
+
+
+/* Free the records in the arrays of a flat map object.
+   `slab' specifies the slab allocator of the records or `NULL'.
+   `ctrls' specifies the control byte array.
+   `slots' specifies the slot array.
+   `snum' specifies the number of the slots. */
+static void tcfmapfreerecs(void *slab, const uint8_t *ctrls, TCFMAPREC **slots, uint32_t snum){
+  assert(ctrls && slots);
+  for(uint32_t i = 0; i < snum; i++){
+    if(!(ctrls[i] & TCFMAPEMPTY)) tcslabfree(slab, slots[i]);
+  }
+}
+
+
+/* Get the regions of the key and the value of a record object of a flat map.
+   `compact' specifies whether the record is compact.
+   `rec' specifies the record object.
+   `ksp' specifies the pointer to the variable into which the size of the key is assigned.
+   `vp' specifies the pointer to the variable into which the pointer to the value is assigned.
+   `vsp' specifies the pointer to the variable into which the size of the value is assigned.
+   The return value is the pointer to the region of the key.
+   A compact record has no header but the sizes of the key and the value in variable length
+   format, followed by the key, the value, and the terminating zero. */
+static const char *tcfmaprecbody(bool compact, const TCFMAPREC *rec, int *ksp, const char **vp,
+                                 int *vsp){
+  assert(rec && ksp && vp && vsp);
+  const char *rp = (const char *)rec;
+  if(compact){
+    int step;
+    TCREADVNUMBUF(rp, *ksp, step);
+    rp += step;
+    TCREADVNUMBUF(rp, *vsp, step);
+    rp += step;
+    *vp = rp + *ksp;
+    return rp;
+  }
+  rp += sizeof(*rec);
+  *ksp = rec->ksiz;
+  *vp = rp + rec->ksiz + TCALIGNPAD(rec->ksiz);
+  *vsp = rec->vsiz;
+  return rp;
+}
+
+
+/* Search the arrays of a flat map object for the slot of a key.
+   `ctrls' specifies the control byte array.
+   `slots' specifies the slot array.
+   `snum' specifies the number of the slots.
+   `compact' specifies whether the records are compact.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key.
+   `ip' specifies the pointer to the variable into which the index of the first free slot on the
+   probe sequence is assigned.  If it is `NULL', it is not used.
+   The return value is the index of the slot of the key or -1 if no record corresponds. */
+static int64_t tcfmapprobe(const uint8_t *ctrls, TCFMAPREC **slots, uint32_t snum, bool compact,
+                           const void *kbuf, int ksiz, uint32_t hash, int64_t *ip){
+  assert(ctrls && slots && kbuf && ksiz >= 0);
+  uint8_t tag = TCFMAPTAG(hash);
+  uint32_t gmask = snum / TCFMAPGRPSIZ - 1;
+  uint32_t gidx = hash & gmask;
+  if(ip) *ip = -1;
+  for(uint32_t step = 1; step <= gmask + 1; step++){
+    const uint8_t *group = ctrls + (uint64_t)gidx * TCFMAPGRPSIZ;
+    uint32_t mask = tcfmapmatch(group, tag);
+    if(mask) __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    while(mask){
+      int64_t sidx = (int64_t)gidx * TCFMAPGRPSIZ + __builtin_ctz(mask);
+      const TCFMAPREC *rec = slots[sidx];
+      if(compact){
+        const char *rvbuf;
+        int rksiz, rvsiz;
+        const char *rkbuf = tcfmaprecbody(true, rec, &rksiz, &rvbuf, &rvsiz);
+        if(rksiz == ksiz && !memcmp(rkbuf, kbuf, ksiz)) return sidx;
+      } else if(rec->hash == hash && rec->ksiz == ksiz &&
+                !memcmp((char *)rec + sizeof(*rec), kbuf, ksiz)){
+        return sidx;
+      }
+      mask &= mask - 1;
+    }
+    if(ip && *ip < 0){
+      uint32_t fmask = tcfmapmatchfree(group);
+      if(fmask) *ip = (int64_t)gidx * TCFMAPGRPSIZ + __builtin_ctz(fmask);
+    }
+    if(tcfmapmatch(group, TCFMAPEMPTY)) break;
+    gidx = (gidx + step) & gmask;
+  }
+  return -1;
+}
+
+
+/* Search a flat map object for the slot of a key.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key.
+   `cp' specifies the pointer to the variable into which the pointer to the control byte of the
+   slot is assigned.  If it is `NULL', it is not used.
+   `ip' specifies the pointer to the variable into which the index of the first free slot of the
+   current array is assigned.  If it is `NULL', it is not used.
+   The return value is the pointer to the slot of the key or `NULL' if no record corresponds.
+   While rehashing, the old arrays are searched too. */
+static TCFMAPREC **tcfmapsearch(const TCFMAP *map, const void *kbuf, int ksiz, uint32_t hash,
+                                uint8_t **cp, int64_t *ip){
+  assert(map && kbuf && ksiz >= 0);
+  int64_t sidx = tcfmapprobe(map->ctrls, map->slots, map->snum, map->compact, kbuf, ksiz, hash,
+                             ip);
+  if(sidx >= 0){
+    if(cp) *cp = map->ctrls + sidx;
+    return map->slots + sidx;
+  }
+  if(map->octrls){
+    sidx = tcfmapprobe(map->octrls, map->oslots, map->osnum, map->compact, kbuf, ksiz, hash,
+                       NULL);
+    if(sidx >= 0){
+      if(cp) *cp = map->octrls + sidx;
+      return map->oslots + sidx;
+    }
+  }
+  return NULL;
+}
+
+
+/* Get the first free slot on the probe sequence of a hash value in a flat map object.
+   `map' specifies the flat map object.
+   `hash' specifies the hash value.
+   The return value is the index of the free slot. */
+static int64_t tcfmapfreeslot(const TCFMAP *map, uint32_t hash){
+  assert(map);
+  uint32_t gmask = map->snum / TCFMAPGRPSIZ - 1;
+  uint32_t gidx = hash & gmask;
+  for(uint32_t step = 1; true; step++){
+    uint32_t fmask = tcfmapmatchfree(map->ctrls + (uint64_t)gidx * TCFMAPGRPSIZ);
+    if(fmask) return (int64_t)gidx * TCFMAPGRPSIZ + __builtin_ctz(fmask);
+    gidx = (gidx + step) & gmask;
+  }
+  return -1;
+}
+
+
+/* Start rehashing a flat map object into new arrays.
+   `map' specifies the flat map object.
+   `snum' specifies the number of the new slots. */
+static void tcfmaprehash(TCFMAP *map, uint32_t snum){
+  assert(map && !map->octrls);
+  map->octrls = map->ctrls;
+  map->oslots = map->slots;
+  map->osnum = map->snum;
+  map->ridx = 0;
+  map->rhnum++;
+  tcfmapalloc(map, snum);
+  map->dnum = 0;
+}
+
+
+/* Move records in old groups of a flat map object under rehashing into the new arrays.
+   `map' specifies the flat map object.
+   `num' specifies the number of the old groups to be moved. */
+static void tcfmaprehashstep(TCFMAP *map, int num){
+  assert(map && map->octrls && num >= 0);
+  uint32_t gnum = map->osnum / TCFMAPGRPSIZ;
+  while(num-- > 0 && map->ridx < gnum){
+    uint8_t *group = map->octrls + (uint64_t)map->ridx * TCFMAPGRPSIZ;
+    TCFMAPREC **slots = map->oslots + (uint64_t)map->ridx * TCFMAPGRPSIZ;
+    for(int i = 0; i < TCFMAPGRPSIZ; i++){
+      if(group[i] & TCFMAPEMPTY) continue;
+      TCFMAPREC *rec = slots[i];
+      uint32_t hash;
+      if(map->compact){
+        const char *vbuf;
+        int ksiz, vsiz;
+        const char *kbuf = tcfmaprecbody(true, rec, &ksiz, &vbuf, &vsiz);
+        hash = TCFMAPHASH(tchash64(kbuf, ksiz));
+      } else {
+        hash = rec->hash;
+      }
+      int64_t sidx = tcfmapfreeslot(map, hash);
+      if(map->ctrls[sidx] == TCFMAPDELETED) map->dnum--;
+      map->slots[sidx] = rec;
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      map->ctrls[sidx] = TCFMAPTAG(hash);
+      group[i] = TCFMAPDELETED;
+    }
+    map->ridx++;
+  }
+  if(map->ridx >= gnum){
+    if(map->reclaim){
+      tcrclretire(map->reclaim, tcfmaparraydel, map->oslots, map->osnum);
+      tcrclretire(map->reclaim, tcfmaparraydel, map->octrls, map->osnum);
+    } else {
+      tcfmapfreearrays(map->octrls, map->oslots, map->osnum);
+    }
+    map->cur = map->cur > map->osnum ? map->cur - map->osnum : 0;
+    map->octrls = NULL;
+    map->oslots = NULL;
+    map->osnum = 0;
+    map->ridx = 0;
+    map->rhnum++;
+  }
+}
+
+
+/* Create a record object of a flat map.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key.
+   `asiz' specifies the size of the region to be allocated.  If it is too small, the minimum
+   size is used.  It is ignored for compact records.
+   The return value is the new record object. */
+static TCFMAPREC *tcfmaprecnew(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf,
+                               int vsiz, uint32_t hash, int asiz){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(map->compact){
+    char hbuf[TCNUMBUFSIZ];
+    int hsiz, step;
+    TCSETVNUMBUF(hsiz, hbuf, ksiz);
+    TCSETVNUMBUF(step, hbuf + hsiz, vsiz);
+    hsiz += step;
+    char *wp = tcslaballoc(map->slab, hsiz + ksiz + vsiz + 1);
+    memcpy(wp, hbuf, hsiz);
+    memcpy(wp + hsiz, kbuf, ksiz);
+    memcpy(wp + hsiz + ksiz, vbuf, vsiz);
+    wp[hsiz+ksiz+vsiz] = '\0';
+    return (TCFMAPREC *)wp;
+  }
+  TCFMAPREC *rec;
+  int psiz = TCALIGNPAD(ksiz);
+  int msiz = sizeof(*rec) + ksiz + psiz + vsiz + 1;
+  if(asiz < msiz) asiz = msiz;
+  rec = tcslaballoc(map->slab, asiz);
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf, kbuf, ksiz);
+  dbuf[ksiz] = '\0';
+  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
+  dbuf[ksiz+psiz+vsiz] = '\0';
+  rec->ksiz = ksiz;
+  rec->vsiz = vsiz;
+  rec->hash = hash;
+  rec->asiz = asiz;
+  return rec;
+}
+
+
+/* Store a record object into a free slot of a flat map object.
+   `map' specifies the flat map object.
+   `sidx' specifies the index of the free slot of the current array.
+   `rec' specifies the record object.
+   `hash' specifies the hash value of the key.
+   If the current array is filled up, rehashing is started.  Because each update moves some
+   groups ahead of storing, the new array never overflows until the rehashing finishes. */
+static void tcfmapstore(TCFMAP *map, int64_t sidx, TCFMAPREC *rec, uint32_t hash){
+  assert(map && sidx >= 0 && rec);
+  if(map->ctrls[sidx] == TCFMAPEMPTY){
+    if(!map->octrls && (map->rnum + map->dnum + 1) * 8 > (uint64_t)map->snum * 7){
+      uint32_t snum = map->snum;
+      if((map->rnum + 1) * 16 > (uint64_t)snum * 7 && snum < TCFMAPMAXSNUM) snum <<= 1;
+      tcfmaprehash(map, snum);
+      tcfmaprehashstep(map, TCFMAPRHUNIT);
+      sidx = tcfmapfreeslot(map, hash);
+      if(map->ctrls[sidx] == TCFMAPDELETED) map->dnum--;
+    }
+  } else {
+    map->dnum--;
+  }
+  map->slots[sidx] = rec;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  map->ctrls[sidx] = TCFMAPTAG(hash);
+  map->rnum++;
+  const char *vbuf;
+  int ksiz, vsiz;
+  tcfmaprecbody(map->compact, rec, &ksiz, &vbuf, &vsiz);
+  map->msiz += ksiz + vsiz;
+}
+
+
+/* Store a record into a flat map object with a hash value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static void tcfmapputimpl(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                          uint64_t khash){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->octrls) tcfmaprehashstep(map, TCFMAPRHUNIT);
+  uint32_t hash = TCFMAPHASH(khash);
+  int64_t fidx;
+  TCFMAPREC **entp = tcfmapsearch(map, kbuf, ksiz, hash, NULL, &fidx);
+  if(!entp){
+    tcfmapstore(map, fidx, tcfmaprecnew(map, kbuf, ksiz, vbuf, vsiz, hash, 0), hash);
+    return;
+  }
+  TCFMAPREC *rec = *entp;
+  const char *rvbuf;
+  int rksiz, rvsiz;
+  tcfmaprecbody(map->compact, rec, &rksiz, &rvbuf, &rvsiz);
+  map->msiz += vsiz - rvsiz;
+  if(map->reclaim || map->compact){
+    tcfmapswaprec(map, entp, rec, tcfmaprecnew(map, kbuf, ksiz, vbuf, vsiz, hash, 0));
+    return;
+  }
+  int psiz = TCALIGNPAD(ksiz);
+  uint32_t asiz = sizeof(*rec) + ksiz + psiz + vsiz + 1;
+  if(asiz > rec->asiz){
+    TCREALLOC(rec, rec, asiz);
+    rec->asiz = asiz;
+    *entp = rec;
+  }
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf + ksiz + psiz, vbuf, vsiz);
+  dbuf[ksiz+psiz+vsiz] = '\0';
+  rec->vsiz = vsiz;
+}
+
+
+/* Store a new record into a flat map object with a hash value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static bool tcfmapputkeepimpl(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                              uint64_t khash){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->octrls) tcfmaprehashstep(map, TCFMAPRHUNIT);
+  uint32_t hash = TCFMAPHASH(khash);
+  int64_t fidx;
+  if(tcfmapsearch(map, kbuf, ksiz, hash, NULL, &fidx)) return false;
+  tcfmapstore(map, fidx, tcfmaprecnew(map, kbuf, ksiz, vbuf, vsiz, hash, 0), hash);
+  return true;
+}
+
+
+/* Concatenate a value at the end of the value of the existing record with a hash value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static void tcfmapputcatimpl(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                             uint64_t khash){
+  assert(map && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->octrls) tcfmaprehashstep(map, TCFMAPRHUNIT);
+  uint32_t hash = TCFMAPHASH(khash);
+  int64_t fidx;
+  TCFMAPREC **entp = tcfmapsearch(map, kbuf, ksiz, hash, NULL, &fidx);
+  TCFMAPREC *rec;
+  int psiz = TCALIGNPAD(ksiz);
+  if(!entp){
+    int asiz = sizeof(*rec) + ksiz + psiz + vsiz + 1;
+    int unit = (asiz <= TCMAPCSUNIT) ? TCMAPCSUNIT : TCMAPCBUNIT;
+    asiz = (asiz - 1) + unit - (asiz - 1) % unit;
+    tcfmapstore(map, fidx, tcfmaprecnew(map, kbuf, ksiz, vbuf, vsiz, hash, asiz), hash);
+    return;
+  }
+  rec = *entp;
+  map->msiz += vsiz;
+  if(map->compact){
+    const char *rvbuf;
+    int rksiz, rvsiz;
+    tcfmaprecbody(true, rec, &rksiz, &rvbuf, &rvsiz);
+    char *tbuf;
+    TCMALLOC(tbuf, rvsiz + vsiz + 1);
+    memcpy(tbuf, rvbuf, rvsiz);
+    memcpy(tbuf + rvsiz, vbuf, vsiz);
+    tcfmapswaprec(map, entp, rec, tcfmaprecnew(map, kbuf, ksiz, tbuf, rvsiz + vsiz, hash, 0));
+    free(tbuf);
+    return;
+  }
+  uint32_t asiz = sizeof(*rec) + ksiz + psiz + rec->vsiz + vsiz + 1;
+  if(map->reclaim){
+    TCFMAPREC *old = rec;
+    rec = tcfmaprecnew(map, kbuf, ksiz, (char *)old + sizeof(*old) + ksiz + psiz, old->vsiz, hash,
+                       asiz);
+    char *dbuf = (char *)rec + sizeof(*rec);
+    memcpy(dbuf + ksiz + psiz + rec->vsiz, vbuf, vsiz);
+    rec->vsiz += vsiz;
+    dbuf[ksiz+psiz+rec->vsiz] = '\0';
+    tcfmapswaprec(map, entp, old, rec);
+    return;
+  }
+  if(asiz > rec->asiz){
+    int unit = (asiz <= TCMAPCSUNIT) ? TCMAPCSUNIT : TCMAPCBUNIT;
+    asiz = (asiz - 1) + unit - (asiz - 1) % unit;
+    TCREALLOC(rec, rec, asiz);
+    rec->asiz = asiz;
+    *entp = rec;
+  }
+  char *dbuf = (char *)rec + sizeof(*rec);
+  memcpy(dbuf + ksiz + psiz + rec->vsiz, vbuf, vsiz);
+  rec->vsiz += vsiz;
+  dbuf[ksiz+psiz+rec->vsiz] = '\0';
+}
+
+
+/* Remove a record of a flat map object with a hash value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static bool tcfmapoutimpl(TCFMAP *map, const void *kbuf, int ksiz, uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->octrls) tcfmaprehashstep(map, TCFMAPRHUNIT);
+  uint32_t hash = TCFMAPHASH(khash);
+  uint8_t *ctrl;
+  TCFMAPREC **entp = tcfmapsearch(map, kbuf, ksiz, hash, &ctrl, NULL);
+  if(!entp) return false;
+  TCFMAPREC *rec = *entp;
+  if(entp >= map->slots && entp < map->slots + map->snum){
+    const uint8_t *group = map->ctrls + (ctrl - map->ctrls) / TCFMAPGRPSIZ * TCFMAPGRPSIZ;
+    if(tcfmapmatch(group, TCFMAPEMPTY)){
+      *ctrl = TCFMAPEMPTY;
+    } else {
+      *ctrl = TCFMAPDELETED;
+      map->dnum++;
+    }
+  } else {
+    *ctrl = TCFMAPDELETED;
+  }
+  map->rnum--;
+  const char *rvbuf;
+  int rksiz, rvsiz;
+  tcfmaprecbody(map->compact, rec, &rksiz, &rvbuf, &rvsiz);
+  map->msiz -= rksiz + rvsiz;
+  if(map->reclaim){
+    tcrclretire(map->reclaim, map->slab ? tcslabrelease : NULL, rec, 0);
+  } else {
+    tcslabfree(map->slab, rec);
+  }
+  return true;
+}
+
+
+/* Retrieve a record in a flat map object with a hash value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static const void *tcfmapgetimpl(const TCFMAP *map, const void *kbuf, int ksiz, int *sp,
+                                 uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  uint32_t hash = TCFMAPHASH(khash);
+  TCFMAPREC **entp = tcfmapsearch(map, kbuf, ksiz, hash, NULL, NULL);
+  if(!entp) return NULL;
+  const char *vbuf;
+  int rksiz, vsiz;
+  tcfmaprecbody(map->compact, *entp, &rksiz, &vbuf, &vsiz);
+  if(sp) *sp = vsiz;
+  return vbuf;
+}
+
+
+/* Initialize the iterator of a flat map object at the record corresponding a key with a hash
+   value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static void tcfmapiterinit2impl(TCFMAP *map, const void *kbuf, int ksiz, uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  uint32_t hash = TCFMAPHASH(khash);
+  TCFMAPREC **entp = tcfmapsearch(map, kbuf, ksiz, hash, NULL, NULL);
+  if(!entp) return;
+  if(entp >= map->slots && entp < map->slots + map->snum){
+    map->cur = (map->octrls ? map->osnum : 0) + (entp - map->slots);
+  } else {
+    map->cur = entp - map->oslots;
+  }
+}
+
+
+/* Add an integer to a record in a flat map object with a hash value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static int tcfmapaddintimpl(TCFMAP *map, const void *kbuf, int ksiz, int num, uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->octrls) tcfmaprehashstep(map, TCFMAPRHUNIT);
+  uint32_t hash = TCFMAPHASH(khash);
+  int64_t fidx;
+  TCFMAPREC **entp = tcfmapsearch(map, kbuf, ksiz, hash, NULL, &fidx);
+  if(!entp){
+    tcfmapstore(map, fidx, tcfmaprecnew(map, kbuf, ksiz, &num, sizeof(num), hash, 0), hash);
+    return num;
+  }
+  TCFMAPREC *rec = *entp;
+  const char *rvbuf;
+  int rksiz, rvsiz;
+  tcfmaprecbody(map->compact, rec, &rksiz, &rvbuf, &rvsiz);
+  if(rvsiz != sizeof(num)) return INT_MIN;
+  if(map->reclaim || map->compact){
+    int onum;
+    memcpy(&onum, rvbuf, sizeof(onum));
+    num += onum;
+    tcfmapswaprec(map, entp, rec, tcfmaprecnew(map, kbuf, ksiz, &num, sizeof(num), hash, 0));
+    return num;
+  }
+  return *(int *)rvbuf += num;
+}
+
+
+/* Add a real number to a record in a flat map object with a hash value.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `khash' specifies the hash value of the key calculated with `tchash64'. */
+static double tcfmapadddoubleimpl(TCFMAP *map, const void *kbuf, int ksiz, double num,
+                                  uint64_t khash){
+  assert(map && kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  if(map->octrls) tcfmaprehashstep(map, TCFMAPRHUNIT);
+  uint32_t hash = TCFMAPHASH(khash);
+  int64_t fidx;
+  TCFMAPREC **entp = tcfmapsearch(map, kbuf, ksiz, hash, NULL, &fidx);
+  if(!entp){
+    tcfmapstore(map, fidx, tcfmaprecnew(map, kbuf, ksiz, &num, sizeof(num), hash, 0), hash);
+    return num;
+  }
+  TCFMAPREC *rec = *entp;
+  const char *rvbuf;
+  int rksiz, rvsiz;
+  tcfmaprecbody(map->compact, rec, &rksiz, &rvbuf, &rvsiz);
+  if(rvsiz != sizeof(num)) return nan("");
+  if(map->reclaim || map->compact){
+    double onum;
+    memcpy(&onum, rvbuf, sizeof(onum));
+    num += onum;
+    tcfmapswaprec(map, entp, rec, tcfmaprecnew(map, kbuf, ksiz, &num, sizeof(num), hash, 0));
+    return num;
+  }
+  return *(double *)rvbuf += num;
+}
+
+
+/* Replace a record of a flat map object with its updated duplication.
+   `map' specifies the flat map object.
+   `entp' specifies the pointer to the slot of the original record.
+   `old' specifies the original record object.
+   `rec' specifies the new record object.
+   The original is retired so that readers without locking never see a partial update.  If the
+   map has no reclaimer, the original is freed at once. */
+static void tcfmapswaprec(TCFMAP *map, TCFMAPREC **entp, TCFMAPREC *old, TCFMAPREC *rec){
+  assert(map && entp && old && rec);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  *entp = rec;
+  if(map->reclaim){
+    tcrclretire(map->reclaim, map->slab ? tcslabrelease : NULL, old, 0);
+  } else {
+    tcslabfree(map->slab, old);
+  }
+}
+
+
+/* Retrieve a record in a flat map object which may be updated concurrently.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `khash' specifies the hash value of the key calculated with `tchash64'.
+   `seqp' specifies the pointer to the sequence number bumped by updates of the map.
+   `seq' specifies the even sequence number read before reading the map.
+   `vp' specifies the pointer to the variable into which the pointer to the region of the value
+   or `NULL' is assigned.
+   `sp' specifies the pointer to the variable into which the size of the value is assigned.
+   The return value is true if the result is consistent, or false if an update interfered.
+   The caller must have entered a reading section of the reclaimer of the map. */
+static bool tcfmapgetopt(const TCFMAP *map, const void *kbuf, int ksiz, uint64_t khash,
+                         const uint32_t *seqp, uint32_t seq, const char **vp, int *sp){
+  assert(map && kbuf && ksiz >= 0 && seqp && vp && sp);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  const uint8_t *ctrls = map->ctrls;
+  TCFMAPREC **slots = map->slots;
+  uint32_t snum = map->snum;
+  const uint8_t *octrls = map->octrls;
+  TCFMAPREC **oslots = map->oslots;
+  uint32_t osnum = map->osnum;
+  if(!tcseqcheck(seqp, seq)) return false;
+  uint32_t hash = TCFMAPHASH(khash);
+  int64_t sidx = tcfmapprobe(ctrls, slots, snum, map->compact, kbuf, ksiz, hash, NULL);
+  if(sidx < 0 && octrls){
+    sidx = tcfmapprobe(octrls, oslots, osnum, map->compact, kbuf, ksiz, hash, NULL);
+    slots = oslots;
+  }
+  *vp = NULL;
+  if(sidx >= 0){
+    int rksiz;
+    tcfmaprecbody(map->compact, slots[sidx], &rksiz, vp, sp);
+  }
+  return tcseqcheck(seqp, seq);
+}
+
+
+
+/*************************************************************************************************
+ * on-memory hash database
+ *************************************************************************************************/
+
+
+#define TCMDBDEFMNUM   8                 // default number of internal maps
+#define TCMDBMAXMNUM   4096              // maximum number of internal maps
+#define TCMDBDEFBNUM   65536             // default bucket number
+#define TCMDBOPTTRY    4                 // number of tries of optimistic reading before locking
+#define TCMDBREFMIN    (1ULL<<12)        // minimum number of reference bits of each shard
+#define TCMDBREFMAX    (1ULL<<26)        // maximum number of reference bits of each shard
+#define TCMDBREFUNIT   64                // size of the capacity per reference bit
+#define TCMDBXMAPBNUM  64                // initial number of slots of expiration tables
+#define TCMDBXLVNUM    4                 // number of levels of timer wheels
+#define TCMDBXLVBITS   6                 // number of bits of the slot index of each level
+#define TCMDBXSLOTNUM  (1<<TCMDBXLVBITS) // number of slots of each level
+#define TCMDBIDXLVMAX  16                // maximum number of levels of ordered indices
+#define TCMDBSCANSTEP  16                // number of positions visited per record to be scanned
+#define TCMDBSCANRHMASK 0xfffff          // mask of the number of rehashing in a cursor
+#define TCMDBRLSUNIT   65536             // number of regions released in each step in background
+#define TCMDBRLSWAIT   0.02              // seconds of waiting between steps of releasing
+#define TCMDBCMPMAGIC  "\xffLZ\x01"        // magic data at the head of compressed values
+#define TCMDBCMPMSIZ   4                 // size of the magic data of compressed values
+#define TCMDBCMPMIN    64                // minimum size of values to be compressed
+#define TCMDBCNTSIZ    16                // size of stored values of decimal counters
+#define TCMDBSTHSIZ    16                // size of the header of striped counters
+#define TCMDBSTLINE    64                // size of each slot of striped counters
+#define TCMDBSTMAX     64                // maximum number of slots of striped counters
+#define TCMDBSNAPMAGIC "TCMDBSN1"        // magic data at the head of snapshot files
+#define TCMDBSNAPHSIZ  16                // size of the header of snapshot files
+#define TCMDBSNAPRSIZ  17                // size of the header of each record of snapshots
+#define TCMDBSNAPBUFSIZ (1<<20)          // size of the buffer of writing snapshots
+#define TCMDBSNAPTHMAX 64                // maximum number of threads loading a snapshot
+
+typedef struct _TCMDBXENT {              // type of structure for an entry of a timer wheel
+  struct _TCMDBXENT *prev;               // previous entry in the slot
+  struct _TCMDBXENT *next;               // next entry in the slot
+  int64_t xtime;                         // expiration time
+  uint32_t sidx;                         // index of the slot
+  int ksiz;                              // size of the key following the structure
+} TCMDBXENT;
+
+typedef struct {                         // type of structure for a timer wheel
+  TCMDBXENT *slots[TCMDBXLVNUM*TCMDBXSLOTNUM];  // lists of entries of the slots of all levels
+  int64_t cur;                           // last time whose slot has been processed
+} TCMDBWHEEL;
+
+typedef struct {                         // type of structure for a value of an expiration table
+  int64_t xtime;                         // expiration time
+  TCMDBXENT *ent;                        // entry of the timer wheel
+} TCMDBXVAL;
+
+typedef struct _TCMDBIDXNODE {           // type of structure for a node of an ordered index
+  int ksiz;                              // size of the key following the links
+  int lvnum;                             // number of the levels of the node
+  struct _TCMDBIDXNODE *next[];          // next nodes of the levels
+} TCMDBIDXNODE;
+
+typedef struct {                         // type of structure for an ordered index
+  TCMDBIDXNODE *head;                    // head node of all levels
+  int lvnum;                             // number of the levels in use
+  uint32_t seed;                         // seed of the levels of new nodes
+  uint64_t msiz;                         // total size of the nodes
+} TCMDBIDX;
+
+typedef struct _TCMDBRLS {               // type of structure for detached contents of a shard
+  struct _TCMDBRLS *next;                // next contents in the queue
+  TCMAP *map;                            // detached map or `NULL'
+  TCFMAP *fmap;                          // detached flat map or `NULL'
+  TCFMAP *xmap;                          // detached expiration table or `NULL'
+  TCMDBWHEEL *wheel;                     // detached timer wheel or `NULL'
+  TCMDBIDX *index;                       // detached ordered index or `NULL'
+  TCRCL *reclaim;                        // detached reclaimer or `NULL'
+  TCSLAB *slab;                          // slab allocator owning the records
+  uint64_t epoch;                        // epoch at detaching
+  uint64_t pos;                          // position of releasing in the current structure
+} TCMDBRLS;
+
+typedef struct {                         // type of structure for a loader of a snapshot
+  TCMDB *mdb;                            // database object
+  const char *ptr;                       // pointer to the region of the snapshot
+  const uint64_t *dir;                   // directory of the sections
+  int snum;                              // number of the sections
+  int id;                                // index of the first section to be loaded
+  int step;                              // step to the next section to be loaded
+  bool err;                              // whether a section is broken
+} TCMDBSNAPLD;
+
+typedef struct {                         // type of structure for a visitor of stored values
+  TCVISITRAWPROC proc;                   // visitor function
+  void *op;                              // opaque pointer given to the visitor
+} TCMDBRAWARG;
+
+enum {                                   // enumeration for flags of records of snapshots
+  TCMDBSNAPSTRIPE = 1 << 0               // striped counter
+};
+
+/* get the region of the key of a node of an ordered index */
+#define TCMDBIDXKEY(TC_node) \
+  ((char *)((TC_node)->next + (TC_node)->lvnum))
+
+/* get the number of records of a shard of an on-memory hash database */
+#define TCMDBSHARDRNUM(TC_mdb, TC_shard) \
+  (((TC_mdb)->opts & MDBTFLAT) ? (TC_shard)->fmap->rnum : (TC_shard)->map->rnum)
+
+/* get the size of stored values of striped counters of an on-memory hash database */
+#define TCMDBSTSIZ(TC_mdb) \
+  (TCMDBSTHSIZ + ((TC_mdb)->stnum + 1) * TCMDBSTLINE)
+
+/* get the index of the internal map of a key from its 64-bit hash value */
+#define TCMDBHASH(TC_res, TC_mdb, TC_hash)                              \
   do {                                                                  \
-    const unsigned char *_TC_p = (const unsigned char *)(TC_kbuf) + TC_ksiz - 1; \
-    int _TC_ksiz = TC_ksiz;                                             \
-    for((TC_res) = 0x20071123; _TC_ksiz--;){                            \
-      (TC_res) = (TC_res) * 33 + *(_TC_p)--;                            \
-    }                                                                   \
-    (TC_res) &= TCMDBMNUM - 1;                                          \
+    (TC_res) = ((TC_hash) >> 40) & ((TC_mdb)->mnum - 1);                \
   } while(false)
 
 
-const char *tcmdbpath(TCMDB *mdb){
-  assert(mdb);
-  const char *rv = "*";
+/* Queue of detached contents of shards to be released in background. */
+static TCMDBRLS *tcmdbrlshead = NULL;
+static TCMDBRLS *tcmdbrlstail = NULL;
+
+
+/* Mutex and condition variable of the queue of detached contents. */
+static pthread_mutex_t tcmdbrlsmtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tcmdbrlscnd = PTHREAD_COND_INITIALIZER;
+
+
+/* Whether the thread releasing detached contents is running. */
+static bool tcmdbrlsrun = false;
+
+
+/* private function prototypes */
+static void tcmdbseqbegin(TCMDBSHARD *shard);
+static void tcmdbseqend(TCMDBSHARD *shard);
+static bool tcmdbgetopt(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash,
+                        const char **vp, int *sp);
+static void tcmdbtouch(TCMDBSHARD *shard, uint64_t hash);
+static bool tcmdbuntouch(TCMDBSHARD *shard, uint64_t hash);
+static void tcmdbcutshard(TCMDB *mdb, TCMDBSHARD *shard);
+static int64_t tcmdbshardxtime(TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash);
+static void tcmdbxset(TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash, int64_t xtime);
+static void tcmdbxcut(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash);
+static void tcmdbwheelput(TCMDBWHEEL *wheel, TCMDBXENT *ent);
+static void tcmdbwheelout(TCMDBWHEEL *wheel, TCMDBXENT *ent);
+static void tcmdbwheeldel(TCMDBWHEEL *wheel);
+static void tcmdbwheelstep(TCMDBWHEEL *wheel, int64_t now, TCLIST *keys, int max);
+static void tcmdbidxsync(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t rnum);
+static TCLIST *tcmdbrangeshard(TCMDB *mdb, TCMDBSHARD *shard, const void *bkbuf, int bksiz,
+                               const void *ekbuf, int eksiz, int max, bool vals);
+static bool tcmdbscanshard(TCMDB *mdb, TCMDBSHARD *shard, uint32_t *rhp, uint32_t *pp, int max,
+                           int64_t *vp, bool vals, TCLIST *recs);
+static void tcmdbscanbucket(TCMDBSHARD *shard, const TCMAPREC *rec, int64_t now, bool vals,
+                            TCLIST *recs);
+static void tcmdbscanpush(TCMDBSHARD *shard, const char *kbuf, int ksiz, const char *vbuf,
+                          int vsiz, int64_t now, bool vals, TCLIST *recs);
+static int tcmdbidxcmp(const char *abuf, int asiz, const char *bbuf, int bsiz);
+static int tcmdbidxcmplist(const void *a, const void *b);
+static TCMDBIDX *tcmdbidxnew(void);
+static void tcmdbidxdel(TCMDBIDX *idx);
+static TCMDBIDXNODE *tcmdbidxseek(TCMDBIDX *idx, const void *kbuf, int ksiz,
+                                  TCMDBIDXNODE **prevs);
+static void tcmdbidxput(TCMDBIDX *idx, const void *kbuf, int ksiz);
+static void tcmdbidxout(TCMDBIDX *idx, const void *kbuf, int ksiz);
+static void tcmdbrlsqueue(TCMDBSHARD *shard, TCMDBRLS *rls);
+static void *tcmdbrlsproc(void *arg);
+static void tcmdbrlsdel(void *ptr, uint32_t num);
+static bool tcmdbrlsstep(TCMDBRLS *rls, int max);
+static bool tcmdbrlsfmap(TCFMAP *map, uint64_t *pp, int *np);
+static bool tcmdbvisitimpl(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash,
+                           TCVISITPROC proc, TCVISITRAWPROC rproc, void *op);
+static void tcmdbvisitcall(TCMDB *mdb, const char *vbuf, int vsiz, TCVISITPROC proc,
+                           TCVISITRAWPROC rproc, void *op);
+static void tcmdbvisitraw(const void *vbuf, int vsiz, void *op);
+static uint64_t tcmdbcputime(void);
+static bool tcmdbcmpcheck(TCMDB *mdb, const char *vbuf, int vsiz);
+static char *tcmdbcmppack(TCMDB *mdb, const char *vbuf, int vsiz, int *sp);
+static char *tcmdbcmpunpack(TCMDB *mdb, const char *vbuf, int vsiz, int *sp);
+static char *tcmdbvaldup(TCMDB *mdb, const char *vbuf, int vsiz, int *sp);
+static int tcmdbvalsiz(TCMDB *mdb, const char *vbuf, int vsiz);
+static void tcmdbunpacklist(TCMDB *mdb, TCLIST *recs);
+static bool tcmdbputcatcmp(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz,
+                           const void *vbuf, int vsiz, uint64_t hash);
+static char *tcmdbcellget(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz,
+                          uint64_t hash, int *sp);
+static bool tcmdbcntcheck(TCMDB *mdb, const char *vbuf, int vsiz);
+static bool tcmdbstcheck(TCMDB *mdb, const char *vbuf, int vsiz);
+static int tcmdbcntrender(TCMDB *mdb, const char *vbuf, int vsiz, char *buf);
+static int tcmdbstadd(TCMDB *mdb, char *vbuf, int num);
+static int tcmdbstsum(TCMDB *mdb, const char *vbuf);
+static void tcmdbstput(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, int num,
+                       uint64_t hash);
+static uint64_t tcmdbcntadd(uint64_t onum, int64_t num);
+static bool tcmdbdumpimpl(TCMDB *mdb, const char *path, const void *mbuf, int msiz, bool lock);
+static bool tcmdbdumpshard(TCMDB *mdb, TCMDBSHARD *shard, int fd, TCXSTR *xstr,
+                           uint64_t *rnp, uint64_t *sp);
+static bool tcmdbdumprec(TCMDB *mdb, TCMDBSHARD *shard, const char *kbuf, int ksiz,
+                         const char *vbuf, int vsiz, int64_t now, int fd, TCXSTR *xstr,
+                         uint64_t *rnp, uint64_t *sp);
+static void *tcmdbloadproc(void *targ);
+
+
+const char *tcmdbpath(TCMDB *mdb){
+  assert(mdb);
+  const char *rv = mdb->hdb ? ((TCHDB *)mdb->hdb)->path : "*";
+  return rv;
+}
+
+
+TCLIST *tcmdbmisc(TCMDB *mdb, const char *name, const TCLIST *args){
+  assert(mdb && name && args);
+  int argc = tclistnum(args);
+  TCLIST *rv;
+  if(!strcmp(name, "put") || !strcmp(name, "putkeep") || !strcmp(name, "putcat")){
+    if(argc > 1){
+      rv = tclistnew2(1);
+      const char *kbuf;
+      int ksiz;
+      kbuf = tclistval(args, 0, &ksiz);
+      const char *vbuf;
+      int vsiz;
+      vbuf = tclistval(args, 1, &vsiz);
+      bool err = false;
+      if(!strcmp(name, "put")){
+        tcmdbput(mdb, kbuf, ksiz, vbuf, vsiz);
+      } else if(!strcmp(name, "putkeep")){
+        if(!tcmdbputkeep(mdb, kbuf, ksiz, vbuf, vsiz)) err = true;
+      } else if(!strcmp(name, "putcat")){
+        tcmdbputcat(mdb, kbuf, ksiz, vbuf, vsiz);
+      }
+      if(err){
+        tclistdel(rv);
+        rv = NULL;
+      }
+    } else {
+      rv = NULL;
+    }
+  } else if(!strcmp(name, "out")){
+    if(argc > 0){
+      rv = tclistnew2(1);
+      const char *kbuf;
+      int ksiz;
+      kbuf = tclistval(args, 0, &ksiz);
+      if(!tcmdbout(mdb, kbuf, ksiz)){
+        tclistdel(rv);
+        rv = NULL;
+      }
+    } else {
+      rv = NULL;
+    }
+  } else if(!strcmp(name, "get")){
+    if(argc > 0){
+      rv = tclistnew2(1);
+      const char *kbuf;
+      int ksiz;
+      kbuf = tclistval(args, 0, &ksiz);
+      int vsiz;
+      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
+      if(vbuf){
+        tclistpush(rv, vbuf, vsiz);
+        free(vbuf);
+      } else {
+        tclistdel(rv);
+        rv = NULL;
+      }
+    } else {
+      rv = NULL;
+    }
+  } else if(!strcmp(name, "putlist")){
+    rv = tclistnew2(1);
+    argc--;
+    for(int i = 0; i < argc; i += 2){
+      const char *kbuf, *vbuf;
+      int ksiz, vsiz;
+      kbuf = tclistval(args, i, &ksiz);
+      vbuf = tclistval(args, i + 1, &vsiz);
+      tcmdbput(mdb, kbuf, ksiz, vbuf, vsiz);
+    }
+  } else if(!strcmp(name, "outlist")){
+    rv = tclistnew2(1);
+    for(int i = 0; i < argc; i++){
+      const char *kbuf;
+      int ksiz;
+      kbuf = tclistval(args, i, &ksiz);
+      tcmdbout(mdb, kbuf, ksiz);
+    }
+  } else if(!strcmp(name, "getlist")){
+    rv = tclistnew2(argc * 2);
+    for(int i = 0; i < argc; i++){
+      const char *kbuf;
+      int ksiz;
+      kbuf = tclistval(args, i, &ksiz);
+      int vsiz;
+      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
+      if(vbuf){
+        tclistpush(rv, kbuf, ksiz);
+        tclistpush(rv, vbuf, vsiz);
+        free(vbuf);
+      }
+    }
+  } else if(!strcmp(name, "getpart")){
+    if(argc > 0){
+      const char *kbuf;
+      int ksiz;
+      kbuf = tclistval(args, 0, &ksiz);
+      int off = argc > 1 ? tcatoi(tclistval0(args, 1)) : 0;
+      if(off < 0) off = 0;
+      if(off > INT_MAX / 2 - 1) off = INT_MAX - 1;
+      int len = argc > 2 ? tcatoi(tclistval0(args, 2)) : -1;
+      if(len < 0 || len > INT_MAX / 2) len = INT_MAX / 2;
+      int vsiz;
+      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
+      if(vbuf){
+        if(off < vsiz){
+          rv = tclistnew2(1);
+          vsiz -= off;
+          if(vsiz > len) vsiz = len;
+          if(off > 0) memmove(vbuf, vbuf + off, vsiz);
+          tclistpushmalloc(rv, vbuf, vsiz);
+        } else {
+          rv = NULL;
+          free(vbuf);
+        }
+      } else {
+        rv = NULL;
+      }
+    } else {
+      rv = NULL;
+    }
+  } else if(!strcmp(name, "iterinit")){
+    rv = tclistnew2(1);
+    if(argc > 0){
+      const char *kbuf;
+      int ksiz;
+      kbuf = tclistval(args, 0, &ksiz);
+      tcmdbiterinit2(mdb, kbuf, ksiz);
+    } else {
+      tcmdbiterinit(mdb);
+    }
+  } else if(!strcmp(name, "iternext")){
+    rv = tclistnew2(1);
+    int ksiz;
+    char *kbuf = tcmdbiternext(mdb, &ksiz);
+    if(kbuf){
+      tclistpush(rv, kbuf, ksiz);
+      int vsiz;
+      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
+      if(vbuf){
+        tclistpush(rv, vbuf, vsiz);
+        free(vbuf);
+      }
+      free(kbuf);
+    } else {
+      tclistdel(rv);
+      rv = NULL;
+    }
+  } else if(!strcmp(name, "vanish")){
+    rv = tclistnew2(1);
+    tcmdbvanish(mdb);
+  } else if(!strcmp(name, "regex")){
+    if(argc > 0){
+      const char *regex = tclistval0(args, 0);
+      int options = REG_EXTENDED | REG_NOSUB;
+      if(*regex == '*'){
+        options |= REG_ICASE;
+        regex++;
+      }
+      regex_t rbuf;
+      if(regcomp(&rbuf, regex, options) == 0){
+        rv = tclistnew();
+        int max = argc > 1 ? tcatoi(tclistval0(args, 1)) : 0;
+        if(max < 1) max = INT_MAX;
+        tcmdbiterinit(mdb);
+        char *kbuf;
+        int ksiz;
+        while(max > 0 && (kbuf = tcmdbiternext(mdb, &ksiz))){
+          if(regexec(&rbuf, kbuf, 0, NULL, 0) == 0){
+            int vsiz;
+            char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
+            if(vbuf){
+              tclistpush(rv, kbuf, ksiz);
+              tclistpush(rv, vbuf, vsiz);
+              free(vbuf);
+              max--;
+            }
+          }
+          free(kbuf);
+        }
+        regfree(&rbuf);
+      } else {
+        rv = NULL;
+      }
+    } else {
+      rv = NULL;
+    }
+  } else if(!strcmp(name, "sync")){
+    rv = tclistnew2(1);
+    if(!tcmdbsync(mdb)){
+      tclistdel(rv);
+      rv = NULL;
+    }
+  } else if(!strcmp(name, "stripe")){
+    if(argc > 0){
+      rv = tclistnew2(1);
+      bool err = false;
+      for(int i = 0; i < argc; i++){
+        const char *kbuf;
+        int ksiz;
+        kbuf = tclistval(args, i, &ksiz);
+        if(!tcmdbstripe(mdb, kbuf, ksiz)) err = true;
+      }
+      if(err){
+        tclistdel(rv);
+        rv = NULL;
+      }
+    } else {
+      rv = NULL;
+    }
+  } else {
+    rv = NULL;
+  }
+  return rv;
+}
+
+
+/* Get the hash value of a key of an on-memory hash database object. */
+uint64_t tcmdbhash(const void *kbuf, int ksiz){
+  assert(kbuf && ksiz >= 0);
+  if(ksiz > TCMAPKMAXSIZ) ksiz = TCMAPKMAXSIZ;
+  return tchash64(kbuf, ksiz);
+}
+
+
+/* Create an on-memory hash database object. */
+TCMDB *tcmdbnew(void){
+  return tcmdbnew2(TCMDBDEFBNUM);
+}
+
+
+/* Create an on-memory hash database with specifying the number of the buckets. */
+TCMDB *tcmdbnew2(uint32_t bnum){
+  return tcmdbnew3(bnum, 0, 0);
+}
+
+
+/* Create an on-memory hash database object with specifying tuning parameters. */
+TCMDB *tcmdbnew3(uint32_t bnum, uint32_t mnum, uint8_t opts){
+  TCMDB *mdb;
+  if(bnum < 1) bnum = TCMDBDEFBNUM;
+  if(mnum < 1) mnum = TCMDBDEFMNUM;
+  if(mnum > TCMDBMAXMNUM) mnum = TCMDBMAXMNUM;
+  if(opts & MDBTCOMPACT) opts |= MDBTFLAT;
+  uint32_t pnum = 1;
+  while(pnum < mnum){
+    pnum <<= 1;
+  }
+  mnum = pnum;
+  bnum = bnum / mnum + 17;
+  TCMALLOC(mdb, sizeof(*mdb));
+  void *shards;
+  if(posix_memalign(&shards, __alignof__(*mdb->shards), sizeof(*mdb->shards) * mnum) != 0)
+    tcmyfatal("out of memory");
+  mdb->shards = shards;
+  TCMALLOC(mdb->imtx, sizeof(pthread_mutex_t));
+  if(pthread_mutex_init(mdb->imtx, NULL) != 0) tcmyfatal("mutex error");
+  for(int i = 0; i < mnum; i++){
+    TCMDBSHARD *shard = mdb->shards + i;
+    if(pthread_rwlock_init(&shard->mtx, NULL) != 0) tcmyfatal("rwlock error");
+    shard->map = NULL;
+    shard->fmap = NULL;
+    shard->seq = 0;
+    shard->refs = NULL;
+    shard->rfnum = 0;
+    shard->hand = 0;
+    shard->evnum = 0;
+    shard->xmap = NULL;
+    shard->wheel = NULL;
+    shard->exnum = 0;
+    shard->index = (opts & MDBTORDER) ? tcmdbidxnew() : NULL;
+    shard->reclaim = tcrclnew();
+    shard->slab = tcslabnew();
+    if(tcmpopts & TCMPLOCAL) ((TCSLAB *)shard->slab)->node = i % tcnumanodes();
+    if(opts & MDBTFLAT){
+      shard->fmap = tcfmapnewimpl(bnum, shard->slab);
+      shard->fmap->reclaim = shard->reclaim;
+      shard->fmap->compact = opts & MDBTCOMPACT;
+    } else {
+      shard->map = tcmapnewimpl(bnum, shard->slab);
+      shard->map->reclaim = shard->reclaim;
+    }
+  }
+  mdb->mnum = mnum;
+  mdb->iter = -1;
+  mdb->opts = opts;
+  mdb->capsiz = 0;
+  mdb->cmpsiz = 0;
+  mdb->cmpnum = 0;
+  mdb->cmpisiz = 0;
+  mdb->cmposiz = 0;
+  mdb->cmptime = 0;
+  mdb->dectime = 0;
+  uint64_t seed[3] = { (uintptr_t)mdb, getpid(), tctime() * 1000000 };
+  mdb->cntmagic = tchash64(seed, sizeof(seed));
+  *(unsigned char *)&mdb->cntmagic = 0;
+  mdb->cntuse = false;
+  mdb->stmagic = mdb->cntmagic;
+  *(unsigned char *)&mdb->stmagic = 1;
+  long cnum = sysconf(_SC_NPROCESSORS_CONF);
+  mdb->stnum = tclmin(tclmax(cnum, 1), TCMDBSTMAX);
+  mdb->stprefix = NULL;
+  mdb->stpsiz = 0;
+  mdb->hdb = NULL;
+  return mdb;
+}
+
+
+/* Delete an on-memory hash database object. */
+void tcmdbdel(TCMDB *mdb){
+  assert(mdb);
+  if(mdb->hdb) tchdbdel(mdb->hdb);
+  for(int i = mdb->mnum - 1; i >= 0; i--){
+    if(mdb->opts & MDBTFLAT){
+      tcfmapdel(mdb->shards[i].fmap);
+    } else {
+      tcmapdel(mdb->shards[i].map);
+    }
+    if(mdb->shards[i].xmap) tcfmapdel(mdb->shards[i].xmap);
+    tcmdbwheeldel(mdb->shards[i].wheel);
+    if(mdb->shards[i].index) tcmdbidxdel(mdb->shards[i].index);
+    tcrcldel(mdb->shards[i].reclaim);
+    tcslabdel(mdb->shards[i].slab);
+    free(mdb->shards[i].refs);
+    pthread_rwlock_destroy(&mdb->shards[i].mtx);
+  }
+  pthread_mutex_destroy(mdb->imtx);
+  free(mdb->imtx);
+  free(mdb->stprefix);
+  free(mdb->shards);
+  free(mdb);
+}
+
+
+/* Store the records of an on-memory hash database object in a file hash database. */
+bool tcmdbopen(TCMDB *mdb, const char *path, uint64_t bnum){
+  assert(mdb && path);
+  if(mdb->hdb) return false;
+  TCHDB *hdb = tchdbnew();
+  if(!tchdbopen(hdb, path, bnum)){
+    tchdbdel(hdb);
+    return false;
+  }
+  mdb->hdb = hdb;
+  return true;
+}
+
+
+/* Synchronize the database file of an on-memory hash database object with the device. */
+bool tcmdbsync(TCMDB *mdb){
+  assert(mdb);
+  return mdb->hdb ? tchdbsync(mdb->hdb) : true;
+}
+
+
+/* Store a record into an on-memory hash database. */
+void tcmdbput(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  tcmdbputhash(mdb, kbuf, ksiz, vbuf, vsiz, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Store a record into an on-memory hash database with a hash value. */
+void tcmdbputhash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                  uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  tcmdbputexphash(mdb, kbuf, ksiz, vbuf, vsiz, 0, hash);
+}
+
+/* Store a new record into an on-memory hash database. */
+bool tcmdbputkeep(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  return tcmdbputkeephash(mdb, kbuf, ksiz, vbuf, vsiz, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Store a new record into an on-memory hash database with a hash value. */
+bool tcmdbputkeephash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                      uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  return tcmdbputkeepexphash(mdb, kbuf, ksiz, vbuf, vsiz, 0, hash);
+}
+
+
+/* Concatenate a value at the end of the existing record in an on-memory hash database. */
+void tcmdbputcat(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  tcmdbputcathash(mdb, kbuf, ksiz, vbuf, vsiz, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Concatenate a value at the end of the existing record with a hash value. */
+void tcmdbputcathash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                     uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(mdb->hdb){
+    tchdbputcat(mdb->hdb, kbuf, ksiz, vbuf, vsiz, hash);
+    return;
+  }
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0) return;
+  tcmdbseqbegin(mdb->shards + mi);
+  tcmdbtouch(mdb->shards + mi, hash);
+  uint64_t rnum = TCMDBSHARDRNUM(mdb, mdb->shards + mi);
+  tcmdbxcut(mdb, mdb->shards + mi, kbuf, ksiz, hash);
+  if((mdb->cmpsiz < 1 && !__atomic_load_n(&mdb->cntuse, __ATOMIC_RELAXED)) ||
+     !tcmdbputcatcmp(mdb, mdb->shards + mi, kbuf, ksiz, vbuf, vsiz, hash)){
+    if(mdb->opts & MDBTFLAT){
+      tcfmapputcatimpl(mdb->shards[mi].fmap, kbuf, ksiz, vbuf, vsiz, hash);
+    } else {
+      tcmapputcatimpl(mdb->shards[mi].map, kbuf, ksiz, vbuf, vsiz, hash);
+    }
+  }
+  tcmdbidxsync(mdb, mdb->shards + mi, kbuf, ksiz, rnum);
+  if(mdb->capsiz > 0) tcmdbcutshard(mdb, mdb->shards + mi);
+  tcmdbseqend(mdb->shards + mi);
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+}
+
+
+/* Remove a record of an on-memory hash database. */
+bool tcmdbout(TCMDB *mdb, const void *kbuf, int ksiz){
+  assert(mdb && kbuf && ksiz >= 0);
+  return tcmdbouthash(mdb, kbuf, ksiz, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Remove a record of an on-memory hash database with a hash value. */
+bool tcmdbouthash(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0);
+  if(mdb->hdb) return tchdbout(mdb->hdb, kbuf, ksiz, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0) return false;
+  tcmdbseqbegin(mdb->shards + mi);
+  uint64_t rnum = TCMDBSHARDRNUM(mdb, mdb->shards + mi);
+  bool rv = (mdb->opts & MDBTFLAT) ? tcfmapoutimpl(mdb->shards[mi].fmap, kbuf, ksiz, hash) :
+    tcmapoutimpl(mdb->shards[mi].map, kbuf, ksiz, hash);
+  if(rv) tcmdbxset(mdb->shards + mi, kbuf, ksiz, hash, 0);
+  tcmdbidxsync(mdb, mdb->shards + mi, kbuf, ksiz, rnum);
+  tcmdbseqend(mdb->shards + mi);
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  return rv;
+}
+
+
+/* Retrieve a record in an on-memory hash database. */
+void *tcmdbget(TCMDB *mdb, const void *kbuf, int ksiz, int *sp){
+  assert(mdb && kbuf && ksiz >= 0 && sp);
+  return tcmdbgethash(mdb, kbuf, ksiz, sp, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Retrieve a record in an on-memory hash database with a hash value. */
+void *tcmdbgethash(TCMDB *mdb, const void *kbuf, int ksiz, int *sp, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && sp);
+  if(mdb->hdb) return tchdbget(mdb->hdb, kbuf, ksiz, sp, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  tcmdbtouch(mdb->shards + mi, hash);
+  TCRCLSLOT *slot = tcrclenter();
+  if(slot){
+    const char *vbuf;
+    int vsiz;
+    if(tcmdbgetopt(mdb, mdb->shards + mi, kbuf, ksiz, hash, &vbuf, &vsiz)){
+      char *rv = vbuf ? tcmdbvaldup(mdb, vbuf, vsiz, sp) : NULL;
+      tcrclleave(slot);
+      return rv;
+    }
+    tcrclleave(slot);
+  }
+  if(pthread_rwlock_rdlock(&mdb->shards[mi].mtx) != 0) return NULL;
+  int vsiz;
+  const char *vbuf = (mdb->opts & MDBTFLAT) ?
+    tcfmapgetimpl(mdb->shards[mi].fmap, kbuf, ksiz, &vsiz, hash) :
+    tcmapgetimpl(mdb->shards[mi].map, kbuf, ksiz, &vsiz, hash);
+  if(vbuf){
+    int64_t xtime = tcmdbshardxtime(mdb->shards + mi, kbuf, ksiz, hash);
+    if(xtime > 0 && xtime <= (int64_t)time(NULL)) vbuf = NULL;
+  }
+  char *rv = vbuf ? tcmdbvaldup(mdb, vbuf, vsiz, sp) : NULL;
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  return rv;
+}
+
+
+/* Get the size of the value of a record in an on-memory hash database object. */
+int tcmdbvsiz(TCMDB *mdb, const void *kbuf, int ksiz){
+  assert(mdb && kbuf && ksiz >= 0);
+  return tcmdbvsizhash(mdb, kbuf, ksiz, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Get the size of the value of a record in an on-memory hash database with a hash value. */
+int tcmdbvsizhash(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0);
+  if(mdb->hdb) return tchdbvsiz(mdb->hdb, kbuf, ksiz, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  TCRCLSLOT *slot = tcrclenter();
+  if(slot){
+    const char *vbuf;
+    int vsiz;
+    bool ok = tcmdbgetopt(mdb, mdb->shards + mi, kbuf, ksiz, hash, &vbuf, &vsiz);
+    if(ok && vbuf) vsiz = tcmdbvalsiz(mdb, vbuf, vsiz);
+    tcrclleave(slot);
+    if(ok) return vbuf ? vsiz : -1;
+  }
+  if(pthread_rwlock_rdlock(&mdb->shards[mi].mtx) != 0) return -1;
+  int vsiz;
+  const char *vbuf = (mdb->opts & MDBTFLAT) ?
+    tcfmapgetimpl(mdb->shards[mi].fmap, kbuf, ksiz, &vsiz, hash) :
+    tcmapgetimpl(mdb->shards[mi].map, kbuf, ksiz, &vsiz, hash);
+  if(vbuf){
+    int64_t xtime = tcmdbshardxtime(mdb->shards + mi, kbuf, ksiz, hash);
+    if(xtime > 0 && xtime <= (int64_t)time(NULL)) vbuf = NULL;
+  }
+  vsiz = vbuf ? tcmdbvalsiz(mdb, vbuf, vsiz) : -1;
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  return vsiz;
+}
+
+
+/* Visit the value of a record in an on-memory hash database object without copying it. */
+bool tcmdbvisit(TCMDB *mdb, const void *kbuf, int ksiz, TCVISITPROC proc, void *op){
+  assert(mdb && kbuf && ksiz >= 0 && proc);
+  return tcmdbvisithash(mdb, kbuf, ksiz, proc, op, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Visit the value of a record in an on-memory hash database object with a hash value. */
+bool tcmdbvisithash(TCMDB *mdb, const void *kbuf, int ksiz, TCVISITPROC proc, void *op,
+                    uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && proc);
+  return tcmdbvisitimpl(mdb, kbuf, ksiz, hash, proc, NULL, op);
+}
+
+
+/* Visit the value of a record in an on-memory hash database object as it is stored. */
+bool tcmdbvisitrawhash(TCMDB *mdb, const void *kbuf, int ksiz, TCVISITRAWPROC proc, void *op,
+                       uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && proc);
+  return tcmdbvisitimpl(mdb, kbuf, ksiz, hash, NULL, proc, op);
+}
+
+
+/* Initialize the iterator of an on-memory hash database. */
+void tcmdbiterinit(TCMDB *mdb){
+  assert(mdb);
+  if(mdb->hdb){
+    tchdbiterinit(mdb->hdb);
+    return;
+  }
+  if(pthread_mutex_lock(mdb->imtx) != 0) return;
+  for(int i = 0; i < mdb->mnum; i++){
+    if(mdb->opts & MDBTFLAT){
+      tcfmapiterinit(mdb->shards[i].fmap);
+    } else {
+      tcmapiterinit(mdb->shards[i].map);
+    }
+  }
+  mdb->iter = 0;
+  pthread_mutex_unlock(mdb->imtx);
+}
+
+
+/* Get the next key of the iterator of an on-memory hash database. */
+void *tcmdbiternext(TCMDB *mdb, int *sp){
+  assert(mdb && sp);
+  if(mdb->hdb) return tchdbiternext(mdb->hdb, sp);
+  if(pthread_mutex_lock(mdb->imtx) != 0) return NULL;
+  if(mdb->iter < 0 || mdb->iter >= mdb->mnum){
+    pthread_mutex_unlock(mdb->imtx);
+    return NULL;
+  }
+  int mi = mdb->iter;
+  if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0){
+    pthread_mutex_unlock(mdb->imtx);
+    return NULL;
+  }
+  int ksiz;
+  const char *kbuf;
+  while(!(kbuf = (mdb->opts & MDBTFLAT) ? tcfmapiternext(mdb->shards[mi].fmap, &ksiz) :
+          tcmapiternext(mdb->shards[mi].map, &ksiz)) && mi < mdb->mnum - 1){
+    pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+    mi = ++mdb->iter;
+    if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0){
+      pthread_mutex_unlock(mdb->imtx);
+      return NULL;
+    }
+  }
+  char *rv;
+  if(kbuf){
+    rv = tcmemdup(kbuf, ksiz);
+    *sp = ksiz;
+  } else {
+    rv = NULL;
+  }
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  pthread_mutex_unlock(mdb->imtx);
+  return rv;
+}
+
+
+/* Get forward matching keys in an on-memory hash database object. */
+TCLIST *tcmdbfwmkeys(TCMDB *mdb, const void *pbuf, int psiz, int max){
+  assert(mdb && pbuf && psiz >= 0);
+  if(mdb->hdb) return tchdbfwmkeys(mdb->hdb, pbuf, psiz, max);
+  if(mdb->opts & MDBTORDER){
+    unsigned char *ebuf = tcmemdup(pbuf, psiz);
+    int esiz = psiz;
+    while(esiz > 0 && ebuf[esiz-1] == 0xff){
+      esiz--;
+    }
+    if(esiz > 0) ebuf[esiz-1]++;
+    TCLIST *keys = tcmdbrange(mdb, pbuf, psiz, (esiz > 0) ? ebuf : NULL, esiz, max, false);
+    free(ebuf);
+    return keys;
+  }
+  TCLIST* keys = tclistnew();
+  if(pthread_mutex_lock(mdb->imtx) != 0) return keys;
+  if(max < 0) max = INT_MAX;
+  for(int i = 0; i < mdb->mnum && tclistnum(keys) < max; i++){
+    if(pthread_rwlock_wrlock(&mdb->shards[i].mtx) == 0){
+      const char *kbuf;
+      int ksiz;
+      if(mdb->opts & MDBTFLAT){
+        TCFMAP *map = mdb->shards[i].fmap;
+        uint64_t cur = map->cur;
+        tcfmapiterinit(map);
+        while(tclistnum(keys) < max && (kbuf = tcfmapiternext(map, &ksiz)) != NULL){
+          if(ksiz >= psiz && !memcmp(kbuf, pbuf, psiz)) tclistpush(keys, kbuf, ksiz);
+        }
+        map->cur = cur;
+      } else {
+        TCMAP *map = mdb->shards[i].map;
+        TCMAPREC *cur = map->cur;
+        tcmapiterinit(map);
+        while(tclistnum(keys) < max && (kbuf = tcmapiternext(map, &ksiz)) != NULL){
+          if(ksiz >= psiz && !memcmp(kbuf, pbuf, psiz)) tclistpush(keys, kbuf, ksiz);
+        }
+        map->cur = cur;
+      }
+      pthread_rwlock_unlock(&mdb->shards[i].mtx);
+    }
+  }
+  pthread_mutex_unlock(mdb->imtx);
+  return keys;
+}
+
+
+/* Get keys of ranged records in an on-memory hash database object. */
+TCLIST *tcmdbrange(TCMDB *mdb, const void *bkbuf, int bksiz, const void *ekbuf, int eksiz,
+                   int max, bool vals){
+  assert(mdb && (!bkbuf || bksiz >= 0) && (!ekbuf || eksiz >= 0));
+  if(mdb->hdb) return tchdbrange(mdb->hdb, bkbuf, bksiz, ekbuf, eksiz, max, vals);
+  if(max < 0) max = INT_MAX;
+  TCLIST **lists;
+  TCMALLOC(lists, sizeof(*lists) * mdb->mnum);
+  int *idxs = tccalloc(mdb->mnum, sizeof(*idxs));
+  for(int i = 0; i < mdb->mnum; i++){
+    lists[i] = tcmdbrangeshard(mdb, mdb->shards + i, bkbuf, bksiz, ekbuf, eksiz, max, vals);
+  }
+  int step = vals ? 2 : 1;
+  TCLIST *rv = tclistnew();
+  for(int num = 0; num < max; num++){
+    int mi = -1;
+    const char *mbuf = NULL;
+    int msiz = 0;
+    for(int i = 0; i < mdb->mnum; i++){
+      if(idxs[i] >= tclistnum(lists[i])) continue;
+      int ksiz;
+      const char *kbuf = tclistval(lists[i], idxs[i], &ksiz);
+      if(mi < 0 || tcmdbidxcmp(kbuf, ksiz, mbuf, msiz) < 0){
+        mi = i;
+        mbuf = kbuf;
+        msiz = ksiz;
+      }
+    }
+    if(mi < 0) break;
+    tclistpush(rv, mbuf, msiz);
+    if(vals){
+      int vsiz;
+      const char *vbuf = tclistval(lists[mi], idxs[mi] + 1, &vsiz);
+      tclistpush(rv, vbuf, vsiz);
+    }
+    idxs[mi] += step;
+  }
+  for(int i = 0; i < mdb->mnum; i++){
+    tclistdel(lists[i]);
+  }
+  free(idxs);
+  free(lists);
+  if(vals && (mdb->cmpsiz > 0 || __atomic_load_n(&mdb->cntuse, __ATOMIC_RELAXED)))
+    tcmdbunpacklist(mdb, rv);
+  return rv;
+}
+
+
+/* Scan records of an on-memory hash database object with a cursor. */
+TCLIST *tcmdbscan(TCMDB *mdb, uint64_t *cp, int max, bool vals){
+  assert(mdb && cp);
+  if(mdb->hdb) return tchdbscan(mdb->hdb, cp, max, vals);
+  if(max < 0) max = INT_MAX;
+  TCLIST *recs = tclistnew();
+  uint32_t mi = *cp >> 52;
+  uint32_t rhnum = (*cp >> 32) & TCMDBSCANRHMASK;
+  uint32_t pos = *cp;
+  int64_t vnum = (int64_t)max * TCMDBSCANSTEP;
+  int step = vals ? 2 : 1;
+  while(mi < mdb->mnum && tclistnum(recs) / step < max && vnum > 0){
+    if(tcmdbscanshard(mdb, mdb->shards + mi, &rhnum, &pos, max, &vnum, vals, recs)){
+      mi++;
+      rhnum = 0;
+      pos = 0;
+    }
+  }
+  *cp = (mi < mdb->mnum) ? ((uint64_t)mi << 52) | ((uint64_t)rhnum << 32) | pos : 0;
+  if(vals && (mdb->cmpsiz > 0 || __atomic_load_n(&mdb->cntuse, __ATOMIC_RELAXED)))
+    tcmdbunpacklist(mdb, recs);
+  return recs;
+}
+
+
+/* Write a snapshot of an on-memory hash database object into a file. */
+bool tcmdbdump(TCMDB *mdb, const char *path, const void *mbuf, int msiz){
+  assert(mdb && path && mbuf && msiz >= 0);
+  if(mdb->hdb) return false;
+  return tcmdbdumpimpl(mdb, path, mbuf, msiz, true);
+}
+
+
+/* Write a snapshot of an on-memory hash database object into a file by a child process. */
+pid_t tcmdbdumpbg(TCMDB *mdb, const char *path, const void *mbuf, int msiz){
+  assert(mdb && path && mbuf && msiz >= 0);
+  if(mdb->hdb) return -1;
+  for(int i = 0; i < mdb->mnum; i++){
+    if(pthread_rwlock_rdlock(&mdb->shards[i].mtx) != 0){
+      for(i--; i >= 0; i--){
+        pthread_rwlock_unlock(&mdb->shards[i].mtx);
+      }
+      return -1;
+    }
+  }
+  pid_t pid = fork();
+  if(pid == 0) _exit(tcmdbdumpimpl(mdb, path, mbuf, msiz, false) ? 0 : 1);
+  for(int i = mdb->mnum - 1; i >= 0; i--){
+    pthread_rwlock_unlock(&mdb->shards[i].mtx);
+  }
+  return pid;
+}
+
+
+/* Load records of a snapshot file into an on-memory hash database object. */
+char *tcmdbload(TCMDB *mdb, const char *path, int *sp){
+  assert(mdb && path && sp);
+  int fd = open(path, O_RDONLY, 00644);
+  if(fd == -1) return NULL;
+  struct stat sbuf;
+  if(fstat(fd, &sbuf) == -1 || sbuf.st_size < TCMDBSNAPHSIZ){
+    close(fd);
+    return NULL;
+  }
+  uint64_t fsiz = sbuf.st_size;
+  char *ptr = mmap(0, fsiz, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(ptr == MAP_FAILED) return NULL;
+  madvise(ptr, fsiz, MADV_WILLNEED);
+  uint32_t snum, msiz;
+  memcpy(&snum, ptr + sizeof(TCMDBSNAPMAGIC) - 1, sizeof(snum));
+  snum = TCITOHL(snum);
+  memcpy(&msiz, ptr + sizeof(TCMDBSNAPMAGIC) - 1 + sizeof(snum), sizeof(msiz));
+  msiz = TCITOHL(msiz);
+  uint64_t hsiz = TCMDBSNAPHSIZ + msiz;
+  hsiz += TCALIGNPAD(hsiz);
+  uint64_t dsiz = (uint64_t)snum * sizeof(uint64_t) * 3;
+  if(memcmp(ptr, TCMDBSNAPMAGIC, sizeof(TCMDBSNAPMAGIC) - 1) || snum > TCMDBMAXMNUM ||
+     hsiz + dsiz > fsiz){
+    munmap(ptr, fsiz);
+    return NULL;
+  }
+  const uint64_t *dir = (uint64_t *)(ptr + hsiz);
+  bool err = false;
+  for(int i = 0; i < snum; i++){
+    uint64_t off = TCITOHLL(dir[i*3]);
+    uint64_t size = TCITOHLL(dir[i*3+1]);
+    if(off < hsiz + dsiz || off > fsiz || size > fsiz - off) err = true;
+  }
+  int thnum = err ? 0 : tclmin(snum, TCMDBSNAPTHMAX);
+  TCMDBSNAPLD *args = tcmalloc(sizeof(*args) * tclmax(thnum, 1));
+  pthread_t *ths = tcmalloc(sizeof(*ths) * tclmax(thnum, 1));
+  for(int i = 0; i < thnum; i++){
+    args[i].mdb = mdb;
+    args[i].ptr = ptr;
+    args[i].dir = dir;
+    args[i].snum = snum;
+    args[i].id = i;
+    args[i].step = thnum;
+    args[i].err = false;
+    if(pthread_create(ths + i, NULL, tcmdbloadproc, args + i) != 0){
+      tcmdbloadproc(args + i);
+      args[i].step = 0;
+    }
+  }
+  for(int i = 0; i < thnum; i++){
+    if(args[i].step > 0 && pthread_join(ths[i], NULL) != 0) args[i].err = true;
+  }
+  for(int i = 0; i < thnum; i++){
+    if(args[i].err) err = true;
+  }
+  free(ths);
+  free(args);
+  char *rv = err ? NULL : tcmemdup(ptr + TCMDBSNAPHSIZ, msiz);
+  if(rv) *sp = msiz;
+  munmap(ptr, fsiz);
+  return rv;
+}
+
+
+/* Get the number of records stored in an on-memory hash database. */
+uint64_t tcmdbrnum(TCMDB *mdb){
+  assert(mdb);
+  if(mdb->hdb) return tchdbrnum(mdb->hdb);
+  uint64_t rnum = 0;
+  for(int i = 0; i < mdb->mnum; i++){
+    rnum += (mdb->opts & MDBTFLAT) ? tcfmaprnum(mdb->shards[i].fmap) :
+      tcmaprnum(mdb->shards[i].map);
+  }
+  return rnum;
+}
+
+
+/* Get the total size of memory used in an on-memory hash database object. */
+uint64_t tcmdbmsiz(TCMDB *mdb){
+  assert(mdb);
+  if(mdb->hdb) return tchdbfsiz(mdb->hdb, NULL);
+  uint64_t msiz = 0;
+  for(int i = 0; i < mdb->mnum; i++){
+    msiz += (mdb->opts & MDBTFLAT) ? tcfmapmsiz(mdb->shards[i].fmap) :
+      tcmapmsiz(mdb->shards[i].map);
+  }
+  return msiz;
+}
+
+
+/* Get the number of the buckets of an on-memory hash database object. */
+uint64_t tcmdbbnum(TCMDB *mdb, uint64_t *obnp, uint64_t *rbnp){
+  assert(mdb);
+  if(mdb->hdb){
+    if(obnp) *obnp = 0;
+    if(rbnp) *rbnp = 0;
+    return ((TCHDB *)mdb->hdb)->bnum;
+  }
+  uint64_t bnum = 0;
+  uint64_t obnum = 0;
+  uint64_t rbnum = 0;
+  for(int i = 0; i < mdb->mnum; i++){
+    if(pthread_rwlock_rdlock(&mdb->shards[i].mtx) != 0) continue;
+    if(mdb->opts & MDBTFLAT){
+      TCFMAP *map = mdb->shards[i].fmap;
+      bnum += map->snum;
+      if(map->octrls){
+        obnum += map->osnum;
+        rbnum += (uint64_t)map->ridx * TCFMAPGRPSIZ;
+      }
+    } else {
+      TCMAP *map = mdb->shards[i].map;
+      bnum += map->bnum;
+      if(map->obuckets){
+        obnum += map->obnum;
+        rbnum += map->ridx;
+      }
+    }
+    pthread_rwlock_unlock(&mdb->shards[i].mtx);
+  }
+  if(obnp) *obnp = obnum;
+  if(rbnp) *rbnp = rbnum;
+  return bnum;
+}
+
+
+/* Get the memory usage of the slab allocators of an on-memory hash database object. */
+uint64_t tcmdbslab(TCMDB *mdb, uint64_t *usp, uint64_t *pnp){
+  assert(mdb);
+  uint64_t msiz = 0;
+  uint64_t usiz = 0;
+  uint64_t pnum = 0;
+  for(int i = 0; i < mdb->mnum; i++){
+    if(pthread_rwlock_rdlock(&mdb->shards[i].mtx) != 0) continue;
+    TCSLAB *slab = mdb->shards[i].slab;
+    msiz += slab->msiz;
+    usiz += slab->usiz;
+    pnum += slab->pnum;
+    pthread_rwlock_unlock(&mdb->shards[i].mtx);
+  }
+  if(usp) *usp = usiz;
+  if(pnp) *pnp = pnum;
+  return msiz;
+}
+
+
+/* Get the size of the index of an on-memory hash database object. */
+uint64_t tcmdbisiz(TCMDB *mdb){
+  assert(mdb);
+  if(mdb->hdb) return ((TCHDB *)mdb->hdb)->bnum * sizeof(uint64_t);
+  uint64_t isiz = 0;
+  for(int i = 0; i < mdb->mnum; i++){
+    if(pthread_rwlock_rdlock(&mdb->shards[i].mtx) != 0) continue;
+    if(mdb->opts & MDBTFLAT){
+      TCFMAP *map = mdb->shards[i].fmap;
+      isiz += ((uint64_t)map->snum + map->osnum) * (sizeof(map->slots[0]) + 1);
+    } else {
+      TCMAP *map = mdb->shards[i].map;
+      isiz += ((uint64_t)map->bnum + (map->obuckets ? map->obnum : 0)) * sizeof(map->buckets[0]);
+    }
+    if(mdb->shards[i].index) isiz += ((TCMDBIDX *)mdb->shards[i].index)->msiz;
+    pthread_rwlock_unlock(&mdb->shards[i].mtx);
+  }
+  return isiz;
+}
+
+
+/* Set the capacity size of an on-memory hash database object. */
+void tcmdbsetcapsiz(TCMDB *mdb, uint64_t capsiz){
+  assert(mdb);
+  uint64_t rfnum = TCMDBREFMIN;
+  while(rfnum < TCMDBREFMAX && rfnum * TCMDBREFUNIT < capsiz / mdb->mnum){
+    rfnum <<= 1;
+  }
+  mdb->capsiz = capsiz;
+  if(capsiz < 1) return;
+  for(int i = 0; i < mdb->mnum; i++){
+    TCMDBSHARD *shard = mdb->shards + i;
+    if(pthread_rwlock_wrlock(&shard->mtx) != 0) continue;
+    if(!shard->refs){
+      shard->refs = tccalloc(rfnum / 64, sizeof(*shard->refs));
+      shard->rfnum = rfnum;
+    }
+    tcmdbseqbegin(shard);
+    tcmdbcutshard(mdb, shard);
+    tcmdbseqend(shard);
+    pthread_rwlock_unlock(&shard->mtx);
+  }
+}
+
+
+/* Get the number of evicted records of an on-memory hash database object. */
+uint64_t tcmdbevnum(TCMDB *mdb){
+  assert(mdb);
+  uint64_t evnum = 0;
+  for(int i = 0; i < mdb->mnum; i++){
+    if(pthread_rwlock_rdlock(&mdb->shards[i].mtx) != 0) continue;
+    evnum += mdb->shards[i].evnum;
+    pthread_rwlock_unlock(&mdb->shards[i].mtx);
+  }
+  return evnum;
+}
+
+
+/* Set the minimum size of values to be compressed in an on-memory hash database object. */
+void tcmdbsetcmpsiz(TCMDB *mdb, int cmpsiz){
+  assert(mdb && cmpsiz >= 0);
+  mdb->cmpsiz = (cmpsiz > 0 && cmpsiz < TCMDBCMPMIN) ? TCMDBCMPMIN : cmpsiz;
+}
+
+
+/* Set the prefix of keys of striped counters of an on-memory hash database object. */
+void tcmdbsetstripe(TCMDB *mdb, const char *prefix){
+  assert(mdb);
+  free(mdb->stprefix);
+  mdb->stprefix = (prefix && *prefix != '\0') ? tcstrdup(prefix) : NULL;
+  mdb->stpsiz = mdb->stprefix ? strlen(mdb->stprefix) : 0;
+}
+
+
+/* Convert a record of an on-memory hash database object into a striped counter. */
+bool tcmdbstripe(TCMDB *mdb, const void *kbuf, int ksiz){
+  assert(mdb && kbuf && ksiz >= 0);
+  if(mdb->hdb) return false;
+  uint64_t hash = tcmdbhash(kbuf, ksiz);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  TCMDBSHARD *shard = mdb->shards + mi;
+  if(pthread_rwlock_wrlock(&shard->mtx) != 0) return false;
+  tcmdbseqbegin(shard);
+  tcmdbtouch(shard, hash);
+  uint64_t rnum = TCMDBSHARDRNUM(mdb, shard);
+  tcmdbxcut(mdb, shard, kbuf, ksiz, hash);
+  int vsiz;
+  char *vbuf = tcmdbcellget(mdb, shard, kbuf, ksiz, hash, &vsiz);
+  bool err = false;
+  if(!vbuf){
+    tcmdbstput(mdb, shard, kbuf, ksiz, 0, hash);
+  } else if(vsiz == sizeof(int)){
+    int num;
+    memcpy(&num, vbuf, sizeof(num));
+    tcmdbstput(mdb, shard, kbuf, ksiz, num, hash);
+  } else if(!tcmdbstcheck(mdb, vbuf, vsiz)){
+    err = true;
+  }
+  tcmdbidxsync(mdb, shard, kbuf, ksiz, rnum);
+  if(mdb->capsiz > 0) tcmdbcutshard(mdb, shard);
+  tcmdbseqend(shard);
+  pthread_rwlock_unlock(&shard->mtx);
+  return !err;
+}
+
+
+/* Get the statistics of compression of an on-memory hash database object. */
+uint64_t tcmdbcmpstat(TCMDB *mdb, uint64_t *isp, uint64_t *osp, double *ctp, double *dtp){
+  assert(mdb && isp && osp && ctp && dtp);
+  *isp = __atomic_load_n(&mdb->cmpisiz, __ATOMIC_RELAXED);
+  *osp = __atomic_load_n(&mdb->cmposiz, __ATOMIC_RELAXED);
+  *ctp = __atomic_load_n(&mdb->cmptime, __ATOMIC_RELAXED) / 1000000000.0;
+  *dtp = __atomic_load_n(&mdb->dectime, __ATOMIC_RELAXED) / 1000000000.0;
+  return __atomic_load_n(&mdb->cmpnum, __ATOMIC_RELAXED);
+}
+
+
+/* Store a record with an expiration time into an on-memory hash database object. */
+void tcmdbputexp(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                 int64_t xtime){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  tcmdbputexphash(mdb, kbuf, ksiz, vbuf, vsiz, xtime, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Store a record with an expiration time into an on-memory hash database with a hash value. */
+void tcmdbputexphash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                     int64_t xtime, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(mdb->hdb){
+    tchdbput(mdb->hdb, kbuf, ksiz, vbuf, vsiz, xtime, hash);
+    return;
+  }
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  char *zbuf = NULL;
+  if(mdb->cmpsiz > 0){
+    int zsiz;
+    zbuf = tcmdbcmppack(mdb, vbuf, vsiz, &zsiz);
+    if(zbuf){
+      vbuf = zbuf;
+      vsiz = zsiz;
+    }
+  }
+  if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0){
+    free(zbuf);
+    return;
+  }
+  tcmdbseqbegin(mdb->shards + mi);
+  tcmdbtouch(mdb->shards + mi, hash);
+  uint64_t rnum = TCMDBSHARDRNUM(mdb, mdb->shards + mi);
+  if(mdb->opts & MDBTFLAT){
+    tcfmapputimpl(mdb->shards[mi].fmap, kbuf, ksiz, vbuf, vsiz, hash);
+  } else {
+    tcmapputimpl(mdb->shards[mi].map, kbuf, ksiz, vbuf, vsiz, hash);
+  }
+  tcmdbxset(mdb->shards + mi, kbuf, ksiz, hash, xtime);
+  tcmdbidxsync(mdb, mdb->shards + mi, kbuf, ksiz, rnum);
+  if(mdb->capsiz > 0) tcmdbcutshard(mdb, mdb->shards + mi);
+  tcmdbseqend(mdb->shards + mi);
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  free(zbuf);
+}
+
+
+/* Store a new record with an expiration time into an on-memory hash database object. */
+bool tcmdbputkeepexp(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                     int64_t xtime){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  return tcmdbputkeepexphash(mdb, kbuf, ksiz, vbuf, vsiz, xtime, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Store a new record with an expiration time into an on-memory hash database with a hash
+   value. */
+bool tcmdbputkeepexphash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                         int64_t xtime, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  if(mdb->hdb) return tchdbputkeep(mdb->hdb, kbuf, ksiz, vbuf, vsiz, xtime, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  char *zbuf = NULL;
+  if(mdb->cmpsiz > 0){
+    int zsiz;
+    zbuf = tcmdbcmppack(mdb, vbuf, vsiz, &zsiz);
+    if(zbuf){
+      vbuf = zbuf;
+      vsiz = zsiz;
+    }
+  }
+  if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0){
+    free(zbuf);
+    return false;
+  }
+  tcmdbseqbegin(mdb->shards + mi);
+  tcmdbtouch(mdb->shards + mi, hash);
+  uint64_t rnum = TCMDBSHARDRNUM(mdb, mdb->shards + mi);
+  tcmdbxcut(mdb, mdb->shards + mi, kbuf, ksiz, hash);
+  bool rv = (mdb->opts & MDBTFLAT) ?
+    tcfmapputkeepimpl(mdb->shards[mi].fmap, kbuf, ksiz, vbuf, vsiz, hash) :
+    tcmapputkeepimpl(mdb->shards[mi].map, kbuf, ksiz, vbuf, vsiz, hash);
+  if(rv && xtime > 0) tcmdbxset(mdb->shards + mi, kbuf, ksiz, hash, xtime);
+  tcmdbidxsync(mdb, mdb->shards + mi, kbuf, ksiz, rnum);
+  if(mdb->capsiz > 0) tcmdbcutshard(mdb, mdb->shards + mi);
+  tcmdbseqend(mdb->shards + mi);
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  free(zbuf);
+  return rv;
+}
+
+
+/* Get the keys of expired records of an on-memory hash database object. */
+TCLIST *tcmdbxkeys(TCMDB *mdb, int64_t now, int max){
+  assert(mdb && max >= 0);
+  if(mdb->hdb) return tchdbxkeys(mdb->hdb, now, max);
+  TCLIST *keys = tclistnew();
+  for(int i = 0; i < mdb->mnum && tclistnum(keys) < max; i++){
+    TCMDBSHARD *shard = mdb->shards + (i + now) % mdb->mnum;
+    if(!__atomic_load_n(&shard->xmap, __ATOMIC_ACQUIRE)) continue;
+    if(pthread_rwlock_wrlock(&shard->mtx) != 0) continue;
+    if(shard->wheel) tcmdbwheelstep(shard->wheel, now, keys, max);
+    pthread_rwlock_unlock(&shard->mtx);
+  }
+  return keys;
+}
+
+
+/* Remove an expired record of an on-memory hash database object. */
+bool tcmdbxout(TCMDB *mdb, const void *kbuf, int ksiz, int64_t now){
+  assert(mdb && kbuf && ksiz >= 0);
+  return tcmdbxouthash(mdb, kbuf, ksiz, now, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Remove an expired record of an on-memory hash database object with a hash value. */
+bool tcmdbxouthash(TCMDB *mdb, const void *kbuf, int ksiz, int64_t now, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0);
+  if(mdb->hdb) return tchdbxout(mdb->hdb, kbuf, ksiz, now, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  TCMDBSHARD *shard = mdb->shards + mi;
+  if(pthread_rwlock_wrlock(&shard->mtx) != 0) return false;
+  int64_t xtime = tcmdbshardxtime(shard, kbuf, ksiz, hash);
+  bool rv = false;
+  if(xtime > 0 && xtime <= now){
+    tcmdbseqbegin(shard);
+    uint64_t rnum = TCMDBSHARDRNUM(mdb, shard);
+    if(mdb->opts & MDBTFLAT){
+      tcfmapoutimpl(shard->fmap, kbuf, ksiz, hash);
+    } else {
+      tcmapoutimpl(shard->map, kbuf, ksiz, hash);
+    }
+    tcmdbxset(shard, kbuf, ksiz, hash, 0);
+    tcmdbidxsync(mdb, shard, kbuf, ksiz, rnum);
+    shard->exnum++;
+    tcmdbseqend(shard);
+    rv = true;
+  }
+  pthread_rwlock_unlock(&shard->mtx);
+  return rv;
+}
+
+
+/* Get the expiration time of a record in an on-memory hash database object. */
+int64_t tcmdbxtime(TCMDB *mdb, const void *kbuf, int ksiz){
+  assert(mdb && kbuf && ksiz >= 0);
+  return tcmdbxtimehash(mdb, kbuf, ksiz, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Get the expiration time of a record in an on-memory hash database with a hash value. */
+int64_t tcmdbxtimehash(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0);
+  if(mdb->hdb) return tchdbxtime(mdb->hdb, kbuf, ksiz, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  if(pthread_rwlock_rdlock(&mdb->shards[mi].mtx) != 0) return 0;
+  int64_t xtime = tcmdbshardxtime(mdb->shards + mi, kbuf, ksiz, hash);
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  return xtime;
+}
+
+
+/* Get the number of records with expiration times of an on-memory hash database object. */
+uint64_t tcmdbxnum(TCMDB *mdb, uint64_t *exnp){
+  assert(mdb);
+  if(mdb->hdb){
+    if(exnp) *exnp = 0;
+    return tchdbxnum(mdb->hdb);
+  }
+  uint64_t xnum = 0;
+  uint64_t exnum = 0;
+  for(int i = 0; i < mdb->mnum; i++){
+    if(pthread_rwlock_rdlock(&mdb->shards[i].mtx) != 0) continue;
+    if(mdb->shards[i].xmap) xnum += mdb->shards[i].xmap->rnum;
+    exnum += mdb->shards[i].exnum;
+    pthread_rwlock_unlock(&mdb->shards[i].mtx);
+  }
+  if(exnp) *exnp = exnum;
+  return xnum;
+}
+
+
+/* Add an integer to a record in an on-memory hash database object. */
+int tcmdbaddint(TCMDB *mdb, const void *kbuf, int ksiz, int num){
+  assert(mdb && kbuf && ksiz >= 0);
+  return tcmdbaddinthash(mdb, kbuf, ksiz, num, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Add an integer to a record in an on-memory hash database with a hash value. */
+int tcmdbaddinthash(TCMDB *mdb, const void *kbuf, int ksiz, int num, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0);
+  if(mdb->hdb) return tchdbaddint(mdb->hdb, kbuf, ksiz, num, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  if(pthread_rwlock_rdlock(&mdb->shards[mi].mtx) != 0) return INT_MIN;
+  int vsiz;
+  char *vbuf = tcmdbcellget(mdb, mdb->shards + mi, kbuf, ksiz, hash, &vsiz);
+  if(vbuf && tcmdbstcheck(mdb, vbuf, vsiz)){
+    tcmdbtouch(mdb->shards + mi, hash);
+    int rv = tcmdbstadd(mdb, vbuf, num);
+    pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+    return rv;
+  }
+  if(vbuf && vsiz == sizeof(num) && (uintptr_t)vbuf % sizeof(num) == 0){
+    tcmdbtouch(mdb->shards + mi, hash);
+    int rv = __atomic_add_fetch((int *)vbuf, num, __ATOMIC_RELAXED);
+    pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+    return rv;
+  }
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0) return INT_MIN;
+  tcmdbseqbegin(mdb->shards + mi);
+  tcmdbtouch(mdb->shards + mi, hash);
+  uint64_t rnum = TCMDBSHARDRNUM(mdb, mdb->shards + mi);
+  tcmdbxcut(mdb, mdb->shards + mi, kbuf, ksiz, hash);
+  vbuf = tcmdbcellget(mdb, mdb->shards + mi, kbuf, ksiz, hash, &vsiz);
+  int rv;
+  if(vbuf && tcmdbstcheck(mdb, vbuf, vsiz)){
+    rv = tcmdbstadd(mdb, vbuf, num);
+  } else if(!vbuf && mdb->stprefix && ksiz >= mdb->stpsiz &&
+            !memcmp(kbuf, mdb->stprefix, mdb->stpsiz)){
+    tcmdbstput(mdb, mdb->shards + mi, kbuf, ksiz, num, hash);
+    rv = num;
+  } else {
+    rv = (mdb->opts & MDBTFLAT) ?
+      tcfmapaddintimpl(mdb->shards[mi].fmap, kbuf, ksiz, num, hash) :
+      tcmapaddintimpl(mdb->shards[mi].map, kbuf, ksiz, num, hash);
+  }
+  tcmdbidxsync(mdb, mdb->shards + mi, kbuf, ksiz, rnum);
+  if(mdb->capsiz > 0) tcmdbcutshard(mdb, mdb->shards + mi);
+  tcmdbseqend(mdb->shards + mi);
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  return rv;
+}
+
+
+/* Add a real number to a record in an on-memory hash database object. */
+double tcmdbadddouble(TCMDB *mdb, const void *kbuf, int ksiz, double num){
+  assert(mdb && kbuf && ksiz >= 0);
+  return tcmdbadddoublehash(mdb, kbuf, ksiz, num, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Add a real number to a record in an on-memory hash database with a hash value. */
+double tcmdbadddoublehash(TCMDB *mdb, const void *kbuf, int ksiz, double num, uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0);
+  if(mdb->hdb) return tchdbadddouble(mdb->hdb, kbuf, ksiz, num, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  if(pthread_rwlock_rdlock(&mdb->shards[mi].mtx) != 0) return nan("");
+  int vsiz;
+  char *vbuf = tcmdbcellget(mdb, mdb->shards + mi, kbuf, ksiz, hash, &vsiz);
+  if(vbuf && vsiz == sizeof(num) && (uintptr_t)vbuf % sizeof(num) == 0){
+    tcmdbtouch(mdb->shards + mi, hash);
+    uint64_t *cp = (uint64_t *)vbuf;
+    uint64_t onum = __atomic_load_n(cp, __ATOMIC_RELAXED);
+    uint64_t nnum;
+    double rv;
+    do {
+      memcpy(&rv, &onum, sizeof(rv));
+      rv += num;
+      memcpy(&nnum, &rv, sizeof(nnum));
+    } while(!__atomic_compare_exchange_n(cp, &onum, nnum, true, __ATOMIC_RELAXED,
+                                         __ATOMIC_RELAXED));
+    pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+    return rv;
+  }
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  if(pthread_rwlock_wrlock(&mdb->shards[mi].mtx) != 0) return nan("");
+  tcmdbseqbegin(mdb->shards + mi);
+  tcmdbtouch(mdb->shards + mi, hash);
+  uint64_t rnum = TCMDBSHARDRNUM(mdb, mdb->shards + mi);
+  tcmdbxcut(mdb, mdb->shards + mi, kbuf, ksiz, hash);
+  double rv = (mdb->opts & MDBTFLAT) ?
+    tcfmapadddoubleimpl(mdb->shards[mi].fmap, kbuf, ksiz, num, hash) :
+    tcmapadddoubleimpl(mdb->shards[mi].map, kbuf, ksiz, num, hash);
+  tcmdbidxsync(mdb, mdb->shards + mi, kbuf, ksiz, rnum);
+  if(mdb->capsiz > 0) tcmdbcutshard(mdb, mdb->shards + mi);
+  tcmdbseqend(mdb->shards + mi);
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  return rv;
+}
+
+
+/* Add an integer to a decimal counter of a record in an on-memory hash database object. */
+int tcmdbincr(TCMDB *mdb, const void *kbuf, int ksiz, int64_t num, uint64_t *np){
+  assert(mdb && kbuf && ksiz >= 0 && np);
+  return tcmdbincrhash(mdb, kbuf, ksiz, num, np, tcmdbhash(kbuf, ksiz));
+}
+
+
+/* Add an integer to a decimal counter of a record in an on-memory hash database with a hash
+   value. */
+int tcmdbincrhash(TCMDB *mdb, const void *kbuf, int ksiz, int64_t num, uint64_t *np,
+                  uint64_t hash){
+  assert(mdb && kbuf && ksiz >= 0 && np);
+  if(mdb->hdb) return tchdbincr(mdb->hdb, kbuf, ksiz, num, np, hash);
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  TCMDBSHARD *shard = mdb->shards + mi;
+  if(pthread_rwlock_rdlock(&shard->mtx) != 0) return -1;
+  int vsiz;
+  char *vbuf = tcmdbcellget(mdb, shard, kbuf, ksiz, hash, &vsiz);
+  if(!vbuf){
+    pthread_rwlock_unlock(&shard->mtx);
+    return 0;
+  }
+  if(tcmdbcntcheck(mdb, vbuf, vsiz) && (uintptr_t)vbuf % sizeof(uint64_t) == 0){
+    tcmdbtouch(shard, hash);
+    uint64_t *cp = (uint64_t *)(vbuf + sizeof(mdb->cntmagic));
+    uint64_t onum = __atomic_load_n(cp, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(cp, &onum, tcmdbcntadd(onum, num), true,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *np = tcmdbcntadd(onum, num);
+    pthread_rwlock_unlock(&shard->mtx);
+    return 1;
+  }
+  pthread_rwlock_unlock(&shard->mtx);
+  if(pthread_rwlock_wrlock(&shard->mtx) != 0) return -1;
+  tcmdbseqbegin(shard);
+  vbuf = tcmdbcellget(mdb, shard, kbuf, ksiz, hash, &vsiz);
+  if(vbuf){
+    tcmdbtouch(shard, hash);
+    if(tcmdbcntcheck(mdb, vbuf, vsiz)){
+      uint64_t onum;
+      memcpy(&onum, vbuf + sizeof(mdb->cntmagic), sizeof(onum));
+      *np = tcmdbcntadd(onum, num);
+    } else {
+      int rsiz;
+      char *rbuf = tcmdbvaldup(mdb, vbuf, vsiz, &rsiz);
+      int64_t inum = tcatoi(rbuf) + num;
+      *np = inum > 0 ? inum : 0;
+      free(rbuf);
+    }
+    char cbuf[TCMDBCNTSIZ];
+    memcpy(cbuf, &mdb->cntmagic, sizeof(mdb->cntmagic));
+    memcpy(cbuf + sizeof(mdb->cntmagic), np, sizeof(*np));
+    if(mdb->opts & MDBTFLAT){
+      tcfmapputimpl(shard->fmap, kbuf, ksiz, cbuf, sizeof(cbuf), hash);
+    } else {
+      tcmapputimpl(shard->map, kbuf, ksiz, cbuf, sizeof(cbuf), hash);
+    }
+    __atomic_store_n(&mdb->cntuse, true, __ATOMIC_RELAXED);
+    if(mdb->capsiz > 0) tcmdbcutshard(mdb, shard);
+  }
+  tcmdbseqend(shard);
+  pthread_rwlock_unlock(&shard->mtx);
+  return vbuf ? 1 : 0;
+}
+
+
+/* Clear an on-memory hash database object. */
+void tcmdbvanish(TCMDB *mdb){
+  assert(mdb);
+  if(mdb->hdb){
+    tchdbvanish(mdb->hdb);
+    return;
+  }
+  for(int i = 0; i < mdb->mnum; i++){
+    TCMDBSHARD *shard = mdb->shards + i;
+    if(pthread_rwlock_wrlock(&shard->mtx) == 0){
+      tcmdbseqbegin(shard);
+      TCMDBRLS *rls;
+      TCMALLOC(rls, sizeof(*rls));
+      rls->map = shard->map;
+      rls->fmap = shard->fmap;
+      rls->xmap = shard->xmap;
+      rls->wheel = shard->wheel;
+      rls->index = shard->index;
+      rls->reclaim = shard->reclaim;
+      rls->slab = shard->slab;
+      rls->pos = 0;
+      shard->reclaim = tcrclnew();
+      shard->slab = tcslabnew();
+      ((TCSLAB *)shard->slab)->node = rls->slab->node;
+      if(mdb->opts & MDBTFLAT){
+        TCFMAP *fmap = tcfmapnewimpl(rls->fmap->snum / 8 * 7, shard->slab);
+        fmap->reclaim = shard->reclaim;
+        fmap->compact = rls->fmap->compact;
+        shard->fmap = fmap;
+      } else {
+        TCMAP *map = tcmapnewimpl(rls->map->bnum, shard->slab);
+        map->reclaim = shard->reclaim;
+        shard->map = map;
+      }
+      __atomic_store_n(&shard->xmap, NULL, __ATOMIC_RELEASE);
+      shard->wheel = NULL;
+      if(rls->index) shard->index = tcmdbidxnew();
+      rls->epoch = tcrclstamp();
+      tcmdbrlsqueue(shard, rls);
+      tcmdbseqend(shard);
+      pthread_rwlock_unlock(&shard->mtx);
+    }
+  }
+}
+
+
+/* Initialize the iterator of an on-memory map database object in front of a key. */
+void tcmdbiterinit2(TCMDB *mdb, const void *kbuf, int ksiz){
+  if(mdb->hdb){
+    tchdbiterinit2(mdb->hdb, kbuf, ksiz, tcmdbhash(kbuf, ksiz));
+    return;
+  }
+  if(pthread_mutex_lock(mdb->imtx) != 0) return;
+  unsigned int mi;
+  uint64_t hash = tcmdbhash(kbuf, ksiz);
+  TCMDBHASH(mi, mdb, hash);
+  if(pthread_rwlock_rdlock(&mdb->shards[mi].mtx) != 0){
+    pthread_mutex_unlock(mdb->imtx);
+    return;
+  }
+  int vsiz;
+  if(mdb->opts & MDBTFLAT){
+    if(tcfmapgetimpl(mdb->shards[mi].fmap, kbuf, ksiz, &vsiz, hash)){
+      for(int i = 0; i < mdb->mnum; i++){
+        tcfmapiterinit(mdb->shards[i].fmap);
+      }
+      tcfmapiterinit2impl(mdb->shards[mi].fmap, kbuf, ksiz, hash);
+      mdb->iter = mi;
+    }
+  } else if(tcmapgetimpl(mdb->shards[mi].map, kbuf, ksiz, &vsiz, hash)){
+    for(int i = 0; i < mdb->mnum; i++){
+      tcmapiterinit(mdb->shards[i].map);
+    }
+    tcmapiterinit2impl(mdb->shards[mi].map, kbuf, ksiz, hash);
+    mdb->iter = mi;
+  }
+  pthread_rwlock_unlock(&mdb->shards[mi].mtx);
+  pthread_mutex_unlock(mdb->imtx);
+}
+
+
+/* Begin an update of a shard of an on-memory hash database object.
+   `shard' specifies the shard locked for writing. */
+static void tcmdbseqbegin(TCMDBSHARD *shard){
+  assert(shard);
+  __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+/* End an update of a shard of an on-memory hash database object.
+   `shard' specifies the shard locked for writing. */
+static void tcmdbseqend(TCMDBSHARD *shard){
+  assert(shard);
+  __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELEASE);
+}
+
+
+/* Retrieve a record in a shard of an on-memory hash database object without locking.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   `vp' specifies the pointer to the variable into which the pointer to the region of the value
+   or `NULL' is assigned.
+   `sp' specifies the pointer to the variable into which the size of the value is assigned.
+   The return value is true if successful, or false if updates kept interfering.
+   The caller must have entered a reading section of the reclaimer.  Because records are never
+   modified in place, the region of the value is stable until the section is left.  An expired
+   record is treated as missing; the expiration table is looked up under the same sequence
+   number only if the shard has any record with an expiration time. */
+static bool tcmdbgetopt(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash,
+                        const char **vp, int *sp){
+  assert(mdb && shard && kbuf && ksiz >= 0 && vp && sp);
+  for(int i = 0; i < TCMDBOPTTRY; i++){
+    uint32_t seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+    if(seq & 1) continue;
+    if(!((mdb->opts & MDBTFLAT) ?
+         tcfmapgetopt(shard->fmap, kbuf, ksiz, hash, &shard->seq, seq, vp, sp) :
+         tcmapgetopt(shard->map, kbuf, ksiz, hash, &shard->seq, seq, vp, sp))) continue;
+    const TCFMAP *xmap = __atomic_load_n(&shard->xmap, __ATOMIC_ACQUIRE);
+    if(!*vp || !xmap || xmap->rnum < 1) return true;
+    const char *xbuf;
+    int xsiz;
+    if(!tcfmapgetopt(xmap, kbuf, ksiz, hash, &shard->seq, seq, &xbuf, &xsiz)) continue;
+    if(xbuf){
+      TCMDBXVAL xval;
+      memcpy(&xval, xbuf, sizeof(xval));
+      if(xval.xtime <= (int64_t)time(NULL)) *vp = NULL;
+    }
+    return true;
+  }
+  return false;
+}
+
+
+/* Set the reference bit of a key in a shard of an on-memory hash database object.
+   `shard' specifies the shard.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The bit is set without locking.  Keys sharing a bit are spared together. */
+static void tcmdbtouch(TCMDBSHARD *shard, uint64_t hash){
+  assert(shard);
+  if(!shard->refs) return;
+  uint64_t bidx = hash & (shard->rfnum - 1);
+  uint64_t *wp = shard->refs + bidx / 64;
+  uint64_t bit = 1ULL << (bidx % 64);
+  if(!(__atomic_load_n(wp, __ATOMIC_RELAXED) & bit)) __atomic_fetch_or(wp, bit, __ATOMIC_RELAXED);
+}
+
+
+/* Clear the reference bit of a key in a shard of an on-memory hash database object.
+   `shard' specifies the shard locked for writing.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is true if the bit was set, else, it is false. */
+static bool tcmdbuntouch(TCMDBSHARD *shard, uint64_t hash){
+  assert(shard && shard->refs);
+  uint64_t bidx = hash & (shard->rfnum - 1);
+  uint64_t *wp = shard->refs + bidx / 64;
+  uint64_t bit = 1ULL << (bidx % 64);
+  if(!(__atomic_load_n(wp, __ATOMIC_RELAXED) & bit)) return false;
+  __atomic_fetch_and(wp, ~bit, __ATOMIC_RELAXED);
+  return true;
+}
+
+
+/* Evict records of a shard of an on-memory hash database object exceeding the capacity.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard locked for writing and being updated.
+   A record whose reference bit is set is spared once.  After sparing as many records as the
+   shard has, records are evicted regardless of the bits so that readers touching records
+   concurrently cannot stall the eviction. */
+static void tcmdbcutshard(TCMDB *mdb, TCMDBSHARD *shard){
+  assert(mdb && shard && shard->refs);
+  uint64_t capsiz = mdb->capsiz / mdb->mnum;
+  uint64_t spnum = 0;
+  if(mdb->opts & MDBTFLAT){
+    TCFMAP *map = shard->fmap;
+    while(map->rnum > 0 && tcfmapmsiz(map) > capsiz){
+      uint64_t osnum = map->octrls ? map->osnum : 0;
+      if(shard->hand >= osnum + map->snum) shard->hand = 0;
+      uint64_t sidx = shard->hand++;
+      const uint8_t *ctrls = map->ctrls;
+      TCFMAPREC **slots = map->slots;
+      if(sidx < osnum){
+        ctrls = map->octrls;
+        slots = map->oslots;
+      } else {
+        sidx -= osnum;
+      }
+      if(ctrls[sidx] & TCFMAPEMPTY) continue;
+      const char *vbuf;
+      int ksiz, vsiz;
+      const char *kbuf = tcfmaprecbody(map->compact, slots[sidx], &ksiz, &vbuf, &vsiz);
+      uint64_t hash = tcmdbhash(kbuf, ksiz);
+      if(spnum < map->rnum && tcmdbuntouch(shard, hash)){
+        spnum++;
+        continue;
+      }
+      tcmdbxset(shard, kbuf, ksiz, hash, 0);
+      if(shard->index) tcmdbidxout(shard->index, kbuf, ksiz);
+      tcfmapoutimpl(map, kbuf, ksiz, hash);
+      shard->evnum++;
+    }
+  } else {
+    TCMAP *map = shard->map;
+    while(map->first && tcmapmsiz(map) > capsiz){
+      TCMAPREC *rec = map->first;
+      const char *kbuf = (char *)rec + sizeof(*rec);
+      int ksiz = rec->ksiz & TCMAPKMAXSIZ;
+      uint64_t hash = tcmdbhash(kbuf, ksiz);
+      if(spnum < map->rnum && tcmdbuntouch(shard, hash)){
+        tcmapmovelast(map, rec);
+        spnum++;
+        continue;
+      }
+      tcmdbxset(shard, kbuf, ksiz, hash, 0);
+      if(shard->index) tcmdbidxout(shard->index, kbuf, ksiz);
+      tcmapoutimpl(map, kbuf, ksiz, hash);
+      shard->evnum++;
+    }
+  }
+}
+
+
+/* Get the expiration time of a record in a shard of an on-memory hash database object.
+   `shard' specifies the shard locked for reading or writing.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is the expiration time or 0 if the record has none. */
+static int64_t tcmdbshardxtime(TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash){
+  assert(shard && kbuf && ksiz >= 0);
+  if(!shard->xmap || shard->xmap->rnum < 1) return 0;
+  int vsiz;
+  const char *vbuf = tcfmapgetimpl(shard->xmap, kbuf, ksiz, &vsiz, hash);
+  if(!vbuf) return 0;
+  TCMDBXVAL xval;
+  memcpy(&xval, vbuf, sizeof(xval));
+  return xval.xtime;
+}
+
+
+/* Set the expiration time of a record in a shard of an on-memory hash database object.
+   `shard' specifies the shard locked for writing and being updated.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   `xtime' specifies the expiration time.  If it is not more than 0, the time is cleared.
+   The expiration table and the timer wheel are created at the first use so that shards without
+   expiration times cost nothing.  The table shares the reclaimer and the slab allocator of the
+   shard, and readers without locking look it up as well as the internal map. */
+static void tcmdbxset(TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash, int64_t xtime){
+  assert(shard && kbuf && ksiz >= 0);
+  TCFMAP *xmap = shard->xmap;
+  if(!xmap){
+    if(xtime < 1) return;
+    xmap = tcfmapnewimpl(TCMDBXMAPBNUM, shard->slab);
+    xmap->reclaim = shard->reclaim;
+    TCMDBWHEEL *wheel = tccalloc(1, sizeof(*wheel));
+    wheel->cur = (int64_t)time(NULL) - 1;
+    shard->wheel = wheel;
+    __atomic_store_n(&shard->xmap, xmap, __ATOMIC_RELEASE);
+  } else if(xtime < 1 && xmap->rnum < 1){
+    return;
+  }
+  int vsiz;
+  const char *vbuf = tcfmapgetimpl(xmap, kbuf, ksiz, &vsiz, hash);
+  if(vbuf){
+    TCMDBXVAL xval;
+    memcpy(&xval, vbuf, sizeof(xval));
+    if(xval.xtime == xtime) return;
+    tcmdbwheelout(shard->wheel, xval.ent);
+    free(xval.ent);
+  }
+  if(xtime < 1){
+    if(vbuf) tcfmapoutimpl(xmap, kbuf, ksiz, hash);
+    return;
+  }
+  TCMDBXENT *ent;
+  TCMALLOC(ent, sizeof(*ent) + ksiz);
+  ent->xtime = xtime;
+  ent->ksiz = ksiz;
+  memcpy((char *)ent + sizeof(*ent), kbuf, ksiz);
+  tcmdbwheelput(shard->wheel, ent);
+  TCMDBXVAL xval;
+  xval.xtime = xtime;
+  xval.ent = ent;
+  tcfmapputimpl(xmap, kbuf, ksiz, &xval, sizeof(xval), hash);
+}
+
+
+/* Remove a record of a shard of an on-memory hash database object if it has expired.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard locked for writing and being updated.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   This is called before updates based on the existing value so that they start afresh. */
+static void tcmdbxcut(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t hash){
+  assert(mdb && shard && kbuf && ksiz >= 0);
+  int64_t xtime = tcmdbshardxtime(shard, kbuf, ksiz, hash);
+  if(xtime < 1 || xtime > (int64_t)time(NULL)) return;
+  if(mdb->opts & MDBTFLAT){
+    tcfmapoutimpl(shard->fmap, kbuf, ksiz, hash);
+  } else {
+    tcmapoutimpl(shard->map, kbuf, ksiz, hash);
+  }
+  tcmdbxset(shard, kbuf, ksiz, hash, 0);
+  shard->exnum++;
+}
+
+
+/* Add an entry to a timer wheel.
+   `wheel' specifies the timer wheel.
+   `ent' specifies the entry.
+   An entry due within 64 seconds goes to the lowest level, and one due later goes to the level
+   whose slots span the delay, to be cascaded down when the wheel reaches its slot.  An entry
+   already due is put in the next slot, and one beyond the top level is put in its last slot. */
+static void tcmdbwheelput(TCMDBWHEEL *wheel, TCMDBXENT *ent){
+  assert(wheel && ent);
+  int64_t base = wheel->cur + 1;
+  int64_t xtime = ent->xtime > base ? ent->xtime : base;
+  int64_t span = (int64_t)1 << (TCMDBXLVBITS * TCMDBXLVNUM);
+  if(xtime - base >= span) xtime = base + span - 1;
+  int lv = 0;
+  while(lv < TCMDBXLVNUM - 1 && xtime - base >= (int64_t)1 << (TCMDBXLVBITS * (lv + 1))){
+    lv++;
+  }
+  uint32_t sidx = lv * TCMDBXSLOTNUM + ((xtime >> (TCMDBXLVBITS * lv)) & (TCMDBXSLOTNUM - 1));
+  ent->sidx = sidx;
+  ent->prev = NULL;
+  ent->next = wheel->slots[sidx];
+  if(ent->next) ent->next->prev = ent;
+  wheel->slots[sidx] = ent;
+}
+
+
+/* Remove an entry from a timer wheel.
+   `wheel' specifies the timer wheel.
+   `ent' specifies the entry.  It is not released. */
+static void tcmdbwheelout(TCMDBWHEEL *wheel, TCMDBXENT *ent){
+  assert(wheel && ent);
+  if(ent->prev){
+    ent->prev->next = ent->next;
+  } else {
+    wheel->slots[ent->sidx] = ent->next;
+  }
+  if(ent->next) ent->next->prev = ent->prev;
+}
+
+
+/* Delete a timer wheel and its entries.
+   `wheel' specifies the timer wheel.  If it is `NULL', this function has no effect. */
+static void tcmdbwheeldel(TCMDBWHEEL *wheel){
+  if(!wheel) return;
+  for(int i = 0; i < TCMDBXLVNUM * TCMDBXSLOTNUM; i++){
+    TCMDBXENT *ent = wheel->slots[i];
+    while(ent){
+      TCMDBXENT *next = ent->next;
+      free(ent);
+      ent = next;
+    }
+  }
+  free(wheel);
+}
+
+
+/* Advance a timer wheel and collect the keys of due entries.
+   `wheel' specifies the timer wheel.
+   `now' specifies the current time.
+   `keys' specifies the list object into which the keys are added.
+   `max' specifies the maximum number of the keys in the list.
+   Each second cascades the slots of the upper levels starting at it and then takes the slot of
+   the lowest level.  If the list fills up in the middle of a slot, the wheel stays before the
+   second so that the rest is taken next time; the entries taken are expected to be removed. */
+static void tcmdbwheelstep(TCMDBWHEEL *wheel, int64_t now, TCLIST *keys, int max){
+  assert(wheel && keys);
+  while(wheel->cur < now && tclistnum(keys) < max){
+    int64_t t = wheel->cur + 1;
+    for(int lv = TCMDBXLVNUM - 1; lv > 0; lv--){
+      if(t & (((int64_t)1 << (TCMDBXLVBITS * lv)) - 1)) continue;
+      uint32_t sidx = lv * TCMDBXSLOTNUM + ((t >> (TCMDBXLVBITS * lv)) & (TCMDBXSLOTNUM - 1));
+      TCMDBXENT *ent = wheel->slots[sidx];
+      wheel->slots[sidx] = NULL;
+      while(ent){
+        TCMDBXENT *next = ent->next;
+        tcmdbwheelput(wheel, ent);
+        ent = next;
+      }
+    }
+    for(TCMDBXENT *ent = wheel->slots[t&(TCMDBXSLOTNUM-1)]; ent; ent = ent->next){
+      if(tclistnum(keys) >= max) return;
+      tclistpush(keys, (char *)ent + sizeof(*ent), ent->ksiz);
+    }
+    wheel->cur = t;
+  }
+}
+
+
+/* Keep the ordered index of a shard of an on-memory hash database object up to date.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard locked for writing and being updated.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `rnum' specifies the number of records of the shard before the update.
+   Since an update adds or removes at most the record of the key, the change of the number of
+   records tells whether the key has to be added to the index or removed from it. */
+static void tcmdbidxsync(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, uint64_t rnum){
+  assert(mdb && shard && kbuf && ksiz >= 0);
+  if(!shard->index) return;
+  uint64_t nrnum = TCMDBSHARDRNUM(mdb, shard);
+  if(nrnum > rnum){
+    tcmdbidxput(shard->index, kbuf, ksiz);
+  } else if(nrnum < rnum){
+    tcmdbidxout(shard->index, kbuf, ksiz);
+  }
+}
+
+
+/* Get keys of ranged records of a shard of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard.
+   `bkbuf' specifies the pointer to the region of the beginning key or `NULL'.
+   `bksiz' specifies the size of the region of the beginning key.
+   `ekbuf' specifies the pointer to the region of the ending key or `NULL'.
+   `eksiz' specifies the size of the region of the ending key.
+   `max' specifies the maximum number of records to be fetched.
+   `vals' specifies whether the values are fetched as well as the keys.
+   The return value is a list object of the keys in ascending order, each followed by its value
+   if `vals' is true.  Expired records are skipped.  Without the ordered index, the keys in the
+   range are collected by scanning the shard and then sorted. */
+static TCLIST *tcmdbrangeshard(TCMDB *mdb, TCMDBSHARD *shard, const void *bkbuf, int bksiz,
+                               const void *ekbuf, int eksiz, int max, bool vals){
+  assert(mdb && shard && max >= 0);
+  TCLIST *list = tclistnew();
+  TCLIST *keys = NULL;
+  if(mdb->opts & MDBTORDER){
+    if(pthread_rwlock_rdlock(&shard->mtx) != 0) return list;
+  } else {
+    if(pthread_mutex_lock(mdb->imtx) != 0) return list;
+    if(pthread_rwlock_wrlock(&shard->mtx) != 0){
+      pthread_mutex_unlock(mdb->imtx);
+      return list;
+    }
+    keys = tclistnew();
+    const char *kbuf;
+    int ksiz;
+    if(mdb->opts & MDBTFLAT){
+      TCFMAP *map = shard->fmap;
+      uint64_t cur = map->cur;
+      tcfmapiterinit(map);
+      while((kbuf = tcfmapiternext(map, &ksiz)) != NULL){
+        if((!bkbuf || tcmdbidxcmp(kbuf, ksiz, bkbuf, bksiz) >= 0) &&
+           (!ekbuf || tcmdbidxcmp(kbuf, ksiz, ekbuf, eksiz) < 0)) tclistpush(keys, kbuf, ksiz);
+      }
+      map->cur = cur;
+    } else {
+      TCMAP *map = shard->map;
+      TCMAPREC *cur = map->cur;
+      tcmapiterinit(map);
+      while((kbuf = tcmapiternext(map, &ksiz)) != NULL){
+        if((!bkbuf || tcmdbidxcmp(kbuf, ksiz, bkbuf, bksiz) >= 0) &&
+           (!ekbuf || tcmdbidxcmp(kbuf, ksiz, ekbuf, eksiz) < 0)) tclistpush(keys, kbuf, ksiz);
+      }
+      map->cur = cur;
+    }
+    qsort(keys->array + keys->start, keys->num, sizeof(keys->array[0]), tcmdbidxcmplist);
+  }
+  int64_t now = (shard->xmap && shard->xmap->rnum > 0) ? (int64_t)time(NULL) : 0;
+  TCMDBIDXNODE *node = NULL;
+  if(!keys) node = bkbuf ? tcmdbidxseek(shard->index, bkbuf, bksiz, NULL) :
+    ((TCMDBIDX *)shard->index)->head->next[0];
+  int kidx = 0;
+  int num = 0;
+  while(num < max){
+    const char *kbuf;
+    int ksiz;
+    if(keys){
+      if(kidx >= tclistnum(keys)) break;
+      kbuf = tclistval(keys, kidx++, &ksiz);
+    } else {
+      if(!node) break;
+      kbuf = TCMDBIDXKEY(node);
+      ksiz = node->ksiz;
+      node = node->next[0];
+      if(ekbuf && tcmdbidxcmp(kbuf, ksiz, ekbuf, eksiz) >= 0) break;
+    }
+    uint64_t hash = (now > 0 || vals) ? tcmdbhash(kbuf, ksiz) : 0;
+    if(now > 0){
+      int64_t xtime = tcmdbshardxtime(shard, kbuf, ksiz, hash);
+      if(xtime > 0 && xtime <= now) continue;
+    }
+    if(vals){
+      int vsiz;
+      const char *vbuf = (mdb->opts & MDBTFLAT) ?
+        tcfmapgetimpl(shard->fmap, kbuf, ksiz, &vsiz, hash) :
+        tcmapgetimpl(shard->map, kbuf, ksiz, &vsiz, hash);
+      if(!vbuf) continue;
+      tclistpush(list, kbuf, ksiz);
+      tclistpush(list, vbuf, vsiz);
+    } else {
+      tclistpush(list, kbuf, ksiz);
+    }
+    num++;
+  }
+  pthread_rwlock_unlock(&shard->mtx);
+  if(keys){
+    tclistdel(keys);
+    pthread_mutex_unlock(mdb->imtx);
+  }
+  return list;
+}
+
+
+/* Scan records of a shard of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard.
+   `rhp' specifies the pointer to the variable of the number of rehashing of the internal map.
+   `pp' specifies the pointer to the variable of the position in the internal map.
+   `max' specifies the maximum number of records in the list.
+   `vp' specifies the pointer to the variable of the number of positions to be visited.
+   `vals' specifies whether the values are fetched as well as the keys.
+   `recs' specifies the list object into which the records are added.
+   The return value is true if the shard has been scanned to the end, else, it is false.
+   Positions cover the old array under rehashing followed by the current array.  Records only
+   move from the old array to the current one, so that a record existing through the scan is
+   visited at least once.  If the internal map has started or finished rehashing since the
+   position was taken, the positions mean different records and the shard is scanned again from
+   the beginning. */
+static bool tcmdbscanshard(TCMDB *mdb, TCMDBSHARD *shard, uint32_t *rhp, uint32_t *pp, int max,
+                           int64_t *vp, bool vals, TCLIST *recs){
+  assert(mdb && shard && rhp && pp && max >= 0 && vp && recs);
+  if(pthread_rwlock_rdlock(&shard->mtx) != 0) return true;
+  int64_t now = (shard->xmap && shard->xmap->rnum > 0) ? (int64_t)time(NULL) : 0;
+  int step = vals ? 2 : 1;
+  uint64_t pos = *pp;
+  uint64_t pnum;
+  if(mdb->opts & MDBTFLAT){
+    TCFMAP *map = shard->fmap;
+    if((map->rhnum & TCMDBSCANRHMASK) != *rhp){
+      *rhp = map->rhnum & TCMDBSCANRHMASK;
+      pos = 0;
+    }
+    uint64_t osnum = map->octrls ? map->osnum : 0;
+    pnum = osnum + map->snum;
+    while(pos < pnum && tclistnum(recs) / step < max && *vp > 0){
+      (*vp)--;
+      uint64_t sidx = pos++;
+      const uint8_t *ctrls = map->ctrls;
+      TCFMAPREC **slots = map->slots;
+      if(sidx < osnum){
+        ctrls = map->octrls;
+        slots = map->oslots;
+      } else {
+        sidx -= osnum;
+      }
+      if(ctrls[sidx] & TCFMAPEMPTY) continue;
+      const char *vbuf;
+      int ksiz, vsiz;
+      const char *kbuf = tcfmaprecbody(map->compact, slots[sidx], &ksiz, &vbuf, &vsiz);
+      tcmdbscanpush(shard, kbuf, ksiz, vbuf, vsiz, now, vals, recs);
+    }
+  } else {
+    TCMAP *map = shard->map;
+    if((map->rhnum & TCMDBSCANRHMASK) != *rhp){
+      *rhp = map->rhnum & TCMDBSCANRHMASK;
+      pos = 0;
+    }
+    uint64_t obnum = map->obuckets ? map->obnum : 0;
+    pnum = obnum + map->bnum;
+    while(pos < pnum && tclistnum(recs) / step < max && *vp > 0){
+      (*vp)--;
+      uint64_t bidx = pos++;
+      TCMAPREC *rec = (bidx < obnum) ? map->obuckets[bidx] : map->buckets[bidx-obnum];
+      if(rec) tcmdbscanbucket(shard, rec, now, vals, recs);
+    }
+  }
+  pthread_rwlock_unlock(&shard->mtx);
+  *pp = pos;
+  return pos >= pnum;
+}
+
+
+/* Scan records of a bucket of a map of a shard of an on-memory hash database object.
+   `shard' specifies the shard locked for reading.
+   `rec' specifies the root record of the bucket.
+   `now' specifies the current time or 0 if the shard has no expiration time.
+   `vals' specifies whether the values are fetched as well as the keys.
+   `recs' specifies the list object into which the records are added. */
+static void tcmdbscanbucket(TCMDBSHARD *shard, const TCMAPREC *rec, int64_t now, bool vals,
+                            TCLIST *recs){
+  assert(shard && rec && recs);
+  while(rec){
+    if(rec->left) tcmdbscanbucket(shard, rec->left, now, vals, recs);
+    const char *kbuf = (char *)rec + sizeof(*rec);
+    int ksiz = rec->ksiz & TCMAPKMAXSIZ;
+    tcmdbscanpush(shard, kbuf, ksiz, kbuf + ksiz + TCALIGNPAD(ksiz), rec->vsiz, now, vals, recs);
+    rec = rec->right;
+  }
+}
+
+
+/* Add a scanned record of a shard of an on-memory hash database object into a list.
+   `shard' specifies the shard locked for reading.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `now' specifies the current time or 0 if the shard has no expiration time.
+   `vals' specifies whether the value is added as well as the key.
+   `recs' specifies the list object into which the record is added.
+   An expired record is not added. */
+static void tcmdbscanpush(TCMDBSHARD *shard, const char *kbuf, int ksiz, const char *vbuf,
+                          int vsiz, int64_t now, bool vals, TCLIST *recs){
+  assert(shard && kbuf && ksiz >= 0 && vbuf && vsiz >= 0 && recs);
+  if(now > 0){
+    int64_t xtime = tcmdbshardxtime(shard, kbuf, ksiz, tcmdbhash(kbuf, ksiz));
+    if(xtime > 0 && xtime <= now) return;
+  }
+  tclistpush(recs, kbuf, ksiz);
+  if(vals) tclistpush(recs, vbuf, vsiz);
+}
+
+
+/* Compare two keys in lexical order.
+   `abuf' specifies the pointer to the region of one key.
+   `asiz' specifies the size of the region of one key.
+   `bbuf' specifies the pointer to the region of the other key.
+   `bsiz' specifies the size of the region of the other key.
+   The return value is positive if the former is big, negative if the latter is big, 0 if both
+   are equivalent. */
+static int tcmdbidxcmp(const char *abuf, int asiz, const char *bbuf, int bsiz){
+  assert(abuf && asiz >= 0 && bbuf && bsiz >= 0);
+  int rv = memcmp(abuf, bbuf, (asiz < bsiz) ? asiz : bsiz);
+  if(rv != 0) return rv;
+  return asiz - bsiz;
+}
+
+
+/* Compare two elements of a list of keys in lexical order.
+   `a' specifies the pointer to one element.
+   `b' specifies the pointer to the other element.
+   The return value is positive if the former is big, negative if the latter is big, 0 if both
+   are equivalent. */
+static int tcmdbidxcmplist(const void *a, const void *b){
+  assert(a && b);
+  const TCLISTDATUM *ad = a;
+  const TCLISTDATUM *bd = b;
+  return tcmdbidxcmp(ad->ptr, ad->size, bd->ptr, bd->size);
+}
+
+
+/* Create an ordered index.
+   The return value is the new ordered index.
+   The index is a skip list where a node rises to the next level at the probability of 1/4, so
+   that a search visits a few nodes per level and a node has 1.33 links on average. */
+static TCMDBIDX *tcmdbidxnew(void){
+  TCMDBIDX *idx;
+  TCMALLOC(idx, sizeof(*idx));
+  idx->head = tccalloc(1, sizeof(*idx->head) + sizeof(idx->head->next[0]) * TCMDBIDXLVMAX);
+  idx->head->lvnum = TCMDBIDXLVMAX;
+  idx->lvnum = 1;
+  idx->seed = 2463534242U;
+  idx->msiz = 0;
+  return idx;
+}
+
+
+/* Delete an ordered index.
+   `idx' specifies the ordered index. */
+static void tcmdbidxdel(TCMDBIDX *idx){
+  assert(idx);
+  TCMDBIDXNODE *node = idx->head;
+  while(node){
+    TCMDBIDXNODE *next = node->next[0];
+    free(node);
+    node = next;
+  }
+  free(idx);
+}
+
+
+/* Search an ordered index for the first key not less than a key.
+   `idx' specifies the ordered index.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `prevs' specifies an array into which the last nodes less than the key at the levels in use
+   are assigned.  If it is `NULL', it is not used.
+   The return value is the node of the first key not less than the key or `NULL' if there is
+   no such key. */
+static TCMDBIDXNODE *tcmdbidxseek(TCMDBIDX *idx, const void *kbuf, int ksiz,
+                                  TCMDBIDXNODE **prevs){
+  assert(idx && kbuf && ksiz >= 0);
+  TCMDBIDXNODE *node = idx->head;
+  for(int lv = idx->lvnum - 1; lv >= 0; lv--){
+    TCMDBIDXNODE *next;
+    while((next = node->next[lv]) != NULL &&
+          tcmdbidxcmp(TCMDBIDXKEY(next), next->ksiz, kbuf, ksiz) < 0){
+      node = next;
+    }
+    if(prevs) prevs[lv] = node;
+  }
+  return node->next[0];
+}
+
+
+/* Add a key to an ordered index.
+   `idx' specifies the ordered index.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   If the key already exists in the index, this function has no effect. */
+static void tcmdbidxput(TCMDBIDX *idx, const void *kbuf, int ksiz){
+  assert(idx && kbuf && ksiz >= 0);
+  TCMDBIDXNODE *prevs[TCMDBIDXLVMAX];
+  TCMDBIDXNODE *node = tcmdbidxseek(idx, kbuf, ksiz, prevs);
+  if(node && tcmdbidxcmp(TCMDBIDXKEY(node), node->ksiz, kbuf, ksiz) == 0) return;
+  uint32_t seed = idx->seed;
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  idx->seed = seed;
+  int lvnum = 1;
+  while(lvnum < TCMDBIDXLVMAX && (seed & 0x3) == 0){
+    lvnum++;
+    seed >>= 2;
+  }
+  while(idx->lvnum < lvnum){
+    prevs[idx->lvnum++] = idx->head;
+  }
+  size_t size = sizeof(*node) + sizeof(node->next[0]) * lvnum + ksiz;
+  TCMALLOC(node, size);
+  node->ksiz = ksiz;
+  node->lvnum = lvnum;
+  memcpy(TCMDBIDXKEY(node), kbuf, ksiz);
+  for(int lv = 0; lv < lvnum; lv++){
+    node->next[lv] = prevs[lv]->next[lv];
+    prevs[lv]->next[lv] = node;
+  }
+  idx->msiz += size;
+}
+
+
+/* Remove a key from an ordered index.
+   `idx' specifies the ordered index.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   If the key does not exist in the index, this function has no effect. */
+static void tcmdbidxout(TCMDBIDX *idx, const void *kbuf, int ksiz){
+  assert(idx && kbuf && ksiz >= 0);
+  TCMDBIDXNODE *prevs[TCMDBIDXLVMAX];
+  TCMDBIDXNODE *node = tcmdbidxseek(idx, kbuf, ksiz, prevs);
+  if(!node || tcmdbidxcmp(TCMDBIDXKEY(node), node->ksiz, kbuf, ksiz) != 0) return;
+  for(int lv = 0; lv < node->lvnum; lv++){
+    prevs[lv]->next[lv] = node->next[lv];
+  }
+  while(idx->lvnum > 1 && !idx->head->next[idx->lvnum-1]){
+    idx->lvnum--;
+  }
+  idx->msiz -= sizeof(*node) + sizeof(node->next[0]) * node->lvnum + ksiz;
+  free(node);
+}
+
+
+/* Hand detached contents of a shard to the thread releasing them in background.
+   `shard' specifies the shard which the contents have been detached from.
+   `rls' specifies the detached contents.
+   The thread is started at the first use.  If it is not available, the contents are retired to
+   the reclaimer of the shard and released at once by a later writer. */
+static void tcmdbrlsqueue(TCMDBSHARD *shard, TCMDBRLS *rls){
+  assert(shard && rls);
+  if(pthread_mutex_lock(&tcmdbrlsmtx) != 0){
+    tcrclretire(shard->reclaim, tcmdbrlsdel, rls, 0);
+    return;
+  }
+  if(!tcmdbrlsrun){
+    pthread_t th;
+    if(pthread_create(&th, NULL, tcmdbrlsproc, NULL) == 0){
+      pthread_detach(th);
+      tcmdbrlsrun = true;
+    }
+  }
+  bool run = tcmdbrlsrun;
+  if(run){
+    rls->next = NULL;
+    if(tcmdbrlstail){
+      tcmdbrlstail->next = rls;
+    } else {
+      tcmdbrlshead = rls;
+    }
+    tcmdbrlstail = rls;
+    pthread_cond_signal(&tcmdbrlscnd);
+  }
+  pthread_mutex_unlock(&tcmdbrlsmtx);
+  if(!run) tcrclretire(shard->reclaim, tcmdbrlsdel, rls, 0);
+}
+
+
+/* Release detached contents of shards in background.
+   `arg' is not used.
+   The return value is not used.
+   Each contents are released after no reader can be seeing them, in steps separated by short
+   sleeps so that releasing a huge database does not monopolize the memory bus. */
+static void *tcmdbrlsproc(void *arg){
+  while(true){
+    if(pthread_mutex_lock(&tcmdbrlsmtx) != 0) tcmyfatal("mutex error");
+    while(!tcmdbrlshead){
+      if(pthread_cond_wait(&tcmdbrlscnd, &tcmdbrlsmtx) != 0) tcmyfatal("condition error");
+    }
+    TCMDBRLS *rls = tcmdbrlshead;
+    tcmdbrlshead = rls->next;
+    if(!tcmdbrlshead) tcmdbrlstail = NULL;
+    pthread_mutex_unlock(&tcmdbrlsmtx);
+    while(rls->epoch >= tcrclmin()){
+      tcsleep(TCMDBRLSWAIT);
+    }
+    while(tcmdbrlsstep(rls, TCMDBRLSUNIT)){
+      tcsleep(TCMDBRLSWAIT);
+    }
+    free(rls);
+  }
+  return NULL;
+}
+
+
+/* Release detached contents of a shard at once.
+   `ptr' specifies the detached contents.
+   `num' is not used.
+   This function is suitable as a function to release a retired region. */
+static void tcmdbrlsdel(void *ptr, uint32_t num){
+  assert(ptr);
+  while(tcmdbrlsstep(ptr, INT_MAX));
+  free(ptr);
+}
+
+
+/* Release a part of detached contents of a shard.
+   `rls' specifies the detached contents.
+   `max' specifies the maximum number of regions released or slots visited.
+   The return value is true if some contents remain, else, it is false.
+   Regions retired to the detached reclaimer are released first, as they can belong to the
+   detached slab allocator, which is deleted at last. */
+static bool tcmdbrlsstep(TCMDBRLS *rls, int max){
+  assert(rls && max > 0);
+  int num = max;
+  if(rls->reclaim){
+    tcrcldel(rls->reclaim);
+    rls->reclaim = NULL;
+  }
+  if(rls->map){
+    TCMAP *map = rls->map;
+    while(map->first && num > 0){
+      TCMAPREC *rec = map->first;
+      map->first = rec->next;
+      tcslabfree(map->slab, rec);
+      num--;
+    }
+    if(map->first) return true;
+    tcmapdel(map);
+    rls->map = NULL;
+  }
+  if(rls->fmap){
+    if(!tcmdbrlsfmap(rls->fmap, &rls->pos, &num)) return true;
+    rls->fmap = NULL;
+    rls->pos = 0;
+  }
+  if(rls->xmap){
+    if(!tcmdbrlsfmap(rls->xmap, &rls->pos, &num)) return true;
+    rls->xmap = NULL;
+    rls->pos = 0;
+  }
+  if(rls->wheel){
+    TCMDBWHEEL *wheel = rls->wheel;
+    while(rls->pos < TCMDBXLVNUM * TCMDBXSLOTNUM && num > 0){
+      TCMDBXENT *ent = wheel->slots[rls->pos];
+      if(ent){
+        wheel->slots[rls->pos] = ent->next;
+        free(ent);
+      } else {
+        rls->pos++;
+      }
+      num--;
+    }
+    if(rls->pos < TCMDBXLVNUM * TCMDBXSLOTNUM) return true;
+    free(wheel);
+    rls->wheel = NULL;
+    rls->pos = 0;
+  }
+  if(rls->index){
+    TCMDBIDXNODE *head = rls->index->head;
+    while(head->next[0] && num > 0){
+      TCMDBIDXNODE *node = head->next[0];
+      head->next[0] = node->next[0];
+      free(node);
+      num--;
+    }
+    if(head->next[0]) return true;
+    tcmdbidxdel(rls->index);
+    rls->index = NULL;
+  }
+  tcslabdel(rls->slab);
+  return false;
+}
+
+
+/* Release a part of the records and the arrays of a detached flat map.
+   `map' specifies the flat map object.
+   `pp' specifies the pointer to the variable of the position, counting the slots of the old
+   arrays followed by those of the current arrays.
+   `np' specifies the pointer to the variable of the number of slots to be visited.
+   The return value is true if the map has been deleted, else, it is false. */
+static bool tcmdbrlsfmap(TCFMAP *map, uint64_t *pp, int *np){
+  assert(map && pp && np);
+  uint64_t onum = map->octrls ? map->osnum : 0;
+  uint64_t end = onum + map->snum;
+  while(*pp < end && *np > 0){
+    const uint8_t *ctrls = map->ctrls;
+    TCFMAPREC **slots = map->slots;
+    uint64_t sidx = *pp;
+    if(sidx < onum){
+      ctrls = map->octrls;
+      slots = map->oslots;
+    } else {
+      sidx -= onum;
+    }
+    if(!(ctrls[sidx] & TCFMAPEMPTY)) tcslabfree(map->slab, slots[sidx]);
+    (*pp)++;
+    (*np)--;
+  }
+  if(*pp < end) return false;
+  if(map->octrls) tcfmapfreearrays(map->octrls, map->oslots, map->osnum);
+  tcfmapfreearrays(map->ctrls, map->slots, map->snum);
+  free(map);
+  return true;
+}
+
+
+/* Visit the value of a record in an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   `proc' specifies the pointer to the visitor of decompressed values or `NULL'.
+   `rproc' specifies the pointer to the visitor of stored values, used if `proc' is `NULL'.
+   `op' specifies the opaque pointer given to the visitor.
+   If successful, the return value is true, else, it is false. */
+static bool tcmdbvisitimpl(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash,
+                           TCVISITPROC proc, TCVISITRAWPROC rproc, void *op){
+  assert(mdb && kbuf && ksiz >= 0 && (proc || rproc));
+  if(mdb->hdb){
+    if(proc) return tchdbvisit(mdb->hdb, kbuf, ksiz, proc, op, hash);
+    TCMDBRAWARG arg = { rproc, op };
+    return tchdbvisit(mdb->hdb, kbuf, ksiz, tcmdbvisitraw, &arg, hash);
+  }
+  unsigned int mi;
+  TCMDBHASH(mi, mdb, hash);
+  tcmdbtouch(mdb->shards + mi, hash);
+  TCRCLSLOT *slot = tcrclenter();
+  if(slot){
+    bool ok = false;
+    bool hit = false;
+    pthread_cleanup_push((void (*)(void *))tcrclleave, slot);
+    const char *vbuf;
+    int vsiz;
+    if(tcmdbgetopt(mdb, mdb->shards + mi, kbuf, ksiz, hash, &vbuf, &vsiz)){
+      if(vbuf){
+        tcmdbvisitcall(mdb, vbuf, vsiz, proc, rproc, op);
+        hit = true;
+      }
+      ok = true;
+    }
+    pthread_cleanup_pop(1);
+    if(ok) return hit;
+  }
+  if(pthread_rwlock_rdlock(&mdb->shards[mi].mtx) != 0) return false;
+  bool hit = false;
+  pthread_cleanup_push((void (*)(void *))pthread_rwlock_unlock, &mdb->shards[mi].mtx);
+  int vsiz;
+  const char *vbuf = (mdb->opts & MDBTFLAT) ?
+    tcfmapgetimpl(mdb->shards[mi].fmap, kbuf, ksiz, &vsiz, hash) :
+    tcmapgetimpl(mdb->shards[mi].map, kbuf, ksiz, &vsiz, hash);
+  if(vbuf){
+    int64_t xtime = tcmdbshardxtime(mdb->shards + mi, kbuf, ksiz, hash);
+    if(xtime > 0 && xtime <= (int64_t)time(NULL)) vbuf = NULL;
+  }
+  if(vbuf){
+    tcmdbvisitcall(mdb, vbuf, vsiz, proc, rproc, op);
+    hit = true;
+  }
+  pthread_cleanup_pop(1);
+  return hit;
+}
+
+
+/* Call a visitor with the value of a record.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   `proc' specifies the pointer to the visitor of decompressed values or `NULL'.
+   `rproc' specifies the pointer to the visitor of stored values, used if `proc' is `NULL'.
+   `op' specifies the opaque pointer given to the visitor. */
+static void tcmdbvisitcall(TCMDB *mdb, const char *vbuf, int vsiz, TCVISITPROC proc,
+                           TCVISITRAWPROC rproc, void *op){
+  assert(mdb && vbuf && vsiz >= 0 && (proc || rproc));
+  char nbuf[TCNUMBUFSIZ];
+  int nsiz = tcmdbcntrender(mdb, vbuf, vsiz, nbuf);
+  if(nsiz >= 0){
+    vbuf = nbuf;
+    vsiz = nsiz;
+  }
+  bool cmp = tcmdbcmpcheck(mdb, vbuf, vsiz);
+  if(!proc){
+    if(cmp){
+      rproc(vbuf + TCMDBCMPMSIZ, vsiz - TCMDBCMPMSIZ, true, op);
+    } else {
+      rproc(vbuf, vsiz, false, op);
+    }
+    return;
+  }
+  int rsiz;
+  char *rbuf = cmp ? tcmdbcmpunpack(mdb, vbuf, vsiz, &rsiz) : NULL;
+  pthread_cleanup_push(free, rbuf);
+  if(rbuf){
+    proc(rbuf, rsiz, op);
+  } else {
+    proc(vbuf, vsiz, op);
+  }
+  pthread_cleanup_pop(1);
+}
+
+
+/* Call a visitor of stored values for a value of a file hash database.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `op' specifies the pointer to the structure of the visitor. */
+static void tcmdbvisitraw(const void *vbuf, int vsiz, void *op){
+  assert(vbuf && vsiz >= 0 && op);
+  TCMDBRAWARG *arg = op;
+  arg->proc(vbuf, vsiz, false, arg->op);
+}
+
+
+/* Get the CPU time of the calling thread.
+   The return value is the CPU time in nanoseconds. */
+static uint64_t tcmdbcputime(void){
+  struct timespec ts;
+  if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/* Check whether a stored value of an on-memory hash database is compressed.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   The return value is true if the value is compressed, else, it is false.
+   A compressed value is the magic data followed by the result of `tclzencode'.  Values of eight
+   bytes or less are never compressed so that numbers updated in place are not mistaken. */
+static bool tcmdbcmpcheck(TCMDB *mdb, const char *vbuf, int vsiz){
+  assert(mdb && vbuf && vsiz >= 0);
+  return mdb->cmpsiz > 0 && vsiz > TCMDBCMPMSIZ * 2 &&
+    !memcmp(vbuf, TCMDBCMPMAGIC, TCMDBCMPMSIZ);
+}
+
+
+/* Compress a value to be stored into an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `sp' specifies the pointer to the variable into which the size of the result is assigned.
+   The return value is the pointer to the region of the value to be stored or `NULL' if the
+   value should be stored as it is.
+   A value not smaller than the threshold is kept compressed if it gets smaller.  A value which
+   looks like a compressed one is always compressed so that it is not mistaken. */
+static char *tcmdbcmppack(TCMDB *mdb, const char *vbuf, int vsiz, int *sp){
+  assert(mdb && vbuf && vsiz >= 0 && sp);
+  bool fake = tcmdbcmpcheck(mdb, vbuf, vsiz);
+  if(!fake && vsiz < mdb->cmpsiz) return NULL;
+  uint64_t stime = tcmdbcputime();
+  int zsiz;
+  char *zbuf = tclzencode(vbuf, vsiz, &zsiz);
+  char *rv = NULL;
+  if(fake || zsiz + TCMDBCMPMSIZ < vsiz){
+    TCMALLOC(rv, zsiz + TCMDBCMPMSIZ + 1);
+    memcpy(rv, TCMDBCMPMAGIC, TCMDBCMPMSIZ);
+    memcpy(rv + TCMDBCMPMSIZ, zbuf, zsiz);
+    *sp = zsiz + TCMDBCMPMSIZ;
+  }
+  free(zbuf);
+  __atomic_add_fetch(&mdb->cmptime, tcmdbcputime() - stime, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&mdb->cmpnum, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&mdb->cmpisiz, vsiz, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&mdb->cmposiz, rv ? *sp : vsiz, __ATOMIC_RELAXED);
+  return rv;
+}
+
+
+/* Decompress a stored value of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value, which is compressed.
+   `vsiz' specifies the size of the region of the stored value.
+   `sp' specifies the pointer to the variable into which the size of the result is assigned.
+   The return value is the pointer to the region of the original value or `NULL' if the stored
+   value is broken. */
+static char *tcmdbcmpunpack(TCMDB *mdb, const char *vbuf, int vsiz, int *sp){
+  assert(mdb && vbuf && vsiz >= TCMDBCMPMSIZ && sp);
+  uint64_t stime = tcmdbcputime();
+  char *rv = tclzdecode(vbuf + TCMDBCMPMSIZ, vsiz - TCMDBCMPMSIZ, sp);
+  __atomic_add_fetch(&mdb->dectime, tcmdbcputime() - stime, __ATOMIC_RELAXED);
+  return rv;
+}
+
+
+/* Duplicate a stored value of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   `sp' specifies the pointer to the variable into which the size of the result is assigned.
+   The return value is the pointer to the region of the original value. */
+static char *tcmdbvaldup(TCMDB *mdb, const char *vbuf, int vsiz, int *sp){
+  assert(mdb && vbuf && vsiz >= 0 && sp);
+  char nbuf[TCNUMBUFSIZ];
+  int nsiz = tcmdbcntrender(mdb, vbuf, vsiz, nbuf);
+  if(nsiz >= 0){
+    *sp = nsiz;
+    return tcmemdup(nbuf, nsiz);
+  }
+  if(tcmdbcmpcheck(mdb, vbuf, vsiz)){
+    char *rv = tcmdbcmpunpack(mdb, vbuf, vsiz, sp);
+    if(rv) return rv;
+  }
+  *sp = vsiz;
+  return tcmemdup(vbuf, vsiz);
+}
+
+
+/* Get the original size of a stored value of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   The return value is the size of the original value. */
+static int tcmdbvalsiz(TCMDB *mdb, const char *vbuf, int vsiz){
+  assert(mdb && vbuf && vsiz >= 0);
+  char nbuf[TCNUMBUFSIZ];
+  int nsiz = tcmdbcntrender(mdb, vbuf, vsiz, nbuf);
+  if(nsiz >= 0) return nsiz;
+  if(tcmdbcmpcheck(mdb, vbuf, vsiz)){
+    int rsiz = tclzsize(vbuf + TCMDBCMPMSIZ, vsiz - TCMDBCMPMSIZ);
+    if(rsiz >= 0) return rsiz;
+  }
+  return vsiz;
+}
+
+
+/* Decompress the values in a list of keys and values of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `recs' specifies the list object of keys and values alternately.
+   Counters are rendered as well. */
+static void tcmdbunpacklist(TCMDB *mdb, TCLIST *recs){
+  assert(mdb && recs);
+  int num = tclistnum(recs);
+  for(int i = 1; i < num; i += 2){
+    int vsiz;
+    const char *vbuf = tclistval(recs, i, &vsiz);
+    char nbuf[TCNUMBUFSIZ];
+    int nsiz = tcmdbcntrender(mdb, vbuf, vsiz, nbuf);
+    if(nsiz >= 0){
+      tclistover(recs, i, nbuf, nsiz);
+      continue;
+    }
+    if(!tcmdbcmpcheck(mdb, vbuf, vsiz)) continue;
+    int rsiz;
+    char *rbuf = tcmdbcmpunpack(mdb, vbuf, vsiz, &rsiz);
+    if(rbuf){
+      tclistover(recs, i, rbuf, rsiz);
+      free(rbuf);
+    }
+  }
+}
+
+
+/* Concatenate a value at the end of a record of a shard keeping compression.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard locked for writing.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is true if the record has been stored, or false if the concatenation should
+   be done on the stored value as it is.
+   The existing value is decompressed and the result is compressed again when the existing one
+   is compressed or the result reaches the threshold size.  An existing counter is rendered
+   before the concatenation. */
+static bool tcmdbputcatcmp(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz,
+                           const void *vbuf, int vsiz, uint64_t hash){
+  assert(mdb && shard && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  int osiz;
+  const char *obuf = (mdb->opts & MDBTFLAT) ?
+    tcfmapgetimpl(shard->fmap, kbuf, ksiz, &osiz, hash) :
+    tcmapgetimpl(shard->map, kbuf, ksiz, &osiz, hash);
+  if(!obuf){
+    obuf = "";
+    osiz = 0;
+  }
+  bool cnt = tcmdbcntcheck(mdb, obuf, osiz) || tcmdbstcheck(mdb, obuf, osiz);
+  bool cmp = tcmdbcmpcheck(mdb, obuf, osiz);
+  if(!cnt && !cmp && (mdb->cmpsiz < 1 || osiz > INT_MAX - vsiz || osiz + vsiz < mdb->cmpsiz))
+    return false;
+  int rsiz;
+  char *rbuf = (cnt || cmp) ? tcmdbvaldup(mdb, obuf, osiz, &rsiz) : NULL;
+  if(!rbuf){
+    rbuf = tcmemdup(obuf, osiz);
+    rsiz = osiz;
+  }
+  if(rsiz > INT_MAX - vsiz){
+    free(rbuf);
+    return false;
+  }
+  TCREALLOC(rbuf, rbuf, rsiz + vsiz + 1);
+  memcpy(rbuf + rsiz, vbuf, vsiz);
+  rsiz += vsiz;
+  int zsiz;
+  char *zbuf = (mdb->cmpsiz > 0) ? tcmdbcmppack(mdb, rbuf, rsiz, &zsiz) : NULL;
+  if(!zbuf){
+    zbuf = rbuf;
+    zsiz = rsiz;
+    rbuf = NULL;
+  }
+  if(mdb->opts & MDBTFLAT){
+    tcfmapputimpl(shard->fmap, kbuf, ksiz, zbuf, zsiz, hash);
+  } else {
+    tcmapputimpl(shard->map, kbuf, ksiz, zbuf, zsiz, hash);
+  }
+  free(zbuf);
+  free(rbuf);
+  return true;
+}
+
+
+/* Find the value of a record to be updated in place in a shard of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard locked for reading or writing.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   `sp' specifies the pointer to the variable into which the size of the value is assigned.
+   The return value is the pointer to the region of the stored value or `NULL' if no record
+   corresponds or the record has expired.
+   Holders of the read lock may modify numbers in the region by atomic operations only, as
+   writers which duplicate records are excluded and readers without locking load each number at
+   once. */
+static char *tcmdbcellget(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz,
+                          uint64_t hash, int *sp){
+  assert(mdb && shard && kbuf && ksiz >= 0 && sp);
+  const char *vbuf = (mdb->opts & MDBTFLAT) ?
+    tcfmapgetimpl(shard->fmap, kbuf, ksiz, sp, hash) :
+    tcmapgetimpl(shard->map, kbuf, ksiz, sp, hash);
+  if(vbuf && shard->xmap){
+    int64_t xtime = tcmdbshardxtime(shard, kbuf, ksiz, hash);
+    if(xtime > 0 && xtime <= (int64_t)time(NULL)) vbuf = NULL;
+  }
+  return (char *)vbuf;
+}
+
+
+/* Check whether a stored value of an on-memory hash database is a decimal counter.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   The return value is true if the value is a decimal counter, else, it is false.
+   A counter is the prefix of the database followed by a native 64-bit integer.  The prefix is
+   chosen at random for each database object so that values stored by users are not mistaken,
+   and its first byte is zero so that counters are not mistaken for compressed values. */
+static bool tcmdbcntcheck(TCMDB *mdb, const char *vbuf, int vsiz){
+  assert(mdb && vbuf && vsiz >= 0);
+  return vsiz == TCMDBCNTSIZ && !memcmp(vbuf, &mdb->cntmagic, sizeof(mdb->cntmagic));
+}
+
+
+/* Check whether a stored value of an on-memory hash database is a striped counter.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   The return value is true if the value is a striped counter, else, it is false.
+   A striped counter is the prefix of the database, the offset of the first slot, and the slots
+   of 32-bit integers each of which occupies a cache line.  The prefix differs from the one of
+   decimal counters in the first byte. */
+static bool tcmdbstcheck(TCMDB *mdb, const char *vbuf, int vsiz){
+  assert(mdb && vbuf && vsiz >= 0);
+  return vsiz == TCMDBSTSIZ(mdb) && !memcmp(vbuf, &mdb->stmagic, sizeof(mdb->stmagic));
+}
+
+
+/* Render a counter of an on-memory hash database as its value.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   `buf' specifies the pointer to the region into which the value is written.  It should be of
+   `TCNUMBUFSIZ' bytes at least.
+   The return value is the size of the value, or -1 if the stored value is not a counter.
+   A decimal counter is rendered as a decimal string and a striped counter is rendered as a
+   native integer of the sum of the slots. */
+static int tcmdbcntrender(TCMDB *mdb, const char *vbuf, int vsiz, char *buf){
+  assert(mdb && vbuf && vsiz >= 0 && buf);
+  if(tcmdbstcheck(mdb, vbuf, vsiz)){
+    int num = tcmdbstsum(mdb, vbuf);
+    memcpy(buf, &num, sizeof(num));
+    return sizeof(num);
+  }
+  if(!tcmdbcntcheck(mdb, vbuf, vsiz)) return -1;
+  const char *cp = vbuf + sizeof(mdb->cntmagic);
+  uint64_t num;
+  if((uintptr_t)cp % sizeof(num) == 0){
+    num = __atomic_load_n((const uint64_t *)cp, __ATOMIC_RELAXED);
+  } else {
+    memcpy(&num, cp, sizeof(num));
+  }
+  return sprintf(buf, "%llu", (unsigned long long)num);
+}
+
+
+/* Add an integer to the value of a decimal counter.
+   `onum' specifies the original value.
+   `num' specifies the additional value.
+   The return value is the summation value, which is not less than 0. */
+static uint64_t tcmdbcntadd(uint64_t onum, int64_t num){
+  if(num >= 0) return onum + num;
+  uint64_t dnum = -(uint64_t)num;
+  return (dnum < onum) ? onum - dnum : 0;
+}
+
+
+/* Add an integer to a striped counter of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `num' specifies the additional value.
+   The return value is the summation value.
+   Only the slot of the current CPU is updated, so that concurrent additions on different CPUs do
+   not contend for the same cache line. */
+static int tcmdbstadd(TCMDB *mdb, char *vbuf, int num){
+  assert(mdb && vbuf);
+  uint32_t off;
+  memcpy(&off, vbuf + sizeof(mdb->stmagic), sizeof(off));
+  int cpu = sched_getcpu();
+  if(cpu < 0) cpu = 0;
+  uint32_t *sp = (uint32_t *)(vbuf + off + (cpu % mdb->stnum) * TCMDBSTLINE);
+  __atomic_add_fetch(sp, (uint32_t)num, __ATOMIC_RELAXED);
+  return tcmdbstsum(mdb, vbuf);
+}
+
+
+/* Get the value of a striped counter of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `vbuf' specifies the pointer to the region of the stored value.  It may be a copy of the
+   stored value.
+   The return value is the summation of the slots. */
+static int tcmdbstsum(TCMDB *mdb, const char *vbuf){
+  assert(mdb && vbuf);
+  uint32_t off;
+  memcpy(&off, vbuf + sizeof(mdb->stmagic), sizeof(off));
+  uint32_t sum = 0;
+  for(int i = 0; i < mdb->stnum; i++){
+    const char *cp = vbuf + off + i * TCMDBSTLINE;
+    uint32_t num;
+    if((uintptr_t)cp % sizeof(num) == 0){
+      num = __atomic_load_n((const uint32_t *)cp, __ATOMIC_RELAXED);
+    } else {
+      memcpy(&num, cp, sizeof(num));
+    }
+    sum += num;
+  }
+  return (int)sum;
+}
+
+
+/* Store a striped counter into a shard of an on-memory hash database.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard holding the write lock.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the initial value.
+   `hash' specifies the hash value of the key.
+   The offset of the first slot is decided after the value is stored so that each slot begins a
+   cache line wherever the value is placed, and is recorded in the value for its copies. */
+static void tcmdbstput(TCMDB *mdb, TCMDBSHARD *shard, const void *kbuf, int ksiz, int num,
+                       uint64_t hash){
+  assert(mdb && shard && kbuf && ksiz >= 0);
+  int ssiz = TCMDBSTSIZ(mdb);
+  char *sbuf = tccalloc(1, ssiz);
+  memcpy(sbuf, &mdb->stmagic, sizeof(mdb->stmagic));
+  if(mdb->opts & MDBTFLAT){
+    tcfmapputimpl(shard->fmap, kbuf, ksiz, sbuf, ssiz, hash);
+  } else {
+    tcmapputimpl(shard->map, kbuf, ksiz, sbuf, ssiz, hash);
+  }
+  free(sbuf);
+  int vsiz;
+  char *vbuf = (char *)((mdb->opts & MDBTFLAT) ?
+                        tcfmapgetimpl(shard->fmap, kbuf, ksiz, &vsiz, hash) :
+                        tcmapgetimpl(shard->map, kbuf, ksiz, &vsiz, hash));
+  uint32_t off = TCMDBSTHSIZ +
+    (TCMDBSTLINE - ((uintptr_t)vbuf + TCMDBSTHSIZ) % TCMDBSTLINE) % TCMDBSTLINE;
+  memcpy(vbuf + sizeof(mdb->stmagic), &off, sizeof(off));
+  memcpy(vbuf + off, &num, sizeof(num));
+  __atomic_store_n(&mdb->cntuse, true, __ATOMIC_RELAXED);
+}
+
+
+/* Write a snapshot of an on-memory hash database object into a file.
+   `mdb' specifies the on-memory hash database object.
+   `path' specifies the path of the snapshot file.
+   `mbuf' specifies the pointer to the region of the metadata.
+   `msiz' specifies the size of the region of the metadata.
+   `lock' specifies whether each shard is locked during its pass.
+   If successful, the return value is true, else, it is false.
+   The file is written under a temporary name and renamed at last, so that the previous snapshot
+   is kept until the new one is complete.  The header is the magic data, the number of the
+   sections, and the size of the metadata, followed by the metadata and the directory of the
+   offset, the size, and the number of records of each section.  Each shard makes a section. */
+static bool tcmdbdumpimpl(TCMDB *mdb, const char *path, const void *mbuf, int msiz, bool lock){
+  assert(mdb && path && mbuf && msiz >= 0);
+  char *tpath = tcsprintf("%s%ctmp%c%d", path, MYEXTCHR, MYEXTCHR, (int)getpid());
+  int fd = open(tpath, O_WRONLY | O_CREAT | O_TRUNC, 00644);
+  if(fd == -1){
+    free(tpath);
+    return false;
+  }
+  bool err = false;
+  TCXSTR *xstr = tcxstrnew2(TCMDBSNAPBUFSIZ + TCMDBSNAPRSIZ);
+  tcxstrcat(xstr, TCMDBSNAPMAGIC, sizeof(TCMDBSNAPMAGIC) - 1);
+  uint32_t lnum = TCHTOIL(mdb->mnum);
+  tcxstrcat(xstr, &lnum, sizeof(lnum));
+  lnum = TCHTOIL(msiz);
+  tcxstrcat(xstr, &lnum, sizeof(lnum));
+  tcxstrcat(xstr, mbuf, msiz);
+  uint64_t zero = 0;
+  tcxstrcat(xstr, &zero, TCALIGNPAD(tcxstrsize(xstr)));
+  uint64_t hsiz = tcxstrsize(xstr);
+  int dnum = mdb->mnum * 3;
+  uint64_t *dir = tccalloc(dnum, sizeof(*dir));
+  tcxstrcat(xstr, dir, dnum * sizeof(*dir));
+  uint64_t off = tcxstrsize(xstr);
+  for(int i = 0; i < mdb->mnum; i++){
+    TCMDBSHARD *shard = mdb->shards + i;
+    if(lock && pthread_rwlock_rdlock(&shard->mtx) != 0){
+      err = true;
+      break;
+    }
+    uint64_t rnum = 0;
+    uint64_t size = 0;
+    if(!tcmdbdumpshard(mdb, shard, fd, xstr, &rnum, &size)) err = true;
+    if(lock) pthread_rwlock_unlock(&shard->mtx);
+    if(err) break;
+    dir[i*3] = TCHTOILL(off);
+    dir[i*3+1] = TCHTOILL(size);
+    dir[i*3+2] = TCHTOILL(rnum);
+    off += size;
+  }
+  if(!err && !tcwrite(fd, tcxstrptr(xstr), tcxstrsize(xstr))) err = true;
+  if(!err && pwrite(fd, dir, dnum * sizeof(*dir), hsiz) != dnum * sizeof(*dir)) err = true;
+  if(!err && fsync(fd) != 0) err = true;
+  if(close(fd) != 0) err = true;
+  if(!err && rename(tpath, path) != 0) err = true;
+  if(err) unlink(tpath);
+  free(dir);
+  tcxstrdel(xstr);
+  free(tpath);
+  return !err;
+}
+
+
+/* Write the records of a shard of an on-memory hash database object into a snapshot file.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard, which should not be updated during the call.
+   `fd' specifies the file descriptor of the snapshot file.
+   `xstr' specifies the buffer of writing.
+   `rnp' specifies the pointer to the variable of the number of written records.
+   `sp' specifies the pointer to the variable of the size of written records.
+   If successful, the return value is true, else, it is false.
+   Flat maps are read through their arrays including the old ones under rehashing, and maps of
+   binary trees are read through the list of the stored order. */
+static bool tcmdbdumpshard(TCMDB *mdb, TCMDBSHARD *shard, int fd, TCXSTR *xstr,
+                           uint64_t *rnp, uint64_t *sp){
+  assert(mdb && shard && fd >= 0 && xstr && rnp && sp);
+  int64_t now = (shard->xmap && shard->xmap->rnum > 0) ? (int64_t)time(NULL) : 0;
+  if(mdb->opts & MDBTFLAT){
+    TCFMAP *map = shard->fmap;
+    for(int i = 0; i < 2; i++){
+      const uint8_t *ctrls = (i == 0) ? map->octrls : map->ctrls;
+      TCFMAPREC **slots = (i == 0) ? map->oslots : map->slots;
+      uint64_t snum = (i == 0) ? map->osnum : map->snum;
+      if(!ctrls) continue;
+      for(uint64_t sidx = 0; sidx < snum; sidx++){
+        if(ctrls[sidx] & TCFMAPEMPTY) continue;
+        const char *vbuf;
+        int ksiz, vsiz;
+        const char *kbuf = tcfmaprecbody(map->compact, slots[sidx], &ksiz, &vbuf, &vsiz);
+        if(!tcmdbdumprec(mdb, shard, kbuf, ksiz, vbuf, vsiz, now, fd, xstr, rnp, sp))
+          return false;
+      }
+    }
+  } else {
+    for(TCMAPREC *rec = shard->map->first; rec; rec = rec->next){
+      const char *kbuf = (char *)rec + sizeof(*rec);
+      int ksiz = rec->ksiz & TCMAPKMAXSIZ;
+      if(!tcmdbdumprec(mdb, shard, kbuf, ksiz, kbuf + ksiz + TCALIGNPAD(ksiz), rec->vsiz,
+                       now, fd, xstr, rnp, sp)) return false;
+    }
+  }
+  return true;
+}
+
+
+/* Write a record of a shard of an on-memory hash database object into a snapshot file.
+   `mdb' specifies the on-memory hash database object.
+   `shard' specifies the shard.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the stored value.
+   `vsiz' specifies the size of the region of the stored value.
+   `now' specifies the current time or 0 if the shard has no expiration time.
+   `fd' specifies the file descriptor of the snapshot file.
+   `xstr' specifies the buffer of writing, which is flushed when it gets full.
+   `rnp' specifies the pointer to the variable of the number of written records.
+   `sp' specifies the pointer to the variable of the size of written records.
+   If successful, the return value is true, else, it is false.
+   Each record is the flags, the size of the key, the size of the value, and the expiration
+   time, followed by the key and the value.  Values are written in their original form, as the
+   stored forms of counters depend on the database object.  An expired record is skipped. */
+static bool tcmdbdumprec(TCMDB *mdb, TCMDBSHARD *shard, const char *kbuf, int ksiz,
+                         const char *vbuf, int vsiz, int64_t now, int fd, TCXSTR *xstr,
+                         uint64_t *rnp, uint64_t *sp){
+  assert(mdb && shard && kbuf && ksiz >= 0 && vbuf && vsiz >= 0 && fd >= 0 && xstr && rnp && sp);
+  int64_t xtime = 0;
+  if(now > 0){
+    xtime = tcmdbshardxtime(shard, kbuf, ksiz, tcmdbhash(kbuf, ksiz));
+    if(xtime > 0 && xtime <= now) return true;
+  }
+  uint8_t flags = tcmdbstcheck(mdb, vbuf, vsiz) ? TCMDBSNAPSTRIPE : 0;
+  char *rbuf = NULL;
+  if(mdb->cmpsiz > 0 || __atomic_load_n(&mdb->cntuse, __ATOMIC_RELAXED)){
+    rbuf = tcmdbvaldup(mdb, vbuf, vsiz, &vsiz);
+    vbuf = rbuf;
+  }
+  uint64_t osiz = tcxstrsize(xstr);
+  tcxstrcat(xstr, &flags, sizeof(flags));
+  uint32_t lnum = TCHTOIL(ksiz);
+  tcxstrcat(xstr, &lnum, sizeof(lnum));
+  lnum = TCHTOIL(vsiz);
+  tcxstrcat(xstr, &lnum, sizeof(lnum));
+  uint64_t llnum = TCHTOILL(xtime);
+  tcxstrcat(xstr, &llnum, sizeof(llnum));
+  tcxstrcat(xstr, kbuf, ksiz);
+  tcxstrcat(xstr, vbuf, vsiz);
+  free(rbuf);
+  (*rnp)++;
+  *sp += tcxstrsize(xstr) - osiz;
+  if(tcxstrsize(xstr) >= TCMDBSNAPBUFSIZ){
+    if(!tcwrite(fd, tcxstrptr(xstr), tcxstrsize(xstr))) return false;
+    tcxstrclear(xstr);
+  }
+  return true;
+}
+
+
+/* Load sections of a snapshot into an on-memory hash database object.
+   `targ' specifies the pointer to the loader object.
+   The return value is `NULL'.
+   Sections are loaded in order of the index stepping by the number of the threads, and each
+   record is stored by the usual update functions so that it goes to the shard of the database
+   object whatever the number of shards of the snapshot is. */
+static void *tcmdbloadproc(void *targ){
+  TCMDBSNAPLD *arg = targ;
+  TCMDB *mdb = arg->mdb;
+  int64_t now = time(NULL);
+  for(int i = arg->id; i < arg->snum && arg->step > 0; i += arg->step){
+    uint64_t off = TCITOHLL(arg->dir[i*3]);
+    uint64_t size = TCITOHLL(arg->dir[i*3+1]);
+    uint64_t rnum = TCITOHLL(arg->dir[i*3+2]);
+    const char *rp = arg->ptr + off;
+    const char *ep = rp + size;
+    uint64_t cnt = 0;
+    while(rp < ep){
+      if(ep - rp < TCMDBSNAPRSIZ){
+        arg->err = true;
+        return NULL;
+      }
+      uint8_t flags = *(uint8_t *)rp;
+      uint32_t ksiz, vsiz;
+      memcpy(&ksiz, rp + 1, sizeof(ksiz));
+      ksiz = TCITOHL(ksiz);
+      memcpy(&vsiz, rp + 1 + sizeof(ksiz), sizeof(vsiz));
+      vsiz = TCITOHL(vsiz);
+      int64_t xtime;
+      memcpy(&xtime, rp + 1 + sizeof(ksiz) * 2, sizeof(xtime));
+      xtime = TCITOHLL(xtime);
+      rp += TCMDBSNAPRSIZ;
+      if(ksiz > TCMAPKMAXSIZ || vsiz > INT_MAX || (uint64_t)(ep - rp) < (uint64_t)ksiz + vsiz){
+        arg->err = true;
+        return NULL;
+      }
+      const char *kbuf = rp;
+      const char *vbuf = rp + ksiz;
+      rp += ksiz + vsiz;
+      cnt++;
+      if(xtime > 0 && xtime <= now) continue;
+      if(xtime > 0){
+        tcmdbputexp(mdb, kbuf, ksiz, vbuf, vsiz, xtime);
+      } else {
+        tcmdbput(mdb, kbuf, ksiz, vbuf, vsiz);
+      }
+      if(flags & TCMDBSNAPSTRIPE) tcmdbstripe(mdb, kbuf, ksiz);
+    }
+    if(cnt != rnum){
+      arg->err = true;
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+
+
+/*************************************************************************************************
+ * file hash database
+ *************************************************************************************************/
+
+
+#define TCHDBMAGIC     "DBM-HASH-1\n"    // magic data at the head of the file
+#define TCHDBHSIZ      256               // size of the header
+#define TCHDBDEFBNUM   1048573           // default number of the buckets
+#define TCHDBLOCKNUM   256               // number of the mutexes of records
+#define TCHDBPAGESIZ   4096              // unit of the size of the file
+#define TCHDBINITSIZ   (1ULL<<20)        // initial size of the region of records
+#define TCHDBGROWMAX   (1ULL<<30)        // maximum size of each expansion of the file
+#define TCHDBFCNUM     33                // number of size classes of free blocks
+#define TCHDBSPLITMIN  64                // minimum size of a block split from a free block
+#define TCHDBXSWEEP    65536             // number of buckets swept at each call of expiration
+#define TCHDBSCANSTEP  64                // number of buckets visited per record to be scanned
+#define TCHDBSCANBITS  20                // number of bits of the position in a chain in a cursor
+#define TCHDBFREEKSIZ  UINT32_MAX        // size of the key marking a free block
+
+typedef struct {                         // type of structure for the header of a database file
+  char magic[16];                        // magic data
+  uint64_t bnum;                         // number of the buckets
+  uint64_t rnum;                         // number of the records
+  uint64_t xnum;                         // number of the records with expiration times
+  uint64_t fsiz;                         // end offset of the region in use
+  uint64_t ffree;                        // offset of the first free block written at closing
+  uint64_t flags;                        // flags
+} TCHDBHEAD;
+
+typedef struct {                         // type of structure for a record of a database file
+  uint64_t next;                         // offset of the next record in the chain
+  uint32_t rsiz;                         // size of the whole block
+  uint32_t ksiz;                         // size of the key
+  uint32_t vsiz;                         // size of the value
+  uint32_t hchk;                         // upper half of the hash value of the key
+  int64_t xtime;                         // expiration time or 0
+} TCHDBREC;
+
+typedef struct {                         // type of structure for a size class of free blocks
+  uint64_t *offs;                        // offsets of the blocks
+  int num;                               // number of the blocks
+  int anum;                              // number of the allocated elements
+} TCHDBFCLS;
+
+enum {                                   // enumeration for flags of database files
+  TCHDBFOPEN = 1 << 0                    // the file is open
+};
+
+enum {                                   // enumeration for modes of storing
+  TCHDBPDOVER,                           // overwrite an existing value
+  TCHDBPDKEEP,                           // keep an existing value
+  TCHDBPDCAT,                            // concatenate values
+  TCHDBPDADDINT,                         // add an integer
+  TCHDBPDADDDBL,                         // add a real number
+  TCHDBPDINCR                            // add to a decimal counter
+};
+
+/* round up a size to a multiple of 8 */
+#define TCHDBALIGN(TC_size) (((uint64_t)(TC_size) + 7) & ~(uint64_t)7)
+
+/* get the offset of the first record from the number of the buckets */
+#define TCHDBFREC(TC_bnum) \
+  (((TCHDBHSIZ + (uint64_t)(TC_bnum) * sizeof(uint64_t)) + TCHDBPAGESIZ - 1) & \
+   ~(uint64_t)(TCHDBPAGESIZ - 1))
+
+/* get the size of the block of a record */
+#define TCHDBRSIZ(TC_ksiz, TC_vsiz) \
+  (sizeof(TCHDBREC) + TCHDBALIGN(TC_ksiz) + TCHDBALIGN(TC_vsiz))
+
+/* get the header of a file hash database */
+#define TCHDBHEADP(TC_hdb) ((TCHDBHEAD *)(TC_hdb)->map)
+
+/* get the array of the buckets of a file hash database */
+#define TCHDBBUCKETS(TC_hdb) ((uint64_t *)((TC_hdb)->map + TCHDBHSIZ))
+
+/* get a record of a file hash database by its offset */
+#define TCHDBRECP(TC_hdb, TC_off) ((TCHDBREC *)((TC_hdb)->map + (TC_off)))
+
+/* get the region of the key of a record */
+#define TCHDBRECKEY(TC_rec) ((char *)(TC_rec) + sizeof(TCHDBREC))
+
+/* get the region of the value of a record, which is aligned to 8 bytes */
+#define TCHDBRECVAL(TC_rec) (TCHDBRECKEY(TC_rec) + TCHDBALIGN((TC_rec)->ksiz))
+
+/* check whether a record has not expired */
+#define TCHDBLIVE(TC_rec, TC_now) ((TC_rec)->xtime <= 0 || (TC_rec)->xtime > (TC_now))
+
+
+/* private function prototypes */
+static bool tchdbmapfile(TCHDB *hdb, uint64_t size);
+static bool tchdbexpand(TCHDB *hdb, uint64_t size);
+static void tchdbfpush(TCHDB *hdb, uint64_t off, uint64_t rsiz);
+static void tchdbfclear(TCHDB *hdb);
+static uint64_t tchdballoc(TCHDB *hdb, uint64_t size);
+static void tchdbfree(TCHDB *hdb, uint64_t off);
+static void tchdbloadfree(TCHDB *hdb);
+static void tchdbsavefree(TCHDB *hdb);
+static bool tchdbrecvalid(TCHDB *hdb, uint64_t off, uint64_t fsiz);
+static void tchdbrecover(TCHDB *hdb);
+static int tchdboffcmp(const void *a, const void *b);
+static pthread_rwlock_t *tchdblock(TCHDB *hdb, uint64_t hash, bool wr, uint64_t *bp);
+static void tchdbunlock(TCHDB *hdb, pthread_rwlock_t *rmtx);
+static uint64_t *tchdbsearch(TCHDB *hdb, uint64_t bidx, const void *kbuf, int ksiz,
+                             uint64_t hash);
+static void tchdbunlink(TCHDB *hdb, uint64_t *lp);
+static int tchdbputproc(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                        int64_t xtime, uint64_t hash, int dmode, void *op);
+static int tchdbputimpl(TCHDB *hdb, uint64_t bidx, const char *kbuf, int ksiz,
+                        const char *vbuf, int vsiz, int64_t xtime, uint64_t hash, int dmode,
+                        void *op, uint64_t *np);
+
+
+/* Create a file hash database object. */
+TCHDB *tchdbnew(void){
+  TCHDB *hdb;
+  TCMALLOC(hdb, sizeof(*hdb));
+  if(pthread_rwlock_init(&hdb->mmtx, NULL) != 0) tcmyfatal("rwlock error");
+  TCMALLOC(hdb->rmtxs, sizeof(*hdb->rmtxs) * TCHDBLOCKNUM);
+  for(int i = 0; i < TCHDBLOCKNUM; i++){
+    if(pthread_rwlock_init(hdb->rmtxs + i, NULL) != 0) tcmyfatal("rwlock error");
+  }
+  if(pthread_mutex_init(&hdb->amtx, NULL) != 0) tcmyfatal("mutex error");
+  if(pthread_mutex_init(&hdb->imtx, NULL) != 0) tcmyfatal("mutex error");
+  hdb->path = NULL;
+  hdb->fd = -1;
+  hdb->map = NULL;
+  hdb->msiz = 0;
+  hdb->bnum = 0;
+  hdb->frec = 0;
+  hdb->fpool = tccalloc(TCHDBFCNUM, sizeof(TCHDBFCLS));
+  hdb->fnum = 0;
+  hdb->fsum = 0;
+  hdb->ibidx = 0;
+  hdb->ipos = 0;
+  hdb->xbidx = 0;
+  return hdb;
+}
+
+
+/* Delete a file hash database object. */
+void tchdbdel(TCHDB *hdb){
+  assert(hdb);
+  if(hdb->fd >= 0) tchdbclose(hdb);
+  tchdbfclear(hdb);
+  free(hdb->fpool);
+  pthread_mutex_destroy(&hdb->imtx);
+  pthread_mutex_destroy(&hdb->amtx);
+  for(int i = TCHDBLOCKNUM - 1; i >= 0; i--){
+    pthread_rwlock_destroy(hdb->rmtxs + i);
+  }
+  free(hdb->rmtxs);
+  pthread_rwlock_destroy(&hdb->mmtx);
+  free(hdb);
+}
+
+
+/* Open a database file and connect a file hash database object. */
+bool tchdbopen(TCHDB *hdb, const char *path, uint64_t bnum){
+  assert(hdb && path);
+  if(pthread_rwlock_wrlock(&hdb->mmtx) != 0) return false;
+  if(hdb->fd >= 0){
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return false;
+  }
+  int fd = open(path, O_RDWR | O_CREAT, 00644);
+  if(fd == -1){
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return false;
+  }
+  struct flock lock;
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  struct stat sbuf;
+  if(fcntl(fd, F_SETLK, &lock) == -1 || fstat(fd, &sbuf) == -1){
+    close(fd);
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return false;
+  }
+  hdb->fd = fd;
+  bool err = false;
+  if(sbuf.st_size == 0){
+    if(bnum < 1) bnum = TCHDBDEFBNUM;
+    hdb->bnum = bnum;
+    hdb->frec = TCHDBFREC(bnum);
+    if(tchdbmapfile(hdb, hdb->frec + TCHDBINITSIZ)){
+      TCHDBHEAD *head = TCHDBHEADP(hdb);
+      memcpy(head->magic, TCHDBMAGIC, sizeof(TCHDBMAGIC));
+      head->bnum = bnum;
+      head->fsiz = hdb->frec;
+    } else {
+      err = true;
+    }
+  } else if(sbuf.st_size < TCHDBHSIZ){
+    err = true;
+  } else {
+    char *map = mmap(0, sbuf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map != MAP_FAILED){
+      hdb->map = map;
+      hdb->msiz = sbuf.st_size;
+      TCHDBHEAD *head = TCHDBHEADP(hdb);
+      if(memcmp(head->magic, TCHDBMAGIC, sizeof(TCHDBMAGIC)) || head->bnum < 1 ||
+         head->bnum > (hdb->msiz - TCHDBHSIZ) / sizeof(uint64_t) ||
+         head->fsiz < TCHDBFREC(head->bnum) || head->fsiz > hdb->msiz){
+        err = true;
+      } else {
+        hdb->bnum = head->bnum;
+        hdb->frec = TCHDBFREC(head->bnum);
+        if(head->flags & TCHDBFOPEN){
+          tchdbrecover(hdb);
+        } else {
+          tchdbloadfree(hdb);
+        }
+      }
+    } else {
+      err = true;
+    }
+  }
+  if(err){
+    if(hdb->map) munmap(hdb->map, hdb->msiz);
+    close(fd);
+    tchdbfclear(hdb);
+    hdb->fd = -1;
+    hdb->map = NULL;
+    hdb->msiz = 0;
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return false;
+  }
+  TCHDBHEADP(hdb)->flags |= TCHDBFOPEN;
+  msync(hdb->map, TCHDBPAGESIZ, MS_SYNC);
+  hdb->path = tcstrdup(path);
+  hdb->ibidx = hdb->bnum;
+  hdb->ipos = 0;
+  hdb->xbidx = 0;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return true;
+}
+
+
+/* Close a file hash database object. */
+bool tchdbclose(TCHDB *hdb){
+  assert(hdb);
+  if(pthread_rwlock_wrlock(&hdb->mmtx) != 0) return false;
+  if(hdb->fd < 0){
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return false;
+  }
+  bool err = false;
+  tchdbsavefree(hdb);
+  if(msync(hdb->map, hdb->msiz, MS_SYNC) == -1) err = true;
+  TCHDBHEADP(hdb)->flags &= ~(uint64_t)TCHDBFOPEN;
+  if(msync(hdb->map, TCHDBPAGESIZ, MS_SYNC) == -1) err = true;
+  if(munmap(hdb->map, hdb->msiz) == -1) err = true;
+  if(close(hdb->fd) == -1) err = true;
+  tchdbfclear(hdb);
+  free(hdb->path);
+  hdb->path = NULL;
+  hdb->fd = -1;
+  hdb->map = NULL;
+  hdb->msiz = 0;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return !err;
+}
+
+
+/* Synchronize updated contents of a file hash database object with the device. */
+bool tchdbsync(TCHDB *hdb){
+  assert(hdb);
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return false;
+  bool err = !hdb->map || msync(hdb->map, hdb->msiz, MS_SYNC) == -1;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return !err;
+}
+
+
+/* Store a record into a file hash database object. */
+bool tchdbput(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+              int64_t xtime, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  return tchdbputproc(hdb, kbuf, ksiz, vbuf, vsiz, xtime, hash, TCHDBPDOVER, NULL) > 0;
+}
+
+
+/* Store a new record into a file hash database object. */
+bool tchdbputkeep(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                  int64_t xtime, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  return tchdbputproc(hdb, kbuf, ksiz, vbuf, vsiz, xtime, hash, TCHDBPDKEEP, NULL) > 0;
+}
+
+
+/* Concatenate a value at the end of the existing record in a file hash database object. */
+bool tchdbputcat(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                 uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  return tchdbputproc(hdb, kbuf, ksiz, vbuf, vsiz, 0, hash, TCHDBPDCAT, NULL) > 0;
+}
+
+
+/* Remove a record of a file hash database object. */
+bool tchdbout(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  uint64_t bidx;
+  pthread_rwlock_t *rmtx = tchdblock(hdb, hash, true, &bidx);
+  if(!rmtx) return false;
+  uint64_t *lp = tchdbsearch(hdb, bidx, kbuf, ksiz, hash);
+  bool rv = false;
+  if(lp){
+    rv = TCHDBLIVE(TCHDBRECP(hdb, *lp), (int64_t)time(NULL));
+    tchdbunlink(hdb, lp);
+  }
+  tchdbunlock(hdb, rmtx);
+  return rv;
+}
+
+
+/* Retrieve a record in a file hash database object. */
+void *tchdbget(TCHDB *hdb, const void *kbuf, int ksiz, int *sp, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0 && sp);
+  uint64_t bidx;
+  pthread_rwlock_t *rmtx = tchdblock(hdb, hash, false, &bidx);
+  if(!rmtx) return NULL;
+  uint64_t *lp = tchdbsearch(hdb, bidx, kbuf, ksiz, hash);
+  char *rv = NULL;
+  if(lp){
+    TCHDBREC *rec = TCHDBRECP(hdb, *lp);
+    if(TCHDBLIVE(rec, (int64_t)time(NULL))){
+      rv = tcmemdup(TCHDBRECVAL(rec), rec->vsiz);
+      *sp = rec->vsiz;
+    }
+  }
+  tchdbunlock(hdb, rmtx);
+  return rv;
+}
+
+
+/* Get the size of the value of a record in a file hash database object. */
+int tchdbvsiz(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  uint64_t bidx;
+  pthread_rwlock_t *rmtx = tchdblock(hdb, hash, false, &bidx);
+  if(!rmtx) return -1;
+  uint64_t *lp = tchdbsearch(hdb, bidx, kbuf, ksiz, hash);
+  int rv = -1;
+  if(lp){
+    TCHDBREC *rec = TCHDBRECP(hdb, *lp);
+    if(TCHDBLIVE(rec, (int64_t)time(NULL))) rv = rec->vsiz;
+  }
+  tchdbunlock(hdb, rmtx);
   return rv;
 }
 
 
-TCLIST *tcmdbmisc(TCMDB *mdb, const char *name, const TCLIST *args){
-  assert(mdb && name && args);
-  int argc = tclistnum(args);
-  TCLIST *rv;
-  if(!strcmp(name, "put") || !strcmp(name, "putkeep") || !strcmp(name, "putcat")){
-    if(argc > 1){
-      rv = tclistnew2(1);
-      const char *kbuf;
-      int ksiz;
-      kbuf = tclistval(args, 0, &ksiz);
-      const char *vbuf;
-      int vsiz;
-      vbuf = tclistval(args, 1, &vsiz);
-      bool err = false;
-      if(!strcmp(name, "put")){
-        tcmdbput(mdb, kbuf, ksiz, vbuf, vsiz);
-      } else if(!strcmp(name, "putkeep")){
-        if(!tcmdbputkeep(mdb, kbuf, ksiz, vbuf, vsiz)) err = true;
-      } else if(!strcmp(name, "putcat")){
-        tcmdbputcat(mdb, kbuf, ksiz, vbuf, vsiz);
-      }
-      if(err){
-        tclistdel(rv);
-        rv = NULL;
-      }
-    } else {
-      rv = NULL;
-    }
-  } else if(!strcmp(name, "out")){
-    if(argc > 0){
-      rv = tclistnew2(1);
-      const char *kbuf;
-      int ksiz;
-      kbuf = tclistval(args, 0, &ksiz);
-      if(!tcmdbout(mdb, kbuf, ksiz)){
-        tclistdel(rv);
-        rv = NULL;
-      }
-    } else {
-      rv = NULL;
+/* Visit the value of a record in a file hash database object without copying it. */
+bool tchdbvisit(TCHDB *hdb, const void *kbuf, int ksiz, TCVISITPROC proc, void *op,
+                uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0 && proc);
+  uint64_t bidx;
+  pthread_rwlock_t *rmtx = tchdblock(hdb, hash, false, &bidx);
+  if(!rmtx) return false;
+  uint64_t *lp = tchdbsearch(hdb, bidx, kbuf, ksiz, hash);
+  bool rv = false;
+  if(lp){
+    TCHDBREC *rec = TCHDBRECP(hdb, *lp);
+    if(TCHDBLIVE(rec, (int64_t)time(NULL))){
+      pthread_cleanup_push((void (*)(void *))pthread_rwlock_unlock, &hdb->mmtx);
+      pthread_cleanup_push((void (*)(void *))pthread_rwlock_unlock, rmtx);
+      proc(TCHDBRECVAL(rec), rec->vsiz, op);
+      pthread_cleanup_pop(0);
+      pthread_cleanup_pop(0);
+      rv = true;
     }
-  } else if(!strcmp(name, "get")){
-    if(argc > 0){
-      rv = tclistnew2(1);
-      const char *kbuf;
-      int ksiz;
-      kbuf = tclistval(args, 0, &ksiz);
-      int vsiz;
-      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-      if(vbuf){
-        tclistpush(rv, vbuf, vsiz);
-        free(vbuf);
-      } else {
-        tclistdel(rv);
-        rv = NULL;
+  }
+  tchdbunlock(hdb, rmtx);
+  return rv;
+}
+
+
+/* Initialize the iterator of a file hash database object. */
+void tchdbiterinit(TCHDB *hdb){
+  assert(hdb);
+  if(pthread_mutex_lock(&hdb->imtx) != 0) return;
+  hdb->ibidx = 0;
+  hdb->ipos = 0;
+  pthread_mutex_unlock(&hdb->imtx);
+}
+
+
+/* Initialize the iterator of a file hash database object in front of a key. */
+void tchdbiterinit2(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  if(pthread_mutex_lock(&hdb->imtx) != 0) return;
+  uint64_t bidx;
+  pthread_rwlock_t *rmtx = tchdblock(hdb, hash, false, &bidx);
+  if(rmtx){
+    uint32_t hchk = hash >> 32;
+    uint64_t off = TCHDBBUCKETS(hdb)[bidx];
+    uint64_t pos = 0;
+    while(off > 0){
+      TCHDBREC *rec = TCHDBRECP(hdb, off);
+      if(rec->hchk == hchk && rec->ksiz == ksiz && !memcmp(TCHDBRECKEY(rec), kbuf, ksiz)){
+        hdb->ibidx = bidx;
+        hdb->ipos = pos;
+        break;
       }
-    } else {
-      rv = NULL;
+      off = rec->next;
+      pos++;
     }
-  } else if(!strcmp(name, "putlist")){
-    rv = tclistnew2(1);
-    argc--;
-    for(int i = 0; i < argc; i += 2){
-      const char *kbuf, *vbuf;
-      int ksiz, vsiz;
-      kbuf = tclistval(args, i, &ksiz);
-      vbuf = tclistval(args, i + 1, &vsiz);
-      tcmdbput(mdb, kbuf, ksiz, vbuf, vsiz);
+    tchdbunlock(hdb, rmtx);
+  }
+  pthread_mutex_unlock(&hdb->imtx);
+}
+
+
+/* Get the next key of the iterator of a file hash database object. */
+void *tchdbiternext(TCHDB *hdb, int *sp){
+  assert(hdb && sp);
+  if(pthread_mutex_lock(&hdb->imtx) != 0) return NULL;
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0){
+    pthread_mutex_unlock(&hdb->imtx);
+    return NULL;
+  }
+  int64_t now = time(NULL);
+  char *rv = NULL;
+  while(hdb->map && !rv && hdb->ibidx < hdb->bnum){
+    uint64_t *bp = TCHDBBUCKETS(hdb) + hdb->ibidx;
+    if(__atomic_load_n(bp, __ATOMIC_RELAXED) < 1){
+      hdb->ibidx++;
+      hdb->ipos = 0;
+      continue;
     }
-  } else if(!strcmp(name, "outlist")){
-    rv = tclistnew2(1);
-    for(int i = 0; i < argc; i++){
-      const char *kbuf;
-      int ksiz;
-      kbuf = tclistval(args, i, &ksiz);
-      tcmdbout(mdb, kbuf, ksiz);
+    pthread_rwlock_t *rmtx = hdb->rmtxs + hdb->ibidx % TCHDBLOCKNUM;
+    if(pthread_rwlock_rdlock(rmtx) != 0) break;
+    uint64_t off = *bp;
+    for(uint64_t i = 0; off > 0 && i < hdb->ipos; i++){
+      off = TCHDBRECP(hdb, off)->next;
     }
-  } else if(!strcmp(name, "getlist")){
-    rv = tclistnew2(argc * 2);
-    for(int i = 0; i < argc; i++){
-      const char *kbuf;
-      int ksiz;
-      kbuf = tclistval(args, i, &ksiz);
-      int vsiz;
-      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-      if(vbuf){
-        tclistpush(rv, kbuf, ksiz);
-        tclistpush(rv, vbuf, vsiz);
-        free(vbuf);
+    while(off > 0){
+      TCHDBREC *rec = TCHDBRECP(hdb, off);
+      hdb->ipos++;
+      if(TCHDBLIVE(rec, now)){
+        rv = tcmemdup(TCHDBRECKEY(rec), rec->ksiz);
+        *sp = rec->ksiz;
+        break;
       }
+      off = rec->next;
     }
-  } else if(!strcmp(name, "getpart")){
-    if(argc > 0){
-      const char *kbuf;
-      int ksiz;
-      kbuf = tclistval(args, 0, &ksiz);
-      int off = argc > 1 ? tcatoi(tclistval0(args, 1)) : 0;
-      if(off < 0) off = 0;
-      if(off > INT_MAX / 2 - 1) off = INT_MAX - 1;
-      int len = argc > 2 ? tcatoi(tclistval0(args, 2)) : -1;
-      if(len < 0 || len > INT_MAX / 2) len = INT_MAX / 2;
-      int vsiz;
-      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-      if(vbuf){
-        if(off < vsiz){
-          rv = tclistnew2(1);
-          vsiz -= off;
-          if(vsiz > len) vsiz = len;
-          if(off > 0) memmove(vbuf, vbuf + off, vsiz);
-          tclistpushmalloc(rv, vbuf, vsiz);
-        } else {
-          rv = NULL;
-          free(vbuf);
-        }
-      } else {
-        rv = NULL;
-      }
-    } else {
-      rv = NULL;
+    if(!rv){
+      hdb->ibidx++;
+      hdb->ipos = 0;
     }
-  } else if(!strcmp(name, "iterinit")){
-    rv = tclistnew2(1);
-    if(argc > 0){
-      const char *kbuf;
-      int ksiz;
-      kbuf = tclistval(args, 0, &ksiz);
-      tcmdbiterinit2(mdb, kbuf, ksiz);
-    } else {
-      tcmdbiterinit(mdb);
+    pthread_rwlock_unlock(rmtx);
+  }
+  pthread_rwlock_unlock(&hdb->mmtx);
+  pthread_mutex_unlock(&hdb->imtx);
+  return rv;
+}
+
+
+/* Get forward matching keys in a file hash database object. */
+TCLIST *tchdbfwmkeys(TCHDB *hdb, const void *pbuf, int psiz, int max){
+  assert(hdb && pbuf && psiz >= 0);
+  if(max < 0) max = INT_MAX;
+  TCLIST *keys = tclistnew();
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return keys;
+  int64_t now = time(NULL);
+  uint64_t *buckets = hdb->map ? TCHDBBUCKETS(hdb) : NULL;
+  for(uint64_t i = 0; buckets && i < hdb->bnum && tclistnum(keys) < max; i++){
+    if(__atomic_load_n(buckets + i, __ATOMIC_RELAXED) < 1) continue;
+    pthread_rwlock_t *rmtx = hdb->rmtxs + i % TCHDBLOCKNUM;
+    if(pthread_rwlock_rdlock(rmtx) != 0) continue;
+    uint64_t off = buckets[i];
+    while(off > 0 && tclistnum(keys) < max){
+      TCHDBREC *rec = TCHDBRECP(hdb, off);
+      if(rec->ksiz >= psiz && !memcmp(TCHDBRECKEY(rec), pbuf, psiz) && TCHDBLIVE(rec, now))
+        tclistpush(keys, TCHDBRECKEY(rec), rec->ksiz);
+      off = rec->next;
     }
-  } else if(!strcmp(name, "iternext")){
-    rv = tclistnew2(1);
+    pthread_rwlock_unlock(rmtx);
+  }
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return keys;
+}
+
+
+/* Get keys of ranged records in a file hash database object. */
+TCLIST *tchdbrange(TCHDB *hdb, const void *bkbuf, int bksiz, const void *ekbuf, int eksiz,
+                   int max, bool vals){
+  assert(hdb && (!bkbuf || bksiz >= 0) && (!ekbuf || eksiz >= 0));
+  if(max < 0) max = INT_MAX;
+  TCLIST *keys = tclistnew();
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return keys;
+  int64_t now = time(NULL);
+  uint64_t *buckets = hdb->map ? TCHDBBUCKETS(hdb) : NULL;
+  for(uint64_t i = 0; buckets && i < hdb->bnum; i++){
+    if(__atomic_load_n(buckets + i, __ATOMIC_RELAXED) < 1) continue;
+    pthread_rwlock_t *rmtx = hdb->rmtxs + i % TCHDBLOCKNUM;
+    if(pthread_rwlock_rdlock(rmtx) != 0) continue;
+    uint64_t off = buckets[i];
+    while(off > 0){
+      TCHDBREC *rec = TCHDBRECP(hdb, off);
+      const char *kbuf = TCHDBRECKEY(rec);
+      if((!bkbuf || tcmdbidxcmp(kbuf, rec->ksiz, bkbuf, bksiz) >= 0) &&
+         (!ekbuf || tcmdbidxcmp(kbuf, rec->ksiz, ekbuf, eksiz) < 0) && TCHDBLIVE(rec, now))
+        tclistpush(keys, kbuf, rec->ksiz);
+      off = rec->next;
+    }
+    pthread_rwlock_unlock(rmtx);
+  }
+  pthread_rwlock_unlock(&hdb->mmtx);
+  qsort(keys->array + keys->start, keys->num, sizeof(keys->array[0]), tcmdbidxcmplist);
+  for(int i = max; i < keys->num; i++){
+    free(keys->array[keys->start+i].ptr);
+  }
+  if(keys->num > max) keys->num = max;
+  if(!vals) return keys;
+  TCLIST *recs = tclistnew2(tclistnum(keys) * 2);
+  for(int i = 0; i < tclistnum(keys); i++){
     int ksiz;
-    char *kbuf = tcmdbiternext(mdb, &ksiz);
-    if(kbuf){
-      tclistpush(rv, kbuf, ksiz);
-      int vsiz;
-      char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-      if(vbuf){
-        tclistpush(rv, vbuf, vsiz);
-        free(vbuf);
-      }
-      free(kbuf);
-    } else {
-      tclistdel(rv);
-      rv = NULL;
+    const char *kbuf = tclistval(keys, i, &ksiz);
+    int vsiz;
+    char *vbuf = tchdbget(hdb, kbuf, ksiz, &vsiz, tcmdbhash(kbuf, ksiz));
+    if(vbuf){
+      tclistpush(recs, kbuf, ksiz);
+      tclistpushmalloc(recs, vbuf, vsiz);
     }
-  } else if(!strcmp(name, "vanish")){
-    rv = tclistnew2(1);
-    tcmdbvanish(mdb);
-  } else if(!strcmp(name, "regex")){
-    if(argc > 0){
-      const char *regex = tclistval0(args, 0);
-      int options = REG_EXTENDED | REG_NOSUB;
-      if(*regex == '*'){
-        options |= REG_ICASE;
-        regex++;
+  }
+  tclistdel(keys);
+  return recs;
+}
+
+
+/* Scan records of a file hash database object with a cursor. */
+TCLIST *tchdbscan(TCHDB *hdb, uint64_t *cp, int max, bool vals){
+  assert(hdb && cp);
+  if(max < 0) max = INT_MAX;
+  TCLIST *recs = tclistnew();
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return recs;
+  if(!hdb->map){
+    pthread_rwlock_unlock(&hdb->mmtx);
+    *cp = 0;
+    return recs;
+  }
+  int64_t now = time(NULL);
+  uint64_t *buckets = TCHDBBUCKETS(hdb);
+  uint64_t bidx = *cp >> TCHDBSCANBITS;
+  uint64_t pos = *cp & ((1ULL << TCHDBSCANBITS) - 1);
+  int64_t vnum = (int64_t)max * TCHDBSCANSTEP;
+  int step = vals ? 2 : 1;
+  while(bidx < hdb->bnum && tclistnum(recs) / step < max && vnum-- > 0){
+    if(__atomic_load_n(buckets + bidx, __ATOMIC_RELAXED) < 1){
+      bidx++;
+      pos = 0;
+      continue;
+    }
+    pthread_rwlock_t *rmtx = hdb->rmtxs + bidx % TCHDBLOCKNUM;
+    if(pthread_rwlock_rdlock(rmtx) != 0) break;
+    uint64_t off = buckets[bidx];
+    for(uint64_t i = 0; off > 0 && i < pos; i++){
+      off = TCHDBRECP(hdb, off)->next;
+    }
+    while(off > 0 && tclistnum(recs) / step < max){
+      TCHDBREC *rec = TCHDBRECP(hdb, off);
+      if(TCHDBLIVE(rec, now)){
+        tclistpush(recs, TCHDBRECKEY(rec), rec->ksiz);
+        if(vals) tclistpush(recs, TCHDBRECVAL(rec), rec->vsiz);
       }
-      regex_t rbuf;
-      if(regcomp(&rbuf, regex, options) == 0){
-        rv = tclistnew();
-        int max = argc > 1 ? tcatoi(tclistval0(args, 1)) : 0;
-        if(max < 1) max = INT_MAX;
-        tcmdbiterinit(mdb);
-        char *kbuf;
-        int ksiz;
-        while(max > 0 && (kbuf = tcmdbiternext(mdb, &ksiz))){
-          if(regexec(&rbuf, kbuf, 0, NULL, 0) == 0){
-            int vsiz;
-            char *vbuf = tcmdbget(mdb, kbuf, ksiz, &vsiz);
-            if(vbuf){
-              tclistpush(rv, kbuf, ksiz);
-              tclistpush(rv, vbuf, vsiz);
-              free(vbuf);
-              max--;
-            }
-          }
-          free(kbuf);
-        }
-        regfree(&rbuf);
-      } else {
-        rv = NULL;
+      off = rec->next;
+      pos++;
+    }
+    if(off < 1 || pos >= (1ULL << TCHDBSCANBITS)){
+      bidx++;
+      pos = 0;
+    }
+    pthread_rwlock_unlock(rmtx);
+  }
+  *cp = (bidx < hdb->bnum) ? (bidx << TCHDBSCANBITS) | pos : 0;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return recs;
+}
+
+
+/* Get the keys of expired records of a file hash database object. */
+TCLIST *tchdbxkeys(TCHDB *hdb, int64_t now, int max){
+  assert(hdb && max >= 0);
+  TCLIST *keys = tclistnew();
+  if(pthread_mutex_lock(&hdb->imtx) != 0) return keys;
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0){
+    pthread_mutex_unlock(&hdb->imtx);
+    return keys;
+  }
+  if(hdb->map && __atomic_load_n(&TCHDBHEADP(hdb)->xnum, __ATOMIC_RELAXED) > 0){
+    uint64_t *buckets = TCHDBBUCKETS(hdb);
+    for(int i = 0; i < TCHDBXSWEEP && tclistnum(keys) < max; i++){
+      uint64_t bidx = hdb->xbidx;
+      hdb->xbidx = (bidx + 1) % hdb->bnum;
+      if(__atomic_load_n(buckets + bidx, __ATOMIC_RELAXED) < 1) continue;
+      pthread_rwlock_t *rmtx = hdb->rmtxs + bidx % TCHDBLOCKNUM;
+      if(pthread_rwlock_rdlock(rmtx) != 0) continue;
+      uint64_t off = buckets[bidx];
+      while(off > 0){
+        TCHDBREC *rec = TCHDBRECP(hdb, off);
+        if(rec->xtime > 0 && rec->xtime <= now) tclistpush(keys, TCHDBRECKEY(rec), rec->ksiz);
+        off = rec->next;
       }
-    } else {
-      rv = NULL;
+      pthread_rwlock_unlock(rmtx);
+    }
+  }
+  pthread_rwlock_unlock(&hdb->mmtx);
+  pthread_mutex_unlock(&hdb->imtx);
+  return keys;
+}
+
+
+/* Remove an expired record of a file hash database object. */
+bool tchdbxout(TCHDB *hdb, const void *kbuf, int ksiz, int64_t now, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  uint64_t bidx;
+  pthread_rwlock_t *rmtx = tchdblock(hdb, hash, true, &bidx);
+  if(!rmtx) return false;
+  uint64_t *lp = tchdbsearch(hdb, bidx, kbuf, ksiz, hash);
+  bool rv = false;
+  if(lp){
+    TCHDBREC *rec = TCHDBRECP(hdb, *lp);
+    if(rec->xtime > 0 && rec->xtime <= now){
+      tchdbunlink(hdb, lp);
+      rv = true;
     }
-  } else {
-    rv = NULL;
   }
+  tchdbunlock(hdb, rmtx);
   return rv;
 }
 
 
-/* Create an on-memory hash database object. */
-TCMDB *tcmdbnew(void){
-  return tcmdbnew2(TCMDBDEFBNUM);
+/* Get the expiration time of a record in a file hash database object. */
+int64_t tchdbxtime(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  uint64_t bidx;
+  pthread_rwlock_t *rmtx = tchdblock(hdb, hash, false, &bidx);
+  if(!rmtx) return 0;
+  uint64_t *lp = tchdbsearch(hdb, bidx, kbuf, ksiz, hash);
+  int64_t xtime = lp ? TCHDBRECP(hdb, *lp)->xtime : 0;
+  tchdbunlock(hdb, rmtx);
+  return xtime;
+}
+
+
+/* Get the number of records with expiration times of a file hash database object. */
+uint64_t tchdbxnum(TCHDB *hdb){
+  assert(hdb);
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return 0;
+  uint64_t xnum = hdb->map ? __atomic_load_n(&TCHDBHEADP(hdb)->xnum, __ATOMIC_RELAXED) : 0;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return xnum;
+}
+
+
+/* Add an integer to a record in a file hash database object. */
+int tchdbaddint(TCHDB *hdb, const void *kbuf, int ksiz, int num, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  int rv;
+  if(tchdbputproc(hdb, kbuf, ksiz, &num, sizeof(num), 0, hash, TCHDBPDADDINT, &rv) < 1)
+    return INT_MIN;
+  return rv;
+}
+
+
+/* Add a real number to a record in a file hash database object. */
+double tchdbadddouble(TCHDB *hdb, const void *kbuf, int ksiz, double num, uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  double rv;
+  if(tchdbputproc(hdb, kbuf, ksiz, &num, sizeof(num), 0, hash, TCHDBPDADDDBL, &rv) < 1)
+    return nan("");
+  return rv;
+}
+
+
+/* Add an integer to a decimal counter of a record in a file hash database object. */
+int tchdbincr(TCHDB *hdb, const void *kbuf, int ksiz, int64_t num, uint64_t *np,
+              uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0 && np);
+  return tchdbputproc(hdb, kbuf, ksiz, &num, sizeof(num), 0, hash, TCHDBPDINCR, np);
+}
+
+
+/* Clear a file hash database object. */
+bool tchdbvanish(TCHDB *hdb){
+  assert(hdb);
+  if(pthread_rwlock_wrlock(&hdb->mmtx) != 0) return false;
+  if(!hdb->map){
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return false;
+  }
+  memset(TCHDBBUCKETS(hdb), 0, hdb->bnum * sizeof(uint64_t));
+  TCHDBHEAD *head = TCHDBHEADP(hdb);
+  head->rnum = 0;
+  head->xnum = 0;
+  head->fsiz = hdb->frec;
+  tchdbfclear(hdb);
+  bool err = false;
+  if(hdb->msiz > hdb->frec + TCHDBINITSIZ && !tchdbmapfile(hdb, hdb->frec + TCHDBINITSIZ))
+    err = true;
+  hdb->ibidx = hdb->bnum;
+  hdb->ipos = 0;
+  hdb->xbidx = 0;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return !err;
+}
+
+
+/* Get the number of records stored in a file hash database object. */
+uint64_t tchdbrnum(TCHDB *hdb){
+  assert(hdb);
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return 0;
+  uint64_t rnum = hdb->map ? __atomic_load_n(&TCHDBHEADP(hdb)->rnum, __ATOMIC_RELAXED) : 0;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return rnum;
 }
 
 
-/* Create an on-memory hash database with specifying the number of the buckets. */
-TCMDB *tcmdbnew2(uint32_t bnum){
-  TCMDB *mdb;
-  if(bnum < 1) bnum = TCMDBDEFBNUM;
-  bnum = bnum / TCMDBMNUM + 17;
-  TCMALLOC(mdb, sizeof(*mdb));
-  TCMALLOC(mdb->mmtxs, sizeof(pthread_rwlock_t) * TCMDBMNUM);
-  TCMALLOC(mdb->imtx, sizeof(pthread_mutex_t));
-  TCMALLOC(mdb->maps, sizeof(TCMAP *) * TCMDBMNUM);
-  if(pthread_mutex_init(mdb->imtx, NULL) != 0) tcmyfatal("mutex error");
-  for(int i = 0; i < TCMDBMNUM; i++){
-    if(pthread_rwlock_init((pthread_rwlock_t *)mdb->mmtxs + i, NULL) != 0)
-      tcmyfatal("rwlock error");
-    mdb->maps[i] = tcmapnew2(bnum);
+/* Get the size of the database file of a file hash database object. */
+uint64_t tchdbfsiz(TCHDB *hdb, uint64_t *fsp){
+  assert(hdb);
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return 0;
+  uint64_t fsiz = hdb->msiz;
+  if(fsp){
+    pthread_mutex_lock(&hdb->amtx);
+    *fsp = hdb->fsum;
+    pthread_mutex_unlock(&hdb->amtx);
   }
-  mdb->iter = -1;
-  return mdb;
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return fsiz;
 }
 
 
-/* Delete an on-memory hash database object. */
-void tcmdbdel(TCMDB *mdb){
-  assert(mdb);
-  for(int i = TCMDBMNUM - 1; i >= 0; i--){
-    tcmapdel(mdb->maps[i]);
-    pthread_rwlock_destroy((pthread_rwlock_t *)mdb->mmtxs + i);
+/* Change the size of the database file and map it.
+   `hdb' specifies the file hash database object locked for writing.
+   `size' specifies the new size of the file.
+   If successful, the return value is true, else, it is false.
+   The added region is allocated on the device beforehand so that writing into the mapping does
+   not raise a bus error when the device is full. */
+static bool tchdbmapfile(TCHDB *hdb, uint64_t size){
+  assert(hdb && size > 0);
+  if(size < hdb->msiz){
+    char *map = mremap(hdb->map, hdb->msiz, size, 0);
+    if(map == MAP_FAILED) return false;
+    hdb->msiz = size;
+    return ftruncate(hdb->fd, size) == 0;
   }
-  pthread_mutex_destroy(mdb->imtx);
-  free(mdb->maps);
-  free(mdb->imtx);
-  free(mdb->mmtxs);
-  free(mdb);
+  if(ftruncate(hdb->fd, size) == -1 ||
+     posix_fallocate(hdb->fd, hdb->msiz, size - hdb->msiz) != 0) return false;
+  char *map = hdb->map ? mremap(hdb->map, hdb->msiz, size, MREMAP_MAYMOVE) :
+    mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, hdb->fd, 0);
+  if(map == MAP_FAILED) return false;
+  hdb->map = map;
+  hdb->msiz = size;
+  return true;
 }
 
 
-/* Store a record into an on-memory hash database. */
-void tcmdbput(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
-  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return;
-  tcmapput(mdb->maps[mi], kbuf, ksiz, vbuf, vsiz);
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-}
-
-/* Store a new record into an on-memory hash database. */
-bool tcmdbputkeep(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
-  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return false;
-  bool rv = tcmapputkeep(mdb->maps[mi], kbuf, ksiz, vbuf, vsiz);
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  return rv;
+/* Expand the database file of a file hash database object.
+   `hdb' specifies the file hash database object.
+   `size' specifies the size of the block to be allocated.
+   If successful, the return value is true, else, it is false.
+   The file grows by its current size up to the limit of each expansion, so that the number of
+   remapping is logarithmic. */
+static bool tchdbexpand(TCHDB *hdb, uint64_t size){
+  assert(hdb && size > 0);
+  if(pthread_rwlock_wrlock(&hdb->mmtx) != 0) return false;
+  bool err = false;
+  if(!hdb->map){
+    err = true;
+  } else if(TCHDBHEADP(hdb)->fsiz + size > hdb->msiz){
+    uint64_t inc = hdb->msiz < TCHDBGROWMAX ? hdb->msiz : TCHDBGROWMAX;
+    if(inc < size) inc = size;
+    uint64_t nsiz = (hdb->msiz + inc + TCHDBPAGESIZ - 1) & ~(uint64_t)(TCHDBPAGESIZ - 1);
+    if(!tchdbmapfile(hdb, nsiz)) err = true;
+  }
+  pthread_rwlock_unlock(&hdb->mmtx);
+  return !err;
 }
 
 
-/* Concatenate a value at the end of the existing record in an on-memory hash database. */
-void tcmdbputcat(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz){
-  assert(mdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return;
-  tcmapputcat(mdb->maps[mi], kbuf, ksiz, vbuf, vsiz);
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
+/* Add a free block into the size classes of a file hash database object.
+   `hdb' specifies the file hash database object.
+   `off' specifies the offset of the block.
+   `rsiz' specifies the size of the block. */
+static void tchdbfpush(TCHDB *hdb, uint64_t off, uint64_t rsiz){
+  assert(hdb && off > 0 && rsiz >= sizeof(TCHDBREC));
+  TCHDBFCLS *fcls = (TCHDBFCLS *)hdb->fpool + (63 - __builtin_clzll(rsiz));
+  if(fcls->num >= fcls->anum){
+    fcls->anum = fcls->anum > 0 ? fcls->anum * 2 : 64;
+    TCREALLOC(fcls->offs, fcls->offs, sizeof(*fcls->offs) * fcls->anum);
+  }
+  fcls->offs[fcls->num++] = off;
+  hdb->fnum++;
+  hdb->fsum += rsiz;
 }
 
 
-/* Remove a record of an on-memory hash database. */
-bool tcmdbout(TCMDB *mdb, const void *kbuf, int ksiz){
-  assert(mdb && kbuf && ksiz >= 0);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return false;
-  bool rv = tcmapout(mdb->maps[mi], kbuf, ksiz);
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  return rv;
+/* Clear the size classes of free blocks of a file hash database object.
+   `hdb' specifies the file hash database object. */
+static void tchdbfclear(TCHDB *hdb){
+  assert(hdb);
+  TCHDBFCLS *fpool = hdb->fpool;
+  for(int i = 0; i < TCHDBFCNUM; i++){
+    free(fpool[i].offs);
+    fpool[i].offs = NULL;
+    fpool[i].num = 0;
+    fpool[i].anum = 0;
+  }
+  hdb->fnum = 0;
+  hdb->fsum = 0;
 }
 
 
-/* Retrieve a record in an on-memory hash database. */
-void *tcmdbget(TCMDB *mdb, const void *kbuf, int ksiz, int *sp){
-  assert(mdb && kbuf && ksiz >= 0 && sp);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_rdlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return NULL;
-  int vsiz;
-  const char *vbuf = tcmapget(mdb->maps[mi], kbuf, ksiz, &vsiz);
-  char *rv;
-  if(vbuf){
-    rv = tcmemdup(vbuf, vsiz);
-    *sp = vsiz;
+/* Allocate a block in the database file of a file hash database object.
+   `hdb' specifies the file hash database object locked for reading.
+   `size' specifies the size of the block, which is a multiple of 8.
+   The return value is the offset of the block, or 0 if the file should be expanded.
+   A free block of the same size class is tried first and a block of the next larger class is
+   split.  Otherwise, the block is appended at the end of the region in use.  The size of the
+   block is written before the block becomes a part of the region in use, so that the blocks
+   can be walked from the first record after a crash. */
+static uint64_t tchdballoc(TCHDB *hdb, uint64_t size){
+  assert(hdb && size >= sizeof(TCHDBREC) && size % 8 == 0);
+  if(pthread_mutex_lock(&hdb->amtx) != 0) return 0;
+  TCHDBFCLS *fpool = hdb->fpool;
+  int cidx = 63 - __builtin_clzll(size);
+  uint64_t off = 0;
+  TCHDBFCLS *fcls = fpool + cidx;
+  if(fcls->num > 0 && TCHDBRECP(hdb, fcls->offs[fcls->num-1])->rsiz >= size){
+    off = fcls->offs[--fcls->num];
   } else {
-    rv = NULL;
+    for(cidx++; cidx < TCHDBFCNUM; cidx++){
+      fcls = fpool + cidx;
+      if(fcls->num > 0){
+        off = fcls->offs[--fcls->num];
+        break;
+      }
+    }
   }
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  return rv;
+  if(off > 0){
+    TCHDBREC *rec = TCHDBRECP(hdb, off);
+    uint64_t rsiz = rec->rsiz;
+    hdb->fnum--;
+    hdb->fsum -= rsiz;
+    if(rsiz - size >= TCHDBSPLITMIN){
+      TCHDBREC *rrec = TCHDBRECP(hdb, off + size);
+      rrec->rsiz = rsiz - size;
+      rrec->ksiz = TCHDBFREEKSIZ;
+      __atomic_store_n(&rec->rsiz, size, __ATOMIC_RELEASE);
+      tchdbfpush(hdb, off + size, rsiz - size);
+    }
+  } else {
+    TCHDBHEAD *head = TCHDBHEADP(hdb);
+    if(head->fsiz + size <= hdb->msiz){
+      off = head->fsiz;
+      TCHDBREC *rec = TCHDBRECP(hdb, off);
+      rec->rsiz = size;
+      rec->ksiz = TCHDBFREEKSIZ;
+      __atomic_store_n(&head->fsiz, off + size, __ATOMIC_RELEASE);
+    }
+  }
+  pthread_mutex_unlock(&hdb->amtx);
+  return off;
 }
 
 
-/* Get the size of the value of a record in an on-memory hash database object. */
-int tcmdbvsiz(TCMDB *mdb, const void *kbuf, int ksiz){
-  assert(mdb && kbuf && ksiz >= 0);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_rdlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return -1;
-  int vsiz;
-  const char *vbuf = tcmapget(mdb->maps[mi], kbuf, ksiz, &vsiz);
-  if(!vbuf) vsiz = -1;
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  return vsiz;
+/* Release a block in the database file of a file hash database object.
+   `hdb' specifies the file hash database object locked for reading.
+   `off' specifies the offset of the block, which is no longer linked from any bucket.
+   The contents of the block are kept until it is reused. */
+static void tchdbfree(TCHDB *hdb, uint64_t off){
+  assert(hdb && off > 0);
+  if(pthread_mutex_lock(&hdb->amtx) != 0) return;
+  tchdbfpush(hdb, off, TCHDBRECP(hdb, off)->rsiz);
+  pthread_mutex_unlock(&hdb->amtx);
 }
 
 
-/* Initialize the iterator of an on-memory hash database. */
-void tcmdbiterinit(TCMDB *mdb){
-  assert(mdb);
-  if(pthread_mutex_lock(mdb->imtx) != 0) return;
-  for(int i = 0; i < TCMDBMNUM; i++){
-    tcmapiterinit(mdb->maps[i]);
+/* Load the free blocks written at closing of a file hash database object.
+   `hdb' specifies the file hash database object locked for writing.
+   If the chain of the free blocks is broken, the free blocks are reconstructed. */
+static void tchdbloadfree(TCHDB *hdb){
+  assert(hdb);
+  TCHDBHEAD *head = TCHDBHEADP(hdb);
+  uint64_t off = head->ffree;
+  uint64_t lim = (head->fsiz - hdb->frec) / sizeof(TCHDBREC);
+  while(off > 0){
+    TCHDBREC *rec = off >= hdb->frec && off % 8 == 0 && off + sizeof(TCHDBREC) <= head->fsiz ?
+      TCHDBRECP(hdb, off) : NULL;
+    if(!rec || rec->ksiz != TCHDBFREEKSIZ || rec->rsiz < sizeof(TCHDBREC) ||
+       off + rec->rsiz > head->fsiz || lim-- < 1){
+      tchdbfclear(hdb);
+      tchdbrecover(hdb);
+      return;
+    }
+    tchdbfpush(hdb, off, rec->rsiz);
+    off = rec->next;
   }
-  mdb->iter = 0;
-  pthread_mutex_unlock(mdb->imtx);
+  head->ffree = 0;
 }
 
 
-/* Get the next key of the iterator of an on-memory hash database. */
-void *tcmdbiternext(TCMDB *mdb, int *sp){
-  assert(mdb && sp);
-  if(pthread_mutex_lock(mdb->imtx) != 0) return NULL;
-  if(mdb->iter < 0 || mdb->iter >= TCMDBMNUM){
-    pthread_mutex_unlock(mdb->imtx);
-    return NULL;
-  }
-  int mi = mdb->iter;
-  if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0){
-    pthread_mutex_unlock(mdb->imtx);
-    return NULL;
-  }
-  int ksiz;
-  const char *kbuf;
-  while(!(kbuf = tcmapiternext(mdb->maps[mi], &ksiz)) && mi < TCMDBMNUM - 1){
-    pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-    mi = ++mdb->iter;
-    if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0){
-      pthread_mutex_unlock(mdb->imtx);
-      return NULL;
+/* Write the free blocks of a file hash database object into the file.
+   `hdb' specifies the file hash database object locked for writing.
+   The free blocks are chained by their headers from the header of the file. */
+static void tchdbsavefree(TCHDB *hdb){
+  assert(hdb);
+  TCHDBFCLS *fpool = hdb->fpool;
+  uint64_t first = 0;
+  for(int i = 0; i < TCHDBFCNUM; i++){
+    for(int j = 0; j < fpool[i].num; j++){
+      TCHDBREC *rec = TCHDBRECP(hdb, fpool[i].offs[j]);
+      rec->ksiz = TCHDBFREEKSIZ;
+      rec->next = first;
+      first = fpool[i].offs[j];
     }
   }
-  char *rv;
-  if(kbuf){
-    rv = tcmemdup(kbuf, ksiz);
-    *sp = ksiz;
-  } else {
-    rv = NULL;
-  }
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  pthread_mutex_unlock(mdb->imtx);
-  return rv;
+  TCHDBHEADP(hdb)->ffree = first;
 }
 
 
-/* Get forward matching keys in an on-memory hash database object. */
-TCLIST *tcmdbfwmkeys(TCMDB *mdb, const void *pbuf, int psiz, int max){
-  assert(mdb && pbuf && psiz >= 0);
-  TCLIST* keys = tclistnew();
-  if(pthread_mutex_lock(mdb->imtx) != 0) return keys;
-  if(max < 0) max = INT_MAX;
-  for(int i = 0; i < TCMDBMNUM && tclistnum(keys) < max; i++){
-    if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + i) == 0){
-      TCMAP *map = mdb->maps[i];
-      TCMAPREC *cur = map->cur;
-      tcmapiterinit(map);
-      const char *kbuf;
-      int ksiz;
-      while(tclistnum(keys) < max && (kbuf = tcmapiternext(map, &ksiz)) != NULL){
-        if(ksiz >= psiz && !memcmp(kbuf, pbuf, psiz)) tclistpush(keys, kbuf, ksiz);
+/* Check whether a linked record of a file hash database object is sane.
+   `hdb' specifies the file hash database object.
+   `off' specifies the offset of the record.
+   `fsiz' specifies the end offset of the region in use.
+   The return value is true if the record is sane, else, it is false. */
+static bool tchdbrecvalid(TCHDB *hdb, uint64_t off, uint64_t fsiz){
+  assert(hdb);
+  if(off < hdb->frec || off % 8 != 0 || off + sizeof(TCHDBREC) > fsiz) return false;
+  TCHDBREC *rec = TCHDBRECP(hdb, off);
+  return rec->ksiz != TCHDBFREEKSIZ && rec->rsiz >= TCHDBRSIZ(rec->ksiz, rec->vsiz) &&
+    off + rec->rsiz <= fsiz;
+}
+
+
+/* Reconstruct the free blocks of a file hash database object after a crash.
+   `hdb' specifies the file hash database object locked for writing.
+   Every record linked from the buckets is collected and the blocks are walked by their sizes
+   from the first record.  Blocks not linked from any bucket are released and adjacent ones are
+   merged.  The numbers of the records are counted again. */
+static void tchdbrecover(TCHDB *hdb){
+  assert(hdb);
+  TCHDBHEAD *head = TCHDBHEADP(hdb);
+  uint64_t fsiz = head->fsiz;
+  uint64_t *buckets = TCHDBBUCKETS(hdb);
+  uint64_t lim = (fsiz - hdb->frec) / sizeof(TCHDBREC);
+  uint64_t anum = 1024;
+  uint64_t onum = 0;
+  uint64_t *offs;
+  TCMALLOC(offs, sizeof(*offs) * anum);
+  uint64_t rnum = 0;
+  uint64_t xnum = 0;
+  for(uint64_t i = 0; i < hdb->bnum; i++){
+    uint64_t *lp = buckets + i;
+    uint64_t cnum = 0;
+    while(*lp > 0){
+      if(!tchdbrecvalid(hdb, *lp, fsiz) || cnum++ >= lim){
+        *lp = 0;
+        break;
       }
-      map->cur = cur;
-      pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + i);
+      if(onum >= anum){
+        anum *= 2;
+        TCREALLOC(offs, offs, sizeof(*offs) * anum);
+      }
+      offs[onum++] = *lp;
+      TCHDBREC *rec = TCHDBRECP(hdb, *lp);
+      rnum++;
+      if(rec->xtime > 0) xnum++;
+      lp = &rec->next;
     }
   }
-  pthread_mutex_unlock(mdb->imtx);
-  return keys;
+  qsort(offs, onum, sizeof(*offs), tchdboffcmp);
+  uint64_t off = hdb->frec;
+  uint64_t oidx = 0;
+  uint64_t foff = 0;
+  uint64_t fsum = 0;
+  while(off + sizeof(TCHDBREC) <= fsiz){
+    TCHDBREC *rec = TCHDBRECP(hdb, off);
+    uint64_t rsiz = rec->rsiz;
+    if(rsiz < sizeof(TCHDBREC) || rsiz % 8 != 0 || off + rsiz > fsiz) break;
+    while(oidx < onum && offs[oidx] < off){
+      oidx++;
+    }
+    if(oidx < onum && offs[oidx] == off){
+      if(fsum > 0){
+        TCHDBRECP(hdb, foff)->rsiz = fsum;
+        tchdbfpush(hdb, foff, fsum);
+        fsum = 0;
+      }
+    } else if(fsum > 0 && fsum + rsiz <= UINT32_MAX){
+      fsum += rsiz;
+    } else {
+      if(fsum > 0){
+        TCHDBRECP(hdb, foff)->rsiz = fsum;
+        tchdbfpush(hdb, foff, fsum);
+      }
+      rec->ksiz = TCHDBFREEKSIZ;
+      foff = off;
+      fsum = rsiz;
+    }
+    off += rsiz;
+  }
+  while(oidx < onum && offs[oidx] < off){
+    oidx++;
+  }
+  if(oidx >= onum){
+    if(fsum > 0) off = foff;
+    head->fsiz = off;
+  } else if(fsum > 0){
+    TCHDBRECP(hdb, foff)->rsiz = fsum;
+    tchdbfpush(hdb, foff, fsum);
+  }
+  free(offs);
+  head->rnum = rnum;
+  head->xnum = xnum;
+  head->ffree = 0;
 }
 
 
-/* Get the number of records stored in an on-memory hash database. */
-uint64_t tcmdbrnum(TCMDB *mdb){
-  assert(mdb);
-  uint64_t rnum = 0;
-  for(int i = 0; i < TCMDBMNUM; i++){
-    rnum += tcmaprnum(mdb->maps[i]);
-  }
-  return rnum;
+/* Compare two offsets of records.
+   `a' specifies the pointer to one offset.
+   `b' specifies the pointer to the other offset.
+   The return value is positive if the former is big, negative if the latter is big, 0 if both
+   are equivalent. */
+static int tchdboffcmp(const void *a, const void *b){
+  assert(a && b);
+  uint64_t aoff = *(uint64_t *)a;
+  uint64_t boff = *(uint64_t *)b;
+  return (aoff > boff) - (aoff < boff);
 }
 
 
-/* Get the total size of memory used in an on-memory hash database object. */
-uint64_t tcmdbmsiz(TCMDB *mdb){
-  assert(mdb);
-  uint64_t msiz = 0;
-  for(int i = 0; i < TCMDBMNUM; i++){
-    msiz += tcmapmsiz(mdb->maps[i]);
+/* Lock a file hash database object and the mutex of the bucket of a key.
+   `hdb' specifies the file hash database object.
+   `hash' specifies the hash value of the key.
+   `wr' specifies whether the bucket is locked for writing.
+   `bp' specifies the pointer to the variable into which the index of the bucket is assigned.
+   The return value is the mutex of the bucket, or `NULL' on failure.  The object itself is
+   locked for reading so that it is not remapped while the bucket is in use. */
+static pthread_rwlock_t *tchdblock(TCHDB *hdb, uint64_t hash, bool wr, uint64_t *bp){
+  assert(hdb && bp);
+  if(pthread_rwlock_rdlock(&hdb->mmtx) != 0) return NULL;
+  if(!hdb->map){
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return NULL;
   }
-  return msiz;
+  *bp = hash % hdb->bnum;
+  pthread_rwlock_t *rmtx = hdb->rmtxs + *bp % TCHDBLOCKNUM;
+  if((wr ? pthread_rwlock_wrlock(rmtx) : pthread_rwlock_rdlock(rmtx)) != 0){
+    pthread_rwlock_unlock(&hdb->mmtx);
+    return NULL;
+  }
+  return rmtx;
 }
 
 
-/* Add an integer to a record in an on-memory hash database object. */
-int tcmdbaddint(TCMDB *mdb, const void *kbuf, int ksiz, int num){
-  assert(mdb && kbuf && ksiz >= 0);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return INT_MIN;
-  int rv = tcmapaddint(mdb->maps[mi], kbuf, ksiz, num);
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  return rv;
+/* Unlock a file hash database object and the mutex of a bucket.
+   `hdb' specifies the file hash database object.
+   `rmtx' specifies the mutex of the bucket. */
+static void tchdbunlock(TCHDB *hdb, pthread_rwlock_t *rmtx){
+  assert(hdb && rmtx);
+  pthread_rwlock_unlock(rmtx);
+  pthread_rwlock_unlock(&hdb->mmtx);
 }
 
 
-/* Add a real number to a record in an on-memory hash database object. */
-double tcmdbadddouble(TCMDB *mdb, const void *kbuf, int ksiz, double num){
-  assert(mdb && kbuf && ksiz >= 0);
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0) return nan("");
-  double rv = tcmapadddouble(mdb->maps[mi], kbuf, ksiz, num);
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  return rv;
+/* Search the chain of a bucket of a file hash database object for a key.
+   `hdb' specifies the file hash database object whose bucket is locked.
+   `bidx' specifies the index of the bucket.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key.
+   The return value is the pointer to the link to the record in the bucket or in the previous
+   record, or `NULL' if no record corresponds.  Expired records are found as well. */
+static uint64_t *tchdbsearch(TCHDB *hdb, uint64_t bidx, const void *kbuf, int ksiz,
+                             uint64_t hash){
+  assert(hdb && kbuf && ksiz >= 0);
+  uint32_t hchk = hash >> 32;
+  uint64_t *lp = TCHDBBUCKETS(hdb) + bidx;
+  while(*lp > 0){
+    TCHDBREC *rec = TCHDBRECP(hdb, *lp);
+    if(rec->hchk == hchk && rec->ksiz == ksiz && !memcmp(TCHDBRECKEY(rec), kbuf, ksiz))
+      return lp;
+    lp = &rec->next;
+  }
+  return NULL;
 }
 
 
-/* Clear an on-memory hash database object. */
-void tcmdbvanish(TCMDB *mdb){
-  assert(mdb);
-  for(int i = 0; i < TCMDBMNUM; i++){
-    if(pthread_rwlock_wrlock((pthread_rwlock_t *)mdb->mmtxs + i) == 0){
-      tcmapclear(mdb->maps[i]);
-      pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + i);
-    }
+/* Unlink a record of a file hash database object and release its block.
+   `hdb' specifies the file hash database object whose bucket is locked for writing.
+   `lp' specifies the pointer to the link to the record. */
+static void tchdbunlink(TCHDB *hdb, uint64_t *lp){
+  assert(hdb && lp);
+  uint64_t off = *lp;
+  TCHDBREC *rec = TCHDBRECP(hdb, off);
+  __atomic_store_n(lp, rec->next, __ATOMIC_RELEASE);
+  TCHDBHEAD *head = TCHDBHEADP(hdb);
+  __atomic_sub_fetch(&head->rnum, 1, __ATOMIC_RELAXED);
+  if(rec->xtime > 0) __atomic_sub_fetch(&head->xnum, 1, __ATOMIC_RELAXED);
+  tchdbfree(hdb, off);
+}
+
+
+/* Store a record into a file hash database object in a mode.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value or of the additional number.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time.
+   `hash' specifies the hash value of the key.
+   `dmode' specifies the mode of storing.
+   `op' specifies the pointer to the variable into which the resulting number is assigned.
+   The return value is 1 if the record is stored, 0 if it is not, or -1 on failure.
+   When the file is short of space, it is expanded and the operation is retried. */
+static int tchdbputproc(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                        int64_t xtime, uint64_t hash, int dmode, void *op){
+  assert(hdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  uint64_t need = 0;
+  while(true){
+    if(need > 0 && !tchdbexpand(hdb, need)) return -1;
+    uint64_t bidx;
+    pthread_rwlock_t *rmtx = tchdblock(hdb, hash, true, &bidx);
+    if(!rmtx) return -1;
+    int rv = tchdbputimpl(hdb, bidx, kbuf, ksiz, vbuf, vsiz, xtime, hash, dmode, op, &need);
+    tchdbunlock(hdb, rmtx);
+    if(rv >= 0) return rv;
   }
 }
 
 
-/* Initialize the iterator of an on-memory map database object in front of a key. */
-void tcmdbiterinit2(TCMDB *mdb, const void *kbuf, int ksiz){
-  if(pthread_mutex_lock(mdb->imtx) != 0) return;
-  unsigned int mi;
-  TCMDBHASH(mi, kbuf, ksiz);
-  if(pthread_rwlock_rdlock((pthread_rwlock_t *)mdb->mmtxs + mi) != 0){
-    pthread_mutex_unlock(mdb->imtx);
-    return;
+/* Store a record into a file hash database object whose bucket is locked for writing.
+   `hdb' specifies the file hash database object.
+   `bidx' specifies the index of the bucket.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value or of the additional number.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time.
+   `hash' specifies the hash value of the key.
+   `dmode' specifies the mode of storing.
+   `op' specifies the pointer to the variable into which the resulting number is assigned.
+   `np' specifies the pointer to the variable into which the size of the block is assigned when
+   the file is short of space.
+   The return value is 1 if the record is stored, 0 if it is not, or -1 if the file is short of
+   space.  Numbers of the same size are added in place.  Otherwise, the new record is written
+   into a free block and linked in place of the old record by a single store, and then the old
+   block is released. */
+static int tchdbputimpl(TCHDB *hdb, uint64_t bidx, const char *kbuf, int ksiz,
+                        const char *vbuf, int vsiz, int64_t xtime, uint64_t hash, int dmode,
+                        void *op, uint64_t *np){
+  assert(hdb && kbuf && ksiz >= 0 && vbuf && vsiz >= 0 && np);
+  uint64_t *lp = tchdbsearch(hdb, bidx, kbuf, ksiz, hash);
+  uint64_t ooff = lp ? *lp : 0;
+  TCHDBREC *orec = lp ? TCHDBRECP(hdb, ooff) : NULL;
+  bool live = orec && TCHDBLIVE(orec, (int64_t)time(NULL));
+  const char *obuf = NULL;
+  int osiz = 0;
+  char nbuf[TCNUMBUFSIZ];
+  switch(dmode){
+    case TCHDBPDKEEP:
+      if(live) return 0;
+      break;
+    case TCHDBPDCAT:
+      if(live){
+        if(orec->vsiz > INT_MAX - vsiz) return 0;
+        obuf = TCHDBRECVAL(orec);
+        osiz = orec->vsiz;
+        xtime = orec->xtime;
+      }
+      break;
+    case TCHDBPDADDINT:
+      if(live){
+        if(orec->vsiz != sizeof(int)) return 0;
+        int *ip = (int *)TCHDBRECVAL(orec);
+        *ip += *(int *)vbuf;
+        *(int *)op = *ip;
+        return 1;
+      }
+      *(int *)op = *(int *)vbuf;
+      break;
+    case TCHDBPDADDDBL:
+      if(live){
+        if(orec->vsiz != sizeof(double)) return 0;
+        double *dp = (double *)TCHDBRECVAL(orec);
+        *dp += *(double *)vbuf;
+        *(double *)op = *dp;
+        return 1;
+      }
+      *(double *)op = *(double *)vbuf;
+      break;
+    case TCHDBPDINCR:
+      if(!live) return 0;
+      {
+        int nsiz = tclmin(orec->vsiz, sizeof(nbuf) - 1);
+        memcpy(nbuf, TCHDBRECVAL(orec), nsiz);
+        nbuf[nsiz] = '\0';
+        int64_t inum = tcatoi(nbuf) + *(int64_t *)vbuf;
+        *(uint64_t *)op = inum > 0 ? inum : 0;
+        vsiz = sprintf(nbuf, "%" PRIu64, *(uint64_t *)op);
+        vbuf = nbuf;
+        xtime = orec->xtime;
+      }
+      break;
   }
-  int vsiz;
-  if(tcmapget(mdb->maps[mi], kbuf, ksiz, &vsiz)){
-    for(int i = 0; i < TCMDBMNUM; i++){
-      tcmapiterinit(mdb->maps[i]);
-    }
-    tcmapiterinit2(mdb->maps[mi], kbuf, ksiz);
-    mdb->iter = mi;
+  uint64_t rsiz = TCHDBRSIZ(ksiz, (uint64_t)osiz + vsiz);
+  if(rsiz > UINT32_MAX) return 0;
+  uint64_t off = tchdballoc(hdb, rsiz);
+  if(off < 1){
+    *np = rsiz;
+    return -1;
   }
-  pthread_rwlock_unlock((pthread_rwlock_t *)mdb->mmtxs + mi);
-  pthread_mutex_unlock(mdb->imtx);
+  uint64_t *bp = TCHDBBUCKETS(hdb) + bidx;
+  TCHDBREC *rec = TCHDBRECP(hdb, off);
+  rec->next = orec ? orec->next : *bp;
+  rec->ksiz = ksiz;
+  rec->vsiz = osiz + vsiz;
+  rec->hchk = hash >> 32;
+  rec->xtime = xtime > 0 ? xtime : 0;
+  memcpy(TCHDBRECKEY(rec), kbuf, ksiz);
+  char *wp = TCHDBRECVAL(rec);
+  if(osiz > 0) memcpy(wp, obuf, osiz);
+  memcpy(wp + osiz, vbuf, vsiz);
+  __atomic_store_n(lp ? lp : bp, off, __ATOMIC_RELEASE);
+  TCHDBHEAD *head = TCHDBHEADP(hdb);
+  if(!orec) __atomic_add_fetch(&head->rnum, 1, __ATOMIC_RELAXED);
+  if(rec->xtime > 0 && !(orec && orec->xtime > 0)){
+    __atomic_add_fetch(&head->xnum, 1, __ATOMIC_RELAXED);
+  } else if(rec->xtime < 1 && orec && orec->xtime > 0){
+    __atomic_sub_fetch(&head->xnum, 1, __ATOMIC_RELAXED);
+  }
+  if(orec) tchdbfree(hdb, ooff);
+  return 1;
 }
 
 
@@ -1676,6 +7489,39 @@ long tclmin(long a, long b){
 }
 
 
+/* Get the 64-bit hash value of a region. */
+uint64_t tchash64(const void *buf, int size){
+  assert(buf && size >= 0);
+  const unsigned char *rp = buf;
+  uint64_t hash = 0x9e3779b97f4a7c15ULL ^ (uint64_t)size * 0xc6a4a7935bd1e995ULL;
+  uint64_t word;
+  while(size >= sizeof(word)){
+    memcpy(&word, rp, sizeof(word));
+    word *= 0x87c37b91114253d5ULL;
+    word = (word << 31) | (word >> 33);
+    word *= 0x4cf5ad432745937fULL;
+    hash ^= word;
+    hash = ((hash << 27) | (hash >> 37)) * 5 + 0x52dce729;
+    rp += sizeof(word);
+    size -= sizeof(word);
+  }
+  if(size > 0){
+    word = 0;
+    memcpy(&word, rp, size);
+    word *= 0x87c37b91114253d5ULL;
+    word = (word << 31) | (word >> 33);
+    word *= 0x4cf5ad432745937fULL;
+    hash ^= word;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+
 /* Compare two strings with case insensitive evaluation. */
 int tcstricmp(const char *astr, const char *bstr){
   assert(astr && bstr);
@@ -2263,6 +8109,18 @@ bool tcread(int fd, void *buf, size_t size){
  *************************************************************************************************/
 
 
+#define TCLZHASHBITS   12                // number of bits of the hash table of LZ compression
+#define TCLZMINLEN     4                 // minimum length of each match of LZ compression
+#define TCLZMAXOFF     65535             // maximum offset of each match of LZ compression
+#define TCLZSKIPBITS   5                 // bits of literals to accelerate skipping on misses
+
+
+/* private function prototypes */
+static unsigned char *tclzputseq(unsigned char *wp, const unsigned char *lbuf, int lsiz,
+                                 int off, int mlen);
+static bool tclzgetlen(const unsigned char **rpp, const unsigned char *ep, int *lp);
+
+
 /* Encode a serial object with URL encoding. */
 char *tcurlencode(const char *ptr, int size){
   assert(ptr && size >= 0);
@@ -2925,6 +8783,196 @@ void tcwwwformdecode2(const void *ptr, int size, const char *type, TCMAP *params
 }
 
 
+/* Compress a serial object with the built-in LZ encoding. */
+char *tclzencode(const char *ptr, int size, int *sp){
+  assert(ptr && size >= 0 && sp);
+  char *buf;
+  TCMALLOC(buf, size + size / 255 + 16);
+  unsigned char *wp = (unsigned char *)buf;
+  int step;
+  TCSETVNUMBUF(step, wp, size);
+  wp += step;
+  const unsigned char *base = (const unsigned char *)ptr;
+  const unsigned char *ep = base + size;
+  const unsigned char *rp = base;
+  const unsigned char *lp = base;
+  uint32_t table[1<<TCLZHASHBITS];
+  memset(table, 0, sizeof(table));
+  while(rp + TCLZMINLEN <= ep){
+    uint32_t seq;
+    memcpy(&seq, rp, sizeof(seq));
+    uint32_t hidx = (seq * 2654435761U) >> (32 - TCLZHASHBITS);
+    const unsigned char *cp = base + table[hidx];
+    table[hidx] = rp - base;
+    uint32_t cseq;
+    memcpy(&cseq, cp, sizeof(cseq));
+    if(cp < rp && rp - cp <= TCLZMAXOFF && cseq == seq){
+      const unsigned char *mp = rp + TCLZMINLEN;
+      const unsigned char *np = cp + TCLZMINLEN;
+      while(mp < ep && *mp == *np){
+        mp++;
+        np++;
+      }
+      wp = tclzputseq(wp, lp, rp - lp, rp - cp, mp - rp);
+      rp = mp;
+      lp = rp;
+    } else {
+      rp += 1 + ((rp - lp) >> TCLZSKIPBITS);
+    }
+  }
+  wp = tclzputseq(wp, lp, ep - lp, 0, 0);
+  *sp = wp - (unsigned char *)buf;
+  return buf;
+}
+
+
+/* Decompress a serial object compressed with the built-in LZ encoding. */
+char *tclzdecode(const char *ptr, int size, int *sp){
+  assert(ptr && size >= 0 && sp);
+  int rsiz = tclzsize(ptr, size);
+  if(rsiz < 0) return NULL;
+  const unsigned char *rp = (const unsigned char *)ptr;
+  const unsigned char *ep = rp + size;
+  while(*rp >= 0x80){
+    rp++;
+  }
+  rp++;
+  char *buf;
+  TCMALLOC(buf, rsiz + 1);
+  unsigned char *wp = (unsigned char *)buf;
+  unsigned char *wend = wp + rsiz;
+  bool err = false;
+  while(rp < ep){
+    int token = *(rp++);
+    int lsiz = token >> 4;
+    if(lsiz == 15 && !tclzgetlen(&rp, ep, &lsiz)){
+      err = true;
+      break;
+    }
+    if(lsiz > ep - rp || lsiz > wend - wp){
+      err = true;
+      break;
+    }
+    memcpy(wp, rp, lsiz);
+    rp += lsiz;
+    wp += lsiz;
+    if(rp >= ep) break;
+    if(ep - rp < 2){
+      err = true;
+      break;
+    }
+    int off = rp[0] | (rp[1] << 8);
+    rp += 2;
+    int mlen = (token & 0xf) + TCLZMINLEN;
+    if((token & 0xf) == 15 && !tclzgetlen(&rp, ep, &mlen)){
+      err = true;
+      break;
+    }
+    if(off < 1 || off > wp - (unsigned char *)buf || mlen > wend - wp){
+      err = true;
+      break;
+    }
+    const unsigned char *mp = wp - off;
+    if(off >= mlen){
+      memcpy(wp, mp, mlen);
+      wp += mlen;
+    } else {
+      while(mlen-- > 0){
+        *(wp++) = *(mp++);
+      }
+    }
+  }
+  if(err || wp != wend){
+    free(buf);
+    return NULL;
+  }
+  *wp = '\0';
+  *sp = rsiz;
+  return buf;
+}
+
+
+/* Get the size of the original data of a region compressed with the built-in LZ encoding. */
+int tclzsize(const char *ptr, int size){
+  assert(ptr && size >= 0);
+  const unsigned char *rp = (const unsigned char *)ptr;
+  int64_t num = 0;
+  int64_t base = 1;
+  for(int i = 0; i < size && i < 5; i++){
+    int c = ((signed char *)rp)[i];
+    if(c >= 0){
+      num += c * base;
+      return num <= INT_MAX ? num : -1;
+    }
+    num += base * (-c - 1);
+    base <<= 7;
+  }
+  return -1;
+}
+
+
+/* Write a sequence of LZ compression.
+   `wp' specifies the pointer to the region into which the sequence is written.
+   `lbuf' specifies the pointer to the region of the literals.
+   `lsiz' specifies the size of the region of the literals.
+   `off' specifies the offset of the match.  If it is 0, the sequence is the last one.
+   `mlen' specifies the length of the match.
+   The return value is the pointer to the end of the written sequence.
+   Each sequence is a token with the literal size in the upper nibble and the match length
+   minus the minimum in the lower nibble, each extended by bytes of 255 summed until a smaller
+   one, the literals, and the offset of the match in two bytes of little endian. */
+static unsigned char *tclzputseq(unsigned char *wp, const unsigned char *lbuf, int lsiz,
+                                 int off, int mlen){
+  assert(wp && lbuf && lsiz >= 0);
+  unsigned char *tp = wp++;
+  int mrem = off > 0 ? mlen - TCLZMINLEN : 0;
+  *tp = ((lsiz < 15 ? lsiz : 15) << 4) | (mrem < 15 ? mrem : 15);
+  if(lsiz >= 15){
+    int rem = lsiz - 15;
+    while(rem >= 255){
+      *(wp++) = 255;
+      rem -= 255;
+    }
+    *(wp++) = rem;
+  }
+  memcpy(wp, lbuf, lsiz);
+  wp += lsiz;
+  if(off < 1) return wp;
+  *(wp++) = off & 0xff;
+  *(wp++) = off >> 8;
+  if(mrem >= 15){
+    int rem = mrem - 15;
+    while(rem >= 255){
+      *(wp++) = 255;
+      rem -= 255;
+    }
+    *(wp++) = rem;
+  }
+  return wp;
+}
+
+
+/* Read the extension of a length of LZ compression.
+   `rpp' specifies the pointer to the variable of the reading position.
+   `ep' specifies the pointer to the end of the region.
+   `lp' specifies the pointer to the variable of the length, to which the extension is added.
+   If successful, the return value is true, else, it is false. */
+static bool tclzgetlen(const unsigned char **rpp, const unsigned char *ep, int *lp){
+  assert(rpp && ep && lp);
+  const unsigned char *rp = *rpp;
+  int len = *lp;
+  while(true){
+    if(rp >= ep || len > INT_MAX - 255) return false;
+    int c = *(rp++);
+    len += c;
+    if(c < 255) break;
+  }
+  *rpp = rp;
+  *lp = len;
+  return true;
+}
+
+
 /* Show error message on the standard error output and exit. */
 void *tcmyfatal(const char *message){
   assert(message);
@@ -2938,11 +8986,7 @@ void *tcmyfatal(const char *message){
 void *tczeromap(uint64_t size){
 #if defined(_SYS_LINUX_)
   assert(size > 0);
-  void *ptr = mmap(0, sizeof(size) + size,
-                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-  if(ptr == MAP_FAILED) tcmyfatal("out of memory");
-  *(uint64_t *)ptr = size;
-  return (char *)ptr + sizeof(size);
+  return tcmpzeromap(size, -1);
 #else
   assert(size > 0);
   void *ptr;
@@ -2965,6 +9009,42 @@ void tczerounmap(void *ptr){
 }
 
 
+/* Set the options of memory placement of large regions. */
+void tcsetmemplace(int opts){
+  tcmpopts = opts;
+  tcslabpsiz = (opts & (TCMPTHP | TCMPHUGETLB)) ? TCSLABHUGESIZ : TCSLABPAGESIZ;
+}
+
+
+/* Get the options of memory placement of large regions. */
+int tcmemplace(void){
+  return tcmpopts;
+}
+
+
+/* Get the number of NUMA nodes of the system. */
+int tcnumanodes(void){
+  static int nnum = 0;
+  int num = __atomic_load_n(&nnum, __ATOMIC_RELAXED);
+  if(num > 0) return num;
+  num = 1;
+  DIR *dd = opendir("/sys/devices/system/node");
+  if(dd){
+    struct dirent *dp;
+    while((dp = readdir(dd)) != NULL){
+      if(tcstrfwm(dp->d_name, "node") && isdigit((unsigned char)dp->d_name[4])){
+        int id = tcatoi(dp->d_name + 4);
+        if(id >= num) num = id + 1;
+      }
+    }
+    closedir(dd);
+  }
+  if(num > TCMPNODEMAX) num = TCMPNODEMAX;
+  __atomic_store_n(&nnum, num, __ATOMIC_RELAXED);
+  return num;
+}
+
+
 /* Convert an integer to the string as binary numbers. */
 int tcnumtostrbin(uint64_t num, char *buf, int col, int fc){
   assert(buf);
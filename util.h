@@ -137,6 +137,7 @@ __UTIL_CLINKAGEBEGIN
 #include <pthread.h>
 #include <sched.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <sys/select.h>
 #include <aio.h>
@@ -146,6 +147,7 @@ __UTIL_CLINKAGEBEGIN
 #include <netdb.h>
 #include <dlfcn.h>
 #include <sys/epoll.h>
+#include <sys/syscall.h>
 
 
 
@@ -465,6 +467,12 @@ typedef struct {                         /* type of structure for a map */
   uint32_t bnum;                         /* number of buckets */
   uint64_t rnum;                         /* number of records */
   uint64_t msiz;                         /* total size of records */
+  TCMAPREC **obuckets;                   /* old bucket array under rehashing */
+  uint32_t obnum;                        /* number of old buckets */
+  uint32_t ridx;                         /* index of the old bucket to be moved next */
+  uint32_t rhnum;                        /* number of starts and ends of rehashing */
+  void *reclaim;                         /* reclaimer of released regions or `NULL' */
+  void *slab;                            /* slab allocator of records or `NULL' */
 } TCMAP;
 
 
@@ -475,7 +483,10 @@ TCMAP *tcmapnew(void);
 
 /* Create a map object with specifying the number of the buckets.
    `bnum' specifies the number of the buckets.
-   The return value is the new map object. */
+   The return value is the new map object.
+   When the number of records exceeds twice the number of the buckets, a bucket array of twice
+   the size is allocated and the records are moved into it a few buckets at a time by each
+   following update. */
 TCMAP *tcmapnew2(uint32_t bnum);
 
 
@@ -687,18 +698,228 @@ void tcmapprintf(TCMAP *map, const char *kstr, const char *format, ...);
 
 
 
+/*************************************************************************************************
+ * flat hash map
+ *************************************************************************************************/
+
+
+typedef struct {                         /* type of structure for an element of a flat map */
+  int32_t ksiz;                          /* size of the region of the key */
+  int32_t vsiz;                          /* size of the region of the value */
+  uint32_t hash;                         /* hash value of the key */
+  uint32_t asiz;                         /* size of the allocated region */
+} TCFMAPREC;
+
+typedef struct {                         /* type of structure for a flat map */
+  uint8_t *ctrls;                        /* control byte array */
+  TCFMAPREC **slots;                     /* slot array */
+  uint32_t snum;                         /* number of slots */
+  uint32_t dnum;                         /* number of deleted slots */
+  uint64_t cur;                          /* index of the current slot */
+  uint64_t rnum;                         /* number of records */
+  uint64_t msiz;                         /* total size of records */
+  uint8_t *octrls;                       /* old control byte array under rehashing */
+  TCFMAPREC **oslots;                    /* old slot array under rehashing */
+  uint32_t osnum;                        /* number of old slots */
+  uint32_t ridx;                         /* index of the old group to be moved next */
+  uint32_t rhnum;                        /* number of starts and ends of rehashing */
+  void *reclaim;                         /* reclaimer of released regions or `NULL' */
+  void *slab;                            /* slab allocator of records or `NULL' */
+  bool compact;                          /* whether records are packed without headers */
+} TCFMAP;
+
+
+/* Create a flat map object with specifying the number of the buckets.
+   `bnum' specifies the number of the buckets.  The slot array is grown on demand so that the
+   number only gives the initial capacity.
+   The return value is the new flat map object.
+   A flat map is an open addressing hash table whose slots are grouped by 16 and probed with one
+   byte tag of each slot.  Looking up a key touches one group of the control bytes and the
+   record of the key in most cases.  When the slots are filled up, a slot array of twice the
+   size is allocated and the records are moved into it a few groups at a time by each following
+   update. */
+TCFMAP *tcfmapnew2(uint32_t bnum);
+
+
+/* Delete a flat map object.
+   `map' specifies the flat map object.
+   Note that the deleted object and its derivatives can not be used anymore. */
+void tcfmapdel(TCFMAP *map);
+
+
+/* Store a record into a flat map object.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   If a record with the same key exists in the map, it is overwritten. */
+void tcfmapput(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+
+
+/* Store a new record into a flat map object.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   If successful, the return value is true, else, it is false.
+   If a record with the same key exists in the map, this function has no effect. */
+bool tcfmapputkeep(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+
+
+/* Concatenate a value at the end of the value of the existing record in a flat map object.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   If there is no corresponding record, a new record is created. */
+void tcfmapputcat(TCFMAP *map, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
+
+
+/* Remove a record of a flat map object.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   If successful, the return value is true.  False is returned when no record corresponds to
+   the specified key. */
+bool tcfmapout(TCFMAP *map, const void *kbuf, int ksiz);
+
+
+/* Retrieve a record in a flat map object.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   If successful, the return value is the pointer to the region of the value of the
+   corresponding record.  `NULL' is returned when no record corresponds.
+   Because an additional zero code is appended at the end of the region of the return value,
+   the return value can be treated as a character string. */
+const void *tcfmapget(const TCFMAP *map, const void *kbuf, int ksiz, int *sp);
+
+
+/* Initialize the iterator of a flat map object.
+   `map' specifies the flat map object.
+   The iterator is used in order to access the key of every record stored in the map object. */
+void tcfmapiterinit(TCFMAP *map);
+
+
+/* Initialize the iterator of a flat map object at the record corresponding a key.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   If there is no record corresponding the condition, the iterator is not modified. */
+void tcfmapiterinit2(TCFMAP *map, const void *kbuf, int ksiz);
+
+
+/* Get the next key of the iterator of a flat map object.
+   `map' specifies the flat map object.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   If successful, the return value is the pointer to the region of the next key, else, it is
+   `NULL'.  `NULL' is returned when no record can be fetched from the iterator.
+   The order of iteration is the order of the slots.  If the slot array is grown while
+   iterating, some records may be skipped or fetched twice. */
+const void *tcfmapiternext(TCFMAP *map, int *sp);
+
+
+/* Get the number of records stored in a flat map object.
+   `map' specifies the flat map object.
+   The return value is the number of the records stored in the map object. */
+uint64_t tcfmaprnum(const TCFMAP *map);
+
+
+/* Get the total size of memory used in a flat map object.
+   `map' specifies the flat map object.
+   The return value is the total size of memory used in a flat map object. */
+uint64_t tcfmapmsiz(const TCFMAP *map);
+
+
+/* Add an integer to a record in a flat map object.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   The return value is the summation value.
+   If the corresponding record exists, the value is treated as an integer and is added to.  If no
+   record corresponds, a new record of the additional value is stored. */
+int tcfmapaddint(TCFMAP *map, const void *kbuf, int ksiz, int num);
+
+
+/* Add a real number to a record in a flat map object.
+   `map' specifies the flat map object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   The return value is the summation value.
+   If the corresponding record exists, the value is treated as a real number and is added to.  If
+   no record corresponds, a new record of the additional value is stored. */
+double tcfmapadddouble(TCFMAP *map, const void *kbuf, int ksiz, double num);
+
+
+/* Clear a flat map object.
+   `map' specifies the flat map object.
+   All records are removed. */
+void tcfmapclear(TCFMAP *map);
+
+
+
 /*************************************************************************************************
  * on-memory hash database
  *************************************************************************************************/
 
 
+typedef struct {                         /* type of structure for a shard of a database */
+  pthread_rwlock_t mtx;                  /* mutex for method */
+  TCMAP *map;                            /* internal map object */
+  TCFMAP *fmap;                          /* internal flat map object */
+  uint32_t seq;                          /* sequence number, odd while being updated */
+  void *reclaim;                         /* reclaimer of released regions */
+  void *slab;                            /* slab allocator of records */
+  uint64_t *refs;                        /* bitmap of reference bits or `NULL' */
+  uint64_t rfnum;                        /* number of the reference bits */
+  uint64_t hand;                         /* position of the hand of eviction */
+  uint64_t evnum;                        /* number of evicted records */
+  TCFMAP *xmap;                          /* table of expiration times or `NULL' */
+  void *wheel;                           /* timer wheel of expiration times or `NULL' */
+  uint64_t exnum;                        /* number of expired records */
+  void *index;                           /* ordered index of the keys or `NULL' */
+} __attribute__((aligned(64))) TCMDBSHARD;
+
 typedef struct {                         /* type of structure for a on-memory hash database */
-  void **mmtxs;                          /* mutexes for method */
+  TCMDBSHARD *shards;                    /* shards of internal maps */
+  uint32_t mnum;                         /* number of the shards */
   void *imtx;                            /* mutex for iterator */
-  TCMAP **maps;                          /* internal map objects */
   int iter;                              /* index of maps for the iterator */
+  uint8_t opts;                          /* options */
+  uint64_t capsiz;                       /* capacity size or 0 */
+  int cmpsiz;                            /* minimum size of values to be compressed or 0 */
+  uint64_t cmpnum;                       /* number of values tried to be compressed */
+  uint64_t cmpisiz;                      /* total size of the values before compression */
+  uint64_t cmposiz;                      /* total size of the values as stored */
+  uint64_t cmptime;                      /* CPU time of compression in nanoseconds */
+  uint64_t dectime;                      /* CPU time of decompression in nanoseconds */
+  uint64_t cntmagic;                     /* prefix of stored values of decimal counters */
+  bool cntuse;                           /* whether any counter has been stored */
+  uint64_t stmagic;                      /* prefix of stored values of striped counters */
+  int stnum;                             /* number of slots of striped counters */
+  char *stprefix;                        /* prefix of keys of striped counters or NULL */
+  int stpsiz;                            /* size of the prefix of keys of striped counters */
+  void *hdb;                             /* file hash database or `NULL' */
 } TCMDB;
 
+enum {                                   /* enumeration for tuning options */
+  MDBTFLAT = 1 << 0,                     /* use flat maps */
+  MDBTCOMPACT = 1 << 1,                  /* use flat maps of compact records */
+  MDBTORDER = 1 << 2                     /* keep ordered indices of the keys */
+};
+
+typedef void (*TCVISITPROC)(const void *vbuf, int vsiz, void *op);  /* type of a record visitor */
+typedef void (*TCVISITRAWPROC)(const void *vbuf, int vsiz, bool cmp, void *op);
+                                         /* type of a visitor of stored values */
+
 
 const char *tcmdbpath(TCMDB *mdb);
 
@@ -714,6 +935,10 @@ const char *tcmdbpath(TCMDB *mdb);
    returns an empty list.  "getlist" is to retrieve records.  It receives keys, and returns keys
    and values of corresponding records one after the other.  "getpart" is to retrieve the partial
    value of a record.  It receives a key, the offset of the region, and the length of the region.
+   On-memory hash databases also support "stripe", which is to convert records into striped
+   counters by `tcmdbstripe'.  It receives keys, and returns an empty list.  "sync" is to
+   synchronize the database file opened by `tcmdbopen' with the device.  It receives nothing,
+   and returns an empty list.
    `args' specifies a list object containing arguments.
    If successful, the return value is a list object of the result.  `NULL' is returned on failure.
    Because the object of the return value is created with the function `tclistnew', it
@@ -721,6 +946,16 @@ const char *tcmdbpath(TCMDB *mdb);
 TCLIST *tcmdbmisc(TCMDB *mdb, const char *name, const TCLIST *args);
 
 
+/* Get the hash value of a key of an on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   The return value is the hash value of the key.
+   The value is calculated once per request and passed to the functions whose names end with
+   "hash".  Its bits select the internal map, the bucket and the fingerprint of the key in the
+   map, so that the key is scanned only once. */
+uint64_t tcmdbhash(const void *kbuf, int ksiz);
+
+
 /* Create an on-memory hash database object.
    The return value is the new on-memory hash database object.
    The object can be shared by plural threads because of the internal mutex. */
@@ -734,11 +969,51 @@ TCMDB *tcmdbnew(void);
 TCMDB *tcmdbnew2(uint32_t bnum);
 
 
+/* Create an on-memory hash database object with specifying tuning parameters.
+   `bnum' specifies the number of the buckets.
+   `mnum' specifies the number of the internal maps.  It is rounded up to a power of two.  If it
+   is not more than 0, the default value is specified.  The default value is 8.  The maximum
+   value is 4096.  Each internal map is guarded by its own lock, so more maps let more writers
+   run in parallel.
+   `opts' specifies options by bitwise-or: `MDBTFLAT' specifies that each internal map is a
+   flat map of open addressing instead of a map of binary trees, `MDBTCOMPACT' specifies that
+   each internal map is a flat map whose records have no header but the sizes of the key and the
+   value in variable length format.  Compact records save about 16 bytes per record, while
+   updating a record always allocates a new one and probing compares keys without hash values.
+   `MDBTORDER' specifies that each internal map keeps an ordered index of its keys, so that
+   forward matching and range queries do not scan every key.  The index costs a node per
+   record and a little time when a record is added or removed.
+   The return value is the new on-memory hash database object.
+   The object can be shared by plural threads because of the internal mutex.  Note that the
+   order of iteration of flat maps is not the stored order. */
+TCMDB *tcmdbnew3(uint32_t bnum, uint32_t mnum, uint8_t opts);
+
+
 /* Delete an on-memory hash database object.
    `mdb' specifies the on-memory hash database object. */
 void tcmdbdel(TCMDB *mdb);
 
 
+/* Store the records of an on-memory hash database object in a file hash database.
+   `mdb' specifies the on-memory hash database object.  It should be empty.
+   `path' specifies the path of the database file.
+   `bnum' specifies the number of the buckets of a new file.  If it is 0, the default value is
+   specified.
+   If successful, the return value is true, else, it is false.
+   After this call, every operation of the object is performed on the file by `tchdbopen' and
+   the related functions, and the internal maps are not used.  Options of the memory such as the
+   capacity, compression, striped counters, and snapshots have no effect.  The file is closed
+   when the object is deleted. */
+bool tcmdbopen(TCMDB *mdb, const char *path, uint64_t bnum);
+
+
+/* Synchronize the database file of an on-memory hash database object with the device.
+   `mdb' specifies the on-memory hash database object.
+   If successful, the return value is true, else, it is false.  If no file is opened by
+   `tcmdbopen', this function has no effect and returns true. */
+bool tcmdbsync(TCMDB *mdb);
+
+
 /* Store a record into an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -749,6 +1024,18 @@ void tcmdbdel(TCMDB *mdb);
 void tcmdbput(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 
 
+/* Store a record into an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   This function is the same as `tcmdbput' except that the key is not hashed again. */
+void tcmdbputhash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                  uint64_t hash);
+
+
 /* Store a new record into an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -760,6 +1047,19 @@ void tcmdbput(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz
 bool tcmdbputkeep(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 
 
+/* Store a new record into an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   This function is the same as `tcmdbputkeep' except that the key is not hashed again. */
+bool tcmdbputkeephash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                      uint64_t hash);
+
+
 /* Concatenate a value at the end of the existing record in an on-memory hash database.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -770,6 +1070,18 @@ bool tcmdbputkeep(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int
 void tcmdbputcat(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz);
 
 
+/* Concatenate a value at the end of the existing record with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   This function is the same as `tcmdbputcat' except that the key is not hashed again. */
+void tcmdbputcathash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                     uint64_t hash);
+
+
 /* Remove a record of an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -779,6 +1091,17 @@ void tcmdbputcat(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int v
 bool tcmdbout(TCMDB *mdb, const void *kbuf, int ksiz);
 
 
+/* Remove a record of an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true.  False is returned when no record corresponds to
+   the specified key.
+   This function is the same as `tcmdbout' except that the key is not hashed again. */
+bool tcmdbouthash(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash);
+
+
 /* Retrieve a record in an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -790,10 +1113,24 @@ bool tcmdbout(TCMDB *mdb, const void *kbuf, int ksiz);
    Because an additional zero code is appended at the end of the region of the return value,
    the return value can be treated as a character string.  Because the region of the return
    value is allocated with the `malloc' call, it should be released with the `free' call when
-   it is no longer in use. */
+   it is no longer in use.  The record is looked up without locking unless the internal map is
+   being updated at the same time. */
 void *tcmdbget(TCMDB *mdb, const void *kbuf, int ksiz, int *sp);
 
 
+/* Retrieve a record in an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is the pointer to the region of the value of the
+   corresponding record.  `NULL' is returned when no record corresponds.
+   This function is the same as `tcmdbget' except that the key is not hashed again. */
+void *tcmdbgethash(TCMDB *mdb, const void *kbuf, int ksiz, int *sp, uint64_t hash);
+
+
 /* Get the size of the value of a record in an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -803,6 +1140,60 @@ void *tcmdbget(TCMDB *mdb, const void *kbuf, int ksiz, int *sp);
 int tcmdbvsiz(TCMDB *mdb, const void *kbuf, int ksiz);
 
 
+/* Get the size of the value of a record in an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is the size of the value of the corresponding record, else,
+   it is -1.
+   This function is the same as `tcmdbvsiz' except that the key is not hashed again. */
+int tcmdbvsizhash(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash);
+
+
+/* Visit the value of a record in an on-memory hash database object without copying it.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `proc' specifies the pointer to the visitor function.  It receives the pointer to the region
+   of the value, the size of the region, and the opaque pointer.
+   `op' specifies an arbitrary pointer to be given as the opaque pointer to the visitor.
+   If successful, the return value is true.  False is returned when no record corresponds and
+   the visitor is not called.
+   The region is valid only during the call.  Because released records are not reclaimed while
+   a visitor is running, the visitor should not block for long.  The visitor must not update
+   the database.  If the calling thread is canceled in the visitor, the protection of the
+   region is released.  A compressed value is decompressed into a temporary region. */
+bool tcmdbvisit(TCMDB *mdb, const void *kbuf, int ksiz, TCVISITPROC proc, void *op);
+
+
+/* Visit the value of a record in an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `proc' specifies the pointer to the visitor function.
+   `op' specifies an arbitrary pointer to be given as the opaque pointer to the visitor.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   This function is the same as `tcmdbvisit' except that the key is not hashed again. */
+bool tcmdbvisithash(TCMDB *mdb, const void *kbuf, int ksiz, TCVISITPROC proc, void *op,
+                    uint64_t hash);
+
+
+/* Visit the value of a record in an on-memory hash database object as it is stored.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `proc' specifies the pointer to the visitor function.  It receives the pointer to the region
+   of the value, the size of the region, whether the value is compressed, and the opaque pointer.
+   A compressed value is given in the format of `tclzencode'.
+   `op' specifies an arbitrary pointer to be given as the opaque pointer to the visitor.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   This function is the same as `tcmdbvisithash' except that compressed values are given without
+   being decompressed, so that they can be sent to peers which decompress them. */
+bool tcmdbvisitrawhash(TCMDB *mdb, const void *kbuf, int ksiz, TCVISITRAWPROC proc, void *op,
+                       uint64_t hash);
+
+
 /* Initialize the iterator of an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    The iterator is used in order to access the key of every record stored in the on-memory
@@ -834,10 +1225,94 @@ void *tcmdbiternext(TCMDB *mdb, int *sp);
    It returns an empty list even if no key corresponds.
    Because the object of the return value is created with the function `tclistnew', it should be
    deleted with the function `tclistdel' when it is no longer in use.  Note that this function
-   may be very slow because every key in the database is scanned. */
+   may be very slow because every key in the database is scanned unless the database was created
+   with the option `MDBTORDER'.  With the option, the keys are in ascending lexical order. */
 TCLIST *tcmdbfwmkeys(TCMDB *mdb, const void *pbuf, int psiz, int max);
 
 
+/* Get keys of ranged records in an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `bkbuf' specifies the pointer to the region of the key of the beginning border.  If it is
+   `NULL', the first record is specified.
+   `bksiz' specifies the size of the region of the beginning key.
+   `ekbuf' specifies the pointer to the region of the key of the ending border.  If it is
+   `NULL', the last record is specified.
+   `eksiz' specifies the size of the region of the ending key.
+   `max' specifies the maximum number of records to be fetched.  If it is negative, no limit is
+   specified.
+   `vals' specifies whether the values are fetched as well as the keys.
+   The return value is a list object of the keys of the records whose keys are not less than the
+   beginning key and less than the ending key in ascending lexical order.  If `vals' is true,
+   each key is followed by its value.  This function does never fail.  It returns an empty list
+   even if no record corresponds.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use.  Note that this function
+   may be very slow because every key in the database is scanned unless the database was created
+   with the option `MDBTORDER'. */
+TCLIST *tcmdbrange(TCMDB *mdb, const void *bkbuf, int bksiz, const void *ekbuf, int eksiz,
+                   int max, bool vals);
+
+
+/* Scan records of an on-memory hash database object with a cursor.
+   `mdb' specifies the on-memory hash database object.
+   `cp' specifies the pointer to the variable of the cursor.  It should be 0 at the beginning of
+   a scan.  The cursor to resume the scan is assigned into it, which is 0 at the end.
+   `max' specifies the maximum number of records to be fetched.  If it is negative, no limit is
+   specified.
+   `vals' specifies whether the values are fetched as well as the keys.
+   The return value is a list object of the keys of the fetched records.  If `vals' is true,
+   each key is followed by its value.  Fewer records than the maximum may be fetched before the
+   end of the scan.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use.  The cursor is a position
+   in the internal maps, so that scans of any number hold no state in the database and do not
+   disturb each other or the iterator.  A record existing through the scan is fetched at least
+   once, while records may be fetched twice if an internal map is rehashed during the scan. */
+TCLIST *tcmdbscan(TCMDB *mdb, uint64_t *cp, int max, bool vals);
+
+
+/* Write a snapshot of an on-memory hash database object into a file.
+   `mdb' specifies the on-memory hash database object.
+   `path' specifies the path of the snapshot file.
+   `mbuf' specifies the pointer to the region of arbitrary metadata stored in the file.
+   `msiz' specifies the size of the region of the metadata.
+   If successful, the return value is true, else, it is false.
+   The file is replaced atomically when the new snapshot is complete.  Each shard is written
+   while it is locked for reading, so that the snapshot is consistent per shard but not among
+   shards.  Expired records are not written. */
+bool tcmdbdump(TCMDB *mdb, const char *path, const void *mbuf, int msiz);
+
+
+/* Write a snapshot of an on-memory hash database object into a file by a child process.
+   `mdb' specifies the on-memory hash database object.
+   `path' specifies the path of the snapshot file.
+   `mbuf' specifies the pointer to the region of arbitrary metadata stored in the file.
+   `msiz' specifies the size of the region of the metadata.
+   The return value is the process ID of the child process or -1 on failure.  The exit status
+   of the child process is 0 on success or 1 on failure.
+   All shards are locked for reading only while the process is forked, so that the snapshot is
+   of the exact point in time of the call.  The caller should wait for the child process with
+   the function `waitpid'. */
+pid_t tcmdbdumpbg(TCMDB *mdb, const char *path, const void *mbuf, int msiz);
+
+
+/* Load records of a snapshot file into an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `path' specifies the path of the snapshot file.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   If successful, the return value is the pointer to the region of the metadata of the snapshot,
+   else, it is `NULL'.
+   Because an additional zero code is appended at the end of the region of the return value,
+   the return value can be treated as a character string.  Because the region of the return
+   value is allocated with the `malloc' call, it should be released with the `free' call when it
+   is no longer in use.  The file is mapped into memory and sections of shards are loaded by
+   plural threads in parallel.  The database may have a different number of shards from the
+   object which wrote the snapshot.  Records are stored as well as by `tcmdbput', and existing
+   records are overwritten. */
+char *tcmdbload(TCMDB *mdb, const char *path, int *sp);
+
+
 /* Get the number of records stored in an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    The return value is the number of the records stored in the database. */
@@ -850,6 +1325,226 @@ uint64_t tcmdbrnum(TCMDB *mdb);
 uint64_t tcmdbmsiz(TCMDB *mdb);
 
 
+/* Get the number of the buckets of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `obnp' specifies the pointer to the variable into which the number of the old buckets under
+   rehashing is assigned.  If it is `NULL', it is not used.
+   `rbnp' specifies the pointer to the variable into which the number of the old buckets already
+   moved into the new buckets is assigned.  If it is `NULL', it is not used.
+   The return value is the number of the current buckets.
+   The bucket array of each internal map grows incrementally; while it is being rehashed, records
+   are moved from the old buckets by some buckets at each update. */
+uint64_t tcmdbbnum(TCMDB *mdb, uint64_t *obnp, uint64_t *rbnp);
+
+
+/* Get the memory usage of the slab allocators of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `usp' specifies the pointer to the variable into which the total size of the chunks in use is
+   assigned.  If it is `NULL', it is not used.
+   `pnp' specifies the pointer to the variable into which the number of the pages is assigned.
+   If it is `NULL', it is not used.
+   The return value is the total size of the regions mapped by the slab allocators.
+   Records of each internal map are carved from pages of 1MB divided into chunks of size classes,
+   and large records are mapped separately.  The difference between the mapped size and the size
+   in use is the memory wasted by free chunks.  Pages whose chunks are all free are returned to
+   the system. */
+uint64_t tcmdbslab(TCMDB *mdb, uint64_t *usp, uint64_t *pnp);
+
+
+/* Get the size of the index of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   The return value is the total size of the bucket arrays or the slot arrays of the internal
+   maps, including the old arrays under rehashing, and the nodes of the ordered indices.  The
+   sum of it and the size of the chunks in use of the slab allocators divided by the number of
+   records is the actual memory usage per record. */
+uint64_t tcmdbisiz(TCMDB *mdb);
+
+
+/* Set the capacity size of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `capsiz' specifies the capacity size of the database.  If it is 0, the size is not limited.
+   When an update makes the size of an internal map, as reported by `tcmdbmsiz', exceed its share
+   of the capacity, records are evicted from the map by the CLOCK algorithm.  Each retrieval or
+   update of a record sets its reference bit without locking, and a record whose bit is set is
+   spared once and the bit is cleared.  Flat maps sweep their slots; maps of binary trees move a
+   spared record to the end of the stored order.
+   This function should be called before the object is shared by plural threads. */
+void tcmdbsetcapsiz(TCMDB *mdb, uint64_t capsiz);
+
+
+/* Get the number of evicted records of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   The return value is the number of records evicted by the capacity size. */
+uint64_t tcmdbevnum(TCMDB *mdb);
+
+
+/* Set the minimum size of values to be compressed in an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `cmpsiz' specifies the minimum size of values to be compressed.  If it is 0, values are not
+   compressed.  It is raised to 64 if smaller.
+   Each value stored by a put function or grown by concatenation with the size is compressed by
+   `tclzencode' and kept in the compressed form if it gets smaller.  Functions retrieving values
+   return them decompressed and `tcmdbvsiz' returns the original size.  Update logs keep the
+   original values.
+   This function should be called before any record is stored. */
+void tcmdbsetcmpsiz(TCMDB *mdb, int cmpsiz);
+
+
+/* Set the prefix of keys of striped counters of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `prefix' specifies the string of the prefix.  If it is `NULL' or empty, no key is striped.
+   A record which does not exist and whose key begins with the prefix is created as a striped
+   counter by `tcmdbaddint'.
+   This function should be called before the object is shared by plural threads. */
+void tcmdbsetstripe(TCMDB *mdb, const char *prefix);
+
+
+/* Convert a record of an on-memory hash database object into a striped counter.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   If successful, the return value is true, else, it is false.  False is returned if the value
+   of the existing record is not an integer stored by `tcmdbaddint'.
+   If no record corresponds, a new counter of zero is created.  A striped counter keeps one slot
+   per CPU in its own cache line and `tcmdbaddint' adds to the slot of the calling CPU only, so
+   that hot counters do not bounce a cache line between CPUs.  Retrieval functions return the
+   sum of the slots as a native integer, as if it was stored by `tcmdbaddint'. */
+bool tcmdbstripe(TCMDB *mdb, const void *kbuf, int ksiz);
+
+
+/* Get the statistics of compression of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `isp' specifies the pointer to the variable into which the total size of the values before
+   compression is assigned.
+   `osp' specifies the pointer to the variable into which the total size of the values as stored
+   is assigned.
+   `ctp' specifies the pointer to the variable into which the CPU time of compression in seconds
+   is assigned.
+   `dtp' specifies the pointer to the variable into which the CPU time of decompression in
+   seconds is assigned.
+   The return value is the number of values tried to be compressed. */
+uint64_t tcmdbcmpstat(TCMDB *mdb, uint64_t *isp, uint64_t *osp, double *ctp, double *dtp);
+
+
+/* Store a record with an expiration time into an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.  If it is not more than 0,
+   the record never expires.
+   If a record with the same key exists in the database, it is overwritten.  An expired record is
+   invisible to retrieval at once and is removed by `tcmdbxout' or by the next update of the key.
+   Storing a record by `tcmdbput' clears its expiration time, and the other updates keep it. */
+void tcmdbputexp(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                 int64_t xtime);
+
+
+/* Store a record with an expiration time into an on-memory hash database with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   This function is the same as `tcmdbputexp' except that the key is not hashed again. */
+void tcmdbputexphash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                     int64_t xtime, uint64_t hash);
+
+
+/* Store a new record with an expiration time into an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.  If it is not more than 0,
+   the record never expires.
+   If successful, the return value is true, else, it is false.
+   If a record with the same key exists in the database and has not expired, this function has no
+   effect. */
+bool tcmdbputkeepexp(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                     int64_t xtime);
+
+
+/* Store a new record with an expiration time into an on-memory hash database with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   This function is the same as `tcmdbputkeepexp' except that the key is not hashed again. */
+bool tcmdbputkeepexphash(TCMDB *mdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                         int64_t xtime, uint64_t hash);
+
+
+/* Get the keys of expired records of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `now' specifies the current time in seconds since the epoch.
+   `max' specifies the maximum number of keys to be fetched.
+   The return value is a list object of the keys of records whose expiration time is not after
+   the current time.  Because the object of the return value is created with the function
+   `tclistnew', it should be deleted with the function `tclistdel' when it is no longer in use.
+   The expiration times are kept in a hierarchical timer wheel of each internal map so that each
+   call costs in proportion to the number of keys and the elapsed seconds.  The records are not
+   removed; remove each of them with `tcmdbxout' or `tcmdbxouthash'. */
+TCLIST *tcmdbxkeys(TCMDB *mdb, int64_t now, int max);
+
+
+/* Remove an expired record of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `now' specifies the current time in seconds since the epoch.
+   If successful, the return value is true, else, it is false.  False is returned when the record
+   does not exist or has not expired, as when it has been stored again since the key was got. */
+bool tcmdbxout(TCMDB *mdb, const void *kbuf, int ksiz, int64_t now);
+
+
+/* Remove an expired record of an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `now' specifies the current time in seconds since the epoch.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   This function is the same as `tcmdbxout' except that the key is not hashed again. */
+bool tcmdbxouthash(TCMDB *mdb, const void *kbuf, int ksiz, int64_t now, uint64_t hash);
+
+
+/* Get the expiration time of a record in an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   The return value is the expiration time in seconds since the epoch, or 0 if the record does
+   not exist or never expires. */
+int64_t tcmdbxtime(TCMDB *mdb, const void *kbuf, int ksiz);
+
+
+/* Get the expiration time of a record in an on-memory hash database with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is the expiration time in seconds since the epoch, or 0 if the record does
+   not exist or never expires.
+   This function is the same as `tcmdbxtime' except that the key is not hashed again. */
+int64_t tcmdbxtimehash(TCMDB *mdb, const void *kbuf, int ksiz, uint64_t hash);
+
+
+/* Get the number of records with expiration times of an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `exnp' specifies the pointer to the variable into which the number of the records removed by
+   `tcmdbxout' is assigned.  If it is `NULL', it is not used.
+   The return value is the number of the records with expiration times. */
+uint64_t tcmdbxnum(TCMDB *mdb, uint64_t *exnp);
+
+
 /* Add an integer to a record in an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -857,10 +1552,23 @@ uint64_t tcmdbmsiz(TCMDB *mdb);
    `num' specifies the additional value.
    The return value is the summation value.
    If the corresponding record exists, the value is treated as an integer and is added to.  If no
-   record corresponds, a new record of the additional value is stored. */
+   record corresponds, a new record of the additional value is stored.  An existing value which
+   is aligned is added to in place by an atomic operation under the read lock of the internal
+   map, so that increments of the same map do not exclude each other. */
 int tcmdbaddint(TCMDB *mdb, const void *kbuf, int ksiz, int num);
 
 
+/* Add an integer to a record in an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is the summation value.
+   This function is the same as `tcmdbaddint' except that the key is not hashed again. */
+int tcmdbaddinthash(TCMDB *mdb, const void *kbuf, int ksiz, int num, uint64_t hash);
+
+
 /* Add a real number to a record in an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
    `kbuf' specifies the pointer to the region of the key.
@@ -868,13 +1576,57 @@ int tcmdbaddint(TCMDB *mdb, const void *kbuf, int ksiz, int num);
    `num' specifies the additional value.
    The return value is the summation value.
    If the corresponding record exists, the value is treated as a real number and is added to.  If
-   no record corresponds, a new record of the additional value is stored. */
+   no record corresponds, a new record of the additional value is stored.  An existing value which
+   is aligned is added to in place by an atomic operation as with `tcmdbaddint'. */
 double tcmdbadddouble(TCMDB *mdb, const void *kbuf, int ksiz, double num);
 
 
+/* Add a real number to a record in an on-memory hash database object with a hash value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is the summation value.
+   This function is the same as `tcmdbadddouble' except that the key is not hashed again. */
+double tcmdbadddoublehash(TCMDB *mdb, const void *kbuf, int ksiz, double num, uint64_t hash);
+
+
+/* Add an integer to a decimal counter of a record in an on-memory hash database object.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.  If it is negative, the counter is decreased but not
+   below 0.  Otherwise, the counter wraps around at 2^64.
+   `np' specifies the pointer to the variable into which the resulting value is assigned.
+   The return value is 1 on success, 0 if no record corresponds, or -1 on failure.
+   The existing value is parsed as a signed decimal number at the first addition, added to, and
+   clamped at 0 before it is replaced with a counter of a native 64-bit integer, which is added
+   to in place by an atomic operation under the read lock of the internal map.  Functions
+   retrieving values render the counter as a decimal string, so only the representation in
+   memory differs.  The expiration time of the record is kept. */
+int tcmdbincr(TCMDB *mdb, const void *kbuf, int ksiz, int64_t num, uint64_t *np);
+
+
+/* Add an integer to a decimal counter of a record in an on-memory hash database with a hash
+   value.
+   `mdb' specifies the on-memory hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `np' specifies the pointer to the variable into which the resulting value is assigned.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is 1 on success, 0 if no record corresponds, or -1 on failure.
+   This function is the same as `tcmdbincr' except that the key is not hashed again. */
+int tcmdbincrhash(TCMDB *mdb, const void *kbuf, int ksiz, int64_t num, uint64_t *np,
+                  uint64_t hash);
+
+
 /* Clear an on-memory hash database object.
    `mdb' specifies the on-memory hash database object.
-   All records are removed. */
+   All records are removed.  Each shard is swapped for empty structures in constant time and the
+   old ones are released by a background thread in rate-limited steps once no reader can be
+   seeing them, so the memory is not returned to the system at once. */
 void tcmdbvanish(TCMDB *mdb);
 
 
@@ -886,6 +1638,335 @@ void tcmdbvanish(TCMDB *mdb);
 void tcmdbiterinit2(TCMDB *mdb, const void *kbuf, int ksiz);
 
 
+/*************************************************************************************************
+ * file hash database
+ *************************************************************************************************/
+
+
+typedef struct {                         /* type of structure for a file hash database */
+  pthread_rwlock_t mmtx;                 /* mutex for method */
+  pthread_rwlock_t *rmtxs;               /* mutexes for records */
+  pthread_mutex_t amtx;                  /* mutex for allocation */
+  pthread_mutex_t imtx;                  /* mutex for iterator */
+  char *path;                            /* path of the database file or `NULL' */
+  int fd;                                /* file descriptor of the database file */
+  char *map;                             /* mapped region of the file */
+  uint64_t msiz;                         /* size of the mapped region */
+  uint64_t bnum;                         /* number of the buckets */
+  uint64_t frec;                         /* offset of the first record */
+  void *fpool;                           /* size classes of free blocks */
+  uint64_t fnum;                         /* number of free blocks */
+  uint64_t fsum;                         /* total size of free blocks */
+  uint64_t ibidx;                        /* bucket index of the iterator */
+  uint64_t ipos;                         /* position in the chain of the iterator */
+  uint64_t xbidx;                        /* bucket index of the sweep of expiration */
+} TCHDB;
+
+
+/* Create a file hash database object.
+   The return value is the new file hash database object.
+   The object can be shared by plural threads because of the internal mutexes. */
+TCHDB *tchdbnew(void);
+
+
+/* Delete a file hash database object.
+   `hdb' specifies the file hash database object.
+   If the database file is open, it is closed implicitly. */
+void tchdbdel(TCHDB *hdb);
+
+
+/* Open a database file and connect a file hash database object.
+   `hdb' specifies the file hash database object.
+   `path' specifies the path of the database file.  If it does not exist, it is created.
+   `bnum' specifies the number of the buckets of a new file.  If it is 0, the default value is
+   specified.  The default value is 1048573.  It is ignored for an existing file.
+   If successful, the return value is true, else, it is false.
+   The file is mapped into memory and locked so that no other process opens it at the same time.
+   If the file was not closed normally, the free blocks are reconstructed by walking the chains
+   of the buckets, and the regions not linked from any bucket are reused. */
+bool tchdbopen(TCHDB *hdb, const char *path, uint64_t bnum);
+
+
+/* Close a file hash database object.
+   `hdb' specifies the file hash database object.
+   If successful, the return value is true, else, it is false.
+   The free blocks are written into the file and the file is synchronized with the device. */
+bool tchdbclose(TCHDB *hdb);
+
+
+/* Synchronize updated contents of a file hash database object with the device.
+   `hdb' specifies the file hash database object.
+   If successful, the return value is true, else, it is false. */
+bool tchdbsync(TCHDB *hdb);
+
+
+/* Store a record into a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.  If it is not more than 0,
+   the record never expires.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   If a record with the same key exists in the database, it is overwritten.  A new record is
+   written into a free region before it is linked in place of the old one by a single store of
+   eight bytes, so that a crash of the process leaves either the old record or the new one. */
+bool tchdbput(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+              int64_t xtime, uint64_t hash);
+
+
+/* Store a new record into a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `xtime' specifies the expiration time in seconds since the epoch.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   If a record with the same key exists in the database and has not expired, this function has no
+   effect. */
+bool tchdbputkeep(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                  int64_t xtime, uint64_t hash);
+
+
+/* Concatenate a value at the end of the existing record in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value.
+   `vsiz' specifies the size of the region of the value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.
+   If there is no corresponding record, a new record is created.  The expiration time of an
+   existing record is kept. */
+bool tchdbputcat(TCHDB *hdb, const void *kbuf, int ksiz, const void *vbuf, int vsiz,
+                 uint64_t hash);
+
+
+/* Remove a record of a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false. */
+bool tchdbout(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash);
+
+
+/* Retrieve a record in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is the pointer to the region of the value of the
+   corresponding record.  `NULL' is returned when no record corresponds.
+   Because an additional zero code is appended at the end of the region of the return value,
+   the return value can be treated as a character string.  Because the region of the return
+   value is allocated with the `malloc' call, it should be released with the `free' call when
+   it is no longer in use. */
+void *tchdbget(TCHDB *hdb, const void *kbuf, int ksiz, int *sp, uint64_t hash);
+
+
+/* Get the size of the value of a record in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is the size of the value of the corresponding record, else,
+   it is -1. */
+int tchdbvsiz(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash);
+
+
+/* Visit the value of a record in a file hash database object without copying it.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `proc' specifies the pointer to the visitor function.  It receives the pointer to the region
+   of the value in the mapped file, its size, and `op'.  It must not call functions of the
+   database object.
+   `op' specifies an arbitrary pointer to be given to the visitor function.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.  False is returned when no record
+   corresponds. */
+bool tchdbvisit(TCHDB *hdb, const void *kbuf, int ksiz, TCVISITPROC proc, void *op,
+                uint64_t hash);
+
+
+/* Initialize the iterator of a file hash database object.
+   `hdb' specifies the file hash database object. */
+void tchdbiterinit(TCHDB *hdb);
+
+
+/* Initialize the iterator of a file hash database object in front of a key.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If there is no record corresponding the condition, the iterator is not modified. */
+void tchdbiterinit2(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash);
+
+
+/* Get the next key of the iterator of a file hash database object.
+   `hdb' specifies the file hash database object.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   If successful, the return value is the pointer to the region of the next key, else, it is
+   `NULL'.  `NULL' is returned when no record can be fetched from the iterator.
+   Because the region of the return value is allocated with the `malloc' call, it should be
+   released with the `free' call when it is no longer in use.  The order of iteration is the
+   order of the buckets. */
+void *tchdbiternext(TCHDB *hdb, int *sp);
+
+
+/* Get forward matching keys in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `pbuf' specifies the pointer to the region of the prefix.
+   `psiz' specifies the size of the region of the prefix.
+   `max' specifies the maximum number of keys to be fetched.  If it is negative, no limit is
+   specified.
+   The return value is a list object of the corresponding keys.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use.  Note that this function
+   may be very slow because every key in the database is scanned. */
+TCLIST *tchdbfwmkeys(TCHDB *hdb, const void *pbuf, int psiz, int max);
+
+
+/* Get keys of ranged records in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `bkbuf' specifies the pointer to the region of the key of the beginning border.  If it is
+   `NULL', the first record is specified.
+   `bksiz' specifies the size of the region of the beginning key.
+   `ekbuf' specifies the pointer to the region of the key of the ending border.  If it is
+   `NULL', the last record is specified.
+   `eksiz' specifies the size of the region of the ending key.
+   `max' specifies the maximum number of records to be fetched.  If it is negative, no limit is
+   specified.
+   `vals' specifies whether the values are fetched as well as the keys.
+   The return value is a list object of the keys in ascending lexical order, each of which is
+   followed by its value if `vals' is true.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use.  Note that this function
+   may be very slow because every key in the database is scanned and sorted. */
+TCLIST *tchdbrange(TCHDB *hdb, const void *bkbuf, int bksiz, const void *ekbuf, int eksiz,
+                   int max, bool vals);
+
+
+/* Scan records of a file hash database object with a cursor.
+   `hdb' specifies the file hash database object.
+   `cp' specifies the pointer to the variable of the cursor.  It should be 0 at the beginning of
+   a scan.  The cursor to resume the scan is assigned into it, which is 0 at the end.
+   `max' specifies the maximum number of records to be fetched.  If it is negative, no limit is
+   specified.
+   `vals' specifies whether the values are fetched as well as the keys.
+   The return value is a list object of the keys of the fetched records.  If `vals' is true,
+   each key is followed by its value.  Fewer records than the maximum may be fetched before the
+   end of the scan.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use.  The cursor is a bucket
+   index and a position in its chain. */
+TCLIST *tchdbscan(TCHDB *hdb, uint64_t *cp, int max, bool vals);
+
+
+/* Get the keys of expired records of a file hash database object.
+   `hdb' specifies the file hash database object.
+   `now' specifies the current time in seconds since the epoch.
+   `max' specifies the maximum number of keys to be fetched.
+   The return value is a list object of the keys of records whose expiration time is not after
+   the current time.  Because the object of the return value is created with the function
+   `tclistnew', it should be deleted with the function `tclistdel' when it is no longer in use.
+   Each call sweeps a bounded number of buckets from where the previous call stopped. */
+TCLIST *tchdbxkeys(TCHDB *hdb, int64_t now, int max);
+
+
+/* Remove an expired record of a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `now' specifies the current time in seconds since the epoch.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is true, else, it is false.  False is returned when the record
+   does not exist or has not expired. */
+bool tchdbxout(TCHDB *hdb, const void *kbuf, int ksiz, int64_t now, uint64_t hash);
+
+
+/* Get the expiration time of a record in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is the expiration time in seconds since the epoch, or 0 if the record does
+   not exist or never expires. */
+int64_t tchdbxtime(TCHDB *hdb, const void *kbuf, int ksiz, uint64_t hash);
+
+
+/* Get the number of records with expiration times of a file hash database object.
+   `hdb' specifies the file hash database object.
+   The return value is the number of the records with expiration times. */
+uint64_t tchdbxnum(TCHDB *hdb);
+
+
+/* Add an integer to a record in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is the summation value, else, it is `INT_MIN'.
+   The value of an existing record is added to in place. */
+int tchdbaddint(TCHDB *hdb, const void *kbuf, int ksiz, int num, uint64_t hash);
+
+
+/* Add a real number to a record in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   If successful, the return value is the summation value, else, it is Not-a-Number.
+   The value of an existing record is added to in place. */
+double tchdbadddouble(TCHDB *hdb, const void *kbuf, int ksiz, double num, uint64_t hash);
+
+
+/* Add an integer to a decimal counter of a record in a file hash database object.
+   `hdb' specifies the file hash database object.
+   `kbuf' specifies the pointer to the region of the key.
+   `ksiz' specifies the size of the region of the key.
+   `num' specifies the additional value.  If it is negative, the counter is decreased but not
+   below 0.
+   `np' specifies the pointer to the variable into which the resulting value is assigned.
+   `hash' specifies the hash value of the key calculated with `tcmdbhash'.
+   The return value is 1 on success, 0 if no record corresponds, or -1 on failure.
+   The counter is stored as a decimal string and the expiration time of the record is kept. */
+int tchdbincr(TCHDB *hdb, const void *kbuf, int ksiz, int64_t num, uint64_t *np,
+              uint64_t hash);
+
+
+/* Clear a file hash database object.
+   `hdb' specifies the file hash database object.
+   If successful, the return value is true, else, it is false.
+   All records are removed and the file is truncated. */
+bool tchdbvanish(TCHDB *hdb);
+
+
+/* Get the number of records stored in a file hash database object.
+   `hdb' specifies the file hash database object.
+   The return value is the number of the records. */
+uint64_t tchdbrnum(TCHDB *hdb);
+
+
+/* Get the size of the database file of a file hash database object.
+   `hdb' specifies the file hash database object.
+   `fsp' specifies the pointer to the variable into which the total size of the free blocks is
+   assigned.  If it is `NULL', it is not used.
+   The return value is the size of the database file. */
+uint64_t tchdbfsiz(TCHDB *hdb, uint64_t *fsp);
+
+
+
 /*************************************************************************************************
  * miscellaneous utilities
  *************************************************************************************************/
@@ -905,6 +1986,15 @@ long tclmax(long a, long b);
 long tclmin(long a, long b);
 
 
+/* Get the 64-bit hash value of a region.
+   `buf' specifies the pointer to the region.
+   `size' specifies the size of the region.
+   The return value is the hash value of the region.
+   The region is read by eight bytes at a time.  The value is not portable between platforms of
+   different byte order, so it should not be stored persistently. */
+uint64_t tchash64(const void *buf, int size);
+
+
 /* Compare two strings with case insensitive evaluation.
    `astr' specifies a string.
    `bstr' specifies of the other string.
@@ -1223,6 +2313,40 @@ char *tchexdecode(const char *str, int *sp);
 void tcwwwformdecode2(const void *ptr, int size, const char *type, TCMAP *params);
 
 
+/* Compress a serial object with the built-in LZ encoding.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region.
+   `sp' specifies the pointer to a variable into which the size of the region of the return
+   value is assigned.
+   The return value is the pointer to the result object.
+   The result begins with the size of the original data in variable length format, followed by
+   sequences of literals and back references within 64KB.  It is a little larger than the
+   original if the data is not compressible.  Because the region of the return value is
+   allocated with the `malloc' call, it should be released with the `free' call when it is no
+   longer in use. */
+char *tclzencode(const char *ptr, int size, int *sp);
+
+
+/* Decompress a serial object compressed with the built-in LZ encoding.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region.
+   `sp' specifies the pointer to a variable into which the size of the region of the return
+   value is assigned.
+   If successful, the return value is the pointer to the result object, else, it is `NULL'.
+   `NULL' is returned if the region is broken.  Because an additional zero code is appended at
+   the end of the region of the return value, the return value can be treated as a character
+   string.  Because the region of the return value is allocated with the `malloc' call, it
+   should be released with the `free' call when it is no longer in use. */
+char *tclzdecode(const char *ptr, int size, int *sp);
+
+
+/* Get the size of the original data of a region compressed with the built-in LZ encoding.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region.
+   The return value is the size of the original data or -1 if the region is broken. */
+int tclzsize(const char *ptr, int size);
+
+
 /* Show error message on the standard error output and exit.
    `message' specifies an error message.
    This function does not return. */
@@ -1242,6 +2366,36 @@ void *tczeromap(uint64_t size);
 void tczerounmap(void *ptr);
 
 
+enum {                                   /* enumeration for options of memory placement */
+  TCMPTHP = 1 << 0,                      /* advise transparent huge pages */
+  TCMPHUGETLB = 1 << 1,                  /* use huge pages of the pool */
+  TCMPINTER = 1 << 2,                    /* interleave pages over NUMA nodes */
+  TCMPLOCAL = 1 << 3                     /* place each shard on a NUMA node */
+};
+
+
+/* Set the options of memory placement of large regions.
+   `opts' specifies options by bitwise-or: `TCMPTHP' advises transparent huge pages, `TCMPHUGETLB'
+   maps huge pages of the pool and falls back to ordinary pages when the pool is exhausted,
+   `TCMPINTER' interleaves pages over all NUMA nodes, and `TCMPLOCAL' makes each shard of
+   on-memory hash databases prefer one NUMA node in round-robin order.
+   The options apply to regions allocated by `tczeromap', the bucket arrays of large maps, and
+   the pages of the slab allocators of on-memory hash databases.  With huge pages, the pages of
+   the slab allocators are enlarged to the size of a huge page.
+   This function should be called before any object is created. */
+void tcsetmemplace(int opts);
+
+
+/* Get the options of memory placement of large regions.
+   The return value is the options set by `tcsetmemplace'. */
+int tcmemplace(void);
+
+
+/* Get the number of NUMA nodes of the system.
+   The return value is the number of NUMA nodes, which is 1 on systems without NUMA. */
+int tcnumanodes(void);
+
+
 /* Convert an integer to the string as binary numbers.
    `num' specifies the integer.
    `buf' specifies the pointer to the region into which the result string is written.  The size
@@ -1264,6 +2418,46 @@ typedef union { int32_t i; int64_t l; double d; void *p; TCFUNCPOINTER_FOO f; }
 #define TCALIGNPAD(TC_a) (((TC_a + TCALIGNBYTES - 1) & (~(TCALIGNBYTES - 1))) - TC_a)
 #endif
 
+/* Set a buffer for a variable length number. */
+#define TCSETVNUMBUF(TC_len, TC_buf, TC_num)                            \
+  do {                                                                  \
+    int _TC_num = (TC_num);                                             \
+    if(_TC_num == 0){                                                   \
+      ((signed char *)(TC_buf))[0] = 0;                                 \
+      (TC_len) = 1;                                                     \
+    } else {                                                            \
+      (TC_len) = 0;                                                     \
+      while(_TC_num > 0){                                               \
+        int _TC_rem = _TC_num & 0x7f;                                   \
+        _TC_num >>= 7;                                                  \
+        if(_TC_num > 0){                                                \
+          ((signed char *)(TC_buf))[(TC_len)] = -_TC_rem - 1;           \
+        } else {                                                        \
+          ((signed char *)(TC_buf))[(TC_len)] = _TC_rem;                \
+        }                                                               \
+        (TC_len)++;                                                     \
+      }                                                                 \
+    }                                                                   \
+  } while(false)
+
+/* Read a variable length buffer. */
+#define TCREADVNUMBUF(TC_buf, TC_num, TC_step)                          \
+  do {                                                                  \
+    TC_num = 0;                                                         \
+    int _TC_base = 1;                                                   \
+    int _TC_i = 0;                                                      \
+    while(true){                                                        \
+      if(((signed char *)(TC_buf))[_TC_i] >= 0){                        \
+        TC_num += ((signed char *)(TC_buf))[_TC_i] * _TC_base;          \
+        break;                                                          \
+      }                                                                 \
+      TC_num += _TC_base * (((signed char *)(TC_buf))[_TC_i] + 1) * -1; \
+      _TC_base <<= 7;                                                   \
+      _TC_i++;                                                          \
+    }                                                                   \
+    (TC_step) = _TC_i + 1;                                              \
+  } while(false)
+
 
 __UTIL_CLINKAGEEND
 #endif                                   /* duplication check */